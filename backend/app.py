@@ -23,13 +23,31 @@ from dotenv import load_dotenv
 from vision_provider import analyze_video, generate_tts, get_provider_name
 from network_info import get_local_ip, get_connection_url
 
-# Path to the latest IMU swing data written by server.py
-_IMU_LATEST = Path(__file__).resolve().parent.parent / "swing_data" / "latest_swing.json"
+# IMU swing data written by server.py: the current session file, or the
+# per-swing JSON that older servers wrote
+_REPO_ROOT = Path(__file__).resolve().parent.parent
+_IMU_DIR = _REPO_ROOT / "swing_data"
+_IMU_LATEST = _IMU_DIR / "latest_swing.json"
+_imu_session = None
 
 
 def _load_latest_imu() -> dict | None:
     """Load the most recent IMU swing result, or None if unavailable."""
+    global _imu_session
     try:
+        if (_IMU_DIR / "latest_session").is_file():
+            import sys
+            if str(_REPO_ROOT) not in sys.path:
+                sys.path.append(str(_REPO_ROOT))
+            from session_store import open_latest_session
+
+            # The mapping is kept between requests; only reopen when the
+            # server has started a new session
+            name = (_IMU_DIR / "latest_session").read_text(encoding="utf-8").strip()
+            if _imu_session is None or Path(_imu_session.base_path).name != name:
+                _imu_session = open_latest_session(str(_IMU_DIR))
+            if _imu_session is not None:
+                return _imu_session.latest_result()
         if _IMU_LATEST.is_file():
             import json as _json
             return _json.loads(_IMU_LATEST.read_text(encoding="utf-8"))
@@ -30,6 +30,9 @@ Return the result in JSON format with these fields:
 def format_imu_data(imu_result: dict) -> str:
     """Format an IMU swing analysis result dict into a text block for the VLM prompt."""
     lines = []
+    stroke = imu_result.get("stroke")
+    if stroke and stroke.get("label") != "unknown":
+        lines.append(f"- Stroke (racquet classifier): {stroke['label']} ({stroke['confidence'] * 100:.0f}% confidence)")
     phases = imu_result.get("phases")
     if phases:
         p = phases
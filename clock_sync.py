@@ -0,0 +1,77 @@
+"""
+Racquet monotonic clock -> wall clock mapping for the live stream.
+
+Live samples are stamped with the racquet's esp_timer (microseconds since
+boot), which is steady but drifts against real time by tens of ppm. About
+once a second the racquet sends a sync packet with one (mono_us, wall_us)
+pair; a least-squares line through the recent pairs gives both the offset
+and the drift, so samples between syncs land on the wall clock too.
+
+When SNTP steps the racquet's wall clock, a new pair falls far off the
+line; the fit then starts over from that pair instead of bending towards it.
+
+Usage:
+    clock = ClockSync()
+    clock.on_sync(pkt["mono_us"], pkt["wall_us"])
+    t_ms = clock.wall_ms(sample["t_us"])
+"""
+
+from collections import deque
+
+SYNC_WINDOW = 32            # pairs in the fit, ~30 s at one per second
+STEP_RESET_US = 20_000      # a pair this far off the fit means the wall clock stepped
+
+
+class ClockSync:
+    """Drift-corrected fit of wall time against racquet monotonic time."""
+
+    def __init__(self, window=SYNC_WINDOW):
+        self.points = deque(maxlen=window)
+        self.steps = 0              # wall clock steps seen (fit restarted)
+        self._offset = None         # wall_us - mono_us at _ref_mono
+        self._drift = 0.0           # d(wall - mono) / d(mono)
+        self._ref_mono = 0
+
+    @property
+    def synced(self):
+        return self._offset is not None
+
+    def on_sync(self, mono_us, wall_us):
+        """Add one clock pair from a sync packet."""
+        if self.synced and abs(self.wall_us(mono_us) - wall_us) > STEP_RESET_US:
+            self.points.clear()
+            self.steps += 1
+        if self.points and mono_us <= self.points[-1][0]:
+            self.points.clear()     # racquet rebooted
+        self.points.append((mono_us, wall_us - mono_us))
+        self._fit()
+
+    def _fit(self):
+        n = len(self.points)
+        ref = self.points[-1][0]
+        xs = [m - ref for m, _ in self.points]
+        ys = [off for _, off in self.points]
+        mean_x = sum(xs) / n
+        mean_y = sum(ys) / n
+        sxx = sum((x - mean_x) ** 2 for x in xs)
+        drift = 0.0
+        if n >= 2 and sxx > 0:
+            drift = sum((x - mean_x) * (y - mean_y) for x, y in zip(xs, ys)) / sxx
+        self._ref_mono = ref
+        self._drift = drift
+        self._offset = mean_y - drift * mean_x
+
+    def wall_us(self, mono_us):
+        """Wall-clock microseconds for a racquet timestamp, or None before any sync."""
+        if not self.synced:
+            return None
+        return mono_us + self._offset + self._drift * (mono_us - self._ref_mono)
+
+    def wall_ms(self, mono_us):
+        """wall_us() in milliseconds, falling back to monotonic ms unsynced."""
+        wall = self.wall_us(mono_us)
+        return (mono_us if wall is None else wall) / 1000.0
+
+    @property
+    def drift_ppm(self):
+        return self._drift * 1e6
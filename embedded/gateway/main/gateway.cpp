@@ -0,0 +1,190 @@
+/*
+ * ESP-NOW gateway: a radio modem between the racquets and the laptop.
+ *
+ * Every ESP-NOW frame heard on GATEWAY_CHANNEL goes out on the USB serial
+ * port as one SLIP packet (sender MAC + frame), and every SLIP packet the
+ * laptop writes (destination MAC + frame, FF:FF:FF:FF:FF:FF to broadcast)
+ * is sent on air. The gateway does not look inside the frames: HELLO,
+ * TIME, reassembly and the hand-off to the ingest server are all done by
+ * espnow_bridge.py. Framing is in ../../main/espnow_link.h.
+ *
+ * UART0 carries the packets, so the console is silenced.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "esp_event.h"
+#include "nvs_flash.h"
+#include "driver/uart.h"
+#include "../../main/espnow_link.h"
+
+// ===== Configuration (edit these) =====
+#define GATEWAY_CHANNEL         1           // ESPNOW_CHANNEL in the racquet's main.cpp
+// =======================================
+
+#define GATEWAY_UART            UART_NUM_0
+#define UART_BUF_SIZE           4096
+#define RX_QUEUE_LEN            32          // radio frames waiting for the UART
+#define SEND_TIMEOUT_MS         50
+#define MAC_LEN                 6
+#define PACKET_MAX              (MAC_LEN + ESPNOW_LINK_MTU)
+
+typedef struct {
+    uint16_t len;
+    uint8_t data[PACKET_MAX];   // sender MAC + frame
+} radio_packet_t;
+
+static QueueHandle_t rx_queue = NULL;
+static SemaphoreHandle_t send_done = NULL;
+
+// --- Radio ---
+
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (len <= 0 || len > ESPNOW_LINK_MTU) return;
+    radio_packet_t pkt;
+    memcpy(pkt.data, info->src_addr, MAC_LEN);
+    memcpy(pkt.data + MAC_LEN, data, len);
+    pkt.len = (uint16_t)(MAC_LEN + len);
+    xQueueSend(rx_queue, &pkt, 0);     // serial backed up: drop, like the air would
+}
+
+static void espnow_send_cb(const uint8_t *mac, esp_now_send_status_t status)
+{
+    xSemaphoreGive(send_done);
+}
+
+static void radio_send(const uint8_t *mac, const uint8_t *frame, size_t len)
+{
+    if (!esp_now_is_peer_exist(mac)) {
+        esp_now_peer_info_t peer = {};
+        memcpy(peer.peer_addr, mac, MAC_LEN);
+        peer.channel = GATEWAY_CHANNEL;
+        peer.ifidx = WIFI_IF_STA;
+        if (esp_now_add_peer(&peer) != ESP_OK) return;
+    }
+    xSemaphoreTake(send_done, 0);
+    if (esp_now_send(mac, frame, len) == ESP_OK) {
+        xSemaphoreTake(send_done, pdMS_TO_TICKS(SEND_TIMEOUT_MS));
+    }
+}
+
+static void radio_init(void)
+{
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
+    ESP_ERROR_CHECK(esp_wifi_set_channel(GATEWAY_CHANNEL, WIFI_SECOND_CHAN_NONE));
+    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
+    ESP_ERROR_CHECK(esp_now_register_send_cb(espnow_send_cb));
+}
+
+// --- Serial (SLIP) ---
+
+static void slip_write(const uint8_t *data, size_t len)
+{
+    uint8_t out[2 * PACKET_MAX + 2];
+    size_t n = 0;
+    out[n++] = SLIP_END;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == SLIP_END) {
+            out[n++] = SLIP_ESC;
+            out[n++] = SLIP_ESC_END;
+        } else if (data[i] == SLIP_ESC) {
+            out[n++] = SLIP_ESC;
+            out[n++] = SLIP_ESC_ESC;
+        } else {
+            out[n++] = data[i];
+        }
+    }
+    out[n++] = SLIP_END;
+    uart_write_bytes(GATEWAY_UART, out, n);
+}
+
+// Radio -> laptop
+static void uart_tx_task(void *pvParameters)
+{
+    radio_packet_t pkt;
+    while (1) {
+        if (xQueueReceive(rx_queue, &pkt, portMAX_DELAY) == pdTRUE) {
+            slip_write(pkt.data, pkt.len);
+        }
+    }
+}
+
+// Laptop -> radio
+static void uart_rx_task(void *pvParameters)
+{
+    uint8_t buf[256];
+    uint8_t pkt[PACKET_MAX];
+    size_t len = 0;
+    bool esc = false;
+    bool overflow = false;
+    while (1) {
+        int n = uart_read_bytes(GATEWAY_UART, buf, sizeof(buf), pdMS_TO_TICKS(20));
+        for (int i = 0; i < n; i++) {
+            uint8_t b = buf[i];
+            if (b == SLIP_END) {
+                if (!overflow && len > MAC_LEN) radio_send(pkt, pkt + MAC_LEN, len - MAC_LEN);
+                len = 0;
+                esc = false;
+                overflow = false;
+                continue;
+            }
+            if (esc) {
+                b = b == SLIP_ESC_END ? SLIP_END : b == SLIP_ESC_ESC ? SLIP_ESC : b;
+                esc = false;
+            } else if (b == SLIP_ESC) {
+                esc = true;
+                continue;
+            }
+            if (len < sizeof(pkt)) {
+                pkt[len++] = b;
+            } else {
+                overflow = true;
+            }
+        }
+    }
+}
+
+// --- Main ---
+
+extern "C" void app_main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    uart_config_t uart_cfg = {};
+    uart_cfg.baud_rate = ESPNOW_LINK_BAUD;
+    uart_cfg.data_bits = UART_DATA_8_BITS;
+    uart_cfg.parity = UART_PARITY_DISABLE;
+    uart_cfg.stop_bits = UART_STOP_BITS_1;
+    uart_cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uart_cfg.source_clk = UART_SCLK_DEFAULT;
+    ESP_ERROR_CHECK(uart_driver_install(GATEWAY_UART, UART_BUF_SIZE, UART_BUF_SIZE, 0, NULL, 0));
+    ESP_ERROR_CHECK(uart_param_config(GATEWAY_UART, &uart_cfg));
+
+    rx_queue = xQueueCreate(RX_QUEUE_LEN, sizeof(radio_packet_t));
+    send_done = xSemaphoreCreateBinary();
+    radio_init();
+
+    xTaskCreate(uart_tx_task, "uart_tx", 4096, NULL, 6, NULL);
+    xTaskCreate(uart_rx_task, "uart_rx", 4096, NULL, 5, NULL);
+}
@@ -0,0 +1,816 @@
+/*
+ * Host benchmarks for the firmware data path.
+ *
+ * Each benchmark replays a whole session (session.h) through one stage the
+ * way the firmware drives it: sensor_task pushes every sample through the
+ * trigger and both rings, an event is a 200-sample window serialized
+ * through the 1436-byte HTTP staging buffer, live batches are 50ms of
+ * samples built whole for one datagram. Besides time per iteration every
+ * benchmark reports time/sample and, for the encoders, bytes/sample.
+ *
+ *   bench_datapath [--benchmark_filter=...] [session.json ...]
+ *
+ * With no session arguments the two recordings in the repo root are used.
+ * Exits non-zero if a session fails to load or a stage reports an error, so
+ * a ctest run doubles as a smoke test.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "arena.h"
+#include "byte_sink.h"
+#include "capture_ring.h"
+#include "event_trigger.h"
+#include "json_format.h"
+#include "live_decimator.h"
+#include "packet_queue.h"
+#include "phase_tracker.h"
+#include "profile.h"
+#include "sample_ring.h"
+#include "sample_view.h"
+#include "session.h"
+#include "shtp.h"
+#include "spool.h"
+#include "stroke_classifier.h"
+#include "swing_phase.h"
+#include "wire_format.h"
+
+// Mirrors of main.cpp's configuration
+#define EVENT_SAMPLES           200         // default capture window
+#define HTTP_BODY_CHUNK         1436
+#define LIVE_PAYLOAD_MAX        8192
+#define LIVE_DATAGRAM_MAX       1400
+#define LIVE_BATCH_SAMPLES      20          // 50ms at 400Hz
+#define CAPTURE_RING_SIZE       1024
+#define LIVE_RING_SIZE          256
+#define LIVE_DECIMATION         2           // 400Hz sensor -> 200Hz live
+#define LIVE_QUEUE_SLOTS        8
+#define SHTP_CARGO_LEN          37          // base timestamp + gyro + accel + game RV, one INT
+#define TRIGGER_GYRO_ON         8.0f
+#define TRIGGER_ENERGY_ON       5.0f
+#define TRIGGER_ENERGY_OFF      2.0f
+#define TRIGGER_ACCEL_ON        30.0f
+#define TRIGGER_JERK_ON         2000.0f
+#define EVENT_DEBOUNCE_US       1000000
+#define SPOOL_BATCH_MAX         (64 * 1024)
+#define SPOOL_BENCH_SECTORS     96          // RAM stand-in for the spool partition
+
+// Synthetic racquet taps for the trigger benchmark: an accel spike with
+// hardly any rotation, dropped into quiet stretches of the session
+#define TAP_EVERY_SAMPLES       200
+#define TAP_ACCEL_MS2           60.0f
+#define TAP_GYRO_RAD_S          1.0f
+#define TAP_LEN_SAMPLES         2
+
+static bool bench_failed = false;
+
+// --- Fixtures ---
+
+typedef struct {
+    session_t session;
+    sample_block_t block;           // whole session, per channel
+    std::vector<uint8_t> block_mem;
+    int num_windows;                // whole EVENT_SAMPLES windows in the session
+} fixture_t;
+
+static void fixture_init(fixture_t *fx)
+{
+    size_t n = fx->session.samples.size();
+    fx->block_mem.assign(n * SAMPLE_BLOCK_BYTES_PER_SAMPLE + 64, 0);
+    arena_t arena;
+    arena_init(&arena, "bench", fx->block_mem.data(), fx->block_mem.size());
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) fx->block.axis[a] = arena_alloc_array<float>(&arena, n);
+    fx->block.timestamp_us = arena_alloc_array<int64_t>(&arena, n);
+    fx->block.seq = arena_alloc_array<uint32_t>(&arena, n);
+
+    for (size_t i = 0; i < n; i++) {
+        const sensor_sample_t *s = &fx->session.samples[i];
+        fx->block.axis[SAMPLE_GYRO_X][i] = s->gyro_x;
+        fx->block.axis[SAMPLE_GYRO_Y][i] = s->gyro_y;
+        fx->block.axis[SAMPLE_GYRO_Z][i] = s->gyro_z;
+        fx->block.axis[SAMPLE_ACCEL_X][i] = s->accel_x;
+        fx->block.axis[SAMPLE_ACCEL_Y][i] = s->accel_y;
+        fx->block.axis[SAMPLE_ACCEL_Z][i] = s->accel_z;
+        fx->block.timestamp_us[i] = s->timestamp_us;
+        fx->block.seq[i] = s->seq;
+    }
+    fx->num_windows = (int)(n / EVENT_SAMPLES);
+}
+
+static void fail(benchmark::State &state, const char *what)
+{
+    bench_failed = true;
+    state.SkipWithError(what);
+}
+
+static void report(benchmark::State &state, double samples, double bytes)
+{
+    state.SetItemsProcessed((int64_t)(state.iterations() * samples));
+    state.counters["time/sample"] = benchmark::Counter(
+        samples, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    if (bytes > 0) state.counters["bytes/sample"] = bytes / samples;
+}
+
+// HTTP body stand-in: the staging buffer is flushed to nowhere
+static bool discard_flush(void *ctx, const uint8_t *data, size_t len)
+{
+    (void)ctx;
+    (void)len;
+    benchmark::DoNotOptimize(data);
+    return true;
+}
+
+// --- Event serialization ---
+
+static void bench_event_encode(benchmark::State &state, const fixture_t *fx, bool json,
+                               wire_encoding_t enc)
+{
+    static uint8_t staging[HTTP_BODY_CHUNK];
+    size_t bytes = 0;
+    for (auto _ : state) {
+        bytes = 0;
+        for (int w = 0; w < fx->num_windows; w++) {
+            sample_block_t win = sample_block_offset(&fx->block, (size_t)w * EVENT_SAMPLES);
+            sample_view_t view = sample_view_of_block(&win);
+            byte_sink_t sink;
+            byte_sink_init(&sink, staging, sizeof(staging), discard_flush, NULL);
+            int64_t trigger_t = win.timestamp_us[EVENT_SAMPLES / 2];
+            bool ok = json ? json_write_payload(&sink, "event", &view, EVENT_SAMPLES,
+                                                trigger_t, 0, NULL)
+                           : wire_write_packet(&sink, WIRE_PKT_EVENT, enc, SESSION_RATE_HZ,
+                                               &view, EVENT_SAMPLES, trigger_t, 0, NULL);
+            if (!ok || !byte_sink_flush(&sink)) return fail(state, "event encode failed");
+            bytes += sink.total;
+        }
+    }
+    report(state, (double)fx->num_windows * EVENT_SAMPLES, (double)bytes);
+}
+
+// --- Live serialization ---
+
+static void bench_live_encode(benchmark::State &state, const fixture_t *fx, bool json)
+{
+    static uint8_t datagram[LIVE_PAYLOAD_MAX];
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    int n = (int)samples.size();
+    size_t bytes = 0;
+    for (auto _ : state) {
+        bytes = 0;
+        for (int first = 0; first < n;) {
+            int count = n - first < LIVE_BATCH_SAMPLES ? n - first : LIVE_BATCH_SAMPLES;
+            sample_view_t view = sample_view_of_records(&samples[first]);
+            int used = count;
+            int len;
+            if (json) {
+                byte_sink_t sink;
+                byte_sink_init(&sink, datagram, sizeof(datagram), NULL, NULL);
+                len = json_write_payload(&sink, "live", &view, count, 0, 0, NULL)
+                          ? (int)sink.len : -1;
+            } else {
+                len = wire_build_live_delta(SESSION_RATE_HZ, &view, count, datagram,
+                                            LIVE_DATAGRAM_MAX, &used);
+            }
+            if (len <= 0 || used <= 0) return fail(state, "live encode failed");
+            benchmark::DoNotOptimize(datagram);
+            bytes += (size_t)len;
+            first += used;
+        }
+    }
+    report(state, (double)n, (double)bytes);
+}
+
+// --- IMU reports ---
+
+// SH-2 reports as the hub sends them: one cargo per INT with the sample's
+// gyro, accel and game rotation vector in Q-point
+static void put_i16(uint8_t *p, float v, float scale)
+{
+    long q = lroundf(v * scale);
+    if (q > 32767) q = 32767;
+    if (q < -32768) q = -32768;
+    p[0] = (uint8_t)q;
+    p[1] = (uint8_t)(q >> 8);
+}
+
+static void put_report(uint8_t *r, uint8_t id, uint8_t seq)
+{
+    r[0] = id;
+    r[1] = seq;
+    r[2] = 3;                       // accuracy high, no delay
+    r[3] = 0;
+}
+
+static void build_cargo(const sensor_sample_t *s, uint8_t seq, uint8_t *c)
+{
+    memset(c, 0, SHTP_CARGO_LEN);
+    c[0] = SH2_BASE_TIMESTAMP;      // base at the INT
+
+    uint8_t *r = c + 5;
+    put_report(r, SH2_GYROSCOPE_CALIBRATED, seq);
+    put_i16(r + 4, s->gyro_x, 512.0f);
+    put_i16(r + 6, s->gyro_y, 512.0f);
+    put_i16(r + 8, s->gyro_z, 512.0f);
+
+    r += 10;
+    put_report(r, SH2_ACCELEROMETER, seq);
+    put_i16(r + 4, s->accel_x, 256.0f);
+    put_i16(r + 6, s->accel_y, 256.0f);
+    put_i16(r + 8, s->accel_z, 256.0f);
+
+    // Euler (degrees) back to the quaternion the hub would have sent
+    r += 10;
+    put_report(r, SH2_GAME_ROTATION_VECTOR, seq);
+    float h = (float)M_PI / 360.0f;
+    float cr = cosf(s->euler_x * h), sr = sinf(s->euler_x * h);
+    float cp = cosf(s->euler_y * h), sp = sinf(s->euler_y * h);
+    float cy = cosf(s->euler_z * h), sy = sinf(s->euler_z * h);
+    put_i16(r + 4, sr * cp * cy - cr * sp * sy, 16384.0f);
+    put_i16(r + 6, cr * sp * cy + sr * cp * sy, 16384.0f);
+    put_i16(r + 8, cr * cp * sy - sr * sp * cy, 16384.0f);
+    put_i16(r + 10, cr * cp * cy + sr * sp * sy, 16384.0f);
+}
+
+// Q-point decode of every INT's cargo straight into the working sample,
+// as sensor_task does with IMU_DRIVER_SHTP
+static void bench_imu_decode(benchmark::State &state, const fixture_t *fx)
+{
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    std::vector<uint8_t> cargos(samples.size() * SHTP_CARGO_LEN);
+    for (size_t i = 0; i < samples.size(); i++) {
+        build_cargo(&samples[i], (uint8_t)i, cargos.data() + i * SHTP_CARGO_LEN);
+    }
+
+    shtp_parser_t parser;
+    shtp_parser_init(&parser);
+    sensor_sample_t s = {};
+    size_t decoded = 0;
+    for (auto _ : state) {
+        decoded = 0;
+        for (size_t i = 0; i < samples.size(); i++) {
+            shtp_parser_begin(&parser, cargos.data() + i * SHTP_CARGO_LEN, SHTP_CARGO_LEN,
+                              samples[i].timestamp_us);
+            while (shtp_parser_next(&parser, &s)) {
+                benchmark::DoNotOptimize(s);
+                decoded++;
+            }
+        }
+    }
+    if (decoded != samples.size() || parser.unknown != 0) {
+        return fail(state, "SHTP parser lost samples");
+    }
+    const sensor_sample_t *last = &samples.back();
+    if (s.timestamp_us != last->timestamp_us || fabsf(s.gyro_x - last->gyro_x) > 0.01f ||
+        fabsf(s.accel_z - last->accel_z) > 0.01f) {
+        return fail(state, "SHTP decode mismatch");
+    }
+    report(state, (double)samples.size(), (double)cargos.size());
+}
+
+// --- Rings ---
+
+static void bench_capture_push(benchmark::State &state, const fixture_t *fx)
+{
+    static std::vector<uint8_t> mem(CAPTURE_RING_SIZE * SAMPLE_BLOCK_BYTES_PER_SAMPLE + 64);
+    arena_t arena;
+    arena_init(&arena, "capture", mem.data(), mem.size());
+    sample_block_t store;
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) {
+        store.axis[a] = arena_alloc_array<float>(&arena, CAPTURE_RING_SIZE);
+    }
+    store.timestamp_us = arena_alloc_array<int64_t>(&arena, CAPTURE_RING_SIZE);
+    store.seq = arena_alloc_array<uint32_t>(&arena, CAPTURE_RING_SIZE);
+    capture_ring_t ring;
+    capture_ring_init(&ring, &store, CAPTURE_RING_SIZE);
+
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    for (auto _ : state) {
+        for (const sensor_sample_t &s : samples) capture_ring_push(&ring, &s);
+        benchmark::ClobberMemory();
+    }
+    report(state, (double)samples.size(), 0);
+}
+
+static void bench_capture_copy_recent(benchmark::State &state, const fixture_t *fx)
+{
+    static std::vector<uint8_t> mem((CAPTURE_RING_SIZE + EVENT_SAMPLES) *
+                                    SAMPLE_BLOCK_BYTES_PER_SAMPLE + 128);
+    arena_t arena;
+    arena_init(&arena, "capture", mem.data(), mem.size());
+    sample_block_t store, dest;
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) {
+        store.axis[a] = arena_alloc_array<float>(&arena, CAPTURE_RING_SIZE);
+        dest.axis[a] = arena_alloc_array<float>(&arena, EVENT_SAMPLES);
+    }
+    store.timestamp_us = arena_alloc_array<int64_t>(&arena, CAPTURE_RING_SIZE);
+    store.seq = arena_alloc_array<uint32_t>(&arena, CAPTURE_RING_SIZE);
+    dest.timestamp_us = arena_alloc_array<int64_t>(&arena, EVENT_SAMPLES);
+    dest.seq = arena_alloc_array<uint32_t>(&arena, EVENT_SAMPLES);
+    capture_ring_t ring;
+    capture_ring_init(&ring, &store, CAPTURE_RING_SIZE);
+    // Replay the session so the ring has wrapped the way it does in use
+    for (const sensor_sample_t &s : fx->session.samples) capture_ring_push(&ring, &s);
+
+    for (auto _ : state) {
+        for (int w = 0; w < fx->num_windows; w++) {
+            if (capture_ring_copy_recent(&ring, &dest, EVENT_SAMPLES) != EVENT_SAMPLES) {
+                return fail(state, "capture ring short");
+            }
+            benchmark::ClobberMemory();
+        }
+    }
+    report(state, (double)fx->num_windows * EVENT_SAMPLES, 0);
+}
+
+// Producer and consumer on one thread: push every sample, drain a live
+// batch every LIVE_BATCH_SAMPLES
+static void bench_live_ring(benchmark::State &state, const fixture_t *fx)
+{
+    static sensor_sample_t slots[LIVE_RING_SIZE];
+    sample_ring_t ring;
+    sample_ring_init(&ring, slots, LIVE_RING_SIZE);
+    sample_ring_reader_t reader = {};
+
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    for (auto _ : state) {
+        int pending = 0;
+        for (const sensor_sample_t &s : samples) {
+            sample_ring_push(&ring, &s);
+            if (++pending < LIVE_BATCH_SAMPLES) continue;
+            const sensor_sample_t *span = NULL;
+            uint32_t got;
+            while ((got = sample_ring_peek(&ring, &reader, LIVE_BATCH_SAMPLES, &span)) > 0) {
+                benchmark::DoNotOptimize(span);
+                sample_ring_consume(&reader, got);
+            }
+            pending = 0;
+        }
+    }
+    if (reader.dropped != 0) return fail(state, "live ring overrun");
+    report(state, (double)samples.size(), 0);
+}
+
+// Encode stage and send stage on two threads, as encode_task and
+// udp_live_task: live datagrams go through the slot queue in order and
+// whole, and a full queue holds the encoder back instead of losing any
+static void bench_live_queue(benchmark::State &state, const fixture_t *fx)
+{
+    static packet_slot_t slots[LIVE_QUEUE_SLOTS];
+    static uint8_t storage[LIVE_QUEUE_SLOTS * LIVE_DATAGRAM_MAX];
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    int n = (int)samples.size();
+    uint32_t full = 0, packets = 0;
+    for (auto _ : state) {
+        packet_queue_t q;
+        packet_queue_init(&q, slots, LIVE_QUEUE_SLOTS, storage, LIVE_DATAGRAM_MAX);
+        std::thread encoder([&] {
+            for (int first = 0; first < n;) {
+                packet_slot_t *out = packet_queue_acquire(&q);
+                if (out == NULL) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                int count = n - first < LIVE_BATCH_SAMPLES ? n - first : LIVE_BATCH_SAMPLES;
+                sample_view_t view = sample_view_of_records(&samples[first]);
+                int used = 0;
+                int len = wire_build_live_delta(SESSION_RATE_HZ, &view, count, out->data,
+                                                q.slot_size, &used);
+                if (len <= 0) used = count;     // the sender sees the gap
+                out->len = len > 0 ? (uint32_t)len : 0;
+                out->first_seq = (uint32_t)first;
+                out->count = (uint32_t)used;
+                packet_queue_publish(&q, 0);
+                first += used;
+            }
+        });
+        uint32_t next = 0;
+        bool ok = true;
+        while (next < (uint32_t)n) {
+            packet_slot_t *pkt = packet_queue_peek(&q);
+            if (pkt == NULL) {
+                std::this_thread::yield();
+                continue;
+            }
+            const wire_header_t *hdr = (const wire_header_t *)pkt->data;
+            ok = ok && pkt->first_seq == next && pkt->len >= sizeof(wire_header_t) &&
+                 hdr->magic == WIRE_MAGIC && hdr->count == pkt->count;
+            benchmark::DoNotOptimize(pkt->data);
+            next += pkt->count;
+            packet_queue_pop(&q);
+        }
+        encoder.join();
+        if (!ok) return fail(state, "live queue reordered or tore a datagram");
+        full = q.full.load();
+        packets = q.published.load();
+    }
+    state.counters["full/packet"] = packets > 0 ? (double)full / packets : 0;
+    report(state, (double)n, 0);
+}
+
+// Amplitude (from the RMS, as the outputs need not land on the crests) of
+// gyro_x out of the decimator for a unit sine on gyro_x at `freq` cycles
+// per input sample, once the history has filled
+static float decimated_tone_amplitude(int factor, double freq)
+{
+    static live_decimator_t dec;
+    live_decimator_init(&dec, factor);
+    double sum_sq = 0.0;
+    int outputs = 0, measured = 0;
+    for (int i = 0; i < 40 * dec.taps; i++) {
+        sensor_sample_t s = {};
+        s.gyro_x = (float)sin(2.0 * M_PI * freq * i);
+        s.seq = (uint32_t)i;
+        sensor_sample_t out;
+        if (live_decimator_push(&dec, &s, &out) && ++outputs > dec.taps) {
+            sum_sq += (double)out.gyro_x * out.gyro_x;
+            measured++;
+        }
+    }
+    return (float)sqrt(2.0 * sum_sq / measured);
+}
+
+// An in-band tone keeps its amplitude and one just above the live Nyquist,
+// which would fold back to 0.8 of it, is stopped
+static bool live_decimator_response_ok(int factor, char *why, size_t why_len)
+{
+    double nyquist = 0.5 / factor;
+    float pass = decimated_tone_amplitude(factor, 0.5 * nyquist);
+    float stop = decimated_tone_amplitude(factor, 1.2 * nyquist);
+    float pass_db = 20.0f * log10f(pass);
+    float stop_db = 20.0f * log10f(fmaxf(stop, 1e-9f));
+    if (fabsf(pass_db) > 0.1f || stop_db > -40.0f) {
+        snprintf(why, why_len, "live decimator response /%d: %.2f dB in band, %.1f dB aliased",
+                 factor, pass_db, stop_db);
+        return false;
+    }
+    return true;
+}
+
+// Anti-aliasing FIR on every sample, one live sample out per
+// LIVE_DECIMATION in
+static void bench_live_decimate(benchmark::State &state, const fixture_t *fx)
+{
+    static char why[96];
+    for (int factor : {LIVE_DECIMATION, 5, LIVE_FIR_MAX_FACTOR}) {
+        if (!live_decimator_response_ok(factor, why, sizeof(why))) return fail(state, why);
+    }
+
+    static live_decimator_t dec;
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    size_t out_count = 0;
+    for (auto _ : state) {
+        live_decimator_init(&dec, LIVE_DECIMATION);
+        out_count = 0;
+        sensor_sample_t out;
+        for (const sensor_sample_t &s : samples) {
+            if (live_decimator_push(&dec, &s, &out)) {
+                benchmark::DoNotOptimize(out);
+                out_count++;
+            }
+        }
+    }
+    size_t expected = (samples.size() - (size_t)(dec.taps - 1)) / LIVE_DECIMATION;
+    if (out_count + 1 < expected) return fail(state, "live decimator dropped samples");
+    report(state, (double)samples.size(), 0);
+}
+
+// --- Flash spool ---
+
+// NOR flash in RAM: writes can only clear bits, erases set a sector back
+// to all ones
+static bool nor_read(void *ctx, uint32_t addr, void *buf, size_t len)
+{
+    memcpy(buf, (const uint8_t *)ctx + addr, len);
+    return true;
+}
+
+static bool nor_write(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+    uint8_t *dst = (uint8_t *)ctx + addr;
+    const uint8_t *src = (const uint8_t *)buf;
+    for (size_t i = 0; i < len; i++) dst[i] &= src[i];
+    return true;
+}
+
+static bool nor_erase(void *ctx, uint32_t addr)
+{
+    memset((uint8_t *)ctx + addr, 0xFF, SPOOL_SECTOR_SIZE);
+    return true;
+}
+
+static bool vector_flush(void *ctx, const uint8_t *data, size_t len)
+{
+    std::vector<uint8_t> *out = (std::vector<uint8_t> *)ctx;
+    out->insert(out->end(), data, data + len);
+    return true;
+}
+
+// Samples in a backlog body, or -1 if a record is damaged
+static int backlog_samples(const std::vector<uint8_t> &body, uint32_t records)
+{
+    size_t pos = 0;
+    int samples = 0;
+    for (uint32_t i = 0; i < records; i++) {
+        wire_spool_record_t rec;
+        wire_header_t hdr;
+        if (pos + sizeof(rec) + sizeof(hdr) > body.size()) return -1;
+        memcpy(&rec, body.data() + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (pos + rec.len > body.size()) return -1;
+        if (spool_crc32(0, body.data() + pos, rec.len) != rec.crc32) return -1;
+        memcpy(&hdr, body.data() + pos, sizeof(hdr));
+        if (hdr.magic != WIRE_MAGIC) return -1;
+        samples += hdr.count;
+        pos += rec.len;
+    }
+    return pos == body.size() ? samples : -1;
+}
+
+// A whole session spooled offline the way http_event_task does it (delta
+// records one staging buffer long, a reboot halfway), then uploaded in
+// backlog batches; every sample must come back out, once
+static void bench_spool(benchmark::State &state, const fixture_t *fx)
+{
+    static std::vector<uint8_t> flash_mem((size_t)SPOOL_BENCH_SECTORS * SPOOL_SECTOR_SIZE);
+    static uint8_t staging[HTTP_BODY_CHUNK];
+    spool_flash_t flash = { nor_read, nor_write, nor_erase, flash_mem.data(),
+                            (uint32_t)flash_mem.size() };
+    if (spool_crc32(0, "123456789", 9) != 0xCBF43926) return fail(state, "spool crc32 is not zlib's");
+
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    int n = (int)samples.size();
+    std::vector<uint8_t> body;
+    spool_t sp;
+    int uploaded = 0;
+    uint64_t spooled_bytes = 0;
+    for (auto _ : state) {
+        memset(flash_mem.data(), 0xFF, flash_mem.size());
+        if (!spool_init(&sp, &flash, 1)) return fail(state, "spool init failed");
+        for (int i = 0; i < n;) {
+            if (i >= n / 2 && sp.boot_id == 1 && !spool_init(&sp, &flash, 2)) {
+                return fail(state, "spool rescan failed");
+            }
+            sample_view_t view = sample_view_of_records(&samples[i]);
+            int used = 0;
+            int len = wire_build_live_delta(SESSION_RATE_HZ, &view, n - i, staging,
+                                            sizeof(staging), &used);
+            if (len <= 0 || !spool_append(&sp, staging, (size_t)len)) {
+                return fail(state, "spool append failed");
+            }
+            i += used;
+        }
+        spooled_bytes = spool_pending_bytes(&sp);
+
+        uploaded = 0;
+        spool_batch_t batch;
+        while (spool_batch_plan(&sp, SPOOL_BATCH_MAX, &batch)) {
+            body.clear();
+            byte_sink_t sink;
+            byte_sink_init(&sink, staging, sizeof(staging), vector_flush, &body);
+            if (!spool_batch_read(&sp, &batch, &sink) || !byte_sink_flush(&sink)) {
+                return fail(state, "spool read failed");
+            }
+            int got = backlog_samples(body, batch.records);
+            if (got < 0 || body.size() != batch.bytes) return fail(state, "backlog record damaged");
+            uploaded += got;
+            spool_batch_done(&sp, &batch);
+        }
+    }
+    if (sp.dropped_sectors != 0 || sp.skipped_records != 0) return fail(state, "spool lost records");
+    if (uploaded != n) return fail(state, "backlog does not hold every sample once");
+    report(state, (double)n, (double)spooled_bytes);
+}
+
+// --- Trigger and analysis ---
+
+static const event_trigger_config_t trigger_cfg = {
+    TRIGGER_GYRO_ON, TRIGGER_ENERGY_ON, TRIGGER_ENERGY_OFF,
+    TRIGGER_ACCEL_ON, TRIGGER_JERK_ON, EVENT_DEBOUNCE_US,
+};
+
+static int count_events(const std::vector<sensor_sample_t> &samples)
+{
+    event_trigger_t trigger;
+    event_trigger_init(&trigger, &trigger_cfg);
+    int events = 0;
+    for (const sensor_sample_t &s : samples) {
+        event_trigger_signals_t sig;
+        if (event_trigger_check(&trigger, &s, &sig)) events++;
+        benchmark::DoNotOptimize(sig);
+    }
+    return events;
+}
+
+// What the old |accel|-only threshold would have fired on
+static int count_accel_only(const std::vector<sensor_sample_t> &samples)
+{
+    int events = 0;
+    int64_t last = INT64_MIN / 2;
+    for (const sensor_sample_t &s : samples) {
+        if (s.timestamp_us - last > EVENT_DEBOUNCE_US &&
+            dsp_norm3(s.accel_x, s.accel_y, s.accel_z) > TRIGGER_ACCEL_ON) {
+            last = s.timestamp_us;
+            events++;
+        }
+    }
+    return events;
+}
+
+static std::vector<sensor_sample_t> with_taps(const std::vector<sensor_sample_t> &samples)
+{
+    std::vector<sensor_sample_t> out = samples;
+    for (size_t i = TAP_EVERY_SAMPLES; i + TAP_LEN_SAMPLES < out.size(); i += TAP_EVERY_SAMPLES) {
+        if (dsp_norm3(out[i].gyro_x, out[i].gyro_y, out[i].gyro_z) > TAP_GYRO_RAD_S) continue;
+        for (size_t k = i; k < i + TAP_LEN_SAMPLES; k++) {
+            out[k].accel_x += TAP_ACCEL_MS2;
+            out[k].gyro_y += TAP_GYRO_RAD_S;
+        }
+    }
+    return out;
+}
+
+// Detector over the session; fails if injected taps add events
+static void bench_event_trigger(benchmark::State &state, const fixture_t *fx)
+{
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    int events = 0;
+    for (auto _ : state) {
+        events = count_events(samples);
+    }
+    std::vector<sensor_sample_t> tapped = with_taps(samples);
+    int tapped_events = count_events(tapped);
+    state.counters["events"] = events;
+    state.counters["events_tapped"] = tapped_events;
+    state.counters["accel_only_tapped"] = count_accel_only(tapped);
+    if (events == 0) return fail(state, "trigger missed every swing");
+    if (tapped_events != events) return fail(state, "taps triggered events");
+    report(state, (double)samples.size(), 0);
+}
+
+static void bench_swing_phase(benchmark::State &state, const fixture_t *fx)
+{
+    static std::vector<uint8_t> mem(swing_analyzer_mem_size(EVENT_SAMPLES) + 64);
+    arena_t arena;
+    arena_init(&arena, "swing", mem.data(), mem.size());
+    swing_analyzer_t an;
+    if (!swing_analyzer_init(&an, &arena, EVENT_SAMPLES, SESSION_RATE_HZ)) {
+        return fail(state, "analyzer init failed");
+    }
+
+    int valid = 0;
+    for (auto _ : state) {
+        valid = 0;
+        for (int w = 0; w < fx->num_windows; w++) {
+            sample_block_t win = sample_block_offset(&fx->block, (size_t)w * EVENT_SAMPLES);
+            swing_phase_t phase;
+            swing_phase_analyze(&an, &win, EVENT_SAMPLES, &phase);
+            if (phase.valid) valid++;
+            benchmark::DoNotOptimize(phase);
+        }
+    }
+    state.counters["swings"] = valid;
+    report(state, (double)fx->num_windows * EVENT_SAMPLES, 0);
+}
+
+// Causal phase marks over the whole session, every sample, as sensor_task
+// runs it; each swing must come out as accel start, peak, decel end
+static void bench_phase_track(benchmark::State &state, const fixture_t *fx)
+{
+    const std::vector<sensor_sample_t> &samples = fx->session.samples;
+    phase_tracker_t tr;
+    int marks[4] = {};
+    bool in_order = true;
+    for (auto _ : state) {
+        phase_tracker_init(&tr, SESSION_RATE_HZ);
+        memset(marks, 0, sizeof(marks));
+        in_order = true;
+        uint8_t expect = PHASE_MARK_ACCEL_START;
+        for (const sensor_sample_t &s : samples) {
+            phase_mark_t mark;
+            if (!phase_tracker_update(&tr, &s, &mark)) continue;
+            if (mark.kind != expect || mark.t_us > mark.detected_us) in_order = false;
+            expect = mark.kind == PHASE_MARK_DECEL_END ? PHASE_MARK_ACCEL_START : mark.kind + 1;
+            marks[mark.kind]++;
+        }
+    }
+    state.counters["swings"] = marks[PHASE_MARK_PEAK];
+    if (marks[PHASE_MARK_ACCEL_START] == 0) return fail(state, "phase tracker saw no swing");
+    if (!in_order) return fail(state, "phase marks out of order");
+    report(state, (double)samples.size(), 0);
+}
+
+// Features + classifier over every window the analyzer found a swing in
+static void bench_stroke(benchmark::State &state, const fixture_t *fx)
+{
+    static std::vector<uint8_t> mem(swing_analyzer_mem_size(EVENT_SAMPLES) + 64);
+    arena_t arena;
+    arena_init(&arena, "stroke", mem.data(), mem.size());
+    swing_analyzer_t an;
+    if (!swing_analyzer_init(&an, &arena, EVENT_SAMPLES, SESSION_RATE_HZ)) {
+        return fail(state, "analyzer init failed");
+    }
+    std::vector<swing_phase_t> phases(fx->num_windows);
+    for (int w = 0; w < fx->num_windows; w++) {
+        sample_block_t win = sample_block_offset(&fx->block, (size_t)w * EVENT_SAMPLES);
+        swing_phase_analyze(&an, &win, EVENT_SAMPLES, &phases[w]);
+    }
+
+    int labelled = 0;
+    for (auto _ : state) {
+        labelled = 0;
+        for (int w = 0; w < fx->num_windows; w++) {
+            sample_block_t win = sample_block_offset(&fx->block, (size_t)w * EVENT_SAMPLES);
+            stroke_result_t stroke;
+            stroke_classify(&win, &phases[w], &stroke);
+            if (stroke.label != STROKE_UNKNOWN) labelled++;
+            benchmark::DoNotOptimize(stroke);
+        }
+    }
+    state.counters["labelled"] = labelled;
+    report(state, (double)fx->num_windows * EVENT_SAMPLES, 0);
+}
+
+// --- Instrumentation ---
+
+// Cost of one PROF_START / PROF_END pair, paid several times per sample
+static void bench_profile(benchmark::State &state, const fixture_t *fx)
+{
+    profile_init(1000);
+    size_t n = fx->session.samples.size();
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; i++) {
+            PROF_START(t0);
+            PROF_END(PROF_CAPTURE_PUSH, t0);
+        }
+    }
+    prof_summary_t summary[PROF_NUM_STAGES];
+    profile_snapshot(summary);
+    if (summary[PROF_CAPTURE_PUSH].count == 0) return fail(state, "profile recorded nothing");
+    report(state, (double)n, 0);
+}
+
+// --- Main ---
+
+static void register_session(const fixture_t *fx)
+{
+    const std::string &n = fx->session.name;
+    benchmark::RegisterBenchmark(("event_json/" + n).c_str(), bench_event_encode, fx, true,
+                                 WIRE_ENC_F32);
+    benchmark::RegisterBenchmark(("event_f32/" + n).c_str(), bench_event_encode, fx, false,
+                                 WIRE_ENC_F32);
+    benchmark::RegisterBenchmark(("event_q16/" + n).c_str(), bench_event_encode, fx, false,
+                                 WIRE_ENC_Q16);
+    benchmark::RegisterBenchmark(("live_json/" + n).c_str(), bench_live_encode, fx, true);
+    benchmark::RegisterBenchmark(("live_delta/" + n).c_str(), bench_live_encode, fx, false);
+    benchmark::RegisterBenchmark(("imu_decode/" + n).c_str(), bench_imu_decode, fx);
+    benchmark::RegisterBenchmark(("capture_push/" + n).c_str(), bench_capture_push, fx);
+    benchmark::RegisterBenchmark(("capture_copy_recent/" + n).c_str(),
+                                 bench_capture_copy_recent, fx);
+    benchmark::RegisterBenchmark(("live_ring/" + n).c_str(), bench_live_ring, fx);
+    benchmark::RegisterBenchmark(("live_decimate/" + n).c_str(), bench_live_decimate, fx);
+    benchmark::RegisterBenchmark(("live_queue/" + n).c_str(), bench_live_queue, fx)
+        ->UseRealTime();     // the encoding happens on the other thread
+    benchmark::RegisterBenchmark(("spool/" + n).c_str(), bench_spool, fx);
+    benchmark::RegisterBenchmark(("event_trigger/" + n).c_str(), bench_event_trigger, fx);
+    benchmark::RegisterBenchmark(("swing_phase/" + n).c_str(), bench_swing_phase, fx);
+    benchmark::RegisterBenchmark(("phase_track/" + n).c_str(), bench_phase_track, fx);
+    benchmark::RegisterBenchmark(("stroke/" + n).c_str(), bench_stroke, fx);
+#if PROFILE_ENABLED
+    benchmark::RegisterBenchmark(("profile_record/" + n).c_str(), bench_profile, fx);
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    std::vector<std::string> paths(argv + 1, argv + argc);
+    if (paths.empty()) {
+        paths.push_back(RECORDINGS_DIR "/metrics_federer.json");
+        paths.push_back(RECORDINGS_DIR "/metrics_dj.json");
+    }
+
+    std::vector<fixture_t> fixtures(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!session_load_metrics(paths[i], &fixtures[i].session)) return 1;
+        fixture_init(&fixtures[i]);
+        if (fixtures[i].num_windows == 0) {
+            printf("Session %s: shorter than one event\n", paths[i].c_str());
+            return 1;
+        }
+        printf("Session %s: %zu samples at %d Hz\n", fixtures[i].session.name.c_str(),
+               fixtures[i].session.samples.size(), SESSION_RATE_HZ);
+        register_session(&fixtures[i]);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return bench_failed ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Recorded session loader. See session.h.
+ */
+
+#include "session.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Minimal JSON extraction ---
+
+// The metrics files are flat objects of numbers and number arrays, so a
+// key search plus strtod is all the parsing they need.
+static const char *find_value(const std::string &text, const char *key)
+{
+    std::string quoted = std::string("\"") + key + "\"";
+    size_t pos = text.find(quoted);
+    if (pos == std::string::npos) return NULL;
+    pos = text.find(':', pos + quoted.size());
+    if (pos == std::string::npos) return NULL;
+    const char *p = text.c_str() + pos + 1;
+    while (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') p++;
+    return p;
+}
+
+static bool read_number(const std::string &text, const char *key, double *out)
+{
+    const char *p = find_value(text, key);
+    if (p == NULL) return false;
+    char *end;
+    *out = strtod(p, &end);
+    return end != p;
+}
+
+static bool read_array(const std::string &text, const char *key, std::vector<double> *out)
+{
+    const char *p = find_value(text, key);
+    if (p == NULL || *p != '[') return false;
+    p++;
+    out->clear();
+    while (*p != '\0' && *p != ']') {
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p) {
+            if (strncmp(p, "null", 4) != 0) return false;
+            v = out->empty() ? 0.0 : out->back();   // hold the last value
+            end = (char *)p + 4;
+        }
+        out->push_back(v);
+        p = end;
+        while (*p == ',' || *p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') p++;
+    }
+    return *p == ']';
+}
+
+// --- Synthesis ---
+
+// Linear interpolation of series x (sampled at fps) at time t
+static double lerp_at(const std::vector<double> &x, double fps, double t)
+{
+    double pos = t * fps;
+    size_t i = (size_t)pos;
+    if (i + 1 >= x.size()) return x.back();
+    double frac = pos - (double)i;
+    return x[i] + (x[i + 1] - x[i]) * frac;
+}
+
+static float clamp_accel(double a)
+{
+    if (a > SESSION_ACCEL_RANGE) return SESSION_ACCEL_RANGE;
+    if (a < -SESSION_ACCEL_RANGE) return -SESSION_ACCEL_RANGE;
+    return (float)a;
+}
+
+bool session_load_metrics(const std::string &path, session_t *out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        printf("Session %s: cannot open\n", path.c_str());
+        return false;
+    }
+    std::string text;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) text.append(chunk, n);
+    fclose(f);
+
+    double fps = 0.0;
+    std::vector<double> wrist, x_factor, elbow, knee;
+    if (!read_number(text, "fps", &fps) || fps <= 0.0 ||
+        !read_array(text, "wrist_speed", &wrist) || !read_array(text, "x_factor", &x_factor) ||
+        !read_array(text, "elbow_angle", &elbow) || !read_array(text, "knee_angle", &knee) ||
+        wrist.size() < 2 || x_factor.size() != wrist.size() ||
+        elbow.size() != wrist.size() || knee.size() != wrist.size()) {
+        printf("Session %s: not a metrics file\n", path.c_str());
+        return false;
+    }
+
+    size_t slash = path.find_last_of('/');
+    out->name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    size_t dot = out->name.rfind(".json");
+    if (dot != std::string::npos) out->name.erase(dot);
+
+    const double dt = 1.0 / SESSION_RATE_HZ;
+    const double duration = (double)(wrist.size() - 1) / fps;
+    const double deg = M_PI / 180.0;
+    size_t count = (size_t)(duration * SESSION_RATE_HZ);
+    out->samples.assign(count, sensor_sample_t{});
+
+    for (size_t i = 0; i < count; i++) {
+        double t = (double)i * dt;
+        double t_next = t + dt;
+        double v = lerp_at(wrist, fps, t);
+        sensor_sample_t *s = &out->samples[i];
+        s->euler_x = (float)lerp_at(x_factor, fps, t);
+        s->euler_y = (float)lerp_at(elbow, fps, t);
+        s->euler_z = (float)lerp_at(knee, fps, t);
+        s->gyro_x = (float)((lerp_at(x_factor, fps, t_next) - s->euler_x) * deg / dt);
+        s->gyro_y = (float)((lerp_at(elbow, fps, t_next) - s->euler_y) * deg / dt);
+        s->gyro_z = (float)(v / SESSION_LEVER_M);
+        s->accel_x = clamp_accel((lerp_at(wrist, fps, t_next) - v) / dt);
+        s->accel_y = clamp_accel(v * v / SESSION_LEVER_M);
+        s->accel_z = 9.81f;
+        s->timestamp_us = (int64_t)i * 1000000 / SESSION_RATE_HZ;
+        s->seq = (uint32_t)i;
+    }
+    return true;
+}
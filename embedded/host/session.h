@@ -0,0 +1,37 @@
+/*
+ * Recorded sessions for the host benchmarks.
+ *
+ * The recordings in the repo root (metrics_federer.json, metrics_dj.json)
+ * are pose metrics extracted from video at 30-60 fps, not IMU captures. A
+ * session is synthesized from one by resampling it to the sensor's 400Hz
+ * and mapping the kinematics onto what the racquet would have measured:
+ *
+ *   gyro z      wrist speed / lever arm (swing rotation)
+ *   gyro x, y   rate of change of x-factor and elbow angle
+ *   accel x     tangential, d(wrist speed)/dt
+ *   accel y     centripetal, wrist speed^2 / lever arm
+ *   accel z     gravity
+ *   euler       x-factor, elbow and knee angle
+ *
+ * Accel is clamped to the BNO08x's +-8g range. The result has the swing
+ * shape and magnitudes the trigger and analyzer are tuned for, which is
+ * what a data path benchmark needs.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "sensor_sample.h"
+
+#define SESSION_RATE_HZ         400
+#define SESSION_LEVER_M         0.6f        // shoulder to racquet sweet spot
+#define SESSION_ACCEL_RANGE     78.45f      // 8g, m/s^2
+
+typedef struct {
+    std::string name;
+    std::vector<sensor_sample_t> samples;
+} session_t;
+
+// Load a metrics JSON file and synthesize its 400Hz session
+bool session_load_metrics(const std::string &path, session_t *out);
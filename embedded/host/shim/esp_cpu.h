@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for ESP-IDF's esp_cpu.h: the "cycle" counter is a
+ * nanosecond clock, so profile_init(1000) gives the right time scale.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
@@ -0,0 +1,70 @@
+/*
+ * Motion activity tracker for power save.
+ *
+ * A racquet on the bench reads |gyro| near zero and |accel| near 1 g.
+ * Any sample away from that is motion; after idle_after_us without any,
+ * the tracker switches to ACTIVITY_IDLE, and the first motion sample
+ * switches it back. sensor_task runs it on every sample and, on a change,
+ * drops or restores the IMU report rates, while the network tasks read the
+ * mode to pause live streaming and put the radio in modem sleep.
+ *
+ * Waking is decided on the same gyro/accel reports the trigger uses (at
+ * the idle report rate), so a swing starts at full rate from its
+ * backswing. O(1) per sample, inline and allocation-free; no ESP-IDF
+ * dependencies, so it also builds on the host.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include "dsp_kernels.h"
+#include "sensor_sample.h"
+
+#define ACTIVITY_GYRO_RAD_S         0.5f    // motion: |gyro| above this ...
+#define ACTIVITY_ACCEL_DEV_MS2      1.5f    // ... or |accel| this far from 1 g
+#define ACTIVITY_GRAVITY_MS2        9.81f
+
+typedef enum : uint8_t {
+    ACTIVITY_ACTIVE,
+    ACTIVITY_IDLE,
+} activity_mode_t;
+
+typedef struct {
+    int64_t idle_after_us;          // no motion this long: idle
+    int64_t last_motion_us;
+    activity_mode_t mode;
+} activity_t;
+
+static inline void activity_init(activity_t *act, int64_t idle_after_us, int64_t now_us)
+{
+    act->idle_after_us = idle_after_us;
+    act->last_motion_us = now_us;
+    act->mode = ACTIVITY_ACTIVE;
+}
+
+static inline bool activity_is_motion(const sensor_sample_t *s)
+{
+    float g = dsp_norm3(s->gyro_x, s->gyro_y, s->gyro_z);
+    float a = dsp_norm3(s->accel_x, s->accel_y, s->accel_z);
+    return g > ACTIVITY_GYRO_RAD_S || fabsf(a - ACTIVITY_GRAVITY_MS2) > ACTIVITY_ACCEL_DEV_MS2;
+}
+
+// Feed one sample. Returns true if the mode changed; read act->mode.
+static inline bool activity_update(activity_t *act, const sensor_sample_t *s)
+{
+    int64_t now = s->timestamp_us;
+    if (activity_is_motion(s)) {
+        act->last_motion_us = now;
+        if (act->mode == ACTIVITY_IDLE) {
+            act->mode = ACTIVITY_ACTIVE;
+            return true;
+        }
+        return false;
+    }
+    if (act->mode == ACTIVITY_ACTIVE && now - act->last_motion_us >= act->idle_after_us) {
+        act->mode = ACTIVITY_IDLE;
+        return true;
+    }
+    return false;
+}
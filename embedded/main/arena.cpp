@@ -0,0 +1,41 @@
+/*
+ * Boot-time bump allocator. See arena.h.
+ */
+
+#include "arena.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void arena_init(arena_t *arena, const char *name, void *mem, size_t size)
+{
+    arena->name = name;
+    arena->base = (uint8_t *)mem;
+    arena->size = (mem != NULL) ? size : 0;
+    arena->used = 0;
+    arena->sealed = false;
+}
+
+void *arena_alloc(arena_t *arena, size_t size, size_t align)
+{
+    if (arena->sealed) {
+        printf("ARENA %s: allocation of %u bytes after seal\n", arena->name, (unsigned)size);
+        return NULL;
+    }
+    uintptr_t start = ((uintptr_t)arena->base + arena->used + (align - 1)) & ~(uintptr_t)(align - 1);
+    size_t offset = start - (uintptr_t)arena->base;
+    if (offset + size > arena->size) {
+        printf("ARENA %s: out of space (%u used, %u requested, %u total)\n", arena->name,
+               (unsigned)arena->used, (unsigned)size, (unsigned)arena->size);
+        return NULL;
+    }
+    arena->used = offset + size;
+    void *p = arena->base + offset;
+    memset(p, 0, size);
+    return p;
+}
+
+void arena_seal(arena_t *arena)
+{
+    arena->sealed = true;
+}
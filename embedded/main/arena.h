@@ -0,0 +1,36 @@
+/*
+ * Boot-time bump allocator for the firmware's long-lived buffers.
+ *
+ * app_main reserves one block (in PSRAM when available) and carves every
+ * runtime buffer out of it before the tasks start, then seals the arena.
+ * Nothing is freed, so the heap never fragments under these buffers and a
+ * long session cannot run out of memory for them.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    bool sealed;
+} arena_t;
+
+void arena_init(arena_t *arena, const char *name, void *mem, size_t size);
+
+// Aligned block of `size` bytes, or NULL if the arena is full or sealed.
+void *arena_alloc(arena_t *arena, size_t size, size_t align);
+
+// Typed, zeroed array of `count` elements.
+template <typename T>
+static inline T *arena_alloc_array(arena_t *arena, size_t count)
+{
+    return (T *)arena_alloc(arena, sizeof(T) * count, alignof(T));
+}
+
+// Refuse any further allocation (call once boot is done).
+void arena_seal(arena_t *arena);
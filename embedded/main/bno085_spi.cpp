@@ -0,0 +1,176 @@
+/*
+ * BNO085 SPI + DMA driver. See bno085_spi.h.
+ */
+
+#include "bno085_spi.h"
+#include "shtp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#define BNO085_SPI_MODE             3       // CPOL 1, CPHA 1
+#define BNO085_RESET_PULSE_MS       10
+#define BNO085_BOOT_TIMEOUT_MS      1000    // reset to the first INT (advertisement)
+#define BNO085_INT_POLL_MS          10
+
+static bno085_spi_config_t cfg;
+static spi_device_handle_t dev = NULL;
+
+// Receive pool, read round-robin; tx_buf is all zeros except while a
+// command is going out
+static uint8_t *rx_pool[BNO085_RX_BUFFERS];
+static shtp_packet_t rx_packets[BNO085_RX_BUFFERS];
+static int rx_next = 0;
+static uint8_t *tx_buf = NULL;
+
+// Commands waiting for a read, oldest at tx_first
+static uint8_t tx_queue[BNO085_TX_QUEUE_LEN][SHTP_SET_FEATURE_LEN];
+static int tx_first = 0;
+static int tx_count = 0;
+static uint8_t control_seq = 0;
+
+bool bno085_spi_init(const bno085_spi_config_t *config)
+{
+    cfg = *config;
+
+    gpio_config_t rst = {};
+    rst.pin_bit_mask = 1ULL << cfg.io_rst;
+    rst.mode = GPIO_MODE_OUTPUT;
+    gpio_config(&rst);
+    gpio_set_level(cfg.io_rst, 0);
+
+    gpio_config_t intn = {};
+    intn.pin_bit_mask = 1ULL << cfg.io_int;
+    intn.mode = GPIO_MODE_INPUT;
+    intn.pull_up_en = GPIO_PULLUP_ENABLE;
+    intn.intr_type = GPIO_INTR_NEGEDGE;
+    gpio_config(&intn);
+
+    for (int i = 0; i < BNO085_RX_BUFFERS; i++) {
+        rx_pool[i] = (uint8_t *)heap_caps_malloc(BNO085_RX_BUFFER_SIZE, MALLOC_CAP_DMA);
+        if (rx_pool[i] == NULL) return false;
+    }
+    tx_buf = (uint8_t *)heap_caps_calloc(1, BNO085_RX_BUFFER_SIZE, MALLOC_CAP_DMA);
+    if (tx_buf == NULL) return false;
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = cfg.io_mosi;
+    bus.miso_io_num = cfg.io_miso;
+    bus.sclk_io_num = cfg.io_sclk;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = BNO085_RX_BUFFER_SIZE;
+    if (spi_bus_initialize(cfg.host, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+        printf("BNO085: SPI bus init failed\n");
+        return false;
+    }
+
+    spi_device_interface_config_t devcfg = {};
+    devcfg.mode = BNO085_SPI_MODE;
+    devcfg.clock_speed_hz = cfg.sclk_speed;
+    devcfg.spics_io_num = cfg.io_cs;
+    devcfg.queue_size = 1;
+    if (spi_bus_add_device(cfg.host, &devcfg, &dev) != ESP_OK) {
+        printf("BNO085: SPI device add failed\n");
+        return false;
+    }
+
+    // The ISR service may already be up for other pins
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return false;
+    if (gpio_isr_handler_add(cfg.io_int, cfg.int_isr, NULL) != ESP_OK) return false;
+
+    // Reset; the hub asserts INT once it has its advertisement ready
+    vTaskDelay(pdMS_TO_TICKS(BNO085_RESET_PULSE_MS));
+    gpio_set_level(cfg.io_rst, 1);
+    int64_t deadline = esp_timer_get_time() + (int64_t)BNO085_BOOT_TIMEOUT_MS * 1000;
+    while (!bno085_spi_int_asserted()) {
+        if (esp_timer_get_time() > deadline) {
+            printf("BNO085: no INT after reset\n");
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+bool bno085_spi_set_report(uint8_t report_id, uint32_t period_us)
+{
+    if (tx_count == BNO085_TX_QUEUE_LEN) return false;
+    int slot = (tx_first + tx_count) % BNO085_TX_QUEUE_LEN;
+    shtp_write_set_feature(tx_queue[slot], control_seq++, report_id, period_us);
+    tx_count++;
+    return true;
+}
+
+bool bno085_spi_int_asserted(void)
+{
+    return gpio_get_level(cfg.io_int) == 0;
+}
+
+const shtp_packet_t *bno085_spi_read(void)
+{
+    uint8_t *rx = rx_pool[rx_next];
+    int tx_len = 0;
+    if (tx_count > 0) {
+        tx_len = shtp_packet_length(tx_queue[tx_first]);
+        memcpy(tx_buf, tx_queue[tx_first], tx_len);
+    }
+
+    // Header first, CS held, to learn how much follows
+    spi_device_acquire_bus(dev, portMAX_DELAY);
+    spi_transaction_t hdr = {};
+    hdr.flags = SPI_TRANS_CS_KEEP_ACTIVE;
+    hdr.length = SHTP_HEADER_LEN * 8;
+    hdr.tx_buffer = tx_buf;
+    hdr.rx_buffer = rx;
+    esp_err_t err = spi_device_polling_transmit(dev, &hdr);
+
+    // The rest by DMA: as long as the longer of the two packets, at least
+    // one byte so this transfer is the one that releases CS
+    int rx_len = (err == ESP_OK) ? shtp_packet_length(rx) : 0;
+    int total = rx_len > tx_len ? rx_len : tx_len;
+    if (total > BNO085_RX_BUFFER_SIZE) total = BNO085_RX_BUFFER_SIZE;
+    if (total < SHTP_HEADER_LEN + 1) total = SHTP_HEADER_LEN + 1;
+    spi_transaction_t body = {};
+    body.length = (size_t)(total - SHTP_HEADER_LEN) * 8;
+    body.tx_buffer = tx_buf + SHTP_HEADER_LEN;
+    body.rx_buffer = rx + SHTP_HEADER_LEN;
+    if (spi_device_transmit(dev, &body) != ESP_OK) err = ESP_FAIL;
+    spi_device_release_bus(dev);
+
+    if (tx_len > 0) {
+        memset(tx_buf, 0, tx_len);
+        if (err == ESP_OK) {
+            tx_first = (tx_first + 1) % BNO085_TX_QUEUE_LEN;
+            tx_count--;
+        }
+    }
+    if (err != ESP_OK || rx_len <= SHTP_HEADER_LEN) return NULL;
+
+    shtp_packet_t *pkt = &rx_packets[rx_next];
+    rx_next = (rx_next + 1) % BNO085_RX_BUFFERS;
+    pkt->cargo = rx + SHTP_HEADER_LEN;
+    pkt->cargo_len = (rx_len < total ? rx_len : total) - SHTP_HEADER_LEN;
+    pkt->channel = rx[2];
+    pkt->continuation = shtp_is_continuation(rx);
+    return pkt;
+}
+
+bool bno085_spi_flush(int timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (tx_count > 0) {
+        if (esp_timer_get_time() > deadline) return false;
+        if (!bno085_spi_int_asserted()) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BNO085_INT_POLL_MS));
+            continue;
+        }
+        bno085_spi_read();
+    }
+    return true;
+}
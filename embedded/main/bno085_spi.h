@@ -0,0 +1,67 @@
+/*
+ * BNO085 over SPI with DMA, for the IMU_DRIVER_SHTP path in main.cpp.
+ *
+ * Each INT is one SHTP packet: the header is read by polling, then the
+ * rest of the packet lands by DMA in the next buffer of a small pool of
+ * DMA-capable buffers, with CS held across both. The packet is handed out
+ * where it landed, so shtp.h parses it in place; a buffer is only reused
+ * BNO085_RX_BUFFERS reads later, so a packet stays valid while the
+ * transfers after it run.
+ *
+ * SHTP over SPI is full duplex and the hub only listens while it talks,
+ * so commands (Set Feature) are queued and go out on the MOSI side of the
+ * next read. Keep at least one report running so there is always a next
+ * read; the racquet never turns the gyro off.
+ *
+ * Single caller: everything but the INT handler runs on sensor_task.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+
+#define BNO085_RX_BUFFERS           4
+#define BNO085_RX_BUFFER_SIZE       512     // longer packets arrive in continuations
+#define BNO085_TX_QUEUE_LEN         8       // Set Feature commands waiting for a read
+
+typedef struct {
+    spi_host_device_t host;
+    gpio_num_t io_mosi;
+    gpio_num_t io_miso;
+    gpio_num_t io_sclk;
+    gpio_num_t io_cs;
+    gpio_num_t io_int;
+    gpio_num_t io_rst;
+    int sclk_speed;
+    gpio_isr_t int_isr;             // runs on each falling edge of INT, in ISR context
+} bno085_spi_config_t;
+
+typedef struct {
+    const uint8_t *cargo;           // after the SHTP header, in a DMA buffer
+    int cargo_len;
+    uint8_t channel;
+    bool continuation;              // rest of a packet longer than one read
+} shtp_packet_t;
+
+// Set up the bus and INT, then reset the hub and wait for its first INT.
+// Reports stay off until bno085_spi_set_report() and bno085_spi_flush().
+bool bno085_spi_init(const bno085_spi_config_t *cfg);
+
+// Queue a Set Feature command: report `report_id` every period_us, 0
+// switches it off. False if the queue is full.
+bool bno085_spi_set_report(uint8_t report_id, uint32_t period_us);
+
+// True while the hub holds INT low, i.e. a packet is waiting
+bool bno085_spi_int_asserted(void);
+
+// Read one packet, sending the oldest queued command in the same transfer.
+// Call when INT is asserted. NULL if the transfer failed or the hub had
+// nothing to say.
+const shtp_packet_t *bno085_spi_read(void);
+
+// Read whatever the hub sends until every queued command has gone out.
+// Used at start-up, when the hub's own packets are the only reads there
+// are. False if that took longer than timeout_ms.
+bool bno085_spi_flush(int timeout_ms);
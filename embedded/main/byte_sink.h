@@ -0,0 +1,76 @@
+/*
+ * Small buffered byte sink used by the packet serializers.
+ *
+ * With a flush callback the buffer is a staging area: whenever it fills the
+ * bytes are handed to the callback (an HTTP body write, say) and the buffer
+ * is reused, so a packet of any size streams through a few hundred bytes of
+ * static memory. Without a callback the buffer is the whole destination
+ * (a UDP datagram) and running out of room fails the sink.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef bool (*byte_sink_flush_fn)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;                 // bytes currently buffered
+    size_t total;               // bytes accepted so far
+    byte_sink_flush_fn flush;   // NULL for a fixed buffer
+    void *ctx;
+    bool failed;
+} byte_sink_t;
+
+static inline void byte_sink_init(byte_sink_t *sink, uint8_t *buf, size_t cap,
+                                  byte_sink_flush_fn flush, void *ctx)
+{
+    sink->buf = buf;
+    sink->cap = cap;
+    sink->len = 0;
+    sink->total = 0;
+    sink->flush = flush;
+    sink->ctx = ctx;
+    sink->failed = false;
+}
+
+// Hand buffered bytes to the flush callback. No-op for a fixed buffer.
+static inline bool byte_sink_flush(byte_sink_t *sink)
+{
+    if (sink->failed) return false;
+    if (sink->flush == NULL || sink->len == 0) return true;
+    if (!sink->flush(sink->ctx, sink->buf, sink->len)) {
+        sink->failed = true;
+        return false;
+    }
+    sink->len = 0;
+    return true;
+}
+
+static inline bool byte_sink_write(byte_sink_t *sink, const void *data, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    while (len > 0) {
+        if (sink->failed) return false;
+        size_t room = sink->cap - sink->len;
+        if (room == 0) {
+            if (sink->flush == NULL) {
+                sink->failed = true;
+                return false;
+            }
+            if (!byte_sink_flush(sink)) return false;
+            room = sink->cap;
+        }
+        size_t n = len < room ? len : room;
+        memcpy(sink->buf + sink->len, src, n);
+        sink->len += n;
+        sink->total += n;
+        src += n;
+        len -= n;
+    }
+    return !sink->failed;
+}
@@ -0,0 +1,70 @@
+/*
+ * Per-channel capture ring: the last `capacity` samples at the full sensor
+ * rate, kept for event snapshots.
+ *
+ * Private to sensor_task, so there is no synchronisation. Capacity is a
+ * power of two and slots are addressed by head & mask. Storage is a
+ * sample_block_t, one array per channel, so a snapshot is at most two
+ * memcpy spans per channel and the copied event is contiguous per channel.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "sensor_sample.h"
+
+typedef struct {
+    sample_block_t store;           // capacity entries per channel
+    uint32_t capacity;              // power of two
+    uint32_t mask;                  // capacity - 1
+    uint32_t head;                  // samples written so far
+} capture_ring_t;
+
+static inline void capture_ring_init(capture_ring_t *ring, const sample_block_t *storage,
+                                     uint32_t capacity)
+{
+    ring->store = *storage;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+}
+
+static inline void capture_ring_push(capture_ring_t *ring, const sensor_sample_t *s)
+{
+    uint32_t i = ring->head & ring->mask;
+    ring->store.axis[SAMPLE_GYRO_X][i] = s->gyro_x;
+    ring->store.axis[SAMPLE_GYRO_Y][i] = s->gyro_y;
+    ring->store.axis[SAMPLE_GYRO_Z][i] = s->gyro_z;
+    ring->store.axis[SAMPLE_ACCEL_X][i] = s->accel_x;
+    ring->store.axis[SAMPLE_ACCEL_Y][i] = s->accel_y;
+    ring->store.axis[SAMPLE_ACCEL_Z][i] = s->accel_z;
+    ring->store.timestamp_us[i] = s->timestamp_us;
+    ring->store.seq[i] = s->seq;
+    ring->head++;
+}
+
+static inline void capture_copy_span(const sample_block_t *src, uint32_t from,
+                                     const sample_block_t *dst, uint32_t to, uint32_t n)
+{
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) {
+        memcpy(dst->axis[a] + to, src->axis[a] + from, sizeof(float) * n);
+    }
+    memcpy(dst->timestamp_us + to, src->timestamp_us + from, sizeof(int64_t) * n);
+    memcpy(dst->seq + to, src->seq + from, sizeof(uint32_t) * n);
+}
+
+// Copy the newest `count` samples, oldest first, into dest[0..).
+// Returns the number copied (fewer if the ring has not filled yet).
+static inline uint32_t capture_ring_copy_recent(const capture_ring_t *ring,
+                                                const sample_block_t *dest, uint32_t count)
+{
+    uint32_t have = ring->head < ring->capacity ? ring->head : ring->capacity;
+    if (count > have) count = have;
+    uint32_t first = (ring->head - count) & ring->mask;
+    uint32_t to_wrap = ring->capacity - first;
+    uint32_t n = count < to_wrap ? count : to_wrap;
+    capture_copy_span(&ring->store, first, dest, 0, n);
+    if (n < count) capture_copy_span(&ring->store, 0, dest, n, count - n);
+    return count;
+}
@@ -0,0 +1,78 @@
+/*
+ * Batched signal kernels. See dsp_kernels.h.
+ */
+
+#include "dsp_kernels.h"
+
+#if DSP_KERNELS_ESP_DSP
+#include "dsps_add.h"
+#include "dsps_biquad.h"
+#include "dsps_mul.h"
+#endif
+
+// --- Layout ---
+
+void dsp_reverse(float *x, int n)
+{
+    for (int i = 0, j = n - 1; i < j; i++, j--) {
+        float t = x[i];
+        x[i] = x[j];
+        x[j] = t;
+    }
+}
+
+// --- Magnitude ---
+
+void dsp_magnitude3(const vec3_block_t *in, float *out, float *scratch, int n)
+{
+#if DSP_KERNELS_ESP_DSP
+    dsps_mul_f32(in->x, in->x, out, n, 1, 1, 1);
+    dsps_mul_f32(in->y, in->y, scratch, n, 1, 1, 1);
+    dsps_add_f32(out, scratch, out, n, 1, 1, 1);
+    dsps_mul_f32(in->z, in->z, scratch, n, 1, 1, 1);
+    dsps_add_f32(out, scratch, out, n, 1, 1, 1);
+    for (int i = 0; i < n; i++) out[i] = sqrtf(out[i]);
+#else
+    (void)scratch;
+    for (int i = 0; i < n; i++) out[i] = dsp_norm3(in->x[i], in->y[i], in->z[i]);
+#endif
+}
+
+// --- Biquad ---
+
+void dsp_biquad(const float *in, float *out, int n, const float *coef, float *state)
+{
+#if DSP_KERNELS_ESP_DSP
+    dsps_biquad_f32(in, out, n, (float *)coef, state);
+#else
+    float w0 = state[0];
+    float w1 = state[1];
+    for (int i = 0; i < n; i++) {
+        float d = in[i] - coef[3] * w0 - coef[4] * w1;
+        out[i] = coef[0] * d + coef[1] * w0 + coef[2] * w1;
+        w1 = w0;
+        w0 = d;
+    }
+    state[0] = w0;
+    state[1] = w1;
+#endif
+}
+
+void dsp_biquad_steady_state(const float *coef, float x0, float *state)
+{
+    float d = x0 / (1.0f + coef[3] + coef[4]);
+    state[0] = d;
+    state[1] = d;
+}
+
+void dsp_biquad_design_lowpass(float *coef, double cutoff_hz, double rate_hz)
+{
+    double k = tan(M_PI * cutoff_hz / rate_hz);
+    double norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+    double b0 = k * k * norm;
+    coef[0] = (float)b0;
+    coef[1] = (float)(2.0 * b0);
+    coef[2] = (float)b0;
+    coef[3] = (float)(2.0 * (k * k - 1.0) * norm);
+    coef[4] = (float)((1.0 - M_SQRT2 * k + k * k) * norm);
+}
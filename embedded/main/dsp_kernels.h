@@ -0,0 +1,67 @@
+/*
+ * Batched signal kernels over structure-of-arrays sample blocks.
+ *
+ * The hot loops of the on-device analysis are 3-axis vector norms and
+ * biquad IIR sections. On the ESP32-S3 these go through esp-dsp, whose
+ * dsps_* routines use the S3's vector and zero-overhead-loop instructions;
+ * elsewhere (or with DSP_KERNELS_ESP_DSP 0) the plain C loops below are
+ * used. Both paths produce the same results up to float rounding.
+ *
+ * Kernels work on separate x/y/z arrays, which the capture ring and event
+ * slots store directly (sample_block_t), so no gather step is needed.
+ */
+
+#pragma once
+
+#include <math.h>
+
+#ifndef DSP_KERNELS_ESP_DSP
+#ifdef ESP_PLATFORM
+#define DSP_KERNELS_ESP_DSP     1
+#else
+#define DSP_KERNELS_ESP_DSP     0
+#endif
+#endif
+
+// Coefficient order used by esp-dsp: b0, b1, b2, a1, a2 (a0 == 1)
+#define DSP_BIQUAD_COEFS        5
+
+typedef struct {
+    const float *x;
+    const float *y;
+    const float *z;
+} vec3_block_t;
+
+// Single-vector norm, for per-sample checks that cannot wait for a block
+static inline float dsp_norm3(float x, float y, float z)
+{
+    return sqrtf(x * x + y * y + z * z);
+}
+
+// out[i] = |(x[i], y[i], z[i])|, using n floats of scratch
+void dsp_magnitude3(const vec3_block_t *in, float *out, float *scratch, int n);
+
+// Run one direct form II biquad section over in[0..n) into out (may alias).
+// state[2] carries the delay line between calls.
+void dsp_biquad(const float *in, float *out, int n, const float *coef, float *state);
+
+// Delay line of a section that has settled on a constant input x0
+void dsp_biquad_steady_state(const float *coef, float x0, float *state);
+
+// One sample through a section, same arithmetic as dsp_biquad(), for
+// per-sample filters that cannot wait for a block
+static inline float dsp_biquad_step(float x, const float *coef, float *state)
+{
+    float d = x - coef[3] * state[0] - coef[4] * state[1];
+    float y = coef[0] * d + coef[1] * state[0] + coef[2] * state[1];
+    state[1] = state[0];
+    state[0] = d;
+    return y;
+}
+
+// 2nd-order Butterworth low-pass by the bilinear transform with prewarping,
+// which is what scipy.signal.butter(2, fc / nyq) returns as a single section
+void dsp_biquad_design_lowpass(float *coef, double cutoff_hz, double rate_hz);
+
+// Reverse x[0..n) in place
+void dsp_reverse(float *x, int n);
@@ -0,0 +1,82 @@
+/*
+ * Frames between the racquet and the ESP-NOW gateway (transport_espnow).
+ *
+ * The gateway (embedded/gateway) is a radio modem on USB: every ESP-NOW
+ * frame it receives goes out on the serial port, and every frame the host
+ * writes is sent on air. espnow_bridge.py on the laptop reassembles the
+ * racquet's datagrams and events and hands them to the ingest server over
+ * UDP and HTTP as if the racquet had sent them itself, so the server does
+ * not change.
+ *
+ * One ESP-NOW frame (at most ESPNOW_LINK_MTU bytes):
+ *
+ *   espnow_frame_hdr_t | payload
+ *
+ * Datagrams and event bodies bigger than one frame are split into
+ * fragments that share msg_id and count up in frag, the final one flagged
+ * ESPNOW_FLAG_LAST. A datagram with a missing fragment is dropped (the
+ * server NACKs live gaps as usual); an event with one is never
+ * acknowledged, and the racquet sends it again.
+ *
+ * Racquet -> gateway:
+ *   ESPNOW_DATAGRAM    live channel packet (wire_format.h)
+ *   ESPNOW_EVENT       event body
+ *
+ * Gateway -> racquet:
+ *   ESPNOW_HELLO       broadcast once a second; tells racquets where the
+ *                      gateway is (its MAC is the frame's source)
+ *   ESPNOW_TIME        espnow_time_t, the laptop's wall clock, which stands
+ *                      in for SNTP
+ *   ESPNOW_CONTROL     a packet the server sent back (NACK, config), unicast
+ *   ESPNOW_EVENT_ACK   espnow_event_ack_t for the event with this msg_id
+ *
+ * Serial framing between gateway and host: SLIP (RFC 1055), each packet
+ * the 6-byte peer MAC followed by the frame.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define ESPNOW_LINK_MAGIC       0x4E45      // "EN"
+#define ESPNOW_LINK_MTU         250         // ESP-NOW v1 payload limit
+#define ESPNOW_LINK_BAUD        921600      // gateway USB serial
+
+typedef enum : uint8_t {
+    ESPNOW_DATAGRAM  = 1,
+    ESPNOW_EVENT     = 2,
+    ESPNOW_HELLO     = 3,
+    ESPNOW_TIME      = 4,
+    ESPNOW_CONTROL   = 5,
+    ESPNOW_EVENT_ACK = 6,
+} espnow_kind_t;
+
+#define ESPNOW_FLAG_LAST        0x01        // final fragment of the message
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  kind;          // espnow_kind_t
+    uint8_t  flags;
+    uint16_t msg_id;        // per sender and kind, fragments share it
+    uint16_t frag;          // fragment index within the message
+} espnow_frame_hdr_t;  // 8 bytes
+
+#define ESPNOW_LINK_PAYLOAD     (ESPNOW_LINK_MTU - sizeof(espnow_frame_hdr_t))
+
+typedef struct __attribute__((packed)) {
+    int64_t wall_us;        // Unix microseconds when the gateway host sent it
+} espnow_time_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t status;        // the server's HTTP status for the event
+} espnow_event_ack_t;
+
+// SLIP bytes for the gateway's serial link
+#define SLIP_END                0xC0
+#define SLIP_ESC                0xDB
+#define SLIP_ESC_END            0xDC
+#define SLIP_ESC_ESC            0xDD
+
+static_assert(sizeof(espnow_frame_hdr_t) == 8, "espnow_frame_hdr_t layout");
+static_assert(sizeof(espnow_time_t) == 8, "espnow_time_t layout");
+static_assert(sizeof(espnow_event_ack_t) == 2, "espnow_event_ack_t layout");
@@ -0,0 +1,110 @@
+/*
+ * Fixed pool of captured swing events. See event_pool.h.
+ */
+
+#include "event_pool.h"
+
+static inline bool slot_transition(event_slot_t *slot, event_slot_state_t from,
+                                   event_slot_state_t to)
+{
+    uint8_t expected = from;
+    return slot->state.compare_exchange_strong(expected, (uint8_t)to,
+                                               std::memory_order_acq_rel);
+}
+
+// Oldest slot in `state`, or NULL.
+static event_slot_t *oldest_in_state(event_pool_t *pool, event_slot_state_t state)
+{
+    event_slot_t *best = NULL;
+    for (int i = 0; i < pool->num_slots; i++) {
+        event_slot_t *slot = &pool->slots[i];
+        if (slot->state.load(std::memory_order_acquire) != state) continue;
+        // ids are assigned in capture order; compare as a wrapping difference
+        if (best == NULL || (int32_t)(slot->id - best->id) < 0) best = slot;
+    }
+    return best;
+}
+
+void event_pool_init(event_pool_t *pool, event_slot_t *slots, int num_slots,
+                     const sample_block_t *storage, int slot_capacity,
+                     event_drop_policy_t policy)
+{
+    pool->slots = slots;
+    pool->num_slots = num_slots;
+    pool->slot_capacity = slot_capacity;
+    pool->policy = policy;
+    pool->next_id = 0;
+    pool->dropped.store(0, std::memory_order_relaxed);
+
+    for (int i = 0; i < num_slots; i++) {
+        event_slot_t *slot = &slots[i];
+        slot->id = 0;
+        slot->count = 0;
+        slot->trigger_t_us = 0;
+        slot->trigger_mag = 0.0f;
+        slot->samples = sample_block_offset(storage, (size_t)i * slot_capacity);
+        slot->state.store(EVENT_SLOT_FREE, std::memory_order_release);
+    }
+}
+
+event_slot_t *event_pool_acquire(event_pool_t *pool)
+{
+    for (int i = 0; i < pool->num_slots; i++) {
+        if (slot_transition(&pool->slots[i], EVENT_SLOT_FREE, EVENT_SLOT_FILLING)) {
+            return &pool->slots[i];
+        }
+    }
+
+    if (pool->policy == EVENT_DROP_OLDEST) {
+        // The consumer may grab the oldest READY slot under us; try the next
+        while (true) {
+            event_slot_t *victim = oldest_in_state(pool, EVENT_SLOT_READY);
+            if (victim == NULL) break;
+            if (slot_transition(victim, EVENT_SLOT_READY, EVENT_SLOT_FILLING)) {
+                pool->dropped.fetch_add(1, std::memory_order_relaxed);
+                return victim;
+            }
+        }
+    }
+
+    pool->dropped.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+}
+
+void event_pool_publish(event_pool_t *pool, event_slot_t *slot)
+{
+    slot->id = pool->next_id++;
+    slot->state.store(EVENT_SLOT_READY, std::memory_order_release);
+}
+
+event_slot_t *event_pool_next(event_pool_t *pool)
+{
+    while (true) {
+        event_slot_t *slot = oldest_in_state(pool, EVENT_SLOT_READY);
+        if (slot == NULL) return NULL;
+        // Lost the race to a drop-oldest reclaim; look again
+        if (slot_transition(slot, EVENT_SLOT_READY, EVENT_SLOT_SENDING)) return slot;
+    }
+}
+
+void event_pool_release(event_pool_t *pool, event_slot_t *slot)
+{
+    (void)pool;
+    slot->state.store(EVENT_SLOT_FREE, std::memory_order_release);
+}
+
+void event_pool_requeue(event_pool_t *pool, event_slot_t *slot)
+{
+    (void)pool;
+    slot->state.store(EVENT_SLOT_READY, std::memory_order_release);
+}
+
+int event_pool_pending(const event_pool_t *pool)
+{
+    int pending = 0;
+    for (int i = 0; i < pool->num_slots; i++) {
+        uint8_t state = pool->slots[i].state.load(std::memory_order_acquire);
+        if (state == EVENT_SLOT_READY || state == EVENT_SLOT_SENDING) pending++;
+    }
+    return pending;
+}
@@ -0,0 +1,85 @@
+/*
+ * Fixed pool of captured swing events waiting for upload.
+ *
+ * Slots and their sample storage are handed in once at boot; nothing is
+ * allocated afterwards. sensor_task is the only producer and
+ * http_event_task the only consumer. Each slot moves through
+ *
+ *   FREE -> FILLING -> READY -> SENDING -> FREE
+ *                        ^         |
+ *                        +---------+  (upload failed, retry later)
+ *
+ * with every transition done by an atomic store or compare-exchange on the
+ * slot state, so neither side ever blocks the other. READY slots upload
+ * oldest first. When no slot is FREE the drop policy decides whether the
+ * oldest READY event is overwritten or the new one is discarded; the slot
+ * being uploaded is never touched.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_sample.h"
+#include "swing_phase.h"
+
+typedef enum : uint8_t {
+    EVENT_SLOT_FREE,
+    EVENT_SLOT_FILLING,
+    EVENT_SLOT_READY,
+    EVENT_SLOT_SENDING,
+} event_slot_state_t;
+
+typedef enum : uint8_t {
+    EVENT_DROP_OLDEST,
+    EVENT_DROP_NEWEST,
+} event_drop_policy_t;
+
+typedef struct {
+    std::atomic<uint8_t> state;     // event_slot_state_t
+    uint32_t id;                    // capture order, drives FIFO upload
+    int count;
+    int64_t trigger_t_us;
+    float trigger_mag;
+    uint16_t rate_hz;               // sensor rate the samples were taken at
+    swing_phase_t phase;            // on-device segmentation of samples
+    sample_block_t samples;         // slot_capacity samples per channel
+} event_slot_t;
+
+typedef struct {
+    event_slot_t *slots;
+    int num_slots;
+    int slot_capacity;
+    event_drop_policy_t policy;
+    uint32_t next_id;                   // producer only
+    std::atomic<uint32_t> dropped;      // events lost to the drop policy
+} event_pool_t;
+
+// `storage` must hold num_slots * slot_capacity samples per channel.
+void event_pool_init(event_pool_t *pool, event_slot_t *slots, int num_slots,
+                     const sample_block_t *storage, int slot_capacity,
+                     event_drop_policy_t policy);
+
+// --- Producer (sensor_task) ---
+
+// Claim a slot to fill, applying the drop policy if none is free.
+// Returns NULL if the new event has to be dropped.
+event_slot_t *event_pool_acquire(event_pool_t *pool);
+
+// Queue a filled slot for upload.
+void event_pool_publish(event_pool_t *pool, event_slot_t *slot);
+
+// --- Consumer (http_event_task) ---
+
+// Oldest READY slot, now owned by the caller, or NULL if nothing is queued.
+event_slot_t *event_pool_next(event_pool_t *pool);
+
+// Upload done: return the slot to the pool.
+void event_pool_release(event_pool_t *pool, event_slot_t *slot);
+
+// Upload failed: put the slot back at its place in the FIFO.
+void event_pool_requeue(event_pool_t *pool, event_slot_t *slot);
+
+// Number of slots READY or SENDING.
+int event_pool_pending(const event_pool_t *pool);
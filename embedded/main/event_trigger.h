@@ -0,0 +1,122 @@
+/*
+ * Swing trigger: a multi-signal detector with hysteresis.
+ *
+ * A swing turns the racquet hard for tens of milliseconds; an arm bump or
+ * a tap on the frame spikes the accelerometer without much rotation. So
+ * an event fires only when, on the same sample,
+ *
+ *   - |gyro| is over gyro_on,
+ *   - the short-window gyro energy (RMS |gyro| over ~ENERGY_TAU_US) is over
+ *     energy_on, so a single noisy gyro sample is not enough, and
+ *   - |accel| is over accel_on or the jerk |d accel / dt| is over jerk_on.
+ *
+ * After firing, the detector disarms until the energy has dropped back
+ * under energy_off (hysteresis) and debounce_us has passed, so one long
+ * swing or a shaky follow-through never fires twice.
+ *
+ * Every signal is updated incrementally, O(1) per sample with no history
+ * buffer: the energy is an exponential moving average of |gyro|^2 and the
+ * jerk a difference with the previous sample. Checked on every 400Hz
+ * sample in sensor_task, so it stays inline and allocation-free.
+ * Thresholds can be swapped at runtime with event_trigger_set_config().
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include "dsp_kernels.h"
+#include "sensor_sample.h"
+
+#define EVENT_TRIGGER_ENERGY_TAU_US     20000   // energy averaging time constant
+
+typedef struct {
+    float gyro_on;          // rad/s, instantaneous |gyro| to fire
+    float energy_on;        // rad/s, RMS |gyro| over the window to fire
+    float energy_off;       // rad/s, RMS |gyro| to re-arm after firing
+    float accel_on;         // m/s^2, |accel| to fire ...
+    float jerk_on;          // m/s^3, ... or |jerk|
+    int64_t debounce_us;    // minimum time between events
+} event_trigger_config_t;
+
+typedef struct {
+    float gyro_mag;         // rad/s
+    float accel_mag;        // m/s^2
+    float jerk;             // m/s^3
+    float energy_rms;       // rad/s
+} event_trigger_signals_t;
+
+typedef struct {
+    event_trigger_config_t cfg;
+    float energy;           // EMA of |gyro|^2
+    float prev_accel[3];
+    int64_t prev_t_us;      // 0: no previous sample yet
+    int64_t last_event_us;
+    bool armed;
+} event_trigger_t;
+
+// Thresholds are sane if every one is positive and off stays below on.
+static inline bool event_trigger_config_valid(const event_trigger_config_t *cfg)
+{
+    return cfg->gyro_on > 0.0f && cfg->energy_on > 0.0f && cfg->energy_off >= 0.0f &&
+           cfg->energy_off < cfg->energy_on && cfg->accel_on > 0.0f &&
+           cfg->jerk_on > 0.0f && cfg->debounce_us >= 0;
+}
+
+static inline void event_trigger_init(event_trigger_t *trig, const event_trigger_config_t *cfg)
+{
+    trig->cfg = *cfg;
+    trig->energy = 0.0f;
+    trig->prev_accel[0] = trig->prev_accel[1] = trig->prev_accel[2] = 0.0f;
+    trig->prev_t_us = 0;
+    trig->last_event_us = INT64_MIN / 2;   // armed from boot
+    trig->armed = true;
+}
+
+// New thresholds take effect from the next sample; the signal state is kept.
+static inline void event_trigger_set_config(event_trigger_t *trig,
+                                            const event_trigger_config_t *cfg)
+{
+    trig->cfg = *cfg;
+}
+
+// Feed one sample; true if it starts an event. *out gets every signal for
+// this sample, fired or not.
+static inline bool event_trigger_check(event_trigger_t *trig, const sensor_sample_t *s,
+                                       event_trigger_signals_t *out)
+{
+    const event_trigger_config_t *cfg = &trig->cfg;
+    int64_t now = s->timestamp_us;
+
+    float g = dsp_norm3(s->gyro_x, s->gyro_y, s->gyro_z);
+    out->gyro_mag = g;
+    out->accel_mag = dsp_norm3(s->accel_x, s->accel_y, s->accel_z);
+
+    out->jerk = 0.0f;
+    float alpha = 1.0f;
+    int64_t dt = now - trig->prev_t_us;
+    if (trig->prev_t_us != 0 && dt > 0) {
+        out->jerk = dsp_norm3(s->accel_x - trig->prev_accel[0], s->accel_y - trig->prev_accel[1],
+                              s->accel_z - trig->prev_accel[2]) * (1e6f / (float)dt);
+        alpha = (float)dt / (float)(EVENT_TRIGGER_ENERGY_TAU_US + dt);
+    }
+    trig->prev_accel[0] = s->accel_x;
+    trig->prev_accel[1] = s->accel_y;
+    trig->prev_accel[2] = s->accel_z;
+    trig->prev_t_us = now;
+
+    trig->energy += alpha * (g * g - trig->energy);
+    out->energy_rms = sqrtf(trig->energy);
+
+    if (!trig->armed) {
+        if (out->energy_rms >= cfg->energy_off) return false;
+        trig->armed = true;
+    }
+    if (now - trig->last_event_us < cfg->debounce_us) return false;
+    if (g < cfg->gyro_on || out->energy_rms < cfg->energy_on) return false;
+    if (out->accel_mag < cfg->accel_on && out->jerk < cfg->jerk_on) return false;
+
+    trig->armed = false;
+    trig->last_event_us = now;
+    return true;
+}
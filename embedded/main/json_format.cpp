@@ -0,0 +1,196 @@
+/*
+ * JSON packet serializer. See json_format.h.
+ */
+
+#include "json_format.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "stroke_classifier.h"
+
+static bool json_append(byte_sink_t *sink, const char *fmt, ...)
+{
+    char tmp[192];   // one formatted sample is ~110 bytes
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= sizeof(tmp)) return false;
+    return byte_sink_write(sink, tmp, (size_t)written);
+}
+
+// --- Samples ---
+
+static bool write_json_phase(byte_sink_t *sink, const swing_phase_t *p)
+{
+    if (!json_append(sink, ",\"phase\":{\"valid\":%s,\"num_samples\":%d,"
+                     "\"accel_start_idx\":%d,\"peak_idx\":%d,\"decel_end_idx\":%d,",
+                     p->valid ? "true" : "false", p->num_samples,
+                     p->accel_start_idx, p->peak_idx, p->decel_end_idx)) {
+        return false;
+    }
+    if (!json_append(sink, "\"t_first_us\":%lld,\"accel_start_us\":%lld,"
+                     "\"peak_us\":%lld,\"decel_end_us\":%lld,\"t_last_us\":%lld,",
+                     (long long)p->t_first_us, (long long)p->accel_start_us,
+                     (long long)p->peak_us, (long long)p->decel_end_us,
+                     (long long)p->t_last_us)) {
+        return false;
+    }
+    if (!json_append(sink, "\"peak_gyro_rad_s\":%.3f,\"peak_accel_m_s2\":%.3f,"
+                     "\"gyro_at_peak_rad_s\":%.3f,\"accel_at_peak_m_s2\":%.3f,",
+                     p->peak_gyro, p->peak_accel, p->gyro_at_peak, p->accel_at_peak)) {
+        return false;
+    }
+    return json_append(sink, "\"stroke\":\"%s\",\"stroke_confidence\":%.3f}",
+                       stroke_label_name((stroke_label_t)p->stroke), p->stroke_confidence);
+}
+
+bool json_write_payload(byte_sink_t *sink, const char *type,
+                        const sample_view_t *samples, int count,
+                        int64_t trigger_t_us, int64_t wall_offset_us,
+                        const swing_phase_t *phase)
+{
+    if (!json_append(sink, "{\"type\":\"%s\",\"device_id\":%u,\"samples\":[",
+                     type, (unsigned)wire_device_id())) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!json_append(
+                sink,
+                "%s{\"t_us\":%lld,"
+                "\"gyro\":{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f},"
+                "\"accel\":{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f}}",
+                (i > 0) ? "," : "",
+                (long long)sample_view_timestamp(samples, i),
+                sample_view_axis(samples, SAMPLE_GYRO_X, i),
+                sample_view_axis(samples, SAMPLE_GYRO_Y, i),
+                sample_view_axis(samples, SAMPLE_GYRO_Z, i),
+                sample_view_axis(samples, SAMPLE_ACCEL_X, i),
+                sample_view_axis(samples, SAMPLE_ACCEL_Y, i),
+                sample_view_axis(samples, SAMPLE_ACCEL_Z, i))) {
+            return false;
+        }
+    }
+
+    if (!json_append(sink, "]")) return false;
+    if (count > 0 && !json_append(sink, ",\"first_seq\":%u",
+                                  (unsigned)sample_view_seq(samples, 0))) {
+        return false;
+    }
+
+    if (strcmp(type, "event") == 0) {
+        if (!json_append(sink, ",\"trigger_t_us\":%lld,\"wall_offset_us\":%lld",
+                         (long long)trigger_t_us, (long long)wall_offset_us)) {
+            return false;
+        }
+        if (phase != NULL && !write_json_phase(sink, phase)) return false;
+    }
+
+    return json_append(sink, "}");
+}
+
+// --- Telemetry ---
+
+bool json_write_stats(byte_sink_t *sink, int64_t t_us, const wire_stats_t *st,
+                      const wire_task_stats_t *tasks, int num_tasks)
+{
+    if (!json_append(sink, "{\"type\":\"stats\",\"device_id\":%u,\"t_us\":%lld,"
+                     "\"uptime_ms\":%u,\"free_heap\":%u,\"min_free_heap\":%u,"
+                     "\"largest_free_block\":%u,",
+                     (unsigned)wire_device_id(), (long long)t_us, (unsigned)st->uptime_ms,
+                     (unsigned)st->free_heap, (unsigned)st->min_free_heap,
+                     (unsigned)st->largest_free_block)) {
+        return false;
+    }
+    if (!json_append(sink, "\"arena_used\":%u,\"arena_size\":%u,\"live_dropped\":%u,"
+                     "\"events_dropped\":%u,\"events_pending\":%u,",
+                     (unsigned)st->arena_used, (unsigned)st->arena_size,
+                     (unsigned)st->live_dropped, (unsigned)st->events_dropped,
+                     (unsigned)st->events_pending)) {
+        return false;
+    }
+    if (!json_append(sink, "\"live_nacked\":%u,\"live_retransmitted\":%u,"
+                     "\"live_unrecoverable\":%u,\"live_rate_hz\":%u,",
+                     (unsigned)st->live_nacked, (unsigned)st->live_retransmitted,
+                     (unsigned)st->live_unrecoverable, (unsigned)st->live_rate_hz)) {
+        return false;
+    }
+    if (!json_append(sink, "\"sensor_gaps\":%u,\"sensor_gap_max_us\":%u,",
+                     (unsigned)st->sensor_gaps, (unsigned)st->sensor_gap_max_us)) {
+        return false;
+    }
+    if (!json_append(sink, "\"tasks\":[")) return false;
+    for (int i = 0; i < num_tasks; i++) {
+        if (!json_append(sink, "%s{\"name\":\"%.*s\",\"stack_size\":%u,\"stack_min_free\":%u}",
+                         (i > 0) ? "," : "", WIRE_TASK_NAME_LEN, tasks[i].name,
+                         (unsigned)tasks[i].stack_size, (unsigned)tasks[i].stack_min_free)) {
+            return false;
+        }
+    }
+    return json_append(sink, "]}");
+}
+
+bool json_write_profile(byte_sink_t *sink, int64_t t_us, const wire_profile_ext_t *ext,
+                        const wire_profile_stage_t *stages, int num_stages)
+{
+    if (!json_append(sink, "{\"type\":\"profile\",\"device_id\":%u,\"t_us\":%lld,"
+                     "\"cpu_mhz\":%u,\"window_ms\":%u,\"stages\":[",
+                     (unsigned)wire_device_id(), (long long)t_us, (unsigned)ext->cpu_mhz, (unsigned)ext->window_ms)) {
+        return false;
+    }
+    for (int i = 0; i < num_stages; i++) {
+        const wire_profile_stage_t *st = &stages[i];
+        if (!json_append(sink, "%s{\"name\":\"%.*s\",\"count\":%u,\"min_cycles\":%u,"
+                         "\"p50_cycles\":%u,\"p99_cycles\":%u,\"max_cycles\":%u}",
+                         (i > 0) ? "," : "", WIRE_PROFILE_NAME_LEN, st->name,
+                         (unsigned)st->count, (unsigned)st->min_cycles,
+                         (unsigned)st->p50_cycles, (unsigned)st->p99_cycles,
+                         (unsigned)st->max_cycles)) {
+            return false;
+        }
+    }
+    return json_append(sink, "]}");
+}
+
+// --- Clock ---
+
+bool json_write_sync(byte_sink_t *sink, const wire_clock_t *clock)
+{
+    return json_append(sink, "{\"type\":\"sync\",\"device_id\":%u,\"mono_us\":%lld,"
+                       "\"wall_us\":%lld}", (unsigned)wire_device_id(),
+                       (long long)clock->mono_us, (long long)clock->wall_us);
+}
+
+// --- Config ---
+
+bool json_write_config_ack(byte_sink_t *sink, int64_t t_us, const wire_config_t *cfg)
+{
+    bool ok = json_append(sink, "{\"type\":\"config_ack\",\"device_id\":%u,\"t_us\":%lld,"
+                          "\"request_id\":%u,\"status\":%u,\"set\":%u,\"transport\":%u,",
+                          (unsigned)wire_device_id(), (long long)t_us, (unsigned)cfg->request_id,
+                          (unsigned)cfg->status, (unsigned)cfg->set, (unsigned)cfg->transport);
+    ok = ok && json_append(sink, "\"sensor_rate_hz\":%u,\"pre_samples\":%u,\"post_samples\":%u,"
+                           "\"live_level\":%u,\"server_ip\":\"%s\",\"http_port\":%u,"
+                           "\"udp_port\":%u,",
+                           (unsigned)cfg->sensor_rate_hz, (unsigned)cfg->pre_samples,
+                           (unsigned)cfg->post_samples, (unsigned)cfg->live_level,
+                           cfg->server_ip, (unsigned)cfg->http_port, (unsigned)cfg->udp_port);
+    return ok && json_append(sink, "\"gyro_on\":%.3f,\"energy_on\":%.3f,\"energy_off\":%.3f,"
+                             "\"accel_on\":%.3f,\"jerk_on\":%.1f,\"debounce_ms\":%u}",
+                             cfg->gyro_on, cfg->energy_on, cfg->energy_off, cfg->accel_on,
+                             cfg->jerk_on, (unsigned)cfg->debounce_ms);
+}
+
+// --- Phase marks ---
+
+bool json_write_phase_mark(byte_sink_t *sink, const phase_mark_t *mark)
+{
+    return json_append(sink, "{\"type\":\"phase_mark\",\"device_id\":%u,\"t_us\":%lld,"
+                       "\"mark\":\"%s\",\"swing_id\":%u,\"detect_delay_us\":%lld,"
+                       "\"gyro\":%.3f,\"accel\":%.3f}",
+                       (unsigned)wire_device_id(), (long long)mark->t_us,
+                       phase_mark_name(mark->kind), (unsigned)mark->swing_id,
+                       (long long)(mark->detected_us - mark->t_us), mark->gyro, mark->accel);
+}
@@ -0,0 +1,43 @@
+/*
+ * JSON packet serializer, the human-readable alternative to wire_format.h
+ * (WIRE_FORMAT_JSON in main.cpp). server.py accepts either.
+ *
+ * Output is streamed through a byte_sink_t one formatted record at a time,
+ * so an event of any length needs only the sink's staging buffer. Roughly
+ * 110 bytes per sample against 16 for binary Q16. Timestamps are monotonic
+ * microseconds and every packet carries "device_id", as in the binary
+ * format.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "byte_sink.h"
+#include "sample_view.h"
+#include "swing_phase.h"
+#include "wire_format.h"
+
+// {"type": type, "samples": [...], "first_seq": ...}; events add
+// trigger_t_us, wall_offset_us and, if `phase` is given, the on-device
+// phase summary.
+bool json_write_payload(byte_sink_t *sink, const char *type,
+                        const sample_view_t *samples, int count,
+                        int64_t trigger_t_us, int64_t wall_offset_us,
+                        const swing_phase_t *phase);
+
+// Telemetry packet with the same fields as wire_stats_t
+bool json_write_stats(byte_sink_t *sink, int64_t t_us, const wire_stats_t *st,
+                      const wire_task_stats_t *tasks, int num_tasks);
+
+// Per-stage profile packet with the same fields as the binary one
+bool json_write_profile(byte_sink_t *sink, int64_t t_us, const wire_profile_ext_t *ext,
+                        const wire_profile_stage_t *stages, int num_stages);
+
+// {"type": "sync", "mono_us": ..., "wall_us": ...}
+bool json_write_sync(byte_sink_t *sink, const wire_clock_t *clock);
+
+// {"type": "config_ack", ...} with the same fields as wire_config_t
+bool json_write_config_ack(byte_sink_t *sink, int64_t t_us, const wire_config_t *cfg);
+
+// {"type": "phase_mark", "mark": "peak", ...} with the fields of wire_phase_mark_t
+bool json_write_phase_mark(byte_sink_t *sink, const phase_mark_t *mark);
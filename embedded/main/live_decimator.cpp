@@ -0,0 +1,101 @@
+/*
+ * Anti-aliased live decimation. See live_decimator.h.
+ */
+
+#include "live_decimator.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Zeroth-order modified Bessel function of the first kind, by its series
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50 && term > 1e-12 * sum; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser-windowed sinc low-pass with unity DC gain, cut off at `cutoff`
+// cycles per input sample; beta from the attenuation (Kaiser's formula)
+static void fir_design_lowpass(float *coef, int taps, double cutoff, double atten_db)
+{
+    double beta = atten_db > 50.0 ? 0.1102 * (atten_db - 8.7)
+                                  : 0.5842 * pow(atten_db - 21.0, 0.4) + 0.07886 * (atten_db - 21.0);
+    double mid = (taps - 1) / 2.0;
+    double sum = 0.0;
+    for (int i = 0; i < taps; i++) {
+        double x = i - mid;
+        double sinc = (x == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        double r = x / mid;
+        double window = bessel_i0(beta * sqrt(1.0 - r * r)) / bessel_i0(beta);
+        coef[i] = (float)(sinc * window);
+        sum += coef[i];
+    }
+    for (int i = 0; i < taps; i++) coef[i] = (float)(coef[i] / sum);
+}
+
+void live_decimator_init(live_decimator_t *dec, int factor)
+{
+    if (factor < 1) factor = 1;
+    if (factor > LIVE_FIR_MAX_FACTOR) factor = LIVE_FIR_MAX_FACTOR;
+    dec->factor = factor;
+    dec->taps = (factor == 1) ? 1 : LIVE_FIR_TAPS_PER_FACTOR * factor + 1;
+    dec->head = 0;
+    dec->filled = 0;
+    dec->phase = 0;
+    if (factor == 1) {
+        dec->coef[0] = 1.0f;
+    } else {
+        // Cut off mid-transition; Nyquist of the output is 0.5 / factor
+        fir_design_lowpass(dec->coef, dec->taps,
+                           (LIVE_FIR_PASS + LIVE_FIR_STOP) / 2.0 * 0.5 / factor,
+                           LIVE_FIR_ATTEN_DB);
+    }
+}
+
+bool live_decimator_push(live_decimator_t *dec, const sensor_sample_t *in, sensor_sample_t *out)
+{
+    if (dec->factor == 1) {
+        *out = *in;
+        return true;
+    }
+
+    dec->history[dec->head] = *in;
+    if (++dec->head == dec->taps) dec->head = 0;
+    if (dec->filled < dec->taps) dec->filled++;
+    if (++dec->phase < dec->factor) return false;
+    dec->phase = 0;
+    if (dec->filled < dec->taps) return false;
+
+    float gx = 0.0f, gy = 0.0f, gz = 0.0f;
+    float ax = 0.0f, ay = 0.0f, az = 0.0f;
+    int i = dec->head;
+    for (int k = 0; k < dec->taps; k++) {
+        const sensor_sample_t *s = &dec->history[i];
+        float c = dec->coef[k];
+        gx += c * s->gyro_x;
+        gy += c * s->gyro_y;
+        gz += c * s->gyro_z;
+        ax += c * s->accel_x;
+        ay += c * s->accel_y;
+        az += c * s->accel_z;
+        if (++i == dec->taps) i = 0;
+    }
+
+    int mid = dec->head + dec->taps / 2;
+    if (mid >= dec->taps) mid -= dec->taps;
+    *out = dec->history[mid];
+    out->gyro_x = gx;
+    out->gyro_y = gy;
+    out->gyro_z = gz;
+    out->accel_x = ax;
+    out->accel_y = ay;
+    out->accel_z = az;
+    return true;
+}
@@ -0,0 +1,51 @@
+/*
+ * Anti-aliased decimation of the live stream.
+ *
+ * sensor_task feeds it every sample; every `factor`-th one it hands back a
+ * live sample whose gyro and accel went through a Kaiser-windowed sinc FIR.
+ * The passband is flat (under 0.05 dB) to LIVE_FIR_PASS of the live
+ * Nyquist and the stopband, at least LIVE_FIR_ATTEN_DB down, starts at the
+ * live Nyquist itself, so nothing that can fold back into the live band
+ * gets through the way it did when every n-th sample was picked. Between
+ * the two the response rolls off, -6 dB at 0.8 of Nyquist. Only the kept
+ * outputs are computed (polyphase), about taps / factor multiply-adds per
+ * channel per input sample.
+ *
+ * The output is the history's centre sample with filtered gyro and accel:
+ * its timestamp, seq and orientation are that sample's own (Euler angles
+ * wrap, so they are not filtered), and live samples run (taps - 1) / 2
+ * inputs behind the sensor. The capture ring and the trigger still see
+ * the raw full-rate stream. No ESP-IDF dependencies, so it also builds on
+ * the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sensor_sample.h"
+
+#define LIVE_FIR_TAPS_PER_FACTOR    16      // taps = 16 * factor + 1, what the Kaiser
+                                            // estimate needs for the band below, plus margin
+#define LIVE_FIR_MAX_FACTOR         20      // 1 kHz down to 50 Hz
+#define LIVE_FIR_MAX_TAPS           (LIVE_FIR_TAPS_PER_FACTOR * LIVE_FIR_MAX_FACTOR + 1)
+#define LIVE_FIR_PASS               0.6     // passband edge, fraction of the live Nyquist
+#define LIVE_FIR_STOP               1.0     // stopband edge, the same
+#define LIVE_FIR_ATTEN_DB           50.0    // stopband attenuation the window is sized for
+
+typedef struct {
+    int factor;
+    int taps;
+    float coef[LIVE_FIR_MAX_TAPS];
+    sensor_sample_t history[LIVE_FIR_MAX_TAPS];     // circular, oldest at head once full
+    int head;
+    int filled;
+    int phase;                      // inputs since the last output
+} live_decimator_t;
+
+// Keep one sample in `factor` (clamped to 1..LIVE_FIR_MAX_FACTOR); 1 passes
+// samples straight through. Starts with an empty history.
+void live_decimator_init(live_decimator_t *dec, int factor);
+
+// Feed one sample. Returns true when *out holds the next live sample; none
+// come out until the history has filled once.
+bool live_decimator_push(live_decimator_t *dec, const sensor_sample_t *in, sensor_sample_t *out);
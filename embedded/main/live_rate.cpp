@@ -0,0 +1,105 @@
+/*
+ * Live stream rate controller. See live_rate.h.
+ */
+
+#include "live_rate.h"
+
+// Fastest first. Lower levels batch less often so each datagram stays
+// worth its airtime; the interval is also the worst-case added latency.
+static const live_level_t live_levels[] = {
+    { 400, 25,  -60 },  // 10 samples per batch at 400 Hz
+    { 200, 50,  -72 },
+    { 100, 100, -80 },
+    { 50,  200, -128 }, // floor
+};
+
+static const int NUM_LEVELS = sizeof(live_levels) / sizeof(live_levels[0]);
+
+static void reset_window(live_rate_ctl_t *ctl)
+{
+    ctl->sends = 0;
+    ctl->send_failures = 0;
+    ctl->max_backlog_ms = 0;
+}
+
+void live_rate_init(live_rate_ctl_t *ctl, int level)
+{
+    if (level < 0) level = 0;
+    if (level >= NUM_LEVELS) level = NUM_LEVELS - 1;
+    ctl->level = level;
+    ctl->clean_windows = 0;
+    ctl->pinned = false;
+    reset_window(ctl);
+}
+
+int live_rate_factor(const live_level_t *level, uint16_t sensor_rate_hz)
+{
+    int factor = (sensor_rate_hz + level->rate_hz - 1) / level->rate_hz;
+    return factor < 1 ? 1 : factor;
+}
+
+int live_rate_num_levels(void)
+{
+    return NUM_LEVELS;
+}
+
+bool live_rate_pin(live_rate_ctl_t *ctl, int level)
+{
+    if (level == LIVE_RATE_AUTO) {
+        ctl->pinned = false;
+    } else if (level >= 0 && level < NUM_LEVELS) {
+        ctl->level = level;
+        ctl->pinned = true;
+    } else {
+        return false;
+    }
+    ctl->clean_windows = 0;
+    reset_window(ctl);
+    return true;
+}
+
+const live_level_t *live_rate_level(const live_rate_ctl_t *ctl)
+{
+    return &live_levels[ctl->level];
+}
+
+void live_rate_note_send(live_rate_ctl_t *ctl, bool ok)
+{
+    ctl->sends++;
+    if (!ok) ctl->send_failures++;
+}
+
+void live_rate_note_backlog(live_rate_ctl_t *ctl, uint32_t backlog_ms)
+{
+    if (backlog_ms > ctl->max_backlog_ms) ctl->max_backlog_ms = backlog_ms;
+}
+
+bool live_rate_evaluate(live_rate_ctl_t *ctl, int rssi, uint32_t nacked_in_window)
+{
+    bool known_rssi = rssi != LIVE_RATE_RSSI_NONE;
+    bool congested = ctl->send_failures > 0 || nacked_in_window > 0 ||
+                     ctl->max_backlog_ms > LIVE_RATE_BACKLOG_HIGH_MS;
+    bool too_weak = known_rssi && rssi < live_levels[ctl->level].min_rssi;
+    int old = ctl->level;
+
+    if (ctl->pinned) {
+        reset_window(ctl);
+        return false;
+    }
+    if ((congested || too_weak) && ctl->level < NUM_LEVELS - 1) {
+        ctl->level++;
+        ctl->clean_windows = 0;
+    } else if (congested || too_weak) {
+        ctl->clean_windows = 0;
+    } else if (ctl->level > 0) {
+        ctl->clean_windows++;
+        bool signal_ok = !known_rssi || rssi >= live_levels[ctl->level - 1].min_rssi;
+        if (ctl->clean_windows >= LIVE_RATE_UPGRADE_WINDOWS && signal_ok) {
+            ctl->level--;
+            ctl->clean_windows = 0;
+        }
+    }
+
+    reset_window(ctl);
+    return ctl->level != old;
+}
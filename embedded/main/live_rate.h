@@ -0,0 +1,66 @@
+/*
+ * Live stream rate controller.
+ *
+ * udp_live_task feeds it what it sees on the link (send failures, how far
+ * the live ring backlog has grown, NACKed samples, RSSI) and once per
+ * evaluation window it steps the stream up or down a ladder of levels. A
+ * level caps the live sample rate (sensor_task picks the decimation that
+ * keeps the sensor rate under it, see live_rate_factor()) and sets how often
+ * a batch goes out, so a weak link gets fewer, larger-interval batches at a
+ * lower rate while latency stays bounded by the level's interval. A faster
+ * sensor never makes the live stream heavier than the level allows.
+ *
+ * Degrading is immediate on any bad window; upgrading needs
+ * LIVE_RATE_UPGRADE_WINDOWS clean windows in a row and enough signal for the
+ * level above. A level can also be pinned from the config channel, which
+ * holds it until released. No ESP-IDF dependencies, so it also builds on the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define LIVE_RATE_EVAL_MS           1000    // evaluation window
+#define LIVE_RATE_UPGRADE_WINDOWS   5       // clean windows before stepping up
+#define LIVE_RATE_BACKLOG_HIGH_MS   200     // unsent live data that counts as congestion
+#define LIVE_RATE_RSSI_NONE         127     // RSSI unknown (not associated)
+#define LIVE_RATE_AUTO              -1      // live_rate_pin: back to adaptive
+
+typedef struct {
+    uint16_t rate_hz;               // live samples per second, at most
+    uint16_t interval_ms;           // batch cadence
+    int8_t min_rssi;                // weakest signal this level is allowed on
+} live_level_t;
+
+typedef struct {
+    int level;                      // index into the ladder, 0 = fastest
+    int clean_windows;
+    bool pinned;                    // level fixed by live_rate_pin()
+    // Current window
+    uint32_t sends;
+    uint32_t send_failures;
+    uint32_t max_backlog_ms;
+} live_rate_ctl_t;
+
+void live_rate_init(live_rate_ctl_t *ctl, int level);
+
+// Current level's settings
+const live_level_t *live_rate_level(const live_rate_ctl_t *ctl);
+
+// Decimation of a `sensor_rate_hz` stream that stays within the level's rate
+int live_rate_factor(const live_level_t *level, uint16_t sensor_rate_hz);
+
+// Number of levels in the ladder
+int live_rate_num_levels(void);
+
+// Hold the stream at `level`, or LIVE_RATE_AUTO to let evaluate() move it
+// again. Returns false if the level does not exist.
+bool live_rate_pin(live_rate_ctl_t *ctl, int level);
+
+void live_rate_note_send(live_rate_ctl_t *ctl, bool ok);
+
+// Unsent live data left after a send cycle, in milliseconds of samples
+void live_rate_note_backlog(live_rate_ctl_t *ctl, uint32_t backlog_ms);
+
+// Close the window. Returns true if the level changed (never while pinned).
+bool live_rate_evaluate(live_rate_ctl_t *ctl, int rssi, uint32_t nacked_in_window);
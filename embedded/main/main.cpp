@@ -1,7 +1,15 @@
 /*
  * ESP32-S3 BNO085 IMU — Dual-Mode Streaming (HTTP + UDP)
- * Live 200Hz stream + event capture at 400Hz on swing detection
- * Event: HTTP POST JSON, Live: UDP JSON
+ * Live 200Hz stream + event capture at 400Hz (up to 1kHz) on swing detection
+ * Swing phase marks go out live while the swing is still under way
+ * Event: HTTP POST, Live: UDP (binary wire format or JSON, see WIRE_FORMAT)
+ * over Wi-Fi, or both through an ESP-NOW gateway (transport.h)
+ * With the link down, samples and events spool to flash and go up as a
+ * backlog once it is back (spool.h)
+ * Packets are encoded on Core 1 and only sent from Core 0, through
+ * lock-free slot queues (packet_queue.h)
+ * Rates, thresholds, capture window and server are set at runtime over the
+ * config channel (wire_format.h) and kept in NVS, see config_apply()
  */
 
 #include <stdio.h>
@@ -9,25 +17,51 @@
 #include <math.h>
 #include <sys/time.h>
 #include <time.h>
-#include <stdarg.h>
 #include <stdlib.h>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/event_groups.h"
-#include "freertos/queue.h"
-#include "freertos/semphr.h"
-#include "esp_wifi.h"
-#include "esp_event.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "esp_timer.h"
 #include "esp_system.h"
+#include "esp_mac.h"
 #include "nvs_flash.h"
-#include "esp_netif_sntp.h"
-#include "esp_http_client.h"
-#include "lwip/sockets.h"
+#include "nvs.h"
+#include "esp_partition.h"
 #include "lwip/inet.h"
+#include "sensor_sample.h"
+#include "sample_ring.h"
+#include "sample_view.h"
+#include "capture_ring.h"
+#include "event_pool.h"
+#include "arena.h"
+#include "stroke_classifier.h"
+#include "swing_phase.h"
+#include "phase_tracker.h"
+#include "event_trigger.h"
+#include "activity.h"
+#include "live_rate.h"
+#include "live_decimator.h"
+#include "profile.h"
+#include "transport.h"
+#include "wire_format.h"
+#include "json_format.h"
+#include "spool.h"
+#include "packet_queue.h"
+
+// IMU driver
+#define IMU_DRIVER_COMPONENT    0           // esp32_BNO08x: its own buffers and task, a get() per report
+#define IMU_DRIVER_SHTP         1           // bno085_spi.h: SPI DMA into a buffer pool, shtp.h parses in place
+#define IMU_DRIVER              IMU_DRIVER_SHTP
+
+#if IMU_DRIVER == IMU_DRIVER_SHTP
+#include "driver/gpio.h"
+#include "bno085_spi.h"
+#include "shtp.h"
+#else
 #include "BNO08x.hpp"
+#endif
 
 // ===== Configuration (edit these) =====
 #define WIFI_SSID          "Columbia University"
@@ -35,491 +69,1802 @@
 #define SERVER_IP          "10.206.81.71"
 // #define SERVER_IP          "10.206.99.24"
 #define SERVER_PORT        7103
-#define SERVER_URL         "http://" SERVER_IP ":7103/"
 #define LIVE_UDP_PORT      7104
+#define DEVICE_ID          0            // racquet ID in every packet; 0: from the Wi-Fi MAC
+#define TRANSPORT_DEFAULT  TRANSPORT_WIFI   // until one is saved in NVS, see config_apply()
+#define ESPNOW_CHANNEL     1            // channel the ESP-NOW gateway listens on
 // =======================================
 
 // Sensor timing
-#define SENSOR_PERIOD_US        2500UL      // 400Hz for all reports
-#define SPI_CLOCK_HZ            2000000     // 2MHz SPI
-
-// Live streaming
-#define LIVE_DECIMATION         2           // 400Hz / 2 = 200Hz live output
-#define LIVE_POST_INTERVAL_MS   50          // send live batch every 50ms
+#define SENSOR_PERIOD_US        2500UL      // 400Hz for all reports, until the config changes it
+#define SENSOR_RATE_HZ          (1000000UL / SENSOR_PERIOD_US)
+#define SPI_CLOCK_HZ            3000000     // 3MHz SPI, the BNO085's maximum
+#define RV_MIN_PERIOD_US        2500UL      // rv_game tops out at 400Hz; gyro + accel go to 1kHz
+#define SENSOR_WAIT_TIMEOUT_MS  100         // recover if an INT notification is lost
+#define IMU_START_TIMEOUT_MS    2000        // first Set Feature commands out (IMU_DRIVER_SHTP)
+
+// BNO085 wiring
+#define IMU_SPI_HOST            SPI2_HOST
+#define IMU_PIN_MOSI            GPIO_NUM_11
+#define IMU_PIN_MISO            GPIO_NUM_13
+#define IMU_PIN_SCLK            GPIO_NUM_12
+#define IMU_PIN_CS              GPIO_NUM_10
+#define IMU_PIN_INT             GPIO_NUM_14
+#define IMU_PIN_RST             GPIO_NUM_15
+
+// Live streaming. Decimation and batch interval adapt to the link at
+// runtime (live_rate.h); this is the starting level, 200Hz every 50ms.
+#define LIVE_RATE_START_LEVEL   1
 #define MAX_LIVE_PER_POST       50          // max samples in one live send
 
-// Event detection
-#define ACCEL_THRESHOLD_MS2     30.0f       // ~3g, swing acceleration threshold
+// Wire format (server.py accepts both)
+#define WIRE_FORMAT_JSON        0           // human-readable, ~110 bytes/sample
+#define WIRE_FORMAT_BINARY      1           // wire_format.h, 16 bytes/sample (Q16)
+#define WIRE_FORMAT             WIRE_FORMAT_BINARY
+#define WIRE_SAMPLE_ENCODING    WIRE_ENC_Q16    // event records
+#define WIRE_LIVE_ENCODING      WIRE_ENC_DELTA  // live records (WIRE_ENC_Q16 also works)
+#define LIVE_DATAGRAM_MAX       1400        // keep each live packet in one unfragmented frame
+
+// Event detection (event_trigger.h); defaults, see config_apply()
+#define TRIGGER_GYRO_ON         8.0f        // rad/s, |gyro| on the trigger sample
+#define TRIGGER_ENERGY_ON       5.0f        // rad/s, RMS |gyro| over ~20ms
+#define TRIGGER_ENERGY_OFF      2.0f        // rad/s, re-arm once the swing has died down
+#define TRIGGER_ACCEL_ON        30.0f       // ~3g, swing acceleration ...
+#define TRIGGER_JERK_ON         2000.0f     // m/s^3, ... or a sharp change of it
 #define EVENT_DEBOUNCE_MS       1000        // ignore triggers for 1s after event
-#define EVENT_PRE_SAMPLES       80          // 200ms * 400Hz
+#define EVENT_PRE_SAMPLES       80          // default window: 200ms * 400Hz
 #define EVENT_POST_SAMPLES      120         // 300ms * 400Hz
-
-// Ring buffer
-#define RING_BUF_SIZE           200         // pre + post = 200 samples
-
-// Live queue
-#define LIVE_QUEUE_SIZE         100
+#define EVENT_MAX_SAMPLES       520         // largest pre + post window (1.3s), slot size
+#define EVENT_SEND_RAW_SAMPLES  1           // 0: upload only the on-device phase summary
+#define LIVE_PHASE_MARKS        1           // live accel start / peak / decel end marks (phase_tracker.h)
+#define STROKE_CLASSIFIER       0           // label strokes on the racquet; 1 once stroke_model.h is trained
+#define PHASE_MARK_QUEUE_LEN    8           // power of two, marks waiting for udp_live_task
+#define PHASE_MARK_STALE_MS     300         // too late to coach on, not sent
+
+// Event queue
+#define EVENT_POOL_SLOTS        6           // swings held while uploads are pending
+#define EVENT_DROP_POLICY       EVENT_DROP_OLDEST
+#define EVENT_POLL_MS           100         // upload retry cadence while events are queued
+
+// Power save (activity.h): with no motion for IDLE_AFTER_MS the IMU drops to
+// IDLE_SENSOR_PERIOD_US, live streaming pauses and the radio goes to modem sleep
+#define POWER_SAVE_ENABLED      1
+#define IDLE_AFTER_MS           30000
+#define IDLE_SENSOR_PERIOD_US   20000UL     // 50Hz gyro + accel, rv_game off
+#define IDLE_POLL_MS            1000        // network task wake-up cadence while idle
+#define WIFI_LISTEN_INTERVAL    3           // beacons slept through in max modem sleep
+#define EVENT_BURST_COUNT       3           // upload once this many events are queued (1: no bursts) ...
+#define EVENT_BURST_WAIT_MS     3000        // ... or the oldest has waited this long
+
+// Flash spool (spool.h): with the link down for SPOOL_AFTER_MS, every sample
+// (full rate, while active) and every event goes to the spool partition
+// (partitions.csv) instead, and up in backlog batches once the link is back
+#define SPOOL_ENABLED           1
+#define SPOOL_PARTITION         "spool"
+#define SPOOL_AFTER_MS          1000        // link down this long before spooling starts
+#define SPOOL_RING_SIZE         2048        // power of two, ~5s at 400Hz, ~2s at 1kHz
+#define SPOOL_BATCH_MAX         (64 * 1024) // record bytes per backlog upload
+#define SPOOL_SYNC_INTERVAL_MS  60000       // clock pair into the spool while spooling
+
+// Boot
+#define WIFI_FAST_RECONNECT     1           // cache AP + IP in NVS, skip scan and DHCP next boot
+#define TIME_SYNC_WAIT_MS       10000       // hold the first uploads this long for a wall clock
+#define WALL_CLOCK_VALID_S      1700000000  // gettimeofday() past this: set by SNTP or TIME
+
+// HTTP connection reuse
+#define HTTP_TIMEOUT_MS         2000
+#define HTTP_BACKOFF_MIN_MS     100         // first retry after a failed POST
+#define HTTP_BACKOFF_MAX_MS     5000        // doubling backoff cap
+#define HTTP_REINIT_AFTER_FAILS 8           // rebuild the client after this many in a row
+#define HTTP_BODY_CHUNK         1436        // event body staging buffer, one TCP segment
+#define ESPNOW_ACK_TIMEOUT_MS   3000        // bridge POSTs with a 2s timeout, plus the air
+#define LIVE_PAYLOAD_MAX        8192        // one live datagram (JSON worst case)
+
+// Capture ring (all samples, per channel, sensor_task only)
+#define CAPTURE_RING_SIZE       1024        // power of two, ~2.5s at 400Hz, ~1s at 1kHz
+
+// Live ring (decimated samples, sensor_task -> encode_task)
+#define LIVE_RING_SIZE          256         // power of two, ~1.3s at 200Hz (also the retransmit window)
+
+// Memory and telemetry
+#define ARENA_PREFER_PSRAM      1           // place the buffer arena in PSRAM if present
+#define ARENA_SLACK             256         // alignment padding
+#define STATS_INTERVAL_MS       5000        // heap/stack stats packet over the live channel
+#define CLOCK_SYNC_INTERVAL_MS  1000        // monotonic/wall clock pair for the server's drift fit
+
+// Encode / send pipeline (packet_queue.h): encode_task builds live datagrams
+// and whole event bodies into slot queues; the network tasks only send them
+#define ENCODE_CORE             1           // sensor_task's core has the spare cycles
+#define LIVE_QUEUE_SLOTS        8           // power of two, live datagrams waiting to go out
+#define EVENT_QUEUE_SLOTS       4           // power of two, encoded events waiting to go out (>= a burst)
+#define EVENT_JSON_SAMPLE_MAX   192         // bytes per sample, JSON event body sizing
+#define EVENT_JSON_OVERHEAD     2048        // header fields and phase summary
+
+// Task stacks (bytes); check stack_min_free in the stats packet before shrinking
+#define HTTP_EVENT_STACK        8192
+#define UDP_LIVE_STACK          6144
+#define SENSOR_STACK            8192
+#define ENCODE_STACK            6144
+
+static_assert((CAPTURE_RING_SIZE & (CAPTURE_RING_SIZE - 1)) == 0,
+              "CAPTURE_RING_SIZE must be a power of two");
+static_assert(EVENT_MAX_SAMPLES <= CAPTURE_RING_SIZE, "capture ring shorter than an event");
+static_assert((SPOOL_RING_SIZE & (SPOOL_RING_SIZE - 1)) == 0,
+              "SPOOL_RING_SIZE must be a power of two");
+static_assert((LIVE_QUEUE_SLOTS & (LIVE_QUEUE_SLOTS - 1)) == 0 &&
+              (EVENT_QUEUE_SLOTS & (EVENT_QUEUE_SLOTS - 1)) == 0,
+              "packet queue slot counts must be powers of two");
+static_assert(EVENT_QUEUE_SLOTS >= EVENT_BURST_COUNT, "a burst must fit in the event queue");
+
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+#define LIVE_SLOT_SIZE          LIVE_DATAGRAM_MAX
+#else
+#define LIVE_SLOT_SIZE          LIVE_PAYLOAD_MAX
+#endif
 
 static const char *TAG = "racquet";
 
 // --- Data structures ---
 
-typedef struct __attribute__((packed)) {
-    float euler_x, euler_y, euler_z;
-    float gyro_x, gyro_y, gyro_z;
-    float accel_x, accel_y, accel_z;
-    int64_t timestamp_ms;
-    uint32_t seq;
-} sensor_sample_t;  // 48 bytes
-
 typedef enum {
     STATE_NORMAL,
     STATE_CAPTURING
 } stream_state_t;
 
 typedef struct {
-    int64_t trigger_timestamp_ms;
-    float trigger_gyro_mag;
+    int64_t trigger_timestamp_us;
+    event_trigger_signals_t trigger;    // detector signals on the trigger sample
+    uint32_t pre_samples;
     uint32_t post_samples_needed;
     uint32_t post_samples_count;
 } event_context_t;
 
 // --- Globals ---
 
-// Ring buffer (400Hz, all samples)
-static sensor_sample_t ring_buffer[RING_BUF_SIZE];
-static uint32_t ring_head = 0;
-static uint32_t ring_count = 0;
-
-// Event snapshot (copied from ring buffer when capture completes)
-static sensor_sample_t event_snapshot[RING_BUF_SIZE];
-static volatile int event_snapshot_count = 0;
-static volatile int64_t event_snapshot_trigger_t = 0;
-static volatile bool event_ready = false;
+// Capture ring (400Hz, all samples)
+static capture_ring_t capture_ring;
+
+// Every runtime buffer below is carved out of this arena in app_main
+static arena_t buf_arena;
+
+// Captured events (copied from the capture ring when capture completes), queued
+// for encode_task; see event_pool.h.
+static event_pool_t event_pool;
+static TaskHandle_t http_event_task_handle = NULL;
+static TaskHandle_t encode_task_handle = NULL;
+
+// Encoded packets, encode_task -> the send stages (packet_queue.h): live
+// datagrams for udp_live_task, event bodies for http_event_task
+static packet_queue_t live_queue;
+static packet_queue_t event_queue;
+static std::atomic<uint32_t> live_encode_tail(0);   // live ring index encode_task reads next
+static std::atomic<uint32_t> live_overrun(0);       // live samples lost to ring overrun
+static std::atomic<uint32_t> sensor_gaps(0);        // reports missing while active, sensor_task
+static std::atomic<uint32_t> sensor_gap_max_us(0);
+
+// Phase segmentation of each captured event, run by sensor_task
+static swing_analyzer_t swing_analyzer;
+
+// Live phase marks: sensor_task tracks every sample, udp_live_task sends
+// each mark as soon as it is queued. Single producer, single consumer.
+static phase_tracker_t phase_tracker;
+static phase_mark_t phase_marks[PHASE_MARK_QUEUE_LEN];
+static std::atomic<uint32_t> phase_mark_head(0);    // written by sensor_task
+static std::atomic<uint32_t> phase_mark_tail(0);    // written by udp_live_task
 
 // State
 static stream_state_t current_state = STATE_NORMAL;
 static event_context_t evt_ctx = {};
+// Capture ring index of the first sample at the current report rate, and
+// whether a wake or a rate change has yet to reach it (sensor_task only)
+static uint32_t capture_rate_from = 0;
+static bool capture_rate_settling = false;
+
+// Live ring and sync
+static sample_ring_t live_ring;
+
+// Flash spool, http_event_task's once the tasks run. sensor_task pushes
+// every sample into spool_ring; only the ones from while the link is down
+// are kept.
+static sample_ring_t spool_ring;
+static sample_ring_reader_t spool_reader = {};
+static spool_t spool;
+static bool spool_ok = false;           // partition found and scanned
+static bool spooling = false;           // link down, samples going to flash
+static int64_t spool_sync_us = 0;       // last clock pair spooled
+
+// Link to the server (transport.h). Switched by http_event_task between
+// uploads; see set_transport().
+static std::atomic<const transport_t *> transport(NULL);
+static std::atomic<uint8_t> transport_kind(TRANSPORT_NUM);
+static std::atomic<uint8_t> pending_transport(TRANSPORT_NUM);
+
+// Serializer scratch for what the send stages build themselves: the spool
+// and backlog uploads stage through http_body_buf one TCP segment at a
+// time; retransmits and telemetry are built whole in live_payload_buf.
+static uint8_t *http_body_buf = NULL;      // HTTP_BODY_CHUNK bytes
+static uint8_t *live_payload_buf = NULL;   // LIVE_PAYLOAD_MAX bytes
+
+// Live loss accounting, udp_live_task only
+typedef struct {
+    uint32_t nacked;                // samples the server asked for again
+    uint32_t retransmitted;
+    uint32_t unrecoverable;         // NACKed but already overwritten
+} live_counters_t;
 
-// Queues and sync
-static QueueHandle_t live_queue = NULL;
-static EventGroupHandle_t wifi_event_group = NULL;
-#define WIFI_CONNECTED_BIT BIT0
-
-// HTTP client
-static esp_http_client_handle_t http_client = NULL;
-static int udp_sock = -1;
-static struct sockaddr_in udp_dest_addr = {};
+static live_counters_t live_counters = {};
 
-// Mutex for event snapshot shared between cores
-static SemaphoreHandle_t event_mutex = NULL;
+// Live rate cap, set by udp_live_task's rate controller; sensor_task picks
+// the decimation that keeps under it and runs the anti-aliasing FIR
+static live_rate_ctl_t live_rate;
+static std::atomic<uint16_t> live_max_rate_hz(0);
+static std::atomic<uint16_t> live_interval_ms(0);  // batch interval, for encode_task
+static std::atomic<uint8_t> live_decimation(1);
+static live_decimator_t live_decimator;    // sensor_task only
 
-// --- Ring buffer helpers ---
+// Sensor rate in effect, written by sensor_task when it adopts new settings
+static std::atomic<uint16_t> sensor_rate_hz(SENSOR_RATE_HZ);
 
-static inline void ring_write(const sensor_sample_t *s)
+static uint16_t live_rate_hz(void)
 {
-    ring_buffer[ring_head % RING_BUF_SIZE] = *s;
-    ring_head++;
-    if (ring_count < RING_BUF_SIZE) ring_count++;
+    return (uint16_t)(sensor_rate_hz.load(std::memory_order_relaxed) /
+                      live_decimation.load(std::memory_order_relaxed));
 }
 
-static int ring_copy_recent(sensor_sample_t *dest, int count)
+// Tasks reported in the stats packet
+typedef struct {
+    const char *name;
+    uint32_t stack_size;
+    TaskHandle_t handle;
+} task_entry_t;
+
+enum { TASK_HTTP_EVENT, TASK_UDP_LIVE, TASK_SENSOR, TASK_ENCODE, NUM_TASKS };
+
+static task_entry_t task_table[NUM_TASKS] = {
+    { "http_event", HTTP_EVENT_STACK, NULL },
+    { "udp_live",   UDP_LIVE_STACK,   NULL },
+    { "sensor",     SENSOR_STACK,     NULL },
+    { "encode",     ENCODE_STACK,     NULL },
+};
+
+// INT-driven acquisition: the INT line (IMU_DRIVER_SHTP) or the BNO08x
+// driver's callback stamps the report and wakes sensor_task.
+static TaskHandle_t sensor_task_handle = NULL;
+static volatile uint32_t imu_report_time_us = 0;   // low 32 bits of esp_timer
+
+// activity_mode_t, written by sensor_task, read by the network tasks
+static std::atomic<uint8_t> activity_mode(ACTIVITY_ACTIVE);
+
+static bool racquet_idle(void)
 {
-    if ((uint32_t)count > ring_count) count = (int)ring_count;
-    for (int i = 0; i < count; i++) {
-        uint32_t idx = (ring_head - count + i) % RING_BUF_SIZE;
-        dest[i] = ring_buffer[idx];
-    }
-    return count;
+    return activity_mode.load(std::memory_order_relaxed) == ACTIVITY_IDLE;
 }
 
-// --- Event detection ---
+// Everything sensor_task samples and triggers with, handed over as one
+// snapshot so a change is never seen half-applied
+typedef struct {
+    event_trigger_config_t trigger;
+    uint16_t rate_hz;
+    uint16_t pre_samples;           // capture window, including the trigger sample
+    uint16_t post_samples;
+} sensor_settings_t;
+
+// Set by the config channel, picked up by sensor_task between two samples;
+// the lock is only taken when a change is pending
+static sensor_settings_t pending_sensor_settings;
+static std::atomic<bool> sensor_settings_pending(false);
+static portMUX_TYPE sensor_settings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// --- Sensor settings ---
 
-static inline bool check_event_trigger(const sensor_sample_t *s, float *out_mag)
+static void submit_sensor_settings(const sensor_settings_t *settings)
 {
-    float mag = sqrtf(s->accel_x * s->accel_x +
-                      s->accel_y * s->accel_y +
-                      s->accel_z * s->accel_z);
-    *out_mag = mag;
-    return (mag > ACCEL_THRESHOLD_MS2);
+    taskENTER_CRITICAL(&sensor_settings_lock);
+    pending_sensor_settings = *settings;
+    sensor_settings_pending.store(true, std::memory_order_release);
+    taskEXIT_CRITICAL(&sensor_settings_lock);
+
+    const event_trigger_config_t *cfg = &settings->trigger;
+    printf("Sensor: %u Hz, capture window %u pre + %u post samples\n",
+           (unsigned)settings->rate_hz, (unsigned)settings->pre_samples,
+           (unsigned)settings->post_samples);
+    printf("Trigger: gyro %.1f rad/s, energy %.1f/%.1f rad/s, accel %.1f m/s2, "
+           "jerk %.0f m/s3, debounce %lld ms\n",
+           cfg->gyro_on, cfg->energy_on, cfg->energy_off, cfg->accel_on, cfg->jerk_on,
+           (long long)(cfg->debounce_us / 1000));
 }
 
+// sensor_task side: take the settings submitted since the last sample.
+// Returns false if there are none.
+static bool adopt_sensor_settings(sensor_settings_t *out)
+{
+    if (!sensor_settings_pending.load(std::memory_order_acquire)) return false;
+    taskENTER_CRITICAL(&sensor_settings_lock);
+    *out = pending_sensor_settings;
+    sensor_settings_pending.store(false, std::memory_order_relaxed);
+    taskEXIT_CRITICAL(&sensor_settings_lock);
+    return true;
+}
+
+// --- Event detection ---
+
 static void finalize_event_snapshot(void)
 {
-    int total = EVENT_PRE_SAMPLES + EVENT_POST_SAMPLES;
-    if (xSemaphoreTake(event_mutex, 0) == pdTRUE) {
-        event_snapshot_count = ring_copy_recent(event_snapshot, total);
-        event_snapshot_trigger_t = evt_ctx.trigger_timestamp_ms;
-        event_ready = true;
-        xSemaphoreGive(event_mutex);
-        printf("Event captured: %d samples, trigger=%.1f m/s2\n",
-               event_snapshot_count, evt_ctx.trigger_gyro_mag);
-    }
     current_state = STATE_NORMAL;
+
+    // A window the sensor spent on another report rate would be filtered
+    // and segmented at the wrong one
+    if (capture_rate_settling) {
+        printf("Event dropped: sensor still on its previous report rate\n");
+        return;
+    }
+
+    event_slot_t *slot = event_pool_acquire(&event_pool);
+    if (slot == NULL) {
+        printf("Event dropped: all %d slots pending upload\n", EVENT_POOL_SLOTS);
+        return;
+    }
+
+    PROF_START(prof_t0);
+    uint32_t total = evt_ctx.pre_samples + evt_ctx.post_samples_needed;
+    uint32_t at_rate = capture_ring.head - capture_rate_from;
+    if (total > at_rate) total = at_rate;      // right after a wake: a shorter pre-window
+    slot->count = (int)capture_ring_copy_recent(&capture_ring, &slot->samples, total);
+    slot->trigger_t_us = evt_ctx.trigger_timestamp_us;
+    slot->trigger_mag = evt_ctx.trigger.accel_mag;
+    slot->rate_hz = sensor_rate_hz.load(std::memory_order_relaxed);
+
+    // Segment the swing here so the upload carries the phases; the server
+    // no longer needs the raw samples to coach
+    int64_t t0 = esp_timer_get_time();
+    swing_phase_analyze(&swing_analyzer, &slot->samples, slot->count, &slot->phase);
+    int analyze_us = (int)(esp_timer_get_time() - t0);
+    PROF_END(PROF_SWING_PHASE, prof_t0);
+
+#if STROKE_CLASSIFIER
+    // Label the stroke from the same samples, so the server knows what it
+    // is before any video arrives
+    PROF_START(prof_t1);
+    stroke_result_t stroke;
+    stroke_classify(&slot->samples, &slot->phase, &stroke);
+    slot->phase.stroke = stroke.label;
+    slot->phase.stroke_confidence = stroke.confidence;
+    PROF_END(PROF_STROKE, prof_t1);
+#endif
+
+    event_pool_publish(&event_pool, slot);
+    if (encode_task_handle != NULL) xTaskNotifyGive(encode_task_handle);
+
+    printf("Event captured: %d samples, trigger=%.1f m/s2 (%d pending, %u dropped)\n",
+           slot->count, slot->trigger_mag, event_pool_pending(&event_pool),
+           (unsigned)event_pool.dropped.load(std::memory_order_relaxed));
+    const swing_phase_t *ph = &slot->phase;
+    if (ph->valid) {
+        printf("Swing: accel %lld ms, peak %.1f rad/s, decel %lld ms (analyzed in %d us)\n",
+               (long long)(ph->peak_us - ph->accel_start_us) / 1000, ph->gyro_at_peak,
+               (long long)(ph->decel_end_us - ph->peak_us) / 1000, analyze_us);
+#if STROKE_CLASSIFIER
+        printf("Stroke: %s (%.0f%%)\n", stroke_label_name(stroke.label),
+               stroke.confidence * 100.0f);
+#endif
+    } else {
+        printf("Swing: no gyro peak above %.1f rad/s (max %.1f)\n",
+               SWING_MIN_PEAK_GYRO, ph->peak_gyro);
+    }
 }
 
-// --- Wi-Fi ---
+// --- Device ID ---
 
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data)
+// Stamped into every packet so one server can take several racquets. The
+// low MAC bytes are unique enough for a clinic's worth of them.
+static void device_id_init(void)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
-        printf("Wi-Fi: Connected to AP, waiting for IP...\n");
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        printf("Wi-Fi: Disconnected! Retrying...\n");
-        xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
-        esp_wifi_connect();
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        printf("*** ESP32 IP Address: " IPSTR " ***\n", IP2STR(&event->ip_info.ip));
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+    uint16_t id = DEVICE_ID;
+    uint8_t mac[6];
+    if (id == 0 && esp_read_mac(mac, ESP_MAC_WIFI_STA) == ESP_OK) {
+        id = (uint16_t)((mac[4] << 8) | mac[5]);
     }
+    if (id == 0) id = 1;    // 0 means "unknown" to the server
+    wire_set_device_id(id);
+    printf("Device ID 0x%04x\n", (unsigned)id);
 }
 
-static void wifi_init_sta(void)
+// --- Payload encoding (binary or JSON) ---
+
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+#define PAYLOAD_CONTENT_TYPE    "application/octet-stream"
+#else
+#define PAYLOAD_CONTENT_TYPE    "application/json"
+#endif
+
+// Samples carry esp_timer microseconds; this maps them to wall-clock time.
+// It jumps when SNTP steps the clock, the samples never do.
+static int64_t clock_wall_offset_us(void)
 {
-    wifi_event_group = xEventGroupCreate();
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t mono_us = esp_timer_get_time();
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - mono_us;
+}
 
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+// False until SNTP (or the ESP-NOW gateway's TIME) has set the clock
+static bool wall_clock_valid(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec >= WALL_CLOCK_VALID_S;
+}
 
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+static bool write_payload(byte_sink_t *sink, wire_pkt_type_t type, uint16_t rate_hz,
+                          const sample_view_t *samples, int count, int64_t trigger_t_us,
+                          const swing_phase_t *phase)
+{
+    int64_t wall_offset_us = (type == WIRE_PKT_EVENT) ? clock_wall_offset_us() : 0;
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    // (delta-coded live batches are built by build_live_payload instead)
+    wire_encoding_t enc = (type == WIRE_PKT_LIVE && WIRE_LIVE_ENCODING != WIRE_ENC_DELTA)
+                              ? WIRE_LIVE_ENCODING : WIRE_SAMPLE_ENCODING;
+    return wire_write_packet(sink, type, enc, rate_hz, samples, count, trigger_t_us,
+                             wall_offset_us, phase);
+#else
+    (void)rate_hz;
+    return json_write_payload(sink, type == WIRE_PKT_EVENT ? "event" : "live",
+                              samples, count, trigger_t_us, wall_offset_us, phase);
+#endif
+}
 
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+// Body length known before encoding, or -1 (JSON goes out chunked)
+static int payload_length(wire_pkt_type_t type, int count, bool with_phase)
+{
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    return (int)wire_packet_size(type, WIRE_SAMPLE_ENCODING, count, with_phase);
+#else
+    (void)type;
+    (void)count;
+    (void)with_phase;
+    return -1;
+#endif
+}
 
-    wifi_config_t wifi_config = {};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password));
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_OPEN;
+// Encode a live batch into out (LIVE_SLOT_SIZE bytes) as one UDP datagram.
+// *used is set to how many of the samples made it in; the caller sends the
+// rest next.
+static int build_live_payload(const sensor_sample_t *samples, int count, uint8_t *out,
+                              int *used)
+{
+    sample_view_t view = sample_view_of_records(samples);
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY && WIRE_LIVE_ENCODING == WIRE_ENC_DELTA
+    return wire_build_live_delta(live_rate_hz(), &view, count, out, LIVE_SLOT_SIZE, used);
+#else
+    *used = count;
+    byte_sink_t sink;
+    byte_sink_init(&sink, out, LIVE_SLOT_SIZE, NULL, NULL);
+    if (!write_payload(&sink, WIRE_PKT_LIVE, live_rate_hz(), &view, count, 0, NULL)) return -1;
+    return (int)sink.len;
+#endif
+}
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+// --- Transport ---
 
-    printf("Wi-Fi: Connecting to \"%s\"...\n", WIFI_SSID);
-    esp_wifi_connect();
+static const transport_t *transport_of(uint8_t kind)
+{
+    return kind == TRANSPORT_ESPNOW ? transport_espnow() : transport_wifi();
 }
 
-// --- HTTP JSON helpers ---
+static bool transport_ready(void)
+{
+    const transport_t *tp = transport.load(std::memory_order_acquire);
+    return tp != NULL && tp->ready();
+}
 
-static bool json_append(char **dst, size_t *remaining, const char *fmt, ...)
+// Pick the link to the server. Takes effect when http_event_task next
+// wakes, between two uploads.
+static bool set_transport(uint8_t kind)
 {
-    if (*remaining == 0) return false;
-    va_list args;
-    va_start(args, fmt);
-    int written = vsnprintf(*dst, *remaining, fmt, args);
-    va_end(args);
-    if (written < 0 || (size_t)written >= *remaining) return false;
-    *dst += written;
-    *remaining -= (size_t)written;
+    if (kind >= TRANSPORT_NUM) {
+        printf("Transport %u rejected\n", (unsigned)kind);
+        return false;
+    }
+    pending_transport.store(kind, std::memory_order_release);
+    if (http_event_task_handle != NULL) xTaskNotifyGive(http_event_task_handle);
     return true;
 }
 
-static int build_json_payload(const char *type, const sensor_sample_t *samples,
-                              int count, int64_t trigger_t,
-                              char *out_buf, size_t out_size)
+// http_event_task side (or app_main before the tasks start): stop the old
+// link and start the new one. udp_live_task may still be sending on the old
+// one; those sends just fail.
+static void apply_transport(void)
 {
-    char *p = out_buf;
-    size_t rem = out_size;
+    uint8_t kind = pending_transport.exchange(TRANSPORT_NUM, std::memory_order_acq_rel);
+    if (kind >= TRANSPORT_NUM || kind == transport_kind.load(std::memory_order_relaxed)) return;
+
+    const transport_t *old_tp = transport.load(std::memory_order_relaxed);
+    if (old_tp != NULL) old_tp->stop();
+    const transport_t *tp = transport_of(kind);
+    if (!tp->start()) printf("Transport: %s failed to start\n", tp->name);
+    transport.store(tp, std::memory_order_release);
+    transport_kind.store(kind, std::memory_order_relaxed);
+    printf("Transport: %s\n", tp->name);
+}
 
-    if (!json_append(&p, &rem, "{\"type\":\"%s\",\"samples\":[", type)) return -1;
+// Server endpoint and link kind from `cfg` (the saved config)
+static bool transport_init(const wire_config_t *cfg)
+{
+    transport_wifi_config_t wifi_cfg = {};
+    wifi_cfg.ssid = WIFI_SSID;
+    wifi_cfg.password = WIFI_PASSWORD;
+    wifi_cfg.server_ip = cfg->server_ip;
+    wifi_cfg.http_port = cfg->http_port;
+    wifi_cfg.udp_port = cfg->udp_port;
+    wifi_cfg.content_type = PAYLOAD_CONTENT_TYPE;
+    wifi_cfg.http_timeout_ms = HTTP_TIMEOUT_MS;
+    wifi_cfg.http_reinit_after_fails = HTTP_REINIT_AFTER_FAILS;
+    wifi_cfg.listen_interval = WIFI_LISTEN_INTERVAL;
+    wifi_cfg.cache_link = WIFI_FAST_RECONNECT;
+
+    transport_espnow_config_t espnow_cfg = {};
+    espnow_cfg.channel = ESPNOW_CHANNEL;
+    espnow_cfg.ack_timeout_ms = ESPNOW_ACK_TIMEOUT_MS;
+
+    if (!transport_wifi_init(&wifi_cfg) || !transport_espnow_init(&espnow_cfg)) return false;
+    set_transport(cfg->transport);
+    apply_transport();
+    return true;
+}
 
-    for (int i = 0; i < count; i++) {
-        const sensor_sample_t *s = &samples[i];
-        if (i > 0) {
-            if (!json_append(&p, &rem, ",")) return -1;
-        }
-        if (!json_append(
-                &p, &rem,
-                "{\"t\":%lld,"
-                "\"gyro\":{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f},"
-                "\"accel\":{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f}}",
-                (long long)s->timestamp_ms,
-                s->gyro_x, s->gyro_y, s->gyro_z,
-                s->accel_x, s->accel_y, s->accel_z)) {
-            return -1;
+// --- Server link ---
+
+// Delay before the next attempt after `fails` failed uploads in a row
+static int upload_backoff_ms(int fails)
+{
+    int ms = HTTP_BACKOFF_MIN_MS;
+    for (int i = 1; i < fails && ms < HTTP_BACKOFF_MAX_MS; i++) ms *= 2;
+    return ms < HTTP_BACKOFF_MAX_MS ? ms : HTTP_BACKOFF_MAX_MS;
+}
+
+static bool event_body_write(void *ctx, const uint8_t *data, size_t len)
+{
+    return ((const transport_t *)ctx)->event_write(data, len);
+}
+
+// Largest event body, the event_queue slot size. The phase summary always
+// goes; the raw samples only if asked for.
+static size_t event_body_max(void)
+{
+    int count = EVENT_SEND_RAW_SAMPLES ? EVENT_MAX_SAMPLES : 0;
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    return (size_t)payload_length(WIRE_PKT_EVENT, count, true);
+#else
+    return EVENT_JSON_OVERHEAD + (size_t)count * EVENT_JSON_SAMPLE_MAX;
+#endif
+}
+
+// encode_task: serialize one event whole into an event_queue slot
+static bool encode_event(const event_slot_t *slot, packet_slot_t *out)
+{
+    int count = EVENT_SEND_RAW_SAMPLES ? slot->count : 0;
+    byte_sink_t sink;
+    byte_sink_init(&sink, out->data, event_queue.slot_size, NULL, NULL);
+    sample_view_t view = sample_view_of_block(&slot->samples);
+    if (!write_payload(&sink, WIRE_PKT_EVENT, slot->rate_hz, &view, count,
+                       slot->trigger_t_us, &slot->phase)) {
+        return false;
+    }
+    out->len = (uint32_t)sink.len;
+    out->count = (uint32_t)slot->count;
+    return true;
+}
+
+// Upload one encoded event
+static bool post_event(const transport_t *tp, const packet_slot_t *body)
+{
+    int64_t t0 = esp_timer_get_time();
+    PROF_START(prof_t0);
+
+    bool ok = tp->event_open((int)body->len);
+    if (ok) {
+        bool sent = tp->event_write(body->data, body->len);
+        ok = tp->event_close(sent);
+    }
+
+    PROF_END(PROF_EVENT_POST, prof_t0);
+    int64_t dur_ms = (esp_timer_get_time() - t0) / 1000;
+    if (dur_ms > 500) {
+        printf("%s: upload took %lld ms\n", tp->name, (long long)dur_ms);
+    }
+    return ok;
+}
+
+static bool live_send(const uint8_t *buf, int len)
+{
+    const transport_t *tp = transport.load(std::memory_order_acquire);
+    if (tp == NULL) return false;
+    PROF_START(prof_t0);
+    bool ok = tp->send_datagram(buf, (size_t)len);
+    PROF_END(PROF_LIVE_SEND, prof_t0);
+    return ok;
+}
+
+// --- Telemetry ---
+
+
+// Heap watermarks, arena use, drop counters and per-task stack high-water
+// marks, sent over the live channel every STATS_INTERVAL_MS
+static void send_stats(void)
+{
+    wire_stats_t st = {};
+    st.uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    st.free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    st.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    st.largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    st.arena_used = buf_arena.used;
+    st.arena_size = buf_arena.size;
+    st.live_dropped = live_overrun.load(std::memory_order_relaxed);
+    st.events_dropped = event_pool.dropped.load(std::memory_order_relaxed);
+    st.events_pending = (uint16_t)(event_pool_pending(&event_pool) +
+                                   (int)packet_queue_depth(&event_queue));
+    st.live_nacked = live_counters.nacked;
+    st.live_retransmitted = live_counters.retransmitted;
+    st.live_unrecoverable = live_counters.unrecoverable;
+    st.live_rate_hz = live_rate_hz();
+    st.sensor_gaps = sensor_gaps.load(std::memory_order_relaxed);
+    st.sensor_gap_max_us = sensor_gap_max_us.load(std::memory_order_relaxed);
+
+    wire_task_stats_t tasks[NUM_TASKS] = {};
+    for (int i = 0; i < NUM_TASKS; i++) {
+        strncpy(tasks[i].name, task_table[i].name, WIRE_TASK_NAME_LEN);
+        tasks[i].stack_size = task_table[i].stack_size;
+        if (task_table[i].handle != NULL) {
+            tasks[i].stack_min_free = uxTaskGetStackHighWaterMark(task_table[i].handle);
         }
     }
 
-    if (!json_append(&p, &rem, "]")) return -1;
+    int64_t t_us = esp_timer_get_time();
+
+    byte_sink_t sink;
+    byte_sink_init(&sink, live_payload_buf, LIVE_PAYLOAD_MAX, NULL, NULL);
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    bool ok = wire_write_stats(&sink, t_us, &st, tasks, NUM_TASKS);
+#else
+    bool ok = json_write_stats(&sink, t_us, &st, tasks, NUM_TASKS);
+#endif
+    if (ok) live_send(live_payload_buf, (int)sink.len);
+}
+
+#if PROFILE_ENABLED
+// Per-stage cycle histograms since the last call, sent right after the stats
+static void send_profile(void)
+{
+    static int64_t last_us = 0;
+    int64_t now_us = esp_timer_get_time();
+    prof_summary_t summary[PROF_NUM_STAGES];
+    int n = profile_snapshot(summary);
+
+    wire_profile_ext_t ext = {};
+    ext.cpu_mhz = (uint16_t)profile_cpu_mhz();
+    ext.window_ms = (uint32_t)((now_us - last_us) / 1000);
+    last_us = now_us;
+    wire_profile_stage_t stages[PROF_NUM_STAGES] = {};
+    for (int i = 0; i < n; i++) {
+        memcpy(stages[i].name, summary[i].name, WIRE_PROFILE_NAME_LEN);
+        stages[i].count = summary[i].count;
+        stages[i].min_cycles = summary[i].min;
+        stages[i].p50_cycles = summary[i].p50;
+        stages[i].p99_cycles = summary[i].p99;
+        stages[i].max_cycles = summary[i].max;
+    }
+
+    byte_sink_t sink;
+    byte_sink_init(&sink, live_payload_buf, LIVE_PAYLOAD_MAX, NULL, NULL);
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    bool ok = wire_write_profile(&sink, now_us, &ext, stages, n);
+#else
+    bool ok = json_write_profile(&sink, now_us, &ext, stages, n);
+#endif
+    if (ok) live_send(live_payload_buf, (int)sink.len);
+}
+#endif
+
+// One (monotonic, wall) clock pair. The server fits the drift between the
+// two over recent pairs to put live samples on its own timeline.
+static void send_clock_sync(void)
+{
+    wire_clock_t clock;
+    clock.mono_us = esp_timer_get_time();
+    clock.wall_us = clock.mono_us + clock_wall_offset_us();
+
+    byte_sink_t sink;
+    byte_sink_init(&sink, live_payload_buf, LIVE_PAYLOAD_MAX, NULL, NULL);
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    bool ok = wire_write_sync(&sink, &clock);
+#else
+    bool ok = json_write_sync(&sink, &clock);
+#endif
+    if (ok) live_send(live_payload_buf, (int)sink.len);
+}
+
+// --- Live phase marks ---
 
-    if (strcmp(type, "event") == 0) {
-        if (!json_append(&p, &rem, ",\"trigger_t\":%lld", (long long)trigger_t)) return -1;
+// sensor_task: hand a mark to udp_live_task and wake it. A full queue
+// drops the mark; the event still carries the phases.
+static void queue_phase_mark(const phase_mark_t *mark)
+{
+    uint32_t head = phase_mark_head.load(std::memory_order_relaxed);
+    if (head - phase_mark_tail.load(std::memory_order_acquire) >= PHASE_MARK_QUEUE_LEN) return;
+    phase_marks[head & (PHASE_MARK_QUEUE_LEN - 1)] = *mark;
+    phase_mark_head.store(head + 1, std::memory_order_release);
+    if (task_table[TASK_UDP_LIVE].handle != NULL) xTaskNotifyGive(task_table[TASK_UDP_LIVE].handle);
+}
+
+// udp_live_task: one datagram per mark, ahead of the live batch
+static void send_phase_marks(void)
+{
+    uint32_t head = phase_mark_head.load(std::memory_order_acquire);
+    uint32_t tail = phase_mark_tail.load(std::memory_order_relaxed);
+    int64_t now_us = esp_timer_get_time();
+    for (; tail != head; tail++) {
+        const phase_mark_t *mark = &phase_marks[tail & (PHASE_MARK_QUEUE_LEN - 1)];
+        if (now_us - mark->detected_us > (int64_t)PHASE_MARK_STALE_MS * 1000) continue;
+        byte_sink_t sink;
+        byte_sink_init(&sink, live_payload_buf, LIVE_PAYLOAD_MAX, NULL, NULL);
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+        bool ok = wire_write_phase_mark(&sink, mark);
+#else
+        bool ok = json_write_phase_mark(&sink, mark);
+#endif
+        if (ok) live_send(live_payload_buf, (int)sink.len);
     }
+    phase_mark_tail.store(tail, std::memory_order_release);
+}
 
-    if (!json_append(&p, &rem, "}")) return -1;
+// --- Config channel ---
 
-    return (int)(p - out_buf);
+// Report rates the BNO085 is run at; the capture window is in samples, so
+// it covers more time at the lower ones. 1000 is the high-rate mode: gyro
+// and accel at 1kHz into the capture ring for sharper peak speeds, rv_game
+// held at 400Hz, and the live stream still capped by the rate ladder.
+static const uint16_t sensor_rates_hz[] = { 100, 200, 400, 1000 };
+
+// Settings in effect. Set up by config_init() at boot, then owned by
+// udp_live_task, which serves the config channel.
+static wire_config_t config;
+
+// The compile-time defaults above
+static void config_defaults(wire_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->transport = TRANSPORT_DEFAULT;
+    cfg->sensor_rate_hz = SENSOR_RATE_HZ;
+    cfg->pre_samples = EVENT_PRE_SAMPLES;
+    cfg->post_samples = EVENT_POST_SAMPLES;
+    cfg->live_level = WIRE_LIVE_LEVEL_AUTO;
+    cfg->gyro_on = TRIGGER_GYRO_ON;
+    cfg->energy_on = TRIGGER_ENERGY_ON;
+    cfg->energy_off = TRIGGER_ENERGY_OFF;
+    cfg->accel_on = TRIGGER_ACCEL_ON;
+    cfg->jerk_on = TRIGGER_JERK_ON;
+    cfg->debounce_ms = EVENT_DEBOUNCE_MS;
+    strncpy(cfg->server_ip, SERVER_IP, sizeof(cfg->server_ip) - 1);
+    cfg->http_port = SERVER_PORT;
+    cfg->udp_port = LIVE_UDP_PORT;
 }
 
-static bool http_post_json(const char *json, int len)
+static event_trigger_config_t config_trigger(const wire_config_t *cfg)
 {
-    if (http_client == NULL) return false;
+    event_trigger_config_t trig = {
+        cfg->gyro_on, cfg->energy_on, cfg->energy_off,
+        cfg->accel_on, cfg->jerk_on, cfg->debounce_ms * 1000LL,
+    };
+    return trig;
+}
 
-    esp_http_client_set_url(http_client, SERVER_URL);
-    esp_http_client_set_method(http_client, HTTP_METHOD_POST);
-    esp_http_client_set_header(http_client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(http_client, json, len);
+// Why `cfg` cannot be applied, or NULL if it can
+static const char *config_error(const wire_config_t *cfg)
+{
+    bool rate_ok = false;
+    for (uint16_t rate : sensor_rates_hz) rate_ok = rate_ok || cfg->sensor_rate_hz == rate;
+    if (!rate_ok) return "sensor rate not 100, 200, 400 or 1000 Hz";
+    if (cfg->pre_samples < 1 || cfg->pre_samples + cfg->post_samples > EVENT_MAX_SAMPLES) {
+        return "capture window needs pre >= 1 and pre + post <= EVENT_MAX_SAMPLES";
+    }
+    event_trigger_config_t trig = config_trigger(cfg);
+    if (!event_trigger_config_valid(&trig)) return "trigger thresholds need all > 0, energy off < on";
+    if (cfg->live_level != WIRE_LIVE_LEVEL_AUTO && cfg->live_level >= live_rate_num_levels()) {
+        return "no such live level";
+    }
+    struct in_addr addr;
+    if (memchr(cfg->server_ip, '\0', sizeof(cfg->server_ip)) == NULL ||
+        inet_aton(cfg->server_ip, &addr) == 0 || cfg->http_port == 0 || cfg->udp_port == 0) {
+        return "bad server endpoint";
+    }
+    if (cfg->transport >= TRANSPORT_NUM) return "no such transport";
+    return NULL;
+}
 
-    int64_t t0 = esp_timer_get_time();
+static void config_submit_sensor(const wire_config_t *cfg)
+{
+    sensor_settings_t settings;
+    settings.trigger = config_trigger(cfg);
+    settings.rate_hz = cfg->sensor_rate_hz;
+    settings.pre_samples = cfg->pre_samples;
+    settings.post_samples = cfg->post_samples;
+    submit_sensor_settings(&settings);
+}
 
-    esp_err_t err = esp_http_client_perform(http_client);
-    int64_t dur_ms = (esp_timer_get_time() - t0) / 1000;
-    if (dur_ms > 500) {
-        printf("HTTP: POST took %lld ms\n", (long long)dur_ms);
-    }
-
-    if (err != ESP_OK) {
-        printf("HTTP: POST failed: %s (%lld ms) | heap=%u\n",
-               esp_err_to_name(err), (long long)dur_ms,
-               (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT));
-        // Tear down and recreate client to recover from stale connections
-        esp_http_client_cleanup(http_client);
-        esp_http_client_config_t config = {};
-        config.url = SERVER_URL;
-        config.timeout_ms = 2000;
-        config.keep_alive_enable = false;
-        http_client = esp_http_client_init(&config);
-        return false;
+// udp_live_task (or app_main before it starts): the rate controller's
+// level, for sensor_task's decimation and encode_task's batch interval
+static void publish_live_level(void)
+{
+    const live_level_t *level = live_rate_level(&live_rate);
+    live_max_rate_hz.store(level->rate_hz, std::memory_order_relaxed);
+    live_interval_ms.store(level->interval_ms, std::memory_order_relaxed);
+}
+
+// udp_live_task (or app_main before it starts): it owns the rate controller
+static void config_pin_live_level(uint8_t level)
+{
+    live_rate_pin(&live_rate, level == WIRE_LIVE_LEVEL_AUTO ? LIVE_RATE_AUTO : level);
+    publish_live_level();
+}
+
+// The flash write stalls both cores for a few ms; configs change rarely
+static void config_save(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open("racquet", NVS_READWRITE, &nvs) != ESP_OK) return;
+    nvs_set_blob(nvs, "config", &config, sizeof(config));
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+// Answer a request with the settings now in effect
+static void send_config_ack(const wire_config_t *req, uint8_t status)
+{
+    wire_config_t ack = config;
+    ack.request_id = req->request_id;
+    ack.status = status;
+    ack.set = status == WIRE_CFG_OK ? (req->set & WIRE_CFG_ALL) : 0;
+
+    int64_t t_us = esp_timer_get_time();
+    byte_sink_t sink;
+    byte_sink_init(&sink, live_payload_buf, LIVE_PAYLOAD_MAX, NULL, NULL);
+#if WIRE_FORMAT == WIRE_FORMAT_BINARY
+    bool ok = wire_write_config_ack(&sink, t_us, &ack);
+#else
+    bool ok = json_write_config_ack(&sink, t_us, &ack);
+#endif
+    if (ok) live_send(live_payload_buf, (int)sink.len);
+}
+
+// Apply the fields named in the request's set mask, all of them or none,
+// save the result and ack it. Sensor settings land in sensor_task between
+// two samples, a transport change in http_event_task between two uploads.
+static void config_apply(const wire_config_t *req)
+{
+    uint32_t set = req->set & WIRE_CFG_ALL;
+    wire_config_t next = config;
+    if (set & WIRE_CFG_SENSOR_RATE) next.sensor_rate_hz = req->sensor_rate_hz;
+    if (set & WIRE_CFG_TRIGGER) {
+        next.gyro_on = req->gyro_on;
+        next.energy_on = req->energy_on;
+        next.energy_off = req->energy_off;
+        next.accel_on = req->accel_on;
+        next.jerk_on = req->jerk_on;
+        next.debounce_ms = req->debounce_ms;
+    }
+    if (set & WIRE_CFG_CAPTURE) {
+        next.pre_samples = req->pre_samples;
+        next.post_samples = req->post_samples;
+    }
+    if (set & WIRE_CFG_LIVE_LEVEL) next.live_level = req->live_level;
+    if (set & WIRE_CFG_SERVER) {
+        memcpy(next.server_ip, req->server_ip, sizeof(next.server_ip));
+        next.http_port = req->http_port;
+        next.udp_port = req->udp_port;
     }
+    if (set & WIRE_CFG_TRANSPORT) next.transport = req->transport;
 
-    int status = esp_http_client_get_status_code(http_client);
-    esp_http_client_close(http_client);
-    if (status != 200) {
-        printf("HTTP: Non-200 status: %d\n", status);
-        return false;
+    const char *err = config_error(&next);
+    if (err != NULL) {
+        printf("Config %u rejected: %s\n", (unsigned)req->request_id, err);
+        send_config_ack(req, WIRE_CFG_REJECTED);
+        return;
+    }
+    if (set == 0) {
+        send_config_ack(req, WIRE_CFG_OK);
+        return;
+    }
+
+    if (set & (WIRE_CFG_SENSOR_RATE | WIRE_CFG_TRIGGER | WIRE_CFG_CAPTURE)) {
+        config_submit_sensor(&next);
+    }
+    if (set & WIRE_CFG_LIVE_LEVEL) config_pin_live_level(next.live_level);
+    if (set & WIRE_CFG_TRANSPORT) set_transport(next.transport);
+    config = next;
+    config_save();
+    printf("Config %u applied (fields 0x%02x)\n", (unsigned)req->request_id, (unsigned)set);
+    send_config_ack(req, WIRE_CFG_OK);
+
+    // After the ack, so that still reaches the server that asked
+    if (set & WIRE_CFG_SERVER) {
+        transport_wifi_set_server(next.server_ip, next.http_port, next.udp_port);
     }
-    return true;
 }
 
-static bool udp_send_json(const char *json, int len)
+// Boot: the saved config, or the defaults if there is none or it no longer
+// passes the checks (saved by an older build)
+static void config_init(void)
 {
-    if (udp_sock < 0) return false;
-    int sent = sendto(udp_sock, json, len, 0,
-                      (struct sockaddr *)&udp_dest_addr, sizeof(udp_dest_addr));
-    if (sent != len) {
-        printf("UDP: sendto failed (sent=%d, len=%d)\n", sent, len);
-        return false;
+    config_defaults(&config);
+    nvs_handle_t nvs;
+    if (nvs_open("racquet", NVS_READONLY, &nvs) == ESP_OK) {
+        wire_config_t saved;
+        size_t len = sizeof(saved);
+        uint8_t kind;
+        if (nvs_get_blob(nvs, "config", &saved, &len) == ESP_OK && len == sizeof(saved)) {
+            const char *err = config_error(&saved);
+            if (err == NULL) {
+                config = saved;
+                printf("Config: loaded from NVS\n");
+            } else {
+                printf("Config: saved one rejected (%s), using defaults\n", err);
+            }
+        } else if (nvs_get_u8(nvs, "transport", &kind) == ESP_OK && kind < TRANSPORT_NUM) {
+            config.transport = kind;    // picked before there was a config blob
+        }
+        nvs_close(nvs);
     }
-    return true;
+    config.request_id = 0;
+    config.status = WIRE_CFG_OK;
+    config.set = WIRE_CFG_ALL;
+    config_submit_sensor(&config);
+    config_pin_live_level(config.live_level);
 }
 
-// --- HTTP event send task (Core 0) ---
+// --- Flash spool ---
 
-static void http_event_task(void *pvParameters)
+#if SPOOL_ENABLED
+static bool partition_read(void *ctx, uint32_t addr, void *buf, size_t len)
 {
-    ESP_LOGI(TAG, "HTTP event task waiting for Wi-Fi...");
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT,
-                        pdFALSE, pdTRUE, portMAX_DELAY);
-
-    // Sync real time via SNTP
-    esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
-    esp_netif_sntp_init(&sntp_config);
-    printf("Syncing time via SNTP...\n");
-    if (esp_netif_sntp_sync_wait(pdMS_TO_TICKS(15000)) == ESP_OK) {
-        time_t now;
-        struct tm timeinfo;
-        time(&now);
-        localtime_r(&now, &timeinfo);
-        printf("Time synced: %04d-%02d-%02d %02d:%02d:%02d UTC\n",
-               timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-               timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-    } else {
-        printf("SNTP sync failed, using uptime timestamps.\n");
+    return esp_partition_read((const esp_partition_t *)ctx, addr, buf, len) == ESP_OK;
+}
+
+static bool partition_write(void *ctx, uint32_t addr, const void *buf, size_t len)
+{
+    return esp_partition_write((const esp_partition_t *)ctx, addr, buf, len) == ESP_OK;
+}
+
+static bool partition_erase(void *ctx, uint32_t addr)
+{
+    return esp_partition_erase_range((const esp_partition_t *)ctx, addr, SPOOL_SECTOR_SIZE) == ESP_OK;
+}
+
+// Boots so far, counted in NVS. Spooled records carry it so the server
+// knows which run of the monotonic clock they were stamped with.
+static uint32_t boot_count(void)
+{
+    uint32_t n = 0;
+    nvs_handle_t nvs;
+    if (nvs_open("racquet", NVS_READWRITE, &nvs) != ESP_OK) return 0;
+    nvs_get_u32(nvs, "boots", &n);
+    nvs_set_u32(nvs, "boots", ++n);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+    return n;
+}
+
+// Boot: find the partition and pick up the backlog the last boot left
+static void spool_open(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_ANY,
+                                                           ESP_PARTITION_SUBTYPE_ANY,
+                                                           SPOOL_PARTITION);
+    if (part == NULL) {
+        printf("Spool: no \"%s\" partition, nothing is kept while offline\n", SPOOL_PARTITION);
+        return;
     }
+    spool_flash_t flash = { partition_read, partition_write, partition_erase, (void *)part,
+                            part->size - part->size % SPOOL_SECTOR_SIZE };
+    uint32_t boot = boot_count();
+    spool_ok = spool_init(&spool, &flash, boot);
+    if (!spool_ok) {
+        printf("Spool: partition unusable\n");
+        return;
+    }
+    printf("Spool: %u KB, %u KB waiting for upload (boot %u)\n", (unsigned)(flash.size / 1024),
+           (unsigned)(spool_pending_bytes(&spool) / 1024), (unsigned)boot);
+}
+
+// Clock pair as of now, so records from this boot can be put on the wall
+// clock even if the racquet restarts before they are uploaded
+static void spool_clock(void)
+{
+    wire_clock_t clock;
+    clock.mono_us = esp_timer_get_time();
+    clock.wall_us = clock.mono_us + clock_wall_offset_us();
+    byte_sink_t sink;
+    byte_sink_init(&sink, http_body_buf, HTTP_BODY_CHUNK, NULL, NULL);
+    if (wire_write_sync(&sink, &clock)) spool_append(&spool, http_body_buf, sink.len);
+}
 
-    // Init HTTP client
-    esp_http_client_config_t config = {};
-    config.url = SERVER_URL;
-    config.timeout_ms = 2000;
-    config.keep_alive_enable = false;
-    http_client = esp_http_client_init(&config);
+// Samples since the link was last up, as full-rate delta batches one
+// staging buffer long
+static void spool_samples(void)
+{
+    uint16_t rate_hz = sensor_rate_hz.load(std::memory_order_relaxed);
+    const sensor_sample_t *span = NULL;
+    uint32_t n;
+    while ((n = sample_ring_peek(&spool_ring, &spool_reader, UINT16_MAX, &span)) > 0) {
+        uint32_t first = spool_reader.tail;
+        sample_view_t view = sample_view_of_records(span);
+        int used = 0;
+        int len = wire_build_live_delta(rate_hz, &view, (int)n, http_body_buf, HTTP_BODY_CHUNK,
+                                        &used);
+        if (len <= 0) break;
+        // Producer lapped us while encoding: the batch may be torn, drop it
+        if (sample_ring_intact(&spool_ring, first) &&
+            !spool_append(&spool, http_body_buf, (size_t)len)) {
+            printf("Spool: write failed\n");
+            break;
+        }
+        sample_ring_consume(&spool_reader, (uint32_t)used);
+    }
+}
 
-    printf("HTTP event task started.\n");
+// http_event_task, link down: after SPOOL_AFTER_MS, move the encoded events
+// and the samples into the spool every pass
+static void spool_link_down(int64_t down_since_us)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (!spool_ok || now_us - down_since_us < (int64_t)SPOOL_AFTER_MS * 1000) return;
+    if (!spooling || now_us - spool_sync_us >= (int64_t)SPOOL_SYNC_INTERVAL_MS * 1000) {
+        if (!spooling) printf("Spool: link down, spooling to flash\n");
+        spooling = true;
+        spool_clock();
+        spool_sync_us = now_us;
+    }
 
-    while (1) {
-        // Sleep until there's an event to send
-        vTaskDelay(pdMS_TO_TICKS(100));
+    packet_slot_t *body;
+    while ((body = packet_queue_peek(&event_queue)) != NULL) {
+        if (!spool_append(&spool, body->data, body->len)) break;
+        printf("Event spooled (%u samples)\n", (unsigned)body->count);
+        packet_queue_pop(&event_queue);
+        if (encode_task_handle != NULL) xTaskNotifyGive(encode_task_handle);
+    }
+    spool_samples();
+}
 
-        EventBits_t bits = xEventGroupGetBits(wifi_event_group);
-        if (!(bits & WIFI_CONNECTED_BIT)) continue;
+// http_event_task, link up: nothing to keep, so the next outage is spooled
+// from the last moment the link was up
+static void spool_link_up(void)
+{
+    if (spooling) {
+        printf("Spool: link back, %u KB to upload\n",
+               (unsigned)(spool_pending_bytes(&spool) / 1024));
+        spooling = false;
+    }
+    spool_reader.tail = sample_ring_head(&spool_ring);
+}
 
-        if (!event_ready) continue;
+// Link up and no fresh event waiting: upload the next batch of the
+// backlog. True if more is waiting.
+static bool upload_backlog(const transport_t *tp, int *fail_streak)
+{
+    spool_batch_t batch;
+    if (!spool_ok || !spool_batch_plan(&spool, SPOOL_BATCH_MAX, &batch)) return false;
+
+    int len = (int)(sizeof(wire_header_t) + sizeof(wire_backlog_ext_t) + batch.bytes);
+    bool ok = tp->event_open(len);
+    if (ok) {
+        byte_sink_t sink;
+        byte_sink_init(&sink, http_body_buf, HTTP_BODY_CHUNK, event_body_write, (void *)tp);
+        bool sent = wire_write_backlog_header(&sink, esp_timer_get_time(), clock_wall_offset_us(),
+                                              spool.boot_id, (int)batch.records) &&
+                    spool_batch_read(&spool, &batch, &sink) && byte_sink_flush(&sink);
+        ok = tp->event_close(sent);
+    }
+    if (!ok) {
+        int backoff = upload_backoff_ms(++*fail_streak);
+        printf("Backlog send failed, retrying in %d ms.\n", backoff);
+        vTaskDelay(pdMS_TO_TICKS(backoff));
+        return false;
+    }
+    *fail_streak = 0;
+    spool_batch_done(&spool, &batch);
+    bool more = spool_pending(&spool);
+    printf("Backlog: %u records sent, %u KB still spooled\n", (unsigned)batch.records,
+           (unsigned)(spool_pending_bytes(&spool) / 1024));
+    return more;
+}
+#endif
 
-        // Take mutex to safely read the snapshot
-        if (xSemaphoreTake(event_mutex, pdMS_TO_TICKS(50)) != pdTRUE) continue;
+// --- HTTP event send task (Core 0) ---
 
-        size_t max_size = 65536;
-        char *json = (char *)malloc(max_size);
-        if (json == NULL) {
-            xSemaphoreGive(event_mutex);
-            printf("HTTP: OOM building event JSON\n");
+static void http_event_task(void *pvParameters)
+{
+    printf("HTTP event task started.\n");
+    int64_t queued_since_us = 0;        // when the oldest unsent event was first seen
+    int fail_streak = 0;                // failed uploads in a row, for the backoff
+    int64_t down_since_us = 0;          // when the link went down, 0 while it is up
+    bool backlog = false;               // more spooled records to upload right away
+
+    while (1) {
+        // Sleep until encode_task queues an event, unless the backlog is
+        // being uploaded
+        TickType_t wait = pdMS_TO_TICKS(racquet_idle() ? IDLE_POLL_MS : EVENT_POLL_MS);
+        ulTaskNotifyTake(pdTRUE, backlog ? 0 : wait);
+        backlog = false;
+
+        apply_transport();
+        const transport_t *tp = transport.load(std::memory_order_relaxed);
+        if (!tp->ready()) {
+#if SPOOL_ENABLED
+            if (down_since_us == 0) down_since_us = esp_timer_get_time();
+            spool_link_down(down_since_us);
+#endif
             continue;
         }
-        int snap_count = event_snapshot_count;
-        int64_t snap_trigger = event_snapshot_trigger_t;
-        int len = build_json_payload("event", event_snapshot, snap_count,
-                                     snap_trigger, json, max_size);
-        xSemaphoreGive(event_mutex);
-
-        if (len <= 0) {
-            printf("HTTP: Event JSON build failed (count=%d, heap=%u)\n",
-                   snap_count, (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT));
-            free(json);
+#if SPOOL_ENABLED
+        down_since_us = 0;
+        spool_link_up();
+#endif
+
+        // Backlog batches carry the wall clock offset at upload time, so
+        // records from before the first time sync are stamped right if they
+        // wait for it (encode_task holds the events back the same way)
+        if (!wall_clock_valid() && esp_timer_get_time() < (int64_t)TIME_SYNC_WAIT_MS * 1000) {
             continue;
         }
 
-        bool ok = http_post_json(json, len);
-        free(json);
-
-        if (ok) {
-            event_ready = false;
-            printf("Event sent (%d samples)\n", snap_count);
-        } else {
-            printf("Event send failed, will retry.\n");
+        // Upload in bursts so the radio wakes once for several swings: when
+        // enough have queued, the oldest has waited long enough, the pool
+        // is about to drop, or the racquet has gone idle. Events count from
+        // capture, whether encode_task has got to them yet or not.
+        int in_pool = event_pool_pending(&event_pool);
+        int pending = in_pool + (int)packet_queue_depth(&event_queue);
+        int64_t now_us = esp_timer_get_time();
+        if (pending == 0) {
+            queued_since_us = 0;
+        } else if (queued_since_us == 0) {
+            queued_since_us = now_us;
+        }
+        bool burst_due = pending > 0 &&
+                         (pending >= EVENT_BURST_COUNT || in_pool >= EVENT_POOL_SLOTS - 1 ||
+                          now_us - queued_since_us >= (int64_t)EVENT_BURST_WAIT_MS * 1000 ||
+                          racquet_idle());
+
+        // Drain the encoded events oldest first, back to back on the open
+        // connection; a body stays queued until the server has it
+        packet_slot_t *body;
+        while (burst_due && (body = packet_queue_peek(&event_queue)) != NULL) {
+            bool ok = post_event(tp, body);
+            if (ok) {
+                fail_streak = 0;
+                printf("Event sent (%u samples, %d still pending)\n", (unsigned)body->count,
+                       event_pool_pending(&event_pool) + (int)packet_queue_depth(&event_queue) - 1);
+                packet_queue_pop(&event_queue);
+                // A slot is free: let encode_task fill it while this one goes
+                if (encode_task_handle != NULL) xTaskNotifyGive(encode_task_handle);
+            } else {
+                int backoff = upload_backoff_ms(++fail_streak);
+                printf("Event send failed, retrying in %d ms.\n", backoff);
+                vTaskDelay(pdMS_TO_TICKS(backoff));
+                break;
+            }
+        }
+        bool drained = event_pool_pending(&event_pool) == 0 &&
+                       packet_queue_depth(&event_queue) == 0;
+        if (drained) queued_since_us = 0;
+
+#if SPOOL_ENABLED
+        // Then the backlog, a batch per pass so fresh events go first
+        if (!burst_due || drained) {
+            backlog = upload_backlog(tp, &fail_streak);
         }
+#endif
     }
 }
 
 // --- UDP live send task (Core 0) ---
 
-static void udp_live_task(void *pvParameters)
+// Resend live samples [first, first + count) if the ring still holds them
+static void retransmit_live(uint32_t first, uint32_t count)
 {
-    sensor_sample_t batch[MAX_LIVE_PER_POST];
+    live_counters.nacked += count;
+    while (count > 0) {
+        const sensor_sample_t *span = NULL;
+        uint32_t n = sample_ring_range(&live_ring, first, count, &span);
+        if (n == 0) break;
+        int used = 0;
+        int len = build_live_payload(span, (int)n, live_payload_buf, &used);
+        if (len <= 0 || !sample_ring_intact(&live_ring, first)) break;
+        if (!live_send(live_payload_buf, len)) break;
+        live_counters.retransmitted += (uint32_t)used;
+        first += (uint32_t)used;
+        count -= (uint32_t)used;
+    }
+    live_counters.unrecoverable += count;
+}
 
-    ESP_LOGI(TAG, "UDP live task waiting for Wi-Fi...");
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT,
-                        pdFALSE, pdTRUE, portMAX_DELAY);
+// Answer what the server sent back on the live channel: NACKs and config
+// requests
+static void serve_control(void)
+{
+    uint8_t rx[sizeof(wire_header_t) + sizeof(wire_nack_range_t) * WIRE_NACK_MAX_RANGES];
+    wire_nack_range_t ranges[WIRE_NACK_MAX_RANGES];
+    wire_config_t req;
+    const transport_t *tp = transport.load(std::memory_order_acquire);
+    int len;
+    while ((len = tp->recv_control(rx, sizeof(rx))) > 0) {
+        int n = wire_parse_nack(rx, (size_t)len, ranges, WIRE_NACK_MAX_RANGES);
+        for (int i = 0; i < n; i++) retransmit_live(ranges[i].first_seq, ranges[i].count);
+        if (n < 0 && wire_parse_config(rx, (size_t)len, &req)) config_apply(&req);
+    }
+}
 
-    // Init UDP socket
-    udp_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (udp_sock < 0) {
-        printf("UDP: socket() failed\n");
-        vTaskDelete(NULL);
-        return;
+// Close a rate-control window and apply the level it picks
+static void update_live_rate(void)
+{
+    static uint32_t last_nacked = 0;
+    int rssi = transport.load(std::memory_order_acquire)->rssi();
+    uint32_t nacked = live_counters.nacked - last_nacked;
+    last_nacked = live_counters.nacked;
+    if (live_rate_evaluate(&live_rate, rssi, nacked)) {
+        const live_level_t *level = live_rate_level(&live_rate);
+        publish_live_level();
+        printf("LIVE: rate up to %u Hz every %u ms (rssi %d, %u NACKed)\n",
+               (unsigned)level->rate_hz, (unsigned)level->interval_ms, rssi,
+               (unsigned)nacked);
     }
-    udp_dest_addr.sin_family = AF_INET;
-    udp_dest_addr.sin_port = htons(LIVE_UDP_PORT);
-    inet_aton(SERVER_IP, &udp_dest_addr.sin_addr);
-    printf("UDP live stream to %s:%d\n", SERVER_IP, LIVE_UDP_PORT);
+}
+
+// Backpressure between the stages, logged with the stats while a queue
+// ran full: how deep each got in the window and how often encode_task
+// found no free slot
+static void report_pipeline(void)
+{
+    static uint32_t last_live_full = 0, last_event_full = 0;
+    uint32_t live_full = live_queue.full.load(std::memory_order_relaxed);
+    uint32_t event_full = event_queue.full.load(std::memory_order_relaxed);
+    uint32_t live_max = packet_queue_take_max_depth(&live_queue);
+    uint32_t event_max = packet_queue_take_max_depth(&event_queue);
+    if (live_full == last_live_full && event_full == last_event_full) return;
+    printf("Pipeline: live queue max %u/%u, full %u times; event queue max %u/%u, full %u times\n",
+           (unsigned)live_max, (unsigned)live_queue.num_slots, (unsigned)(live_full - last_live_full),
+           (unsigned)event_max, (unsigned)event_queue.num_slots,
+           (unsigned)(event_full - last_event_full));
+    last_live_full = live_full;
+    last_event_full = event_full;
+}
+
+// Radio power follows the activity mode; called from udp_live_task only
+static void apply_radio_power(bool idle)
+{
+    printf("Power: %s\n", idle ? "idle, live paused" : "active");
+    transport.load(std::memory_order_acquire)->set_power_save(idle);
+}
+
+static void udp_live_task(void *pvParameters)
+{
+    bool radio_idle = false;
+    const transport_t *power_tp = NULL;     // transport radio_idle was applied to
+    int64_t last_stats_us = 0;
+    int64_t last_rate_us = 0;
+    int64_t last_sync_us = 0;
+
+    printf("Live stream started.\n");
 
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(LIVE_POST_INTERVAL_MS));
+        // encode_task notifies as it queues, sensor_task on wake-up, so
+        // neither live nor idle polling adds latency
+        bool idle = racquet_idle();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle ? IDLE_POLL_MS
+                                                    : live_rate_level(&live_rate)->interval_ms));
+        idle = racquet_idle();
+        const transport_t *tp = transport.load(std::memory_order_acquire);
+        if (idle != radio_idle || tp != power_tp) {
+            apply_radio_power(idle);
+            radio_idle = idle;
+            power_tp = tp;
+        }
 
-        EventBits_t bits = xEventGroupGetBits(wifi_event_group);
-        if (!(bits & WIFI_CONNECTED_BIT)) continue;
+        if (!transport_ready()) continue;
+        send_phase_marks();
+
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - last_stats_us >= (int64_t)STATS_INTERVAL_MS * 1000) {
+            send_stats();
+#if PROFILE_ENABLED
+            send_profile();
+#endif
+            report_pipeline();
+            last_stats_us = now_us;
+        }
+        // Idle: stats keep going as a heartbeat, everything else waits
+        if (idle) {
+            serve_control();
+            continue;
+        }
+        if (now_us - last_sync_us >= (int64_t)CLOCK_SYNC_INTERVAL_MS * 1000) {
+            send_clock_sync();
+            last_sync_us = now_us;
+        }
+        if (now_us - last_rate_us >= (int64_t)LIVE_RATE_EVAL_MS * 1000) {
+            update_live_rate();
+            last_rate_us = now_us;
+        }
 
-        int count = 0;
-        while (count < MAX_LIVE_PER_POST &&
-               xQueueReceive(live_queue, &batch[count], 0) == pdTRUE) {
-            count++;
+        // Anything beyond one interval's worth not yet sent at wake-up, in
+        // the ring or already encoded, means the last round of sends could
+        // not keep up
+        uint32_t interval_ms = live_rate_level(&live_rate)->interval_ms;
+        const packet_slot_t *oldest = packet_queue_peek(&live_queue);
+        uint32_t unsent_from = oldest != NULL ? oldest->first_seq
+                                              : live_encode_tail.load(std::memory_order_acquire);
+        uint32_t backlog_ms = (live_ring.head.load(std::memory_order_acquire) - unsent_from) *
+                              1000 / live_rate_hz();
+        live_rate_note_backlog(&live_rate, backlog_ms > interval_ms ? backlog_ms - interval_ms : 0);
+
+        // Send what encode_task has queued, oldest first
+        packet_slot_t *pkt;
+        while ((pkt = packet_queue_peek(&live_queue)) != NULL) {
+            bool ok = live_send(pkt->data, (int)pkt->len);
+            PROF_RECORD(PROF_LIVE_QUEUED,
+                        (uint32_t)((esp_timer_get_time() - pkt->t_us) * profile_cpu_mhz()));
+            packet_queue_pop(&live_queue);
+            if (!ok) printf("Live send failed\n");
+            live_rate_note_send(&live_rate, ok);
         }
 
-        if (count > 0) {
-            size_t max_size = 16384;
-            char *json = (char *)malloc(max_size);
-            if (json == NULL) {
-                printf("LIVE: OOM building live JSON\n");
-                continue;
-            }
-            int len = build_json_payload("live", batch, count, 0, json, max_size);
-            if (len <= 0) {
-                printf("LIVE: JSON build failed (count=%d, heap=%u)\n",
-                       count, (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT));
-            }
-            bool ok = (len > 0) && udp_send_json(json, len);
-            free(json);
-            if (!ok) {
-                printf("Live send failed\n");
-            }
+        serve_control();
+    }
+}
+
+// --- Encode task (ENCODE_CORE) ---
+
+// Queued events into event_queue bodies, oldest first, while slots are
+// free. Held back for the first wall clock as the uploads are, since a
+// body carries the offset at the time it is encoded.
+static void encode_events(void)
+{
+    if (!wall_clock_valid() && esp_timer_get_time() < (int64_t)TIME_SYNC_WAIT_MS * 1000) return;
+    bool queued = false;
+    while (event_pool_pending(&event_pool) > 0) {
+        packet_slot_t *body = packet_queue_acquire(&event_queue);
+        if (body == NULL) break;
+        event_slot_t *slot = event_pool_next(&event_pool);
+        if (slot == NULL) break;
+        PROF_START(prof_t0);
+        bool ok = encode_event(slot, body);
+        PROF_END(PROF_EVENT_ENCODE, prof_t0);
+        if (ok) {
+            packet_queue_publish(&event_queue, esp_timer_get_time());
+            queued = true;
+        } else {
+            printf("Event encode failed (%d samples), dropped\n", slot->count);
+        }
+        event_pool_release(&event_pool, slot);
+    }
+    if (queued && http_event_task_handle != NULL) xTaskNotifyGive(http_event_task_handle);
+}
+
+// Live ring into live_queue datagrams. A full queue stops the encoding and
+// the samples wait in the ring, so a stalled send stage never stalls this
+// one; past the ring's depth they show up as overrun.
+static void encode_live(sample_ring_reader_t *reader)
+{
+    bool queued = false;
+    const sensor_sample_t *batch = NULL;
+    uint32_t count = sample_ring_peek(&live_ring, reader, MAX_LIVE_PER_POST, &batch);
+    if (reader->dropped != live_overrun.load(std::memory_order_relaxed)) {
+        printf("LIVE: ring overrun, %u samples dropped so far\n", (unsigned)reader->dropped);
+        live_overrun.store(reader->dropped, std::memory_order_relaxed);
+    }
+
+    // Straight out of the ring; a wrapped backlog takes two spans
+    while (count > 0) {
+        packet_slot_t *out = packet_queue_acquire(&live_queue);
+        if (out == NULL) break;
+        uint32_t first = reader->tail;
+        int used = 0;
+        PROF_START(prof_t0);
+        int len = build_live_payload(batch, (int)count, out->data, &used);
+        PROF_END(PROF_LIVE_ENCODE, prof_t0);
+        if (len <= 0) {
+            printf("LIVE: payload build failed (count=%u, heap=%u)\n",
+                   (unsigned)count, (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT));
+            used = (int)count;
+        } else if (sample_ring_intact(&live_ring, first)) {
+            out->len = (uint32_t)len;
+            out->first_seq = first;
+            out->count = (uint32_t)used;
+            packet_queue_publish(&live_queue, esp_timer_get_time());
+            queued = true;
         }
+        // (producer lapped us while encoding: the batch may be torn, drop it)
+        sample_ring_consume(reader, (uint32_t)used);
+        count = sample_ring_peek(&live_ring, reader, MAX_LIVE_PER_POST, &batch);
+    }
+    live_encode_tail.store(reader->tail, std::memory_order_release);
+    if (queued && task_table[TASK_UDP_LIVE].handle != NULL) {
+        xTaskNotifyGive(task_table[TASK_UDP_LIVE].handle);
+    }
+}
+
+// Builds every live datagram and event body on ENCODE_CORE, below
+// sensor_task, so the network tasks on Core 0 only send and a slow POST
+// delays no live batch.
+static void encode_task(void *pvParameters)
+{
+    sample_ring_reader_t reader = {};
+    printf("Encode task started.\n");
+
+    while (1) {
+        // One live batch per rate-control interval (live_rate.h); sensor_task
+        // notifies each captured event and the wake-up, the send stages
+        // each freed slot
+        bool idle = racquet_idle();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle ? IDLE_POLL_MS
+                                                    : live_interval_ms.load(std::memory_order_relaxed)));
+        encode_events();
+        // Live pauses while idle or offline, like the sends
+        if (!racquet_idle() && transport_ready()) encode_live(&reader);
     }
 }
 
 // --- Sensor task (Core 1) ---
 
-static void sensor_task(void *pvParameters)
+// sensor_task: (re)start the live FIR for the current sensor rate and cap.
+// The history starts empty, so live output pauses for one filter length.
+static void live_decimation_update(void)
+{
+    live_level_t cap = {};
+    cap.rate_hz = live_max_rate_hz.load(std::memory_order_relaxed);
+    int factor = live_rate_factor(&cap, sensor_rate_hz.load(std::memory_order_relaxed));
+    live_decimator_init(&live_decimator, factor);
+    live_decimation.store((uint8_t)live_decimator.factor, std::memory_order_relaxed);
+}
+
+// Monotonic time of the INT stamped by the driver, independent of how
+// long the sensor task took to get scheduled. esp_timer never steps, so
+// sample spacing survives SNTP corrections; see clock_wall_offset_us().
+static int64_t report_timestamp_us(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint32_t age_us = (uint32_t)now_us - imu_report_time_us;
+    return now_us - (int64_t)age_us;
+}
+
+// The IMU as sensor_task sees it: imu_read() takes in what one INT
+// announced, then imu_next_sample() hands back its samples one at a time.
+
+#if IMU_DRIVER == IMU_DRIVER_SHTP
+
+static shtp_parser_t shtp_parser;
+
+static void IRAM_ATTR imu_int_isr(void *arg)
+{
+    imu_report_time_us = (uint32_t)esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    if (sensor_task_handle != NULL) vTaskNotifyGiveFromISR(sensor_task_handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static bool imu_init(void)
+{
+    bno085_spi_config_t cfg = {};
+    cfg.host = IMU_SPI_HOST;
+    cfg.io_mosi = IMU_PIN_MOSI;
+    cfg.io_miso = IMU_PIN_MISO;
+    cfg.io_sclk = IMU_PIN_SCLK;
+    cfg.io_cs = IMU_PIN_CS;
+    cfg.io_int = IMU_PIN_INT;
+    cfg.io_rst = IMU_PIN_RST;
+    cfg.sclk_speed = SPI_CLOCK_HZ;
+    cfg.int_isr = imu_int_isr;
+    shtp_parser_init(&shtp_parser);
+    return bno085_spi_init(&cfg);
+}
+
+// Full rate with rv_game while active; slow gyro + accel only while idle.
+// The commands go out on the next reads (bno085_spi.h).
+static void imu_set_power(bool idle, uint32_t active_period_us)
+{
+    uint32_t period = idle ? IDLE_SENSOR_PERIOD_US : active_period_us;
+    uint32_t rv_period = active_period_us > RV_MIN_PERIOD_US ? active_period_us : RV_MIN_PERIOD_US;
+    bno085_spi_set_report(SH2_GAME_ROTATION_VECTOR, idle ? 0 : rv_period);
+    bno085_spi_set_report(SH2_GYROSCOPE_CALIBRATED, period);
+    bno085_spi_set_report(SH2_ACCELEROMETER, period);
+}
+
+// First reports on; the hub's start-up packets carry the commands out
+static bool imu_start(uint32_t period_us)
+{
+    imu_set_power(false, period_us);
+    return bno085_spi_flush(IMU_START_TIMEOUT_MS);
+}
+
+// A packet is waiting: read it without sleeping on the notification
+static bool imu_pending(void)
 {
-    BNO08x *imu = (BNO08x *)pvParameters;
+    return bno085_spi_int_asserted();
+}
 
-    imu->rpt.rv_game.enable(SENSOR_PERIOD_US);
-    imu->rpt.cal_gyro.enable(SENSOR_PERIOD_US);
-    imu->rpt.accelerometer.enable(SENSOR_PERIOD_US);
+// The packet lands in a DMA buffer and stays there; only reports-channel
+// cargo is parsed, commands' responses and start-up packets are dropped
+static void imu_read(void)
+{
+    const shtp_packet_t *pkt = bno085_spi_read();
+    if (pkt == NULL || pkt->channel != SHTP_CHAN_REPORTS || pkt->continuation) return;
+    shtp_parser_begin(&shtp_parser, pkt->cargo, pkt->cargo_len, report_timestamp_us());
+}
 
-    printf("Sensor task started (400Hz, live decimated to 200Hz)\n");
+// Q-point fields decoded straight into *s, timestamped by the hub
+static bool imu_next_sample(sensor_sample_t *s)
+{
+    return shtp_parser_next(&shtp_parser, s);
+}
+
+#else
+
+static BNO08x *imu = NULL;
+static bool imu_polled = true;      // this INT's reports already taken
+
+static void imu_report_cb(void)
+{
+    imu_report_time_us = (uint32_t)esp_timer_get_time();
+    xTaskNotifyGive(sensor_task_handle);
+}
+
+static bool imu_init(void)
+{
+    static bno08x_config_t imu_config(IMU_SPI_HOST, IMU_PIN_MOSI, IMU_PIN_MISO, IMU_PIN_SCLK,
+                                      IMU_PIN_CS, IMU_PIN_INT, IMU_PIN_RST, SPI_CLOCK_HZ);
+    static BNO08x bno(imu_config);
+    if (!bno.initialize()) return false;
+    bno.register_cb(imu_report_cb);
+    imu = &bno;
+    return true;
+}
+
+// Full rate with rv_game while active; slow gyro + accel only while idle
+static void imu_set_power(bool idle, uint32_t active_period_us)
+{
+    uint32_t period = idle ? IDLE_SENSOR_PERIOD_US : active_period_us;
+    if (idle) {
+        imu->rpt.rv_game.disable();
+    } else {
+        imu->rpt.rv_game.enable(active_period_us > RV_MIN_PERIOD_US ? active_period_us
+                                                                    : RV_MIN_PERIOD_US);
+    }
+    imu->rpt.cal_gyro.enable(period);
+    imu->rpt.accelerometer.enable(period);
+}
+
+static bool imu_start(uint32_t period_us)
+{
+    imu_set_power(false, period_us);
+    return true;
+}
+
+static bool imu_pending(void)
+{
+    return false;
+}
+
+static void imu_read(void)
+{
+    imu_polled = false;
+}
+
+// One sample per gyro report: gyro and accel run at the same period and
+// arrive in one SHTP transfer; rv_game may be slower (above 400Hz) and its
+// last orientation is carried forward
+static bool imu_next_sample(sensor_sample_t *s)
+{
+    if (imu_polled) return false;
+    imu_polled = true;
+    bool got_data = false;
+
+    if (imu->rpt.rv_game.has_new_data()) {
+        bno08x_euler_angle_t euler = imu->rpt.rv_game.get_euler();
+        s->euler_x = euler.x;
+        s->euler_y = euler.y;
+        s->euler_z = euler.z;
+    }
+
+    if (imu->rpt.cal_gyro.has_new_data()) {
+        bno08x_gyro_t gyro = imu->rpt.cal_gyro.get();
+        s->gyro_x = gyro.x;
+        s->gyro_y = gyro.y;
+        s->gyro_z = gyro.z;
+        got_data = true;
+    }
+
+    if (imu->rpt.accelerometer.has_new_data()) {
+        bno08x_accel_t accel = imu->rpt.accelerometer.get();
+        s->accel_x = accel.x;
+        s->accel_y = accel.y;
+        s->accel_z = accel.z;
+    }
+
+    if (got_data) s->timestamp_us = report_timestamp_us();
+    return got_data;
+}
+
+#endif
+
+static void sensor_task(void *pvParameters)
+{
+    // IMU bring-up runs here, on Core 1, while app_main starts the radio
+    sensor_task_handle = xTaskGetCurrentTaskHandle();
+    printf("Initializing BNO085...\n");
+    if (!imu_init()) {
+        printf("ERROR: Failed to initialize BNO085!\n");
+        sensor_task_handle = NULL;
+        task_table[TASK_SENSOR].handle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    printf("BNO085 initialized (%lld ms after boot).\n", (long long)(esp_timer_get_time() / 1000));
+
+    // app_main ran config_init() before starting this task, so the saved
+    // settings are waiting
+    sensor_settings_t settings = {};
+    adopt_sensor_settings(&settings);
+    uint32_t period_us = 1000000UL / settings.rate_hz;
+    sensor_rate_hz.store(settings.rate_hz, std::memory_order_relaxed);
+    swing_analyzer_set_rate(&swing_analyzer, (float)settings.rate_hz);
+    phase_tracker_init(&phase_tracker, (float)settings.rate_hz);
+    if (!imu_start(period_us)) printf("WARNING: BNO085 did not take its report settings\n");
+    uint16_t live_cap_hz = live_max_rate_hz.load(std::memory_order_relaxed);
+    live_decimation_update();
+
+    printf("Sensor task started (%u Hz, live %u Hz)\n", (unsigned)settings.rate_hz,
+           (unsigned)live_rate_hz());
 
     sensor_sample_t current_sample = {};
     uint32_t sample_seq = 0;
-    int64_t last_event_time_ms = 0;
+    int64_t prev_sample_us = 0;
+    event_trigger_t trigger;
+    event_trigger_init(&trigger, &settings.trigger);
+    activity_t activity;
+    activity_init(&activity, (int64_t)IDLE_AFTER_MS * 1000, esp_timer_get_time());
 
     while (1) {
-        if (!imu->data_available()) {
-            vTaskDelay(1);  // yield to prevent TWDT starvation
+        // Next sample out of the last packet; once it is used up, sleep
+        // until the INT line reports new data
+        PROF_START(prof_decode);
+        if (!imu_next_sample(&current_sample)) {
+            bool pending = imu_pending();
+            TickType_t wait = pending ? 0 : pdMS_TO_TICKS(SENSOR_WAIT_TIMEOUT_MS);
+            if (ulTaskNotifyTake(pdTRUE, wait) == 0 && !pending) continue;
+            PROF_RECORD(PROF_SENSOR_WAKE,
+                        ((uint32_t)esp_timer_get_time() - imu_report_time_us) * profile_cpu_mhz());
+            PROF_START(prof_read);
+            imu_read();
+            PROF_END(PROF_IMU_READ, prof_read);
             continue;
         }
+        PROF_END(PROF_IMU_DECODE, prof_decode);
 
-        bool got_data = false;
+        // Sequence; the timestamp came with the reports
+        current_sample.seq = sample_seq++;
 
-        if (imu->rpt.rv_game.has_new_data()) {
-            bno08x_euler_angle_t euler = imu->rpt.rv_game.get_euler();
-            current_sample.euler_x = euler.x;
-            current_sample.euler_y = euler.y;
-            current_sample.euler_z = euler.z;
-            got_data = true;
+        // Always write to the capture ring, at the full sensor rate
+        PROF_START(prof_t0);
+        capture_ring_push(&capture_ring, &current_sample);
+        PROF_END(PROF_CAPTURE_PUSH, prof_t0);
+
+        // After a wake or a rate change the BNO085 still hands over reports
+        // at the old rate for a moment; the first pair at the new spacing
+        // starts the stretch an event window may reach back into. Past
+        // that, a longer spacing while active means the hub dropped reports
+        // (sensor_task held up for longer than its FIFO lasts)
+        int64_t spacing_us = current_sample.timestamp_us - prev_sample_us;
+        if (capture_rate_settling) {
+            if (spacing_us <= (int64_t)period_us * 3 / 2) {
+                capture_rate_from = capture_ring.head - 2;
+                capture_rate_settling = false;
+            }
+        } else if (prev_sample_us != 0 && activity.mode != ACTIVITY_IDLE &&
+                   spacing_us > (int64_t)period_us * 3 / 2) {
+            sensor_gaps.fetch_add(1, std::memory_order_relaxed);
+            if (spacing_us > (int64_t)sensor_gap_max_us.load(std::memory_order_relaxed)) {
+                sensor_gap_max_us.store((uint32_t)spacing_us, std::memory_order_relaxed);
+            }
         }
-
-        if (imu->rpt.cal_gyro.has_new_data()) {
-            bno08x_gyro_t gyro = imu->rpt.cal_gyro.get();
-            current_sample.gyro_x = gyro.x;
-            current_sample.gyro_y = gyro.y;
-            current_sample.gyro_z = gyro.z;
-            got_data = true;
+        prev_sample_us = current_sample.timestamp_us;
+
+#if POWER_SAVE_ENABLED
+        // Idle mode in and out; the network tasks follow the shared mode
+        if (activity_update(&activity, &current_sample)) {
+            bool idle = activity.mode == ACTIVITY_IDLE;
+            imu_set_power(idle, period_us);
+            activity_mode.store(activity.mode, std::memory_order_relaxed);
+            if (!idle) {
+                capture_rate_settling = true;
+                live_decimation_update();   // drop the history from before the pause
+                phase_tracker_reset(&phase_tracker);
+                if (task_table[TASK_UDP_LIVE].handle != NULL) {
+                    xTaskNotifyGive(task_table[TASK_UDP_LIVE].handle);
+                }
+                if (encode_task_handle != NULL) xTaskNotifyGive(encode_task_handle);
+                if (http_event_task_handle != NULL) xTaskNotifyGive(http_event_task_handle);
+            }
+            printf("Activity: %s\n", idle ? "no motion, going idle" : "motion, waking up");
         }
-
-        if (imu->rpt.accelerometer.has_new_data()) {
-            bno08x_accel_t accel = imu->rpt.accelerometer.get();
-            current_sample.accel_x = accel.x;
-            current_sample.accel_y = accel.y;
-            current_sample.accel_z = accel.z;
-            got_data = true;
+#endif
+
+        // Live stream at the adaptive rate, low-passed and decimated, paused
+        // while idle. Live samples are numbered by their live ring index so
+        // the server can spot gaps and NACK them.
+        if (live_max_rate_hz.load(std::memory_order_relaxed) != live_cap_hz) {
+            live_cap_hz = live_max_rate_hz.load(std::memory_order_relaxed);
+            live_decimation_update();
+        }
+        sensor_sample_t live;
+        PROF_START(prof_push);
+        if (activity.mode == ACTIVITY_ACTIVE &&
+            live_decimator_push(&live_decimator, &current_sample, &live)) {
+            live.seq = live_ring.head.load(std::memory_order_relaxed);
+            sample_ring_push(&live_ring, &live);
+        }
+        PROF_END(PROF_LIVE_PUSH, prof_push);
+
+#if SPOOL_ENABLED
+        // Every sample at the full rate for the flash spool; http_event_task
+        // keeps the ones from while the link is down
+        if (activity.mode == ACTIVITY_ACTIVE) sample_ring_push(&spool_ring, &current_sample);
+#endif
+
+        // New settings land between two samples, never inside a capture
+        if (current_state == STATE_NORMAL && adopt_sensor_settings(&settings)) {
+            event_trigger_set_config(&trigger, &settings.trigger);
+            if (settings.rate_hz != sensor_rate_hz.load(std::memory_order_relaxed)) {
+                period_us = 1000000UL / settings.rate_hz;
+                sensor_rate_hz.store(settings.rate_hz, std::memory_order_relaxed);
+                swing_analyzer_set_rate(&swing_analyzer, (float)settings.rate_hz);
+                phase_tracker_set_rate(&phase_tracker, (float)settings.rate_hz);
+                live_decimation_update();
+                if (activity.mode == ACTIVITY_ACTIVE) {
+                    imu_set_power(false, period_us);
+                    capture_rate_settling = true;
+                }
+            }
         }
 
-        if (!got_data) continue;
-
-        // Timestamp and sequence
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        current_sample.timestamp_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
-        current_sample.seq = sample_seq++;
-
-        // Always write to ring buffer (400Hz)
-        ring_write(&current_sample);
-
-        // Live stream: decimate to 200Hz
-        if (current_sample.seq % LIVE_DECIMATION == 0) {
-            xQueueSend(live_queue, &current_sample, 0);
+        // The detector sees every sample, capturing or not, so its
+        // running energy and jerk never go stale
+        event_trigger_signals_t sig;
+        PROF_START(prof_trig);
+        bool triggered = event_trigger_check(&trigger, &current_sample, &sig);
+        PROF_END(PROF_TRIGGER, prof_trig);
+
+        // Phase marks while the swing is still going; the event's own
+        // segmentation refines them after capture. Not while idle: the
+        // low-pass is designed for the active rate.
+#if LIVE_PHASE_MARKS
+        phase_mark_t mark;
+        if (activity.mode == ACTIVITY_ACTIVE &&
+            phase_tracker_update(&phase_tracker, &current_sample, &mark)) {
+            queue_phase_mark(&mark);
         }
+#endif
 
         // State machine
         switch (current_state) {
             case STATE_NORMAL: {
-                float gyro_mag = 0.0f;
-                int64_t now = current_sample.timestamp_ms;
-                bool debounce_ok = (now - last_event_time_ms) > EVENT_DEBOUNCE_MS;
-
-                if (debounce_ok && !event_ready && check_event_trigger(&current_sample, &gyro_mag)) {
+                if (triggered) {
                     current_state = STATE_CAPTURING;
-                    evt_ctx.trigger_timestamp_ms = now;
-                    evt_ctx.trigger_gyro_mag = gyro_mag;
-                    evt_ctx.post_samples_needed = EVENT_POST_SAMPLES;
+                    evt_ctx.trigger_timestamp_us = current_sample.timestamp_us;
+                    evt_ctx.trigger = sig;
+                    evt_ctx.pre_samples = settings.pre_samples;
+                    evt_ctx.post_samples_needed = settings.post_samples;
                     evt_ctx.post_samples_count = 0;
-                    last_event_time_ms = now;
-                    printf("EVENT TRIGGERED! accel=%.1f m/s2\n", gyro_mag);
+                    printf("EVENT TRIGGERED! gyro=%.1f rad/s (rms %.1f) accel=%.1f m/s2 "
+                           "jerk=%.0f m/s3\n", sig.gyro_mag, sig.energy_rms, sig.accel_mag,
+                           sig.jerk);
                 }
                 break;
             }
@@ -537,6 +1882,96 @@ static void sensor_task(void *pvParameters)
 
 // --- Main ---
 
+// One arena array per channel, `count` samples long
+static bool alloc_sample_block(sample_block_t *block, size_t count)
+{
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) {
+        block->axis[a] = arena_alloc_array<float>(&buf_arena, count);
+        if (block->axis[a] == NULL) return false;
+    }
+    block->timestamp_us = arena_alloc_array<int64_t>(&buf_arena, count);
+    block->seq = arena_alloc_array<uint32_t>(&buf_arena, count);
+    return block->timestamp_us != NULL && block->seq != NULL;
+}
+
+// Reserve every runtime buffer in one block at boot, PSRAM first
+static bool buffers_init(void)
+{
+    size_t size = sizeof(sensor_sample_t) * LIVE_RING_SIZE
+                + SAMPLE_BLOCK_BYTES_PER_SAMPLE * CAPTURE_RING_SIZE
+                + sizeof(event_slot_t) * EVENT_POOL_SLOTS
+                + SAMPLE_BLOCK_BYTES_PER_SAMPLE * EVENT_POOL_SLOTS * EVENT_MAX_SAMPLES
+                + swing_analyzer_mem_size(EVENT_MAX_SAMPLES)
+                + HTTP_BODY_CHUNK + LIVE_PAYLOAD_MAX + ARENA_SLACK;
+    size += sizeof(packet_slot_t) * (LIVE_QUEUE_SLOTS + EVENT_QUEUE_SLOTS)
+          + LIVE_SLOT_SIZE * LIVE_QUEUE_SLOTS + event_body_max() * EVENT_QUEUE_SLOTS;
+#if SPOOL_ENABLED
+    size += sizeof(sensor_sample_t) * SPOOL_RING_SIZE;
+#endif
+
+    void *mem = NULL;
+    const char *where = "PSRAM";
+#if ARENA_PREFER_PSRAM && CONFIG_SPIRAM
+    mem = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+    if (mem == NULL) {
+        mem = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        where = "internal";
+    }
+    if (mem == NULL) return false;
+    arena_init(&buf_arena, "buffers", mem, size);
+
+    sensor_sample_t *live_storage = arena_alloc_array<sensor_sample_t>(&buf_arena, LIVE_RING_SIZE);
+    sample_block_t capture_storage = {};
+    bool capture_ok = alloc_sample_block(&capture_storage, CAPTURE_RING_SIZE);
+    event_slot_t *slots = arena_alloc_array<event_slot_t>(&buf_arena, EVENT_POOL_SLOTS);
+    sample_block_t event_storage = {};
+    bool events_ok = alloc_sample_block(&event_storage, EVENT_POOL_SLOTS * EVENT_MAX_SAMPLES);
+    http_body_buf = arena_alloc_array<uint8_t>(&buf_arena, HTTP_BODY_CHUNK);
+    live_payload_buf = arena_alloc_array<uint8_t>(&buf_arena, LIVE_PAYLOAD_MAX);
+    bool analyzer_ok = swing_analyzer_init(&swing_analyzer, &buf_arena, EVENT_MAX_SAMPLES,
+                                           (float)SENSOR_RATE_HZ);
+    packet_slot_t *live_slots = arena_alloc_array<packet_slot_t>(&buf_arena, LIVE_QUEUE_SLOTS);
+    uint8_t *live_slot_storage = arena_alloc_array<uint8_t>(&buf_arena,
+                                                            LIVE_SLOT_SIZE * LIVE_QUEUE_SLOTS);
+    packet_slot_t *event_slots = arena_alloc_array<packet_slot_t>(&buf_arena, EVENT_QUEUE_SLOTS);
+    uint8_t *event_slot_storage = arena_alloc_array<uint8_t>(&buf_arena,
+                                                             event_body_max() * EVENT_QUEUE_SLOTS);
+#if SPOOL_ENABLED
+    sensor_sample_t *spool_storage = arena_alloc_array<sensor_sample_t>(&buf_arena, SPOOL_RING_SIZE);
+    if (spool_storage == NULL) return false;
+    sample_ring_init(&spool_ring, spool_storage, SPOOL_RING_SIZE);
+#endif
+    arena_seal(&buf_arena);
+    if (live_storage == NULL || !capture_ok || slots == NULL || !events_ok ||
+        http_body_buf == NULL || live_payload_buf == NULL || !analyzer_ok ||
+        live_slots == NULL || live_slot_storage == NULL || event_slots == NULL ||
+        event_slot_storage == NULL) {
+        return false;
+    }
+
+    // Live ring and event pool shared by sensor_task and encode_task
+    capture_ring_init(&capture_ring, &capture_storage, CAPTURE_RING_SIZE);
+    sample_ring_init(&live_ring, live_storage, LIVE_RING_SIZE);
+    event_pool_init(&event_pool, slots, EVENT_POOL_SLOTS,
+                    &event_storage, EVENT_MAX_SAMPLES, EVENT_DROP_POLICY);
+
+    // Encoded packets, encode_task -> the network tasks
+    packet_queue_init(&live_queue, live_slots, LIVE_QUEUE_SLOTS, live_slot_storage,
+                      LIVE_SLOT_SIZE);
+    packet_queue_init(&event_queue, event_slots, EVENT_QUEUE_SLOTS, event_slot_storage,
+                      (uint32_t)event_body_max());
+#if PROFILE_ENABLED
+    profile_init(CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+    live_rate_init(&live_rate, LIVE_RATE_START_LEVEL);
+    publish_live_level();
+
+    printf("Buffers: %u/%u bytes in %s RAM\n",
+           (unsigned)buf_arena.used, (unsigned)buf_arena.size, where);
+    return true;
+}
+
 extern "C" void app_main(void)
 {
     printf("BNO085 Dual-Mode IMU — ESP32-S3 (HTTP+UDP)\n");
@@ -548,49 +1983,40 @@ extern "C" void app_main(void)
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    device_id_init();
 
-    // Init Wi-Fi and wait for connection
-    wifi_init_sta();
-    printf("Waiting for Wi-Fi connection...\n");
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT,
-                        pdFALSE, pdTRUE, portMAX_DELAY);
-    printf("Wi-Fi connected!\n");
-
-    // Create live queue and event mutex
-    live_queue = xQueueCreate(LIVE_QUEUE_SIZE, sizeof(sensor_sample_t));
-    if (live_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create live queue!");
-        return;
-    }
-    event_mutex = xSemaphoreCreateMutex();
-    if (event_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create event mutex!");
+    if (!buffers_init()) {
+        ESP_LOGE(TAG, "Failed to allocate buffers!");
         return;
     }
-
-    // Init BNO085
-    bno08x_config_t imu_config(
-        SPI2_HOST,
-        GPIO_NUM_11,    // MOSI
-        GPIO_NUM_13,    // MISO
-        GPIO_NUM_12,    // SCLK
-        GPIO_NUM_10,    // CS
-        GPIO_NUM_14,    // INT
-        GPIO_NUM_15,    // RST
-        SPI_CLOCK_HZ
-    );
-
-    static BNO08x imu(imu_config);
-
-    printf("Initializing BNO085...\n");
-    if (!imu.initialize()) {
-        printf("ERROR: Failed to initialize BNO085!\n");
+    config_init();
+#if SPOOL_ENABLED
+    spool_open();
+#endif
+
+    // Sampling into the capture ring starts as soon as the BNO085 is up,
+    // without waiting for the network: sensor_task brings the IMU up on
+    // Core 1 while the radio starts here
+    xTaskCreatePinnedToCore(sensor_task, "sensor", SENSOR_STACK, NULL, 8,
+                            &task_table[TASK_SENSOR].handle, 1);
+
+    // Packets are built on ENCODE_CORE below sensor_task, in the time it
+    // leaves between samples
+    xTaskCreatePinnedToCore(encode_task, "encode", ENCODE_STACK, NULL, 3,
+                            &encode_task_handle, ENCODE_CORE);
+    task_table[TASK_ENCODE].handle = encode_task_handle;
+
+    // Bring up the link to the server (non-blocking connect); the network
+    // tasks wait for it to be ready, and events queue in the pool meanwhile
+    if (!transport_init(&config)) {
+        ESP_LOGE(TAG, "Failed to set up the transport!");
         return;
     }
-    printf("BNO085 initialized.\n");
 
-    // Launch tasks: HTTP event + UDP live on Core 0, sensor on Core 1
-    xTaskCreatePinnedToCore(http_event_task, "http_event", 8192, NULL, 4, NULL, 0);
-    xTaskCreatePinnedToCore(udp_live_task, "udp_live", 6144, NULL, 5, NULL, 0);
-    xTaskCreatePinnedToCore(sensor_task, "sensor", 8192, (void *)&imu, 8, NULL, 1);
+    // HTTP event + UDP live on Core 0
+    xTaskCreatePinnedToCore(http_event_task, "http_event", HTTP_EVENT_STACK, NULL, 4,
+                            &http_event_task_handle, 0);
+    xTaskCreatePinnedToCore(udp_live_task, "udp_live", UDP_LIVE_STACK, NULL, 5,
+                            &task_table[TASK_UDP_LIVE].handle, 0);
+    task_table[TASK_HTTP_EVENT].handle = http_event_task_handle;
 }
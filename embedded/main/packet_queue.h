@@ -0,0 +1,119 @@
+/*
+ * Lock-free single-producer, single-consumer queue of encoded packets,
+ * between an encode stage and the send stage that owns the socket.
+ *
+ * Slots are fixed-size buffers carved out at boot. The producer takes the
+ * next free one with packet_queue_acquire(), encodes into it in place and
+ * hands it over with packet_queue_publish() (release ordering on head); the
+ * consumer reads the oldest with packet_queue_peek() and frees it with
+ * packet_queue_pop() (release ordering on tail) once it is sent, so a
+ * failed send can be retried from the same bytes. Neither side ever waits
+ * on the other: with every slot taken, acquire returns NULL and the
+ * producer leaves its input where it is.
+ *
+ * Backpressure is counted on the producer side: `full` for every acquire
+ * that found no free slot, `max_depth` for the deepest the queue has been
+ * since packet_queue_take_max_depth() last read it.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t *data;                  // slot_size bytes
+    uint32_t len;                   // encoded bytes
+    uint32_t first_seq;             // producer's own bookkeeping (live: first sample)
+    uint32_t count;                 // ... (live: samples in the packet)
+    int64_t t_us;                   // published at, for the queueing delay
+} packet_slot_t;
+
+typedef struct {
+    packet_slot_t *slots;
+    uint32_t num_slots;             // power of two
+    uint32_t mask;                  // num_slots - 1
+    uint32_t slot_size;
+    std::atomic<uint32_t> head;     // slots published
+    std::atomic<uint32_t> tail;     // slots popped
+    // Backpressure, written by the producer
+    std::atomic<uint32_t> published;
+    std::atomic<uint32_t> full;
+    std::atomic<uint32_t> max_depth;
+} packet_queue_t;
+
+// slots: num_slots entries; storage: num_slots * slot_size bytes
+static inline void packet_queue_init(packet_queue_t *q, packet_slot_t *slots, uint32_t num_slots,
+                                     uint8_t *storage, uint32_t slot_size)
+{
+    q->slots = slots;
+    q->num_slots = num_slots;
+    q->mask = num_slots - 1;
+    q->slot_size = slot_size;
+    for (uint32_t i = 0; i < num_slots; i++) {
+        slots[i].data = storage + (size_t)i * slot_size;
+        slots[i].len = 0;
+    }
+    q->head.store(0, std::memory_order_relaxed);
+    q->tail.store(0, std::memory_order_relaxed);
+    q->published.store(0, std::memory_order_relaxed);
+    q->full.store(0, std::memory_order_relaxed);
+    q->max_depth.store(0, std::memory_order_relaxed);
+}
+
+// Slots published and not yet popped; either side
+static inline uint32_t packet_queue_depth(const packet_queue_t *q)
+{
+    return q->head.load(std::memory_order_acquire) - q->tail.load(std::memory_order_acquire);
+}
+
+// --- Producer side ---
+
+// Next free slot to encode into, or NULL (counted) if all are queued
+static inline packet_slot_t *packet_queue_acquire(packet_queue_t *q)
+{
+    uint32_t h = q->head.load(std::memory_order_relaxed);
+    if (h - q->tail.load(std::memory_order_acquire) >= q->num_slots) {
+        q->full.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    return &q->slots[h & q->mask];
+}
+
+// Hand the slot from the last acquire to the consumer
+static inline void packet_queue_publish(packet_queue_t *q, int64_t t_us)
+{
+    uint32_t h = q->head.load(std::memory_order_relaxed);
+    q->slots[h & q->mask].t_us = t_us;
+    q->head.store(h + 1, std::memory_order_release);
+    q->published.fetch_add(1, std::memory_order_relaxed);
+    uint32_t depth = h + 1 - q->tail.load(std::memory_order_acquire);
+    if (depth > q->max_depth.load(std::memory_order_relaxed)) {
+        q->max_depth.store(depth, std::memory_order_relaxed);
+    }
+}
+
+// --- Consumer side ---
+
+// Oldest published slot, or NULL if the queue is empty. Stays queued.
+static inline packet_slot_t *packet_queue_peek(packet_queue_t *q)
+{
+    uint32_t t = q->tail.load(std::memory_order_relaxed);
+    if (q->head.load(std::memory_order_acquire) == t) return NULL;
+    return &q->slots[t & q->mask];
+}
+
+// Done with the slot from the last peek; the producer may reuse it
+static inline void packet_queue_pop(packet_queue_t *q)
+{
+    q->tail.store(q->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// --- Metrics ---
+
+// Deepest since the last call, then start over (a reporting window). The
+// reset races a concurrent publish at worst by one window's maximum.
+static inline uint32_t packet_queue_take_max_depth(packet_queue_t *q)
+{
+    return q->max_depth.exchange(packet_queue_depth(q), std::memory_order_relaxed);
+}
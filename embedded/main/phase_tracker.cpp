@@ -0,0 +1,109 @@
+/*
+ * Live swing phase markers. See phase_tracker.h.
+ */
+
+#include "phase_tracker.h"
+
+#include <string.h>
+
+void phase_tracker_init(phase_tracker_t *tr, float rate_hz)
+{
+    memset(tr, 0, sizeof(*tr));
+    phase_tracker_set_rate(tr, rate_hz);
+}
+
+void phase_tracker_set_rate(phase_tracker_t *tr, float rate_hz)
+{
+    dsp_biquad_design_lowpass(tr->lp, SWING_CUTOFF_HZ, rate_hz);
+    phase_tracker_reset(tr);
+}
+
+void phase_tracker_reset(phase_tracker_t *tr)
+{
+    tr->primed = false;
+    tr->state = PHASE_TRACK_QUIET;
+    tr->armed = false;
+}
+
+const char *phase_mark_name(uint8_t kind)
+{
+    switch (kind) {
+        case PHASE_MARK_ACCEL_START:    return "accel_start";
+        case PHASE_MARK_PEAK:           return "peak";
+        case PHASE_MARK_DECEL_END:      return "decel_end";
+        default:                        return "unknown";
+    }
+}
+
+static void make_mark(phase_tracker_t *tr, phase_mark_kind_t kind, int64_t t_us,
+                      int64_t detected_us, float gyro, float accel, phase_mark_t *mark)
+{
+    mark->kind = kind;
+    mark->swing_id = tr->swing_id;
+    mark->t_us = t_us;
+    mark->detected_us = detected_us;
+    mark->gyro = gyro;
+    mark->accel = accel;
+}
+
+bool phase_tracker_update(phase_tracker_t *tr, const sensor_sample_t *s, phase_mark_t *mark)
+{
+    float g_raw = dsp_norm3(s->gyro_x, s->gyro_y, s->gyro_z);
+    float a_raw = dsp_norm3(s->accel_x, s->accel_y, s->accel_z);
+    if (!tr->primed) {
+        dsp_biquad_steady_state(tr->lp, g_raw, tr->gyro_state);
+        dsp_biquad_steady_state(tr->lp, a_raw, tr->accel_state);
+        tr->primed = true;
+    }
+    float g = dsp_biquad_step(g_raw, tr->lp, tr->gyro_state);
+    float a = dsp_biquad_step(a_raw, tr->lp, tr->accel_state);
+    int64_t t = s->timestamp_us;
+    float prev = tr->prev_gyro;
+    tr->prev_gyro = g;
+
+    switch (tr->state) {
+        case PHASE_TRACK_QUIET:
+            if (g < PHASE_REARM_GYRO) {
+                tr->armed = true;
+                if (g <= prev) {
+                    tr->start_us = t;
+                    tr->start_gyro = g;
+                    tr->start_accel = a;
+                }
+            } else if (tr->armed && g >= PHASE_ARM_GYRO) {
+                tr->swing_id++;
+                tr->state = PHASE_TRACK_RISING;
+                tr->rise_us = t;
+                tr->peak_us = t;
+                tr->peak_gyro = g;
+                tr->peak_accel = a;
+                make_mark(tr, PHASE_MARK_ACCEL_START, tr->start_us, t, tr->start_gyro,
+                          tr->start_accel, mark);
+                return true;
+            }
+            return false;
+
+        case PHASE_TRACK_RISING:
+            if (g > tr->peak_gyro) {
+                tr->peak_us = t;
+                tr->peak_gyro = g;
+                tr->peak_accel = a;
+            }
+            if (g < tr->peak_gyro * PHASE_PEAK_CONFIRM_FRAC || t - tr->rise_us > PHASE_MAX_RISE_US) {
+                tr->state = PHASE_TRACK_FALLING;
+                make_mark(tr, PHASE_MARK_PEAK, tr->peak_us, t, tr->peak_gyro, tr->peak_accel, mark);
+                return true;
+            }
+            return false;
+
+        case PHASE_TRACK_FALLING:
+            if (a < SWING_DECEL_ACCEL_THRESH || t - tr->peak_us > PHASE_MAX_FALL_US) {
+                tr->state = PHASE_TRACK_QUIET;
+                tr->armed = false;
+                make_mark(tr, PHASE_MARK_DECEL_END, t, t, g, a, mark);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
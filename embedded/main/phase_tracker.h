@@ -0,0 +1,90 @@
+/*
+ * Live swing phase markers, one sample at a time.
+ *
+ * swing_phase.h segments an event once its whole window is captured; this
+ * follows the same signals causally so the phone can speak while the
+ * swing is still going. |gyro| and |accel| go through the same 30 Hz
+ * Butterworth section as the offline analysis, forward only (a few ms of
+ * lag instead of zero phase), and a three-state machine marks:
+ *
+ *   accel start   |gyro| passed PHASE_ARM_GYRO, having dropped below
+ *                 PHASE_REARM_GYRO since the last swing; stamped with the
+ *                 last local minimum below PHASE_REARM_GYRO, where the
+ *                 rise began (the causal stand-in for walking back to 10%
+ *                 of the peak)
+ *   peak          |gyro| fell to PHASE_PEAK_CONFIRM_FRAC of its running
+ *                 maximum; stamped with the maximum's sample
+ *   decel end     |accel| settled below SWING_DECEL_ACCEL_THRESH after the
+ *                 peak, or PHASE_MAX_FALL_US went by
+ *
+ * O(1) time and memory per sample, nothing allocated. The markers are an
+ * early estimate; the event's swing_phase_t stays the accurate answer.
+ * No ESP-IDF dependencies, so it also builds on the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "dsp_kernels.h"
+#include "sensor_sample.h"
+#include "swing_phase.h"
+
+#define PHASE_ARM_GYRO              8.0f        // rad/s, a swing is under way (the trigger's default)
+#define PHASE_REARM_GYRO            5.0f        // rad/s, the last swing has died down
+#define PHASE_PEAK_CONFIRM_FRAC     0.8f        // peak confirmed once |gyro| falls this far
+#define PHASE_MAX_RISE_US           1000000     // a longer rise is not one swing: peak at once
+#define PHASE_MAX_FALL_US           1000000     // decel end at the latest this long after the peak
+
+typedef enum : uint8_t {
+    PHASE_MARK_ACCEL_START = 1,
+    PHASE_MARK_PEAK = 2,
+    PHASE_MARK_DECEL_END = 3,
+} phase_mark_kind_t;
+
+typedef struct {
+    uint8_t kind;                   // phase_mark_kind_t
+    uint16_t swing_id;              // same for the three marks of one swing
+    int64_t t_us;                   // sample the mark refers to (monotonic)
+    int64_t detected_us;            // sample that completed it
+    float gyro;                     // smoothed |gyro| there, rad/s
+    float accel;                    // smoothed |accel| there, m/s^2
+} phase_mark_t;
+
+typedef enum : uint8_t {
+    PHASE_TRACK_QUIET,
+    PHASE_TRACK_RISING,             // accel start marked, peak not yet confirmed
+    PHASE_TRACK_FALLING,            // peak marked, waiting for decel end
+} phase_track_state_t;
+
+typedef struct {
+    float lp[DSP_BIQUAD_COEFS];
+    float gyro_state[2];
+    float accel_state[2];
+    bool primed;                    // filter states set from the first sample
+    phase_track_state_t state;
+    bool armed;                     // |gyro| has been below PHASE_REARM_GYRO since the last swing
+    float prev_gyro;                // smoothed |gyro| of the previous sample
+    int64_t start_us;               // last local minimum below PHASE_REARM_GYRO
+    float start_gyro;
+    float start_accel;
+    int64_t rise_us;                // rise passed PHASE_ARM_GYRO here
+    int64_t peak_us;
+    float peak_gyro;
+    float peak_accel;
+    uint16_t swing_id;
+} phase_tracker_t;
+
+void phase_tracker_init(phase_tracker_t *tr, float rate_hz);
+
+// Redesign the filter after the sensor rate changed and start over
+void phase_tracker_set_rate(phase_tracker_t *tr, float rate_hz);
+
+// Start over (after an idle pause): filters re-primed, no swing in progress
+void phase_tracker_reset(phase_tracker_t *tr);
+
+// "accel_start", "peak", "decel_end" (as the server names them)
+const char *phase_mark_name(uint8_t kind);
+
+// Feed one sample. Returns true with *mark filled when it completes a
+// phase; at most one mark per sample.
+bool phase_tracker_update(phase_tracker_t *tr, const sensor_sample_t *s, phase_mark_t *mark);
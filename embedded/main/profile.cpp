@@ -0,0 +1,131 @@
+/*
+ * Per-stage cycle profiling. See profile.h.
+ */
+
+#include "profile.h"
+
+#if PROFILE_ENABLED
+
+#include <string.h>
+
+typedef struct {
+    uint16_t bins[PROF_NUM_BINS];
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    std::atomic<bool> reset;        // set by the snapshot, cleared by the writer
+} prof_hist_t;
+
+static const char *const stage_names[PROF_NUM_STAGES] = {
+    "sensor_wake", "imu_read", "imu_decode", "capture_push", "live_push", "trigger",
+    "swing_phase", "stroke", "live_encode", "live_queued", "live_send", "event_encode",
+    "event_post",
+};
+
+static prof_hist_t hists[PROF_NUM_STAGES];
+static uint32_t cpu_mhz = 0;
+
+// --- Bins ---
+
+static int bin_of(uint32_t v)
+{
+    const uint32_t sub = 1u << PROF_SUB_BITS;
+    if (v < sub) return (int)v;
+    int msb = 31 - __builtin_clz(v);
+    int shift = msb - PROF_SUB_BITS;
+    return (int)(((uint32_t)(shift + 1) << PROF_SUB_BITS) + ((v >> shift) & (sub - 1)));
+}
+
+// Middle of the values that fall in bin b
+static uint32_t bin_mid(int b)
+{
+    const int sub = 1 << PROF_SUB_BITS;
+    if (b < sub) return (uint32_t)b;
+    int shift = (b >> PROF_SUB_BITS) - 1;
+    uint64_t low = (uint64_t)(sub + (b & (sub - 1))) << shift;
+    return (uint32_t)(low + ((1ull << shift) >> 1));
+}
+
+static void clear(prof_hist_t *h)
+{
+    memset(h->bins, 0, sizeof(h->bins));
+    h->count = 0;
+    h->min = UINT32_MAX;
+    h->max = 0;
+}
+
+// --- Recording ---
+
+void profile_init(uint32_t mhz)
+{
+    cpu_mhz = mhz;
+    for (int i = 0; i < PROF_NUM_STAGES; i++) {
+        clear(&hists[i]);
+        hists[i].reset.store(false, std::memory_order_relaxed);
+    }
+}
+
+void profile_record(prof_stage_t stage, uint32_t cycles)
+{
+    prof_hist_t *h = &hists[stage];
+    if (h->reset.load(std::memory_order_acquire)) {
+        clear(h);
+        h->reset.store(false, std::memory_order_release);
+    }
+    uint16_t *bin = &h->bins[bin_of(cycles)];
+    if (*bin != UINT16_MAX) (*bin)++;
+    h->count++;
+    if (cycles < h->min) h->min = cycles;
+    if (cycles > h->max) h->max = cycles;
+}
+
+// --- Snapshot ---
+
+// Value below which `frac` of the binned samples fall, kept within [min, max]
+static uint32_t percentile(const uint16_t *bins, uint32_t total, float frac,
+                           uint32_t min, uint32_t max)
+{
+    uint32_t rank = (uint32_t)(frac * (float)(total - 1));
+    uint32_t seen = 0;
+    for (int b = 0; b < PROF_NUM_BINS; b++) {
+        seen += bins[b];
+        if (seen > rank) {
+            uint32_t v = bin_mid(b);
+            return v < min ? min : (v > max ? max : v);
+        }
+    }
+    return max;
+}
+
+int profile_snapshot(prof_summary_t *out)
+{
+    static uint16_t bins[PROF_NUM_BINS];    // stable copy, callers are serialized
+    for (int i = 0; i < PROF_NUM_STAGES; i++) {
+        prof_hist_t *h = &hists[i];
+        prof_summary_t *s = &out[i];
+        memset(s, 0, sizeof(*s));
+        strncpy(s->name, stage_names[i], PROF_NAME_LEN);
+        // Nothing recorded since the last snapshot
+        if (h->reset.load(std::memory_order_acquire)) continue;
+
+        memcpy(bins, h->bins, sizeof(bins));
+        uint32_t total = 0;
+        for (int b = 0; b < PROF_NUM_BINS; b++) total += bins[b];
+        if (total > 0) {
+            s->count = h->count;
+            s->min = h->min;
+            s->max = h->max;
+            s->p50 = percentile(bins, total, 0.50f, s->min, s->max);
+            s->p99 = percentile(bins, total, 0.99f, s->min, s->max);
+        }
+        h->reset.store(true, std::memory_order_release);
+    }
+    return PROF_NUM_STAGES;
+}
+
+uint32_t profile_cpu_mhz(void)
+{
+    return cpu_mhz;
+}
+
+#endif
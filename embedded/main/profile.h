@@ -0,0 +1,82 @@
+/*
+ * Per-stage cycle profiling of the data path.
+ *
+ * Each stage keeps a histogram of its durations in CPU cycles
+ * (esp_cpu_get_cycle_count, per core, so a stage must start and end on the
+ * same task): exact below 8 cycles, then 8 log-spaced bins per power of
+ * two, so a percentile read back from the bins is within 12.5%. Bins are
+ * uint16 and saturate; send_stats() snapshots and resets every stage each
+ * STATS_INTERVAL_MS, well before that matters at 400Hz.
+ *
+ * Every stage has exactly one writer task. A snapshot (from another task)
+ * reads the bins without locking and asks the writer to clear them on its
+ * next record, so the hot path never waits.
+ *
+ * With PROFILE_ENABLED 0 the PROF_* macros expand to nothing and no
+ * histogram memory is reserved.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED         1
+#endif
+
+#define PROF_SUB_BITS           3           // 8 bins per power of two
+#define PROF_NUM_BINS           ((32 - PROF_SUB_BITS + 1) << PROF_SUB_BITS)
+#define PROF_NAME_LEN           12
+
+typedef enum {
+    PROF_SENSOR_WAKE,       // IMU report callback -> sensor_task running
+    PROF_IMU_READ,          // one INT's packet off the bus (IMU_DRIVER_SHTP: SPI DMA)
+    PROF_IMU_DECODE,        // reports -> one sample (Q-point parse or driver getters)
+    PROF_CAPTURE_PUSH,      // capture ring write
+    PROF_LIVE_PUSH,         // live FIR + ring write
+    PROF_TRIGGER,
+    PROF_SWING_PHASE,       // event copy out of the capture ring + analysis
+    PROF_STROKE,            // stroke features + classifier
+    PROF_LIVE_ENCODE,       // one live datagram (encode_task)
+    PROF_LIVE_QUEUED,       // live datagram queued -> sent, encode_task to udp_live_task
+    PROF_LIVE_SEND,         // sendto
+    PROF_EVENT_ENCODE,      // one event body (encode_task)
+    PROF_EVENT_POST,        // POST one encoded event, response included
+    PROF_NUM_STAGES
+} prof_stage_t;
+
+typedef struct {
+    char name[PROF_NAME_LEN];
+    uint32_t count;
+    uint32_t min;           // cycles
+    uint32_t p50;
+    uint32_t p99;
+    uint32_t max;
+} prof_summary_t;
+
+#if PROFILE_ENABLED
+
+#include "esp_cpu.h"
+
+#define PROF_START(var)             uint32_t var = esp_cpu_get_cycle_count()
+#define PROF_END(stage, var)        profile_record((stage), esp_cpu_get_cycle_count() - (var))
+#define PROF_RECORD(stage, cycles)  profile_record((stage), (cycles))
+
+void profile_init(uint32_t cpu_mhz);
+
+void profile_record(prof_stage_t stage, uint32_t cycles);
+
+// Summaries of all stages since the last snapshot, then start a new window.
+// Returns PROF_NUM_STAGES.
+int profile_snapshot(prof_summary_t *out);
+
+uint32_t profile_cpu_mhz(void);
+
+#else
+
+#define PROF_START(var)             do {} while (0)
+#define PROF_END(stage, var)        do {} while (0)
+#define PROF_RECORD(stage, cycles)  do {} while (0)
+
+#endif
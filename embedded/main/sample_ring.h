@@ -0,0 +1,110 @@
+/*
+ * Lock-free single-producer ring of sensor samples shared across cores.
+ *
+ * The producer (sensor_task) never waits on a consumer: it writes
+ * slots[head & mask] and then publishes head with release ordering. The
+ * consumer keeps its own read cursor and reads contiguous spans in place,
+ * so batches go from the ring to the encoder without an intermediate copy.
+ * Slots are addressed by a free-running 32-bit index (the number of samples
+ * pushed before it), so any index newer than head - capacity can be read
+ * back by range.
+ *
+ * The slot the producer is about to write is never readable, so at most
+ * capacity - 1 samples of history are available. A cursor that falls further
+ * behind has been overrun; the next peek skips it forward to the oldest
+ * intact sample and counts the loss.
+ *
+ * Because the producer may lap a slow reader mid-read, a consumer must call
+ * sample_ring_intact() after it has finished with a span and before it
+ * trusts the encoded result. That check is a seqlock read: head is the
+ * sequence, the push fences its previous head store before the slot write,
+ * and intact() fences the slot reads before it loads head again.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include "sensor_sample.h"
+
+typedef struct {
+    sensor_sample_t *slots;
+    uint32_t capacity;              // power of two
+    uint32_t mask;                  // capacity - 1
+    std::atomic<uint32_t> head;     // index of the next sample to be written
+} sample_ring_t;
+
+typedef struct {
+    uint32_t tail;                  // index of the next sample to read
+    uint32_t dropped;               // samples overwritten before being read
+} sample_ring_reader_t;
+
+static inline void sample_ring_init(sample_ring_t *ring, sensor_sample_t *storage,
+                                    uint32_t capacity)
+{
+    ring->slots = storage;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->head.store(0, std::memory_order_relaxed);
+}
+
+// --- Producer side ---
+
+static inline void sample_ring_push(sample_ring_t *ring, const sensor_sample_t *s)
+{
+    uint32_t h = ring->head.load(std::memory_order_relaxed);
+    // A reader that sees any of this overwrite must also see head == h
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->slots[h & ring->mask] = *s;
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+// --- Consumer side ---
+
+static inline uint32_t sample_ring_head(const sample_ring_t *ring)
+{
+    return ring->head.load(std::memory_order_acquire);
+}
+
+// Contiguous span of up to `max` samples starting at `first`, read in place.
+// Returns 0 if `first` is not yet written or has already been overwritten.
+static inline uint32_t sample_ring_range(const sample_ring_t *ring, uint32_t first,
+                                         uint32_t max, const sensor_sample_t **out)
+{
+    uint32_t h = sample_ring_head(ring);
+    uint32_t avail = h - first;
+    if (avail == 0 || avail >= ring->capacity) return 0;
+    uint32_t to_wrap = ring->capacity - (first & ring->mask);
+    uint32_t n = avail < to_wrap ? avail : to_wrap;
+    if (n > max) n = max;
+    *out = &ring->slots[first & ring->mask];
+    return n;
+}
+
+// Next unread span for this reader. Does not advance the cursor.
+static inline uint32_t sample_ring_peek(const sample_ring_t *ring,
+                                        sample_ring_reader_t *reader, uint32_t max,
+                                        const sensor_sample_t **out)
+{
+    uint32_t h = sample_ring_head(ring);
+    if (h - reader->tail >= ring->capacity) {
+        uint32_t oldest = h - ring->capacity + 1;
+        reader->dropped += oldest - reader->tail;
+        reader->tail = oldest;
+    }
+    return sample_ring_range(ring, reader->tail, max, out);
+}
+
+static inline void sample_ring_consume(sample_ring_reader_t *reader, uint32_t n)
+{
+    reader->tail += n;
+}
+
+// True if the span starting at `first` was not overwritten while it was read.
+// The fence keeps the reads of the span from moving after the head load (an
+// acquire load alone only orders what comes after it).
+static inline bool sample_ring_intact(const sample_ring_t *ring, uint32_t first)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return ring->head.load(std::memory_order_relaxed) - first < ring->capacity;
+}
@@ -0,0 +1,76 @@
+/*
+ * Read-only strided view of a run of samples for the encoders.
+ *
+ * Each channel is a base pointer plus a byte stride, so the same encoder
+ * loop reads the live ring's packed sensor_sample_t records (stride 48) and
+ * the event slots' per-channel arrays (stride 4 or 8) without first copying
+ * either into the other's layout. Loads go through memcpy because fields of
+ * the packed record are not naturally aligned.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sensor_sample.h"
+
+typedef struct {
+    const uint8_t *axis[SAMPLE_NUM_AXES];   // SAMPLE_GYRO_X ... SAMPLE_ACCEL_Z
+    const uint8_t *timestamp_us;
+    const uint8_t *seq;
+    size_t axis_stride;                     // bytes between consecutive samples
+    size_t timestamp_stride;
+    size_t seq_stride;
+} sample_view_t;
+
+static inline sample_view_t sample_view_of_records(const sensor_sample_t *samples)
+{
+    const uint8_t *base = (const uint8_t *)samples;
+    sample_view_t v;
+    v.axis[SAMPLE_GYRO_X] = base + offsetof(sensor_sample_t, gyro_x);
+    v.axis[SAMPLE_GYRO_Y] = base + offsetof(sensor_sample_t, gyro_y);
+    v.axis[SAMPLE_GYRO_Z] = base + offsetof(sensor_sample_t, gyro_z);
+    v.axis[SAMPLE_ACCEL_X] = base + offsetof(sensor_sample_t, accel_x);
+    v.axis[SAMPLE_ACCEL_Y] = base + offsetof(sensor_sample_t, accel_y);
+    v.axis[SAMPLE_ACCEL_Z] = base + offsetof(sensor_sample_t, accel_z);
+    v.timestamp_us = base + offsetof(sensor_sample_t, timestamp_us);
+    v.seq = base + offsetof(sensor_sample_t, seq);
+    v.axis_stride = sizeof(sensor_sample_t);
+    v.timestamp_stride = sizeof(sensor_sample_t);
+    v.seq_stride = sizeof(sensor_sample_t);
+    return v;
+}
+
+static inline sample_view_t sample_view_of_block(const sample_block_t *block)
+{
+    sample_view_t v;
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) v.axis[a] = (const uint8_t *)block->axis[a];
+    v.timestamp_us = (const uint8_t *)block->timestamp_us;
+    v.seq = (const uint8_t *)block->seq;
+    v.axis_stride = sizeof(float);
+    v.timestamp_stride = sizeof(int64_t);
+    v.seq_stride = sizeof(uint32_t);
+    return v;
+}
+
+static inline float sample_view_axis(const sample_view_t *v, int axis, int i)
+{
+    float x;
+    memcpy(&x, v->axis[axis] + (size_t)i * v->axis_stride, sizeof(x));
+    return x;
+}
+
+static inline int64_t sample_view_timestamp(const sample_view_t *v, int i)
+{
+    int64_t t;
+    memcpy(&t, v->timestamp_us + (size_t)i * v->timestamp_stride, sizeof(t));
+    return t;
+}
+
+static inline uint32_t sample_view_seq(const sample_view_t *v, int i)
+{
+    uint32_t s;
+    memcpy(&s, v->seq + (size_t)i * v->seq_stride, sizeof(s));
+    return s;
+}
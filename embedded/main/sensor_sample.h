@@ -0,0 +1,45 @@
+/*
+ * Sample record and per-channel sample storage shared by the sensor task,
+ * the network tasks and the wire encoders.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct __attribute__((packed)) {
+    float euler_x, euler_y, euler_z;
+    float gyro_x, gyro_y, gyro_z;
+    float accel_x, accel_y, accel_z;
+    int64_t timestamp_us;           // esp_timer (monotonic) at report arrival
+    uint32_t seq;
+} sensor_sample_t;  // 48 bytes
+
+// Per-channel (structure-of-arrays) storage for the capture ring and the
+// event slots: each channel the event path uses is one contiguous array,
+// so kernels and encoders read slices of it directly.
+enum {
+    SAMPLE_GYRO_X, SAMPLE_GYRO_Y, SAMPLE_GYRO_Z,
+    SAMPLE_ACCEL_X, SAMPLE_ACCEL_Y, SAMPLE_ACCEL_Z,
+    SAMPLE_NUM_AXES
+};
+
+typedef struct {
+    float *axis[SAMPLE_NUM_AXES];
+    int64_t *timestamp_us;
+    uint32_t *seq;
+} sample_block_t;
+
+#define SAMPLE_BLOCK_BYTES_PER_SAMPLE \
+    (SAMPLE_NUM_AXES * sizeof(float) + sizeof(int64_t) + sizeof(uint32_t))
+
+// The same channels starting `offset` samples into `block`
+static inline sample_block_t sample_block_offset(const sample_block_t *block, size_t offset)
+{
+    sample_block_t b;
+    for (int a = 0; a < SAMPLE_NUM_AXES; a++) b.axis[a] = block->axis[a] + offset;
+    b.timestamp_us = block->timestamp_us + offset;
+    b.seq = block->seq + offset;
+    return b;
+}
@@ -0,0 +1,165 @@
+/*
+ * SHTP / SH-2 report decoding. See shtp.h.
+ */
+
+#include "shtp.h"
+
+#include <math.h>
+#include <string.h>
+
+#define Q8_SCALE        (1.0f / 256.0f)
+#define Q9_SCALE        (1.0f / 512.0f)
+#define Q14_SCALE       (1.0f / 16384.0f)
+#define RAD_TO_DEG      57.29577951f
+
+static inline int16_t rd_i16(const uint8_t *p)
+{
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t rd_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void wr_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Length of one record in a reports cargo, or 0 if the ID is not one the
+// racquet enables (the rest of the cargo cannot be walked then)
+static int report_length(uint8_t id)
+{
+    switch (id) {
+        case SH2_ACCELEROMETER:         return 10;
+        case SH2_GYROSCOPE_CALIBRATED:  return 10;
+        case 0x03:                      return 10;  // magnetic field
+        case 0x04:                      return 10;  // linear acceleration
+        case 0x05:                      return 14;  // rotation vector
+        case 0x06:                      return 10;  // gravity
+        case 0x07:                      return 16;  // uncalibrated gyro
+        case SH2_GAME_ROTATION_VECTOR:  return 12;
+        case 0x09:                      return 14;  // geomagnetic rotation vector
+        case SH2_TIMESTAMP_REBASE:      return 5;
+        case SH2_BASE_TIMESTAMP:        return 5;
+        case SH2_GET_FEATURE_RESPONSE:  return 17;
+        default:                        return 0;
+    }
+}
+
+// Delay of a report from the base timestamp: 6 bits in the status byte
+// above the accuracy, 8 in the next
+static inline int64_t report_delay_us(const uint8_t *r)
+{
+    return (int64_t)((((r[2] & 0xFC) << 6) | r[3]) * SHTP_TICK_US);
+}
+
+// Game rotation vector (i, j, k, real) to roll / pitch / yaw in degrees
+static void decode_euler(const uint8_t *r, sensor_sample_t *s)
+{
+    float qi = rd_i16(r + 4) * Q14_SCALE;
+    float qj = rd_i16(r + 6) * Q14_SCALE;
+    float qk = rd_i16(r + 8) * Q14_SCALE;
+    float qr = rd_i16(r + 10) * Q14_SCALE;
+    float sinp = 2.0f * (qr * qj - qk * qi);
+    if (sinp > 1.0f) sinp = 1.0f;
+    if (sinp < -1.0f) sinp = -1.0f;
+    s->euler_x = atan2f(2.0f * (qr * qi + qj * qk), 1.0f - 2.0f * (qi * qi + qj * qj)) * RAD_TO_DEG;
+    s->euler_y = asinf(sinp) * RAD_TO_DEG;
+    s->euler_z = atan2f(2.0f * (qr * qk + qi * qj), 1.0f - 2.0f * (qj * qj + qk * qk)) * RAD_TO_DEG;
+}
+
+int shtp_write_set_feature(uint8_t *buf, uint8_t seq, uint8_t report_id, uint32_t period_us)
+{
+    memset(buf, 0, SHTP_SET_FEATURE_LEN);
+    buf[0] = (uint8_t)SHTP_SET_FEATURE_LEN;
+    buf[1] = 0;
+    buf[2] = SHTP_CHAN_CONTROL;
+    buf[3] = seq;
+
+    // Flags, change sensitivity, batch interval and sensor config all zero
+    uint8_t *cmd = buf + SHTP_HEADER_LEN;
+    cmd[0] = SH2_SET_FEATURE_COMMAND;
+    cmd[1] = report_id;
+    wr_u32(cmd + 5, period_us);
+    return SHTP_SET_FEATURE_LEN;
+}
+
+void shtp_parser_init(shtp_parser_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+void shtp_parser_begin(shtp_parser_t *p, const uint8_t *cargo, int len, int64_t int_time_us)
+{
+    p->cargo = cargo;
+    p->len = len;
+    p->pos = 0;
+    p->int_time_us = int_time_us;
+    p->base_us = int_time_us;
+    p->gyro_pending = false;
+}
+
+bool shtp_parser_next(shtp_parser_t *p, sensor_sample_t *s)
+{
+    while (p->pos < p->len) {
+        const uint8_t *r = p->cargo + p->pos;
+        int n = report_length(r[0]);
+        if (n == 0 || p->pos + n > p->len) {
+            p->unknown++;
+            p->pos = p->len;
+            break;
+        }
+
+        switch (r[0]) {
+            case SH2_BASE_TIMESTAMP:
+                p->base_us = p->int_time_us - (int64_t)rd_u32(r + 1) * SHTP_TICK_US;
+                break;
+
+            case SH2_TIMESTAMP_REBASE:
+                p->base_us += (int64_t)(int32_t)rd_u32(r + 1) * SHTP_TICK_US;
+                break;
+
+            case SH2_GYROSCOPE_CALIBRATED:
+            case SH2_ACCELEROMETER:
+            case SH2_GAME_ROTATION_VECTOR: {
+                int64_t t = p->base_us + report_delay_us(r);
+                int64_t apart = t > p->instant_us ? t - p->instant_us : p->instant_us - t;
+                if (p->gyro_pending && apart > SHTP_SAME_INSTANT_US) {
+                    // Next instant: hand back the sample, come back to r
+                    p->gyro_pending = false;
+                    return true;
+                }
+                p->instant_us = t;
+                if (r[0] == SH2_GYROSCOPE_CALIBRATED) {
+                    s->gyro_x = rd_i16(r + 4) * Q9_SCALE;
+                    s->gyro_y = rd_i16(r + 6) * Q9_SCALE;
+                    s->gyro_z = rd_i16(r + 8) * Q9_SCALE;
+                    s->timestamp_us = t;
+                    p->gyro_pending = true;
+                } else if (r[0] == SH2_ACCELEROMETER) {
+                    s->accel_x = rd_i16(r + 4) * Q8_SCALE;
+                    s->accel_y = rd_i16(r + 6) * Q8_SCALE;
+                    s->accel_z = rd_i16(r + 8) * Q8_SCALE;
+                } else {
+                    decode_euler(r, s);
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+        p->pos += n;
+    }
+
+    if (p->gyro_pending) {
+        p->gyro_pending = false;
+        return true;
+    }
+    return false;
+}
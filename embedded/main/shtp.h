@@ -0,0 +1,86 @@
+/*
+ * SHTP packets and SH-2 input reports from the BNO085, decoded in place.
+ *
+ * The parser walks a report cargo where the SPI transfer left it (a DMA
+ * buffer, bno085_spi.h) and writes the Q-point fields straight into the
+ * caller's sample: no driver-side copies, no intermediate structs.
+ * Reports taken at one instant (same hub timestamp) make one sample;
+ * shtp_parser_next() hands it back each time a gyro report's instant is
+ * complete, so a batched cargo with several gyro reports yields several
+ * samples. Accel and orientation update the sample in place and carry
+ * forward when they run slower than the gyro.
+ *
+ * Timestamps come from the hub: each cargo opens with a base timestamp
+ * relative to the host interrupt, and each report has its delay from that
+ * base (100us ticks). No ESP-IDF dependencies, so it also builds on the
+ * host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sensor_sample.h"
+
+// SHTP header: length (LE, includes the header; bit 15 = continuation),
+// channel, sequence number per channel
+#define SHTP_HEADER_LEN             4
+#define SHTP_CONTINUATION           0x8000
+#define SHTP_MAX_LENGTH             0x7FFF
+
+#define SHTP_CHAN_COMMAND           0
+#define SHTP_CHAN_EXECUTABLE        1
+#define SHTP_CHAN_CONTROL           2       // Set Feature commands and their responses
+#define SHTP_CHAN_REPORTS           3       // input reports (normal)
+#define SHTP_CHAN_WAKE_REPORTS      4
+#define SHTP_CHAN_GYRO_RV           5
+
+// SH-2 report IDs
+#define SH2_ACCELEROMETER           0x01    // m/s^2, Q8
+#define SH2_GYROSCOPE_CALIBRATED    0x02    // rad/s, Q9
+#define SH2_GAME_ROTATION_VECTOR    0x08    // unit quaternion, Q14
+#define SH2_TIMESTAMP_REBASE        0xFA
+#define SH2_BASE_TIMESTAMP          0xFB
+#define SH2_GET_FEATURE_RESPONSE    0xFC
+#define SH2_SET_FEATURE_COMMAND     0xFD
+
+#define SHTP_SET_FEATURE_LEN        (SHTP_HEADER_LEN + 17)
+#define SHTP_TICK_US                100     // base timestamp and report delay unit
+#define SHTP_SAME_INSTANT_US        200     // reports this close belong to one sample
+
+typedef struct {
+    const uint8_t *cargo;           // reports, after the SHTP header
+    int len;
+    int pos;
+    int64_t int_time_us;            // host interrupt the cargo was announced by
+    int64_t base_us;                // reference for report delays
+    int64_t instant_us;             // time of the reports gathered into the sample so far
+    bool gyro_pending;              // the sample has this instant's gyro, not handed back yet
+    uint32_t unknown;               // cargos cut short by a report ID with no known length
+} shtp_parser_t;
+
+static inline int shtp_packet_length(const uint8_t *hdr)
+{
+    return (hdr[0] | (hdr[1] << 8)) & SHTP_MAX_LENGTH;
+}
+
+static inline bool shtp_is_continuation(const uint8_t *hdr)
+{
+    return ((hdr[0] | (hdr[1] << 8)) & SHTP_CONTINUATION) != 0;
+}
+
+// Whole Set Feature packet into buf (SHTP_SET_FEATURE_LEN bytes): report
+// `report_id` every period_us, 0 switches it off. Returns its length.
+int shtp_write_set_feature(uint8_t *buf, uint8_t seq, uint8_t report_id, uint32_t period_us);
+
+void shtp_parser_init(shtp_parser_t *p);
+
+// Start on the cargo of one reports-channel packet. int_time_us is the
+// host's time of the INT that announced it (esp_timer, microseconds).
+void shtp_parser_begin(shtp_parser_t *p, const uint8_t *cargo, int len, int64_t int_time_us);
+
+// Decode up to the next complete sample into *s: gyro, accel, Euler angles
+// (degrees, from the game rotation vector) and timestamp_us are written in
+// place, seq is left to the caller. Returns false once the cargo is used
+// up; an accel or orientation update with no gyro stays in *s for the
+// next sample.
+bool shtp_parser_next(shtp_parser_t *p, sensor_sample_t *s);
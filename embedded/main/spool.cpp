@@ -0,0 +1,360 @@
+/*
+ * Flash spool of wire packets. See spool.h.
+ */
+
+#include "spool.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define SECTOR      SPOOL_SECTOR_SIZE
+#define HDR_LEN     ((uint32_t)sizeof(spool_sector_header_t))
+#define REC_LEN     ((uint32_t)sizeof(wire_spool_record_t))
+#define READ_CHUNK  256
+
+static inline uint32_t pos_seq(uint64_t pos) { return (uint32_t)(pos / SECTOR); }
+static inline uint32_t pos_off(uint64_t pos) { return (uint32_t)(pos % SECTOR); }
+static inline uint64_t sector_pos(uint32_t seq) { return (uint64_t)seq * SECTOR; }
+
+static inline uint32_t flash_addr(const spool_t *sp, uint64_t pos)
+{
+    return (pos_seq(pos) % sp->num_sectors) * SECTOR + pos_off(pos);
+}
+
+uint32_t spool_crc32(uint32_t crc, const void *data, size_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// --- Layout ---
+
+// Where a record header at `pos` really goes: past the sector header, and
+// never split across two sectors
+static uint64_t fit_header(uint64_t pos)
+{
+    uint32_t off = pos_off(pos);
+    if (off == 0) return pos + HDR_LEN;
+    if (SECTOR - off < REC_LEN) return sector_pos(pos_seq(pos) + 1) + HDR_LEN;
+    return pos;
+}
+
+// `pos` moved over n record bytes, stepping around sector headers
+static uint64_t advance(uint64_t pos, uint32_t n)
+{
+    while (n > 0) {
+        if (pos_off(pos) == 0) pos += HDR_LEN;
+        uint32_t room = SECTOR - pos_off(pos);
+        uint32_t step = n < room ? n : room;
+        pos += step;
+        n -= step;
+    }
+    return pos;
+}
+
+// Header of sector `seq`, if the physical sector still holds that one
+static bool read_sector_header(spool_t *sp, uint32_t seq, spool_sector_header_t *hdr)
+{
+    uint32_t addr = (seq % sp->num_sectors) * SECTOR;
+    if (!sp->flash.read(sp->flash.ctx, addr, hdr, sizeof(*hdr))) return false;
+    return hdr->magic == SPOOL_SECTOR_MAGIC && hdr->seq == seq;
+}
+
+static bool write_sector_field(spool_t *sp, uint32_t seq, size_t field, const void *v, size_t len)
+{
+    uint32_t addr = (seq % sp->num_sectors) * SECTOR + (uint32_t)field;
+    return sp->flash.write(sp->flash.ctx, addr, v, len);
+}
+
+// First record starting in sector `seq` or a later one written so far
+static bool first_record_from(spool_t *sp, uint32_t seq, uint64_t *out)
+{
+    for (; seq <= pos_seq(sp->head); seq++) {
+        spool_sector_header_t hdr;
+        if (read_sector_header(sp, seq, &hdr) && hdr.first_record != SPOOL_NO_RECORD) {
+            *out = sector_pos(seq) + hdr.first_record;
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- Reading ---
+
+// A read position at a sector start stands for the first record from
+// there on; find it. False if none has been started yet.
+static bool resolve_read_pos(spool_t *sp)
+{
+    if (pos_off(sp->read_pos) != 0) return true;
+    uint64_t pos;
+    if (!first_record_from(sp, pos_seq(sp->read_pos), &pos)) return false;
+    sp->read_pos = pos;
+    return true;
+}
+
+// Record header at `pos` and where the record ends. False if it is not
+// complete: cut short, or not committed yet.
+static bool read_record(spool_t *sp, uint64_t pos, wire_spool_record_t *rec, uint64_t *end)
+{
+    if (pos >= sp->committed) return false;
+    if (!sp->flash.read(sp->flash.ctx, flash_addr(sp, pos), rec, REC_LEN)) return false;
+    if (rec->len == 0 || rec->len > SPOOL_RECORD_MAX) return false;
+    *end = advance(pos + REC_LEN, rec->len);
+    return *end <= sp->committed;
+}
+
+static bool stream_bytes(spool_t *sp, uint64_t pos, uint32_t n, byte_sink_t *sink)
+{
+    uint8_t chunk[READ_CHUNK];
+    while (n > 0) {
+        if (pos_off(pos) == 0) pos += HDR_LEN;
+        uint32_t room = SECTOR - pos_off(pos);
+        uint32_t step = n < room ? n : room;
+        if (step > READ_CHUNK) step = READ_CHUNK;
+        if (!sp->flash.read(sp->flash.ctx, flash_addr(sp, pos), chunk, step)) return false;
+        if (!byte_sink_write(sink, chunk, step)) return false;
+        pos += step;
+        n -= step;
+    }
+    return true;
+}
+
+// Sectors the upload has moved past get their uploaded mark, so the next
+// boot starts after them
+static void mark_uploaded(spool_t *sp)
+{
+    static const uint32_t zero = 0;
+    uint32_t done = pos_seq(sp->read_pos);
+    for (; sp->marked_seq < done; sp->marked_seq++) {
+        spool_sector_header_t hdr;
+        if (read_sector_header(sp, sp->marked_seq, &hdr) && hdr.uploaded != 0) {
+            write_sector_field(sp, sp->marked_seq, offsetof(spool_sector_header_t, uploaded),
+                               &zero, sizeof(zero));
+        }
+    }
+}
+
+bool spool_init(spool_t *sp, const spool_flash_t *flash, uint32_t boot_id)
+{
+    memset(sp, 0, sizeof(*sp));
+    sp->flash = *flash;
+    sp->boot_id = boot_id;
+    sp->num_sectors = flash->size / SECTOR;
+    // A record may not reach round to its own first sector
+    if (sp->num_sectors < 3 ||
+        (sp->num_sectors - 2) * (SECTOR - HDR_LEN) < SPOOL_RECORD_MAX + REC_LEN) {
+        return false;
+    }
+
+    bool any = false;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < sp->num_sectors; i++) {
+        spool_sector_header_t hdr;
+        if (!sp->flash.read(sp->flash.ctx, i * SECTOR, &hdr, sizeof(hdr))) return false;
+        if (hdr.magic != SPOOL_SECTOR_MAGIC || hdr.seq % sp->num_sectors != i) continue;
+        if (!any || hdr.seq > newest) newest = hdr.seq;
+        any = true;
+    }
+    if (!any) return true;
+
+    // This boot starts a sector of its own; the upload resumes at the
+    // oldest run of sectors not marked uploaded
+    sp->head = sp->committed = sector_pos(newest + 1);
+    uint32_t oldest = newest + 1;
+    for (uint32_t back = 0; back < sp->num_sectors && back <= newest; back++) {
+        spool_sector_header_t hdr;
+        if (!read_sector_header(sp, newest - back, &hdr) || hdr.uploaded == 0) break;
+        oldest = newest - back;
+    }
+    sp->read_pos = sector_pos(oldest);
+    sp->marked_seq = oldest;
+    return true;
+}
+
+// --- Appending ---
+
+// Erase the sector for `seq` and head it. The sector held seq - num_sectors
+// before: if the upload had not got past that one, its records are lost.
+static bool open_sector(spool_t *sp, uint32_t seq)
+{
+    if (seq >= sp->num_sectors) {
+        uint32_t victim = seq - sp->num_sectors;
+        if (sp->read_pos < sector_pos(victim + 1)) {
+            if (spool_pending(sp)) sp->dropped_sectors++;
+            sp->read_pos = sector_pos(victim + 1);
+        }
+        if (sp->marked_seq <= victim) sp->marked_seq = victim + 1;
+    }
+
+    sp->head_open = false;
+    uint32_t addr = (seq % sp->num_sectors) * SECTOR;
+    if (!sp->flash.erase_sector(sp->flash.ctx, addr)) return false;
+    spool_sector_header_t hdr;
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic = SPOOL_SECTOR_MAGIC;
+    hdr.seq = seq;
+    if (!sp->flash.write(sp->flash.ctx, addr, &hdr, sizeof(hdr))) return false;
+    sp->open_seq = seq;
+    sp->head_open = true;
+    sp->head_has_record = false;
+    return true;
+}
+
+static bool ensure_open(spool_t *sp, uint32_t seq)
+{
+    if (sp->head_open && sp->open_seq == seq) return true;
+    return open_sector(sp, seq);
+}
+
+bool spool_begin(spool_t *sp)
+{
+    if (sp->in_record) spool_end(sp, false);
+    uint64_t pos = fit_header(sp->head);
+    if (!ensure_open(sp, pos_seq(pos))) return false;
+    if (!sp->head_has_record) {
+        uint16_t off = (uint16_t)pos_off(pos);
+        if (!write_sector_field(sp, pos_seq(pos), offsetof(spool_sector_header_t, first_record),
+                                &off, sizeof(off))) {
+            return false;
+        }
+        sp->head_has_record = true;
+    }
+    sp->record_pos = pos;
+    sp->record_len = 0;
+    sp->record_crc = 0;
+    sp->head = pos + REC_LEN;
+    sp->in_record = true;
+    return true;
+}
+
+bool spool_write(spool_t *sp, const void *data, size_t len)
+{
+    if (!sp->in_record) return false;
+    if (sp->record_len + len > SPOOL_RECORD_MAX) {
+        spool_end(sp, false);
+        return false;
+    }
+    sp->record_crc = spool_crc32(sp->record_crc, data, len);
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        if (pos_off(sp->head) == 0) {
+            if (!ensure_open(sp, pos_seq(sp->head))) {
+                spool_end(sp, false);
+                return false;
+            }
+            sp->head += HDR_LEN;
+        }
+        uint32_t room = SECTOR - pos_off(sp->head);
+        uint32_t n = len < room ? (uint32_t)len : room;
+        if (!sp->flash.write(sp->flash.ctx, flash_addr(sp, sp->head), p, n)) {
+            spool_end(sp, false);
+            return false;
+        }
+        sp->head += n;
+        sp->record_len += n;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool spool_end(spool_t *sp, bool complete)
+{
+    if (!sp->in_record) return false;
+    sp->in_record = false;
+    if (complete && sp->record_len > 0) {
+        wire_spool_record_t rec = {};
+        rec.len = (uint16_t)sp->record_len;
+        rec.boot_id = sp->boot_id;
+        rec.crc32 = sp->record_crc;
+        if (sp->flash.write(sp->flash.ctx, flash_addr(sp, sp->record_pos), &rec, REC_LEN)) {
+            sp->committed = sp->head;
+            return true;
+        }
+    }
+    // The header stays erased, so readers skip to the next sector's first
+    // record; nothing more may go into this one
+    sp->skipped_records++;
+    if (pos_off(sp->head) != 0) sp->head = sector_pos(pos_seq(sp->head) + 1);
+    return false;
+}
+
+bool spool_append(spool_t *sp, const void *packet, size_t len)
+{
+    return spool_begin(sp) && spool_write(sp, packet, len) && spool_end(sp, true);
+}
+
+bool spool_sink_write(void *ctx, const uint8_t *data, size_t len)
+{
+    return spool_write((spool_t *)ctx, data, len);
+}
+
+// --- Uploading ---
+
+bool spool_pending(spool_t *sp)
+{
+    return resolve_read_pos(sp) && fit_header(sp->read_pos) < sp->committed;
+}
+
+uint64_t spool_pending_bytes(const spool_t *sp)
+{
+    return sp->committed > sp->read_pos ? sp->committed - sp->read_pos : 0;
+}
+
+bool spool_batch_plan(spool_t *sp, uint32_t max_bytes, spool_batch_t *batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    wire_spool_record_t rec;
+    uint64_t pos, end;
+
+    // Step over records that were cut short
+    while (true) {
+        if (!spool_pending(sp)) return false;
+        pos = fit_header(sp->read_pos);
+        if (read_record(sp, pos, &rec, &end)) break;
+        sp->read_pos = sector_pos(pos_seq(pos) + 1);
+        mark_uploaded(sp);
+    }
+
+    batch->start = pos;
+    while (true) {
+        uint32_t size = REC_LEN + rec.len;
+        if (batch->records > 0 && batch->bytes + size > max_bytes) break;
+        batch->records++;
+        batch->bytes += size;
+        batch->end = end;
+        pos = fit_header(end);
+        if (!read_record(sp, pos, &rec, &end)) break;
+    }
+    return true;
+}
+
+bool spool_batch_read(spool_t *sp, const spool_batch_t *batch, byte_sink_t *sink)
+{
+    uint64_t pos = batch->start;
+    for (uint32_t i = 0; i < batch->records; i++) {
+        wire_spool_record_t rec;
+        uint64_t end;
+        pos = fit_header(pos);
+        if (!read_record(sp, pos, &rec, &end)) return false;
+        if (!byte_sink_write(sink, &rec, REC_LEN)) return false;
+        if (!stream_bytes(sp, pos + REC_LEN, rec.len, sink)) return false;
+        pos = end;
+    }
+    return true;
+}
+
+void spool_batch_done(spool_t *sp, const spool_batch_t *batch)
+{
+    sp->read_pos = batch->end;
+    mark_uploaded(sp);
+}
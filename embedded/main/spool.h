@@ -0,0 +1,148 @@
+/*
+ * Log-structured spool of wire packets on raw flash, for sessions away from
+ * the server.
+ *
+ * While the link is down the racquet appends what it would have sent
+ * (full-rate live packets, events, clock pairs) as records, and once it is
+ * back it uploads them oldest first in batches (WIRE_PKT_BACKLOG,
+ * wire_format.h). The flash is a ring of SPOOL_SECTOR_SIZE sectors written
+ * strictly in order; sector number `seq` (counting every sector ever
+ * written) lives at physical sector seq % num_sectors, and each one opens
+ * with a spool_sector_header_t:
+ *
+ *   sector   header | records ... (a record may run on into later sectors,
+ *                     around their headers)
+ *   record   wire_spool_record_t | packet
+ *
+ * NOR flash only clears bits, so fields are written once each, after the
+ * bytes they describe: a record's header (length, boot, CRC) once the
+ * packet is in, a sector's first_record when the first record starting in
+ * it begins, its uploaded mark once the server has all of it. A record
+ * whose header is still erased was cut short (a reset, a failed write) and
+ * is stepped over by going to the next first_record. Every boot opens a
+ * fresh sector, so nothing is ever written over a half-finished record.
+ *
+ * When the ring is full the oldest sector is erased and lost, as the event
+ * pool drops its oldest event. At boot spool_init() finds the newest sector
+ * and the oldest one not yet uploaded from the sector headers alone.
+ * Delivery is at least once: a reset between an upload and its mark can
+ * resend up to one sector.
+ *
+ * A sector erase takes tens of milliseconds, a few hundred at worst, and
+ * on its own it stalls both cores' flash cache, sensor_task included,
+ * which can outlast what the BNO085 buffers at 400 Hz.
+ * sdkconfig.defaults turns on CONFIG_SPI_FLASH_AUTO_SUSPEND, so an erase or
+ * a write is suspended for each cache miss and the other core keeps
+ * running. Reports the hub dropped anyway show up as sensor_gaps in the
+ * stats packet (wire_format.h).
+ *
+ * Spooled samples take about 12 bytes each (full-rate delta batches, record
+ * and sector headers included), so the 0x270000 partition in
+ * partitions.csv holds about 8 minutes of activity at 400 Hz and about 3 at
+ * 1 kHz before the oldest sectors go.
+ *
+ * Single user (http_event_task). The flash itself is behind spool_flash_t,
+ * so the spool also runs on the host over a RAM image.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "byte_sink.h"
+#include "wire_format.h"
+
+#define SPOOL_SECTOR_SIZE       4096        // erase unit
+#define SPOOL_SECTOR_MAGIC      0x4c4f5053  // "SPOL"
+#define SPOOL_NO_RECORD         0xFFFF      // first_record: no record starts in the sector
+#define SPOOL_RECORD_MAX        0xFFF0      // packet bytes; 0xFFFF is an erased header
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;                   // sectors written before this one
+    uint16_t first_record;          // offset of the first record starting here
+    uint16_t reserved;
+    uint32_t uploaded;              // 0 once every record ending here reached the server
+} spool_sector_header_t;  // 16 bytes
+
+static_assert(sizeof(spool_sector_header_t) == 16, "spool_sector_header_t layout");
+
+typedef struct {
+    bool (*read)(void *ctx, uint32_t addr, void *buf, size_t len);
+    bool (*write)(void *ctx, uint32_t addr, const void *buf, size_t len);
+    bool (*erase_sector)(void *ctx, uint32_t addr);
+    void *ctx;
+    uint32_t size;                  // bytes, a multiple of SPOOL_SECTOR_SIZE
+} spool_flash_t;
+
+// Positions count bytes of every sector ever written: seq * SPOOL_SECTOR_SIZE
+// + offset. An offset of 0 (where only a sector header can be) stands for
+// "the first record starting in this sector or later".
+typedef struct {
+    spool_flash_t flash;
+    uint32_t num_sectors;
+    uint32_t boot_id;               // stamped into every record
+    uint64_t head;                  // where the next byte goes
+    uint64_t committed;             // end of the last complete record
+    uint64_t read_pos;              // next record to upload
+    uint32_t open_seq;              // sector head is in, once erased and headed
+    bool head_open;
+    bool head_has_record;           // first_record of the head sector written
+    uint32_t marked_seq;            // next sector to get its uploaded mark
+    // Record being appended
+    bool in_record;
+    uint64_t record_pos;
+    uint32_t record_len;
+    uint32_t record_crc;
+    // Counters
+    uint32_t dropped_sectors;       // overwritten before upload
+    uint32_t skipped_records;       // cut short, stepped over
+} spool_t;
+
+typedef struct {
+    uint64_t start;                 // first record
+    uint64_t end;                   // just past the last
+    uint32_t records;
+    uint32_t bytes;                 // record headers and packets, as uploaded
+} spool_batch_t;
+
+// Find the write head and the upload position from the sector headers.
+// False if the flash is too small or cannot be read.
+bool spool_init(spool_t *sp, const spool_flash_t *flash, uint32_t boot_id);
+
+// crc32 (zlib's) over len bytes, continuing from crc (0 to start)
+uint32_t spool_crc32(uint32_t crc, const void *data, size_t len);
+
+// --- Appending ---
+
+// A record in pieces: begin, write the packet, end. end(false) abandons it
+// (the rest of its sector is given up). False if the flash failed or the
+// packet went over SPOOL_RECORD_MAX; the record is abandoned then.
+bool spool_begin(spool_t *sp);
+bool spool_write(spool_t *sp, const void *data, size_t len);
+bool spool_end(spool_t *sp, bool complete);
+
+// One whole packet as a record
+bool spool_append(spool_t *sp, const void *packet, size_t len);
+
+// byte_sink flush callback (ctx: the spool_t) for streaming a packet
+// between spool_begin() and spool_end()
+bool spool_sink_write(void *ctx, const uint8_t *data, size_t len);
+
+// --- Uploading ---
+
+// True if records are waiting for upload
+bool spool_pending(spool_t *sp);
+
+// Bytes between the upload position and the write head, headers included
+uint64_t spool_pending_bytes(const spool_t *sp);
+
+// The next records oldest first, up to max_bytes of them (at least one).
+// False if nothing is waiting.
+bool spool_batch_plan(spool_t *sp, uint32_t max_bytes, spool_batch_t *batch);
+
+// Stream the batch's records into sink, each as wire_spool_record_t | packet
+bool spool_batch_read(spool_t *sp, const spool_batch_t *batch, byte_sink_t *sink);
+
+// The server has the batch: move past it and mark finished sectors
+void spool_batch_done(spool_t *sp, const spool_batch_t *batch);
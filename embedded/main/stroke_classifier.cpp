@@ -0,0 +1,113 @@
+/*
+ * On-device stroke classification. See stroke_classifier.h.
+ */
+
+#include "stroke_classifier.h"
+
+#include <math.h>
+#include <string.h>
+#include "stroke_model.h"
+
+static const char *const label_names[STROKE_NUM_LABELS] = {
+    "unknown", "forehand", "backhand", "serve",
+};
+
+// --- Features ---
+
+// Value of x[first..last] with the largest magnitude, sign kept
+static float signed_extreme(const float *x, int first, int last)
+{
+    float best = 0.0f;
+    for (int i = first; i <= last; i++) {
+        if (fabsf(x[i]) > fabsf(best)) best = x[i];
+    }
+    return best;
+}
+
+static float mean(const float *x, int first, int last)
+{
+    float sum = 0.0f;
+    for (int i = first; i <= last; i++) sum += x[i];
+    return sum / (float)(last - first + 1);
+}
+
+// Integral of x over samples first..last by the rectangle rule, in unit * s
+static float integral(const float *x, const int64_t *t_us, int first, int last)
+{
+    float sum = 0.0f;
+    for (int i = first + 1; i <= last; i++) {
+        sum += x[i] * (float)(t_us[i] - t_us[i - 1]);
+    }
+    return sum * 1e-6f;
+}
+
+bool stroke_features(const sample_block_t *samples, const swing_phase_t *phase,
+                     float *out)
+{
+    if (!phase->valid) return false;
+
+    const int start = phase->accel_start_idx;
+    const int peak = phase->peak_idx;
+    const int end = phase->decel_end_idx;
+    float *f = out;
+    for (int a = SAMPLE_GYRO_X; a <= SAMPLE_GYRO_Z; a++) {
+        f[a] = signed_extreme(samples->axis[a], 0, start);
+        f[3 + a] = signed_extreme(samples->axis[a], start, peak);
+        f[6 + a] = signed_extreme(samples->axis[a], peak, end);
+        f[9 + a] = integral(samples->axis[a], samples->timestamp_us, start, end);
+    }
+    for (int a = 0; a < 3; a++) {
+        f[12 + a] = mean(samples->axis[SAMPLE_ACCEL_X + a], 0, start);
+    }
+    f[15] = phase->peak_accel;
+    f[16] = (float)(phase->peak_us - phase->accel_start_us) * 1e-3f;
+    f[17] = (float)(phase->decel_end_us - phase->peak_us) * 1e-3f;
+    return true;
+}
+
+// --- Model ---
+
+static int8_t quantize(float v, float scale)
+{
+    float q = roundf(v * scale);
+    if (q > 127.0f) q = 127.0f;
+    if (q < -127.0f) q = -127.0f;
+    return (int8_t)q;
+}
+
+void stroke_classify(const sample_block_t *samples, const swing_phase_t *phase,
+                     stroke_result_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->label = STROKE_UNKNOWN;
+
+    float feat[STROKE_NUM_FEATURES];
+    if (!stroke_features(samples, phase, feat)) return;
+    for (int j = 0; j < STROKE_NUM_FEATURES; j++) {
+        out->features[j] = quantize(feat[j], stroke_feature_scale[j]);
+    }
+
+    float logit[STROKE_NUM_CLASSES];
+    int best = 0;
+    for (int c = 0; c < STROKE_NUM_CLASSES; c++) {
+        int32_t acc = stroke_bias[c];
+        for (int j = 0; j < STROKE_NUM_FEATURES; j++) {
+            acc += (int32_t)stroke_weights[c][j] * out->features[j];
+        }
+        logit[c] = (float)acc * STROKE_LOGIT_SCALE;
+        if (logit[c] > logit[best]) best = c;
+    }
+
+    // Softmax probability of the winner, shifted by its logit for range
+    float sum = 0.0f;
+    for (int c = 0; c < STROKE_NUM_CLASSES; c++) sum += expf(logit[c] - logit[best]);
+    out->confidence = 1.0f / sum;
+    if (out->confidence >= STROKE_MIN_CONFIDENCE) {
+        out->label = (stroke_label_t)(STROKE_FOREHAND + best);
+    }
+}
+
+const char *stroke_label_name(stroke_label_t label)
+{
+    return label < STROKE_NUM_LABELS ? label_names[label] : "unknown";
+}
@@ -0,0 +1,62 @@
+/*
+ * On-device stroke classification (forehand / backhand / serve).
+ *
+ * Runs right after swing_phase_analyze on the same event slot: a fixed
+ * feature vector is read off the per-channel samples using the phase
+ * boundaries, quantized to int8 with per-feature scales, and fed through
+ * a one-layer int8 classifier (stroke_model.h). Features are:
+ *
+ *   - signed extreme gyro per axis in the preparation, acceleration and
+ *     deceleration phases (9)
+ *   - rotation swept per axis from acceleration start to deceleration end,
+ *     the gyro integral in rad (3)
+ *   - mean accel per axis over the preparation phase, i.e. where gravity
+ *     points in the racquet frame before the swing (3)
+ *   - peak |accel|, acceleration and deceleration phase durations (3)
+ *
+ * The event slots carry gyro and accel only, so orientation comes from the
+ * gyro integral and the preparation-phase gravity vector rather than the
+ * rv_game euler angles. train_stroke_model.py computes the same features
+ * from a recorded session and writes stroke_model.h.
+ *
+ * Nothing is allocated; one call is a few hundred multiply-adds over the
+ * event, cheap enough to run inline in sensor_task next to the analysis.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sensor_sample.h"
+#include "swing_phase.h"
+
+#define STROKE_NUM_FEATURES         18
+#define STROKE_MIN_CONFIDENCE       0.5f    // below this the label is STROKE_UNKNOWN
+
+typedef enum : uint8_t {
+    STROKE_UNKNOWN  = 0,    // no valid swing, or no class confident enough
+    STROKE_FOREHAND = 1,
+    STROKE_BACKHAND = 2,
+    STROKE_SERVE    = 3,
+    STROKE_NUM_LABELS
+} stroke_label_t;
+
+#define STROKE_NUM_CLASSES          (STROKE_NUM_LABELS - 1)    // model outputs, UNKNOWN excluded
+
+typedef struct {
+    stroke_label_t label;
+    float confidence;       // softmax probability of the winning class, 0..1
+    int8_t features[STROKE_NUM_FEATURES];   // quantized model input, for logging
+} stroke_result_t;
+
+// Feature vector of one analyzed event, in model units before quantization.
+// Returns false (and leaves `out` untouched) when phase->valid is false.
+bool stroke_features(const sample_block_t *samples, const swing_phase_t *phase,
+                     float *out);
+
+// Classify one analyzed event. `out` is always filled; an invalid phase
+// gives STROKE_UNKNOWN with confidence 0.
+void stroke_classify(const sample_block_t *samples, const swing_phase_t *phase,
+                     stroke_result_t *out);
+
+// "forehand", "backhand", "serve" or "unknown".
+const char *stroke_label_name(stroke_label_t label);
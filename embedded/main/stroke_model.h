@@ -0,0 +1,45 @@
+/*
+ * int8 weights of the stroke classifier (stroke_classifier.h).
+ *
+ * Regenerate from labelled sessions with
+ *   python train_stroke_model.py swing_data/<session> labels.csv
+ * which overwrites this file. The weights below are a hand-set prior, not
+ * a trained model, so main.cpp ships with STROKE_CLASSIFIER off until they
+ * are replaced. The prior: a right-handed player with the sensor mounted x
+ * along the handle towards the tip, y across the string face and z along
+ * the face normal. Forehands and backhands turn the racquet about +y and -y;
+ * a serve starts with the tip up (+x gravity), pronates about x and hits
+ * hardest.
+ *
+ * Feature q[j] = clamp(roundf(feature[j] * stroke_feature_scale[j]), -127, 127)
+ * Logit of class c = (stroke_bias[c] + sum_j stroke_weights[c][j] * q[j])
+ *                    * STROKE_LOGIT_SCALE
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "stroke_classifier.h"
+
+#define STROKE_MODEL_VERSION        0       // 0: hand-set prior
+#define STROKE_LOGIT_SCALE          (1.0f / 2048.0f)
+
+// Per feature: int8 steps per unit (rad/s, rad, m/s^2, ms)
+static const float stroke_feature_scale[STROKE_NUM_FEATURES] = {
+    127.0f / 40.0f, 127.0f / 40.0f, 127.0f / 40.0f,     // preparation gyro xyz
+    127.0f / 40.0f, 127.0f / 40.0f, 127.0f / 40.0f,     // acceleration gyro xyz
+    127.0f / 40.0f, 127.0f / 40.0f, 127.0f / 40.0f,     // deceleration gyro xyz
+    127.0f / 6.0f, 127.0f / 6.0f, 127.0f / 6.0f,        // rotation xyz
+    127.0f / 12.0f, 127.0f / 12.0f, 127.0f / 12.0f,     // preparation gravity xyz
+    127.0f / 160.0f,                                    // peak |accel|
+    127.0f / 500.0f, 127.0f / 500.0f,                   // acceleration, deceleration ms
+};
+
+// Rows: forehand, backhand, serve
+static const int8_t stroke_weights[STROKE_NUM_CLASSES][STROKE_NUM_FEATURES] = {
+    {   0,  10,   0,    0,  60,   0,    0,  30,   0,    0,  50,   0,  -30,   0,   0,    0,   0,   0 },
+    {   0, -10,   0,    0, -60,   0,    0, -30,   0,    0, -50,   0,  -30,   0,   0,    0,   0,   0 },
+    {   0,   0,   0,   10,   0,   0,   40,   0,   0,   20,   0,   0,   70,   0,   0,   30,   0,   0 },
+};
+
+static const int32_t stroke_bias[STROKE_NUM_CLASSES] = { 0, 0, -2048 };
@@ -0,0 +1,202 @@
+/*
+ * On-device swing phase segmentation. See swing_phase.h.
+ */
+
+#include "swing_phase.h"
+
+#include <math.h>
+#include <string.h>
+
+// --- Filter ---
+
+// One pass over x[0..n) in place, starting from the steady state for x[0]
+// (the same initial conditions as scipy's sosfilt_zi)
+static void biquad_pass(const float *coef, float *x, int n)
+{
+    float state[2];
+    dsp_biquad_steady_state(coef, x[0], state);
+    dsp_biquad(x, x, n, coef, state);
+}
+
+// Zero-phase low-pass of sig[0..n) in place (scipy sosfiltfilt, padtype odd)
+static void smooth(swing_analyzer_t *an, float *sig, int n)
+{
+    if (n < SWING_MIN_FILTER_LEN) return;
+
+    const int pad = SWING_FILTER_PAD;
+    const int m = n + 2 * pad;
+    float *ext = an->padded;
+    for (int i = 0; i < pad; i++) {
+        ext[i] = 2.0f * sig[0] - sig[pad - i];
+        ext[pad + n + i] = 2.0f * sig[n - 1] - sig[n - 2 - i];
+    }
+    memcpy(ext + pad, sig, sizeof(float) * (size_t)n);
+
+    biquad_pass(an->lp, ext, m);
+    dsp_reverse(ext, m);
+    biquad_pass(an->lp, ext, m);
+    dsp_reverse(ext, m);
+
+    memcpy(sig, ext + pad, sizeof(float) * (size_t)n);
+}
+
+// --- Peak search (scipy.signal.find_peaks) ---
+
+// Local maxima; a flat top counts once, at its middle
+static int local_maxima(const float *x, int n, int *peaks)
+{
+    int num = 0;
+    int i = 1;
+    while (i < n - 1) {
+        if (x[i - 1] < x[i]) {
+            int ahead = i + 1;
+            while (ahead < n - 1 && x[ahead] == x[i]) ahead++;
+            if (x[ahead] < x[i]) {
+                peaks[num++] = (i + ahead - 1) / 2;
+                i = ahead;
+            }
+        }
+        i++;
+    }
+    return num;
+}
+
+static float prominence(const float *x, int n, int peak)
+{
+    float left_min = x[peak];
+    for (int i = peak; i >= 0 && x[i] <= x[peak]; i--) {
+        if (x[i] < left_min) left_min = x[i];
+    }
+    float right_min = x[peak];
+    for (int i = peak; i < n && x[i] <= x[peak]; i++) {
+        if (x[i] < right_min) right_min = x[i];
+    }
+    return x[peak] - (left_min > right_min ? left_min : right_min);
+}
+
+// Index of the tallest peak passing the height, distance and prominence
+// filters (applied in find_peaks' order), or -1
+static int tallest_peak(swing_analyzer_t *an, const float *x, int n)
+{
+    int *peaks = an->peaks;
+    uint8_t *keep = an->keep;
+
+    int num = 0;
+    int found = local_maxima(x, n, peaks);
+    for (int i = 0; i < found; i++) {
+        if (x[peaks[i]] >= SWING_MIN_PEAK_GYRO) peaks[num++] = peaks[i];
+    }
+
+    // Distance: visit peaks tallest first, dropping lower neighbours that
+    // are too close. Peaks are few, so a quadratic scan beats sorting.
+    memset(keep, 1, (size_t)num);
+    uint8_t *visited = keep + num;
+    memset(visited, 0, (size_t)num);
+    for (int round = 0; round < num; round++) {
+        int j = -1;
+        for (int k = 0; k < num; k++) {
+            if (!visited[k] && (j < 0 || x[peaks[k]] > x[peaks[j]])) j = k;
+        }
+        visited[j] = 1;
+        if (!keep[j]) continue;
+        for (int k = j - 1; k >= 0 && peaks[j] - peaks[k] < an->peak_distance; k--) keep[k] = 0;
+        for (int k = j + 1; k < num && peaks[k] - peaks[j] < an->peak_distance; k++) keep[k] = 0;
+    }
+
+    int best = -1;
+    for (int k = 0; k < num; k++) {
+        if (!keep[k] || prominence(x, n, peaks[k]) < SWING_PEAK_PROMINENCE) continue;
+        if (best < 0 || x[peaks[k]] > x[best]) best = peaks[k];
+    }
+    return best;
+}
+
+// --- Analyzer ---
+
+size_t swing_analyzer_mem_size(int capacity)
+{
+    return sizeof(float) * (size_t)(3 * capacity + 2 * SWING_FILTER_PAD)
+         + sizeof(int) * (size_t)(capacity / 2 + 1)
+         + 2 * (size_t)(capacity / 2 + 1)
+         + 4 * sizeof(float);   // alignment
+}
+
+bool swing_analyzer_init(swing_analyzer_t *an, arena_t *arena, int capacity, float rate_hz)
+{
+    int max_peaks = capacity / 2 + 1;
+    an->capacity = capacity;
+    swing_analyzer_set_rate(an, rate_hz);
+    an->gyro_mag = arena_alloc_array<float>(arena, capacity);
+    an->accel_mag = arena_alloc_array<float>(arena, capacity);
+    an->padded = arena_alloc_array<float>(arena, capacity + 2 * SWING_FILTER_PAD);
+    an->peaks = arena_alloc_array<int>(arena, max_peaks);
+    an->keep = arena_alloc_array<uint8_t>(arena, 2 * max_peaks);   // keep + visited
+    return an->gyro_mag != NULL && an->accel_mag != NULL && an->padded != NULL &&
+           an->peaks != NULL && an->keep != NULL;
+}
+
+void swing_analyzer_set_rate(swing_analyzer_t *an, float rate_hz)
+{
+    an->peak_distance = (int)(rate_hz * SWING_PEAK_DISTANCE_S);
+    dsp_biquad_design_lowpass(an->lp, SWING_CUTOFF_HZ, rate_hz);
+}
+
+void swing_phase_analyze(swing_analyzer_t *an, const sample_block_t *samples, int count,
+                         swing_phase_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (count > an->capacity) count = an->capacity;
+    out->num_samples = count;
+    if (count < SWING_MIN_SAMPLES) return;
+
+    float *g = an->gyro_mag;
+    float *a = an->accel_mag;
+    vec3_block_t gyro = { samples->axis[SAMPLE_GYRO_X], samples->axis[SAMPLE_GYRO_Y],
+                          samples->axis[SAMPLE_GYRO_Z] };
+    vec3_block_t accel = { samples->axis[SAMPLE_ACCEL_X], samples->axis[SAMPLE_ACCEL_Y],
+                           samples->axis[SAMPLE_ACCEL_Z] };
+    dsp_magnitude3(&gyro, g, an->padded, count);
+    dsp_magnitude3(&accel, a, an->padded, count);
+    smooth(an, g, count);
+    smooth(an, a, count);
+
+    for (int i = 0; i < count; i++) {
+        if (g[i] > out->peak_gyro) out->peak_gyro = g[i];
+        if (a[i] > out->peak_accel) out->peak_accel = a[i];
+    }
+    const int64_t *t = samples->timestamp_us;
+    out->t_first_us = t[0];
+    out->t_last_us = t[count - 1];
+
+    int best = tallest_peak(an, g, count);
+    if (best < 0) return;
+
+    // Acceleration start: walk left until gyro drops below a fraction of the peak
+    float accel_thresh = g[best] * SWING_ACCEL_START_FRAC;
+    int accel_start = 0;
+    for (int i = best - 1; i >= 0; i--) {
+        if (g[i] < accel_thresh) {
+            accel_start = i;
+            break;
+        }
+    }
+
+    // Deceleration end: walk right until accel magnitude settles
+    int decel_end = count - 1;
+    for (int i = best + 1; i < count; i++) {
+        if (a[i] < SWING_DECEL_ACCEL_THRESH) {
+            decel_end = i;
+            break;
+        }
+    }
+
+    out->valid = true;
+    out->accel_start_idx = accel_start;
+    out->peak_idx = best;
+    out->decel_end_idx = decel_end;
+    out->accel_start_us = t[accel_start];
+    out->peak_us = t[best];
+    out->decel_end_us = t[decel_end];
+    out->gyro_at_peak = g[best];
+    out->accel_at_peak = a[best];
+}
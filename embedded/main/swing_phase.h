@@ -0,0 +1,76 @@
+/*
+ * On-device swing phase segmentation, a port of swing_analyzer.analyze_swing.
+ *
+ * Gyro and accel magnitudes are smoothed with the same zero-phase 2nd-order
+ * Butterworth low-pass as scipy's sosfiltfilt (odd extension of
+ * SWING_FILTER_PAD samples at each end, steady-state initial conditions),
+ * the tallest gyro peak is picked with find_peaks' height / distance /
+ * prominence rules, and the phase boundaries come from the same threshold
+ * walks. Thresholds below must stay in step with swing_analyzer.py.
+ *
+ * The magnitude and filter loops run on dsp_kernels.h straight over the
+ * event slot's per-channel arrays.
+ * Scratch memory is carved from the boot arena once; swing_phase_analyze
+ * allocates nothing and is cheap enough to run inline in sensor_task.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "dsp_kernels.h"
+#include "sensor_sample.h"
+
+#define SWING_CUTOFF_HZ             30.0f       // low-pass cutoff
+#define SWING_MIN_PEAK_GYRO         1.0f        // rad/s, ignore swings below this
+#define SWING_PEAK_PROMINENCE       (SWING_MIN_PEAK_GYRO * 0.3f)
+#define SWING_PEAK_DISTANCE_S       0.05f       // peaks at least 50 ms apart
+#define SWING_ACCEL_START_FRAC      0.10f       // accel start: gyro below 10% of peak
+#define SWING_DECEL_ACCEL_THRESH    30.0f       // decel end: accel mag below this, m/s^2
+#define SWING_MIN_SAMPLES           10          // fewer than this is not analyzed
+#define SWING_MIN_FILTER_LEN        15          // shorter signals are left unsmoothed
+#define SWING_FILTER_PAD            9           // sosfiltfilt padlen for one section
+
+typedef struct {
+    int capacity;           // longest event that can be analyzed
+    int peak_distance;      // samples
+    float lp[DSP_BIQUAD_COEFS];     // low-pass section
+    float *gyro_mag;        // capacity
+    float *accel_mag;       // capacity
+    float *padded;          // capacity + 2 * SWING_FILTER_PAD, also magnitude scratch
+    int *peaks;             // capacity / 2 + 1 candidate peaks
+    uint8_t *keep;
+} swing_analyzer_t;
+
+typedef struct {
+    bool valid;             // false: too few samples or no peak above threshold
+    int num_samples;
+    int accel_start_idx;
+    int peak_idx;
+    int decel_end_idx;
+    int64_t t_first_us;
+    int64_t accel_start_us;
+    int64_t peak_us;
+    int64_t decel_end_us;
+    int64_t t_last_us;
+    float peak_gyro;        // max smoothed |gyro| over the event, rad/s
+    float peak_accel;       // max smoothed |accel| over the event, m/s^2
+    float gyro_at_peak;     // smoothed |gyro| at peak_idx
+    float accel_at_peak;    // smoothed |accel| at peak_idx
+    uint8_t stroke;         // stroke_label_t from stroke_classifier.h, 0 (unknown) until classified
+    float stroke_confidence;    // 0..1
+} swing_phase_t;
+
+// Arena bytes swing_analyzer_init needs for `capacity` samples.
+size_t swing_analyzer_mem_size(int capacity);
+
+// Design the filter for `rate_hz` and carve scratch space from `arena`.
+bool swing_analyzer_init(swing_analyzer_t *an, arena_t *arena, int capacity, float rate_hz);
+
+// Redesign the filter and peak spacing after the sensor rate changed.
+void swing_analyzer_set_rate(swing_analyzer_t *an, float rate_hz);
+
+// Segment one captured event. `out` is always filled; check out->valid.
+void swing_phase_analyze(swing_analyzer_t *an, const sample_block_t *samples, int count,
+                         swing_phase_t *out);
@@ -0,0 +1,103 @@
+/*
+ * Link to the server, behind one interface so the network tasks do not
+ * care how packets leave the racquet.
+ *
+ * Two channels, matching what the server listens on:
+ *
+ *   datagrams   live batches, stats, profile and sync packets out, and
+ *               control packets (NACKs) back; best effort, like UDP
+ *   events      one event body at a time, streamed through a byte_sink and
+ *               acknowledged by the server, like an HTTP POST
+ *
+ * udp_live_task is the only user of the datagram calls and http_event_task
+ * the only user of the event calls, so an implementation may assume one
+ * caller per channel.
+ *
+ * Backends:
+ *   transport_wifi     infrastructure Wi-Fi, UDP + HTTP to SERVER_IP
+ *   transport_espnow   ESP-NOW frames to a USB gateway next to the server
+ *                      (espnow_link.h), no AP, DHCP or SNTP in the way
+ *
+ * The backend is picked at boot from NVS and can be switched while running
+ * (set_transport() in main.cpp): the old one is stopped, the new one
+ * started, and both tasks pick it up on their next cycle.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum : uint8_t {
+    TRANSPORT_WIFI = 0,
+    TRANSPORT_ESPNOW = 1,
+    TRANSPORT_NUM
+} transport_kind_t;
+
+#define TRANSPORT_RSSI_NONE     127     // no signal reading (same as LIVE_RATE_RSSI_NONE)
+
+typedef struct {
+    const char *name;
+
+    // Bring the link up, or take it down. Both are idempotent and return
+    // quickly; the link may become ready() some time after start().
+    bool (*start)(void);
+    void (*stop)(void);
+
+    // True while packets can go out
+    bool (*ready)(void);
+
+    // One datagram, whole. Returns false if it could not be sent.
+    bool (*send_datagram)(const uint8_t *buf, size_t len);
+
+    // Next control packet from the server into buf, without blocking.
+    // Returns its length, or 0 if none is waiting.
+    int (*recv_control)(uint8_t *buf, size_t cap);
+
+    // Stream one event body: open with its length (-1 if not known up
+    // front), write it in pieces, then close. close(true) finishes the body
+    // and waits for the server's answer; it returns true only if the event
+    // was accepted. close(false) abandons the body.
+    bool (*event_open)(int content_len);
+    bool (*event_write)(const uint8_t *data, size_t len);
+    bool (*event_close)(bool complete);
+
+    // Signal strength of the link in dBm, or TRANSPORT_RSSI_NONE
+    int (*rssi)(void);
+
+    // Radio power save while the racquet is idle (activity.h)
+    void (*set_power_save)(bool idle);
+} transport_t;
+
+// --- Backends ---
+
+typedef struct {
+    const char *ssid;
+    const char *password;
+    const char *server_ip;
+    uint16_t http_port;
+    uint16_t udp_port;
+    const char *content_type;       // of event bodies
+    int http_timeout_ms;
+    int http_reinit_after_fails;    // rebuild the HTTP client after this many in a row
+    uint16_t listen_interval;       // beacons slept through in max modem sleep
+    bool cache_link;                // remember AP and IP in NVS for a fast reconnect
+} transport_wifi_config_t;
+
+// Set up the Wi-Fi driver (station mode, not connected yet). Both backends
+// need it, so it runs at boot whichever one is picked.
+bool transport_wifi_init(const transport_wifi_config_t *cfg);
+const transport_t *transport_wifi(void);
+
+// Point the Wi-Fi link at another server (dotted-quad IP). Datagrams follow
+// at once, events from the next event_open(). False if the address is bad.
+bool transport_wifi_set_server(const char *ip, uint16_t http_port, uint16_t udp_port);
+
+typedef struct {
+    uint8_t channel;                // Wi-Fi channel the gateway listens on
+    int ack_timeout_ms;             // wait for the gateway's answer to an event
+} transport_espnow_config_t;
+
+// Call after transport_wifi_init().
+bool transport_espnow_init(const transport_espnow_config_t *cfg);
+const transport_t *transport_espnow(void);
@@ -0,0 +1,319 @@
+/*
+ * ESP-NOW transport: frames to a USB gateway next to the server, no AP in
+ * between. See transport.h and espnow_link.h.
+ *
+ * The racquet listens on the gateway's channel until a HELLO tells it the
+ * gateway's MAC, then unicasts to it; ESP-NOW acknowledges every unicast
+ * frame at the MAC layer, so a send only counts once the gateway has it.
+ * Both network tasks send, so sends go one at a time under send_lock.
+ */
+
+#include "transport.h"
+#include "espnow_link.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "esp_timer.h"
+
+#define ESPNOW_GATEWAY_TIMEOUT_US   3000000     // not ready after 3 missed HELLOs
+#define ESPNOW_SEND_TIMEOUT_MS      50          // MAC-layer ack of one frame
+#define ESPNOW_TIME_STEP_US         2000        // only step the clock when this far off
+#define ESPNOW_CONTROL_QUEUE_LEN    4
+#define ESPNOW_ACK_QUEUE_LEN        4
+
+typedef struct {
+    uint16_t len;
+    uint8_t data[ESPNOW_LINK_PAYLOAD];
+} espnow_control_t;
+
+typedef struct {
+    uint16_t msg_id;
+    uint16_t status;
+} espnow_ack_t;
+
+static transport_espnow_config_t cfg;
+static bool espnow_up = false;
+
+// Gateway address, learned from HELLO in the receive callback
+static portMUX_TYPE gateway_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t gateway_mac[ESP_NOW_ETH_ALEN];
+static std::atomic<int64_t> gateway_seen_us(0);
+static std::atomic<int> gateway_rssi(TRANSPORT_RSSI_NONE);
+
+static SemaphoreHandle_t send_lock = NULL;
+static SemaphoreHandle_t send_done = NULL;
+static volatile bool send_ok = false;
+static uint8_t send_frame_buf[ESPNOW_LINK_MTU];
+
+static QueueHandle_t control_queue = NULL;
+static QueueHandle_t ack_queue = NULL;
+
+static uint16_t datagram_id = 0;
+
+// Event being streamed, http_event_task only
+static uint8_t event_payload[ESPNOW_LINK_PAYLOAD];
+static size_t event_fill = 0;
+static uint16_t event_id = 0;
+static uint16_t event_frag = 0;
+static bool event_ok = false;
+
+static bool gateway_known(void)
+{
+    int64_t seen = gateway_seen_us.load(std::memory_order_acquire);
+    return seen != 0 && esp_timer_get_time() - seen < ESPNOW_GATEWAY_TIMEOUT_US;
+}
+
+// --- Radio callbacks (Wi-Fi task) ---
+
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (len < (int)sizeof(espnow_frame_hdr_t)) return;
+    espnow_frame_hdr_t hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.magic != ESPNOW_LINK_MAGIC) return;
+    const uint8_t *payload = data + sizeof(hdr);
+    int payload_len = len - (int)sizeof(hdr);
+
+    if (hdr.kind == ESPNOW_HELLO) {
+        taskENTER_CRITICAL(&gateway_lock);
+        memcpy(gateway_mac, info->src_addr, ESP_NOW_ETH_ALEN);
+        taskEXIT_CRITICAL(&gateway_lock);
+        gateway_seen_us.store(esp_timer_get_time(), std::memory_order_release);
+        if (info->rx_ctrl != NULL) gateway_rssi.store(info->rx_ctrl->rssi, std::memory_order_relaxed);
+    } else if (hdr.kind == ESPNOW_TIME && payload_len >= (int)sizeof(espnow_time_t)) {
+        // The laptop's clock stands in for SNTP; small differences are the
+        // air and serial latency, not worth a step in the wall clock offset
+        espnow_time_t t;
+        memcpy(&t, payload, sizeof(t));
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        int64_t now_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+        int64_t off = t.wall_us - now_us;
+        if (off > ESPNOW_TIME_STEP_US || off < -ESPNOW_TIME_STEP_US) {
+            struct timeval tv = { (time_t)(t.wall_us / 1000000), (suseconds_t)(t.wall_us % 1000000) };
+            settimeofday(&tv, NULL);
+        }
+    } else if (hdr.kind == ESPNOW_CONTROL && payload_len <= (int)ESPNOW_LINK_PAYLOAD) {
+        // From the gateway we send to only, as the Wi-Fi transport takes
+        // control datagrams from its server only
+        taskENTER_CRITICAL(&gateway_lock);
+        bool from_gateway = memcmp(info->src_addr, gateway_mac, ESP_NOW_ETH_ALEN) == 0;
+        taskEXIT_CRITICAL(&gateway_lock);
+        if (!from_gateway || !gateway_known()) return;
+        espnow_control_t item;
+        item.len = (uint16_t)payload_len;
+        memcpy(item.data, payload, payload_len);
+        xQueueSend(control_queue, &item, 0);     // full: drop, the server NACKs again
+    } else if (hdr.kind == ESPNOW_EVENT_ACK && payload_len >= (int)sizeof(espnow_event_ack_t)) {
+        espnow_event_ack_t ack;
+        memcpy(&ack, payload, sizeof(ack));
+        espnow_ack_t item = { hdr.msg_id, ack.status };
+        xQueueSend(ack_queue, &item, 0);
+    }
+}
+
+static void espnow_send_cb(const uint8_t *mac, esp_now_send_status_t status)
+{
+    send_ok = status == ESP_NOW_SEND_SUCCESS;
+    xSemaphoreGive(send_done);
+}
+
+// --- Frames ---
+
+// One frame to the gateway; true once its MAC-layer ack is in
+static bool send_frame(uint8_t kind, uint8_t flags, uint16_t msg_id, uint16_t frag,
+                       const uint8_t *payload, size_t len)
+{
+    if (!gateway_known()) return false;
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    taskENTER_CRITICAL(&gateway_lock);
+    memcpy(mac, gateway_mac, ESP_NOW_ETH_ALEN);
+    taskEXIT_CRITICAL(&gateway_lock);
+
+    xSemaphoreTake(send_lock, portMAX_DELAY);
+    if (!espnow_up) {               // stopped while we waited
+        xSemaphoreGive(send_lock);
+        return false;
+    }
+    if (!esp_now_is_peer_exist(mac)) {
+        esp_now_peer_info_t peer = {};
+        memcpy(peer.peer_addr, mac, ESP_NOW_ETH_ALEN);
+        peer.channel = cfg.channel;
+        peer.ifidx = WIFI_IF_STA;
+        esp_now_add_peer(&peer);
+    }
+    espnow_frame_hdr_t hdr = { ESPNOW_LINK_MAGIC, kind, flags, msg_id, frag };
+    memcpy(send_frame_buf, &hdr, sizeof(hdr));
+    memcpy(send_frame_buf + sizeof(hdr), payload, len);
+    xSemaphoreTake(send_done, 0);   // stale completion from a timed-out send
+    bool ok = esp_now_send(mac, send_frame_buf, sizeof(hdr) + len) == ESP_OK &&
+              xSemaphoreTake(send_done, pdMS_TO_TICKS(ESPNOW_SEND_TIMEOUT_MS)) == pdTRUE &&
+              send_ok;
+    xSemaphoreGive(send_lock);
+    return ok;
+}
+
+// --- transport_t ---
+
+static bool espnow_start(void)
+{
+    if (espnow_up) return true;
+    esp_wifi_set_channel(cfg.channel, WIFI_SECOND_CHAN_NONE);
+    if (esp_now_init() != ESP_OK) {
+        printf("ESP-NOW: init failed\n");
+        return false;
+    }
+    esp_now_register_recv_cb(espnow_recv_cb);
+    esp_now_register_send_cb(espnow_send_cb);
+    espnow_up = true;
+    printf("ESP-NOW: listening for the gateway on channel %u...\n", (unsigned)cfg.channel);
+    return true;
+}
+
+static void espnow_stop(void)
+{
+    if (!espnow_up) return;
+    xSemaphoreTake(send_lock, portMAX_DELAY);
+    espnow_up = false;
+    esp_now_deinit();
+    xSemaphoreGive(send_lock);
+    gateway_seen_us.store(0, std::memory_order_release);
+    xQueueReset(control_queue);
+    xQueueReset(ack_queue);
+}
+
+static bool espnow_ready(void)
+{
+    return espnow_up && gateway_known();
+}
+
+static bool espnow_send_datagram(const uint8_t *buf, size_t len)
+{
+    uint16_t id = datagram_id++;
+    uint16_t frag = 0;
+    do {
+        size_t n = len < ESPNOW_LINK_PAYLOAD ? len : ESPNOW_LINK_PAYLOAD;
+        uint8_t flags = n == len ? ESPNOW_FLAG_LAST : 0;
+        if (!send_frame(ESPNOW_DATAGRAM, flags, id, frag++, buf, n)) return false;
+        buf += n;
+        len -= n;
+    } while (len > 0);
+    return true;
+}
+
+static int espnow_recv_control(uint8_t *buf, size_t cap)
+{
+    espnow_control_t item;
+    if (xQueueReceive(control_queue, &item, 0) != pdTRUE) return 0;
+    size_t n = item.len < cap ? item.len : cap;
+    memcpy(buf, item.data, n);
+    return (int)n;
+}
+
+// The length is not needed: the last fragment is flagged instead
+static bool espnow_event_open(int content_len)
+{
+    if (!espnow_ready()) return false;
+    event_id++;
+    event_frag = 0;
+    event_fill = 0;
+    event_ok = true;
+    return true;
+}
+
+// Full fragments go out as the body arrives; the tail waits in
+// event_payload so close() can flag it as the last one
+static bool espnow_event_write(const uint8_t *data, size_t len)
+{
+    while (event_ok && len > 0) {
+        if (event_fill == ESPNOW_LINK_PAYLOAD) {
+            event_ok = send_frame(ESPNOW_EVENT, 0, event_id, event_frag++,
+                                  event_payload, event_fill);
+            event_fill = 0;
+        }
+        size_t n = ESPNOW_LINK_PAYLOAD - event_fill;
+        if (n > len) n = len;
+        memcpy(event_payload + event_fill, data, n);
+        event_fill += n;
+        data += n;
+        len -= n;
+    }
+    return event_ok;
+}
+
+static bool espnow_event_close(bool complete)
+{
+    if (!complete || !event_ok) {
+        printf("ESP-NOW: event %u not sent\n", (unsigned)event_id);
+        return false;
+    }
+    if (!send_frame(ESPNOW_EVENT, ESPNOW_FLAG_LAST, event_id, event_frag++,
+                    event_payload, event_fill)) {
+        printf("ESP-NOW: event %u not sent\n", (unsigned)event_id);
+        return false;
+    }
+    // Wait for the server's answer relayed by the bridge; acks for earlier,
+    // timed-out events are skipped
+    int64_t deadline = esp_timer_get_time() + (int64_t)cfg.ack_timeout_ms * 1000;
+    espnow_ack_t ack;
+    while (true) {
+        int64_t left_ms = (deadline - esp_timer_get_time()) / 1000;
+        if (left_ms <= 0 || xQueueReceive(ack_queue, &ack, pdMS_TO_TICKS(left_ms)) != pdTRUE) {
+            printf("ESP-NOW: no answer for event %u\n", (unsigned)event_id);
+            return false;
+        }
+        if (ack.msg_id == event_id) break;
+    }
+    if (ack.status != 200) {
+        printf("ESP-NOW: event %u status %u\n", (unsigned)event_id, (unsigned)ack.status);
+        return false;
+    }
+    return true;
+}
+
+static int espnow_rssi(void)
+{
+    return espnow_ready() ? gateway_rssi.load(std::memory_order_relaxed) : TRANSPORT_RSSI_NONE;
+}
+
+// The radio has to stay on to hear HELLO, TIME and acks; with no AP there
+// is no modem sleep to switch to
+static void espnow_set_power_save(bool idle)
+{
+}
+
+static const transport_t espnow_transport = {
+    "espnow",
+    espnow_start,
+    espnow_stop,
+    espnow_ready,
+    espnow_send_datagram,
+    espnow_recv_control,
+    espnow_event_open,
+    espnow_event_write,
+    espnow_event_close,
+    espnow_rssi,
+    espnow_set_power_save,
+};
+
+bool transport_espnow_init(const transport_espnow_config_t *config)
+{
+    cfg = *config;
+    send_lock = xSemaphoreCreateMutex();
+    send_done = xSemaphoreCreateBinary();
+    control_queue = xQueueCreate(ESPNOW_CONTROL_QUEUE_LEN, sizeof(espnow_control_t));
+    ack_queue = xQueueCreate(ESPNOW_ACK_QUEUE_LEN, sizeof(espnow_ack_t));
+    return send_lock != NULL && send_done != NULL && control_queue != NULL && ack_queue != NULL;
+}
+
+const transport_t *transport_espnow(void)
+{
+    return &espnow_transport;
+}
@@ -0,0 +1,455 @@
+/*
+ * Infrastructure Wi-Fi transport: datagrams over UDP, events as HTTP POSTs
+ * on one keep-alive connection. See transport.h.
+ *
+ * Fast reconnect (cache_link): once connected, the AP's BSSID and channel
+ * and the DHCP lease (IP, netmask, gateway, DNS) are kept in NVS. The next
+ * boot joins that AP directly, without a scan, and takes the cached
+ * address as a static IP instead of waiting for DHCP. If the cached AP
+ * does not answer, or POSTs keep failing on the cached address, the cache
+ * is dropped and the link falls back to a scan and DHCP.
+ *
+ * The server endpoint can be moved at runtime (transport_wifi_set_server):
+ * datagrams go to the new address right away, and the HTTP connection is
+ * closed and reopened on it before the next event.
+ */
+
+#include "transport.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_netif_sntp.h"
+#include "esp_http_client.h"
+#include "nvs.h"
+#include "lwip/sockets.h"
+#include "lwip/inet.h"
+
+#define WIFI_CONNECTED_BIT      BIT0
+#define ACTIVE_WIFI_PS          WIFI_PS_MIN_MODEM   // ESP-IDF default
+#define IDLE_WIFI_PS            WIFI_PS_MAX_MODEM
+#define WIFI_CACHE_MAX_FAILS    2           // failed joins on the cached AP before scanning
+
+static transport_wifi_config_t cfg;
+static char server_ip[16];
+static char server_url[64];
+static char pending_url[64];
+static bool url_pending = false;            // under server_lock
+static portMUX_TYPE server_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t wifi_event_group = NULL;
+static esp_netif_t *sta_netif = NULL;
+static wifi_config_t wifi_config = {};
+static volatile bool wifi_wanted = false;   // reconnect on disconnect
+static bool has_ip = false;
+static bool sntp_started = false;
+
+// Last AP and lease, in NVS ("wifi_cache")
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip, netmask, gw, dns;
+} wifi_link_cache_t;
+
+static wifi_link_cache_t link_cache = {};
+static bool link_cached = false;            // this connection uses the cache
+static int cache_fails = 0;
+
+static int udp_sock = -1;
+static struct sockaddr_in udp_dest_addr = {};
+static uint32_t udp_foreign = 0;            // control datagrams from elsewhere, dropped
+
+static esp_http_client_handle_t http_client = NULL;
+static int http_fail_streak = 0;
+static bool http_chunked = false;
+
+// --- Link cache ---
+
+static bool wifi_cache_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open("wifi_cache", NVS_READONLY, &nvs) != ESP_OK) return false;
+    size_t len = sizeof(link_cache);
+    bool ok = nvs_get_blob(nvs, "link", &link_cache, &len) == ESP_OK &&
+              len == sizeof(link_cache) && strcmp(link_cache.ssid, cfg.ssid) == 0 &&
+              link_cache.channel != 0 && link_cache.ip != 0;
+    nvs_close(nvs);
+    return ok;
+}
+
+// Called on every new IP; writes flash only when something changed
+static void wifi_cache_store(const esp_netif_ip_info_t *ip_info)
+{
+    wifi_link_cache_t c = {};
+    wifi_ap_record_t ap = {};
+    esp_netif_dns_info_t dns = {};
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return;
+    esp_netif_get_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    strncpy(c.ssid, cfg.ssid, sizeof(c.ssid) - 1);
+    memcpy(c.bssid, ap.bssid, sizeof(c.bssid));
+    c.channel = ap.primary;
+    c.ip = ip_info->ip.addr;
+    c.netmask = ip_info->netmask.addr;
+    c.gw = ip_info->gw.addr;
+    c.dns = dns.ip.u_addr.ip4.addr;
+    if (memcmp(&c, &link_cache, sizeof(c)) == 0) return;
+
+    nvs_handle_t nvs;
+    if (nvs_open("wifi_cache", NVS_READWRITE, &nvs) != ESP_OK) return;
+    if (nvs_set_blob(nvs, "link", &c, sizeof(c)) == ESP_OK) nvs_commit(nvs);
+    nvs_close(nvs);
+    link_cache = c;
+}
+
+// Join the cached AP on its channel with the cached address
+static void wifi_cache_apply(void)
+{
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, link_cache.bssid, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = link_cache.channel;
+
+    esp_netif_ip_info_t ip_info = {};
+    ip_info.ip.addr = link_cache.ip;
+    ip_info.netmask.addr = link_cache.netmask;
+    ip_info.gw.addr = link_cache.gw;
+    esp_netif_dhcpc_stop(sta_netif);
+    esp_netif_set_ip_info(sta_netif, &ip_info);
+    if (link_cache.dns != 0) {
+        esp_netif_dns_info_t dns = {};
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4.addr = link_cache.dns;
+        esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    link_cached = true;
+    printf("Wi-Fi: using cached AP (channel %u) and IP " IPSTR "\n",
+           (unsigned)link_cache.channel, IP2STR(&ip_info.ip));
+}
+
+// Back to a full scan and DHCP; takes effect on the next connect
+static void wifi_cache_drop(const char *why)
+{
+    if (!link_cached) return;
+    printf("Wi-Fi: %s, dropping the cached AP/IP\n", why);
+    link_cached = false;
+    memset(&link_cache, 0, sizeof(link_cache));
+    nvs_handle_t nvs;
+    if (nvs_open("wifi_cache", NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, "link");
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    wifi_config.sta.bssid_set = false;
+    wifi_config.sta.channel = 0;
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    esp_netif_dhcpc_start(sta_netif);
+}
+
+// --- Wi-Fi ---
+
+static void sntp_synced(struct timeval *tv)
+{
+    time_t now = tv->tv_sec;
+    struct tm timeinfo;
+    gmtime_r(&now, &timeinfo);
+    printf("Time synced: %04d-%02d-%02d %02d:%02d:%02d UTC\n",
+           timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+           timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+}
+
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        printf("Wi-Fi: Connected to AP, waiting for IP...\n");
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+        // Never got on through the cached AP: it moved or is gone
+        if (link_cached && !has_ip && ++cache_fails >= WIFI_CACHE_MAX_FAILS) {
+            wifi_cache_drop("cached AP not answering");
+        }
+        has_ip = false;
+        if (wifi_wanted) {
+            printf("Wi-Fi: Disconnected! Retrying...\n");
+            esp_wifi_connect();
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        printf("*** ESP32 IP Address: " IPSTR " ***\n", IP2STR(&event->ip_info.ip));
+        has_ip = true;
+        cache_fails = 0;
+        if (cfg.cache_link) wifi_cache_store(&event->ip_info);
+        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+        // Real time via SNTP in the background; the wall clock offset sent
+        // with each event follows it when it lands
+        if (!sntp_started) {
+            esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
+            sntp_config.sync_cb = sntp_synced;
+            esp_netif_sntp_init(&sntp_config);
+            sntp_started = true;
+        }
+    }
+}
+
+bool transport_wifi_init(const transport_wifi_config_t *config)
+{
+    cfg = *config;
+    strncpy(server_ip, cfg.server_ip, sizeof(server_ip) - 1);
+    cfg.server_ip = server_ip;
+    snprintf(server_url, sizeof(server_url), "http://%s:%u/", cfg.server_ip,
+             (unsigned)cfg.http_port);
+    wifi_event_group = xEventGroupCreate();
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    sta_netif = esp_netif_create_default_wifi_sta();
+
+    wifi_init_config_t init = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&init));
+
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+
+    strncpy((char *)wifi_config.sta.ssid, cfg.ssid, sizeof(wifi_config.sta.ssid));
+    strncpy((char *)wifi_config.sta.password, cfg.password, sizeof(wifi_config.sta.password));
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_OPEN;
+    wifi_config.sta.listen_interval = cfg.listen_interval;
+    if (cfg.cache_link && wifi_cache_load()) wifi_cache_apply();
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    return true;
+}
+
+bool transport_wifi_set_server(const char *ip, uint16_t http_port, uint16_t udp_port)
+{
+    struct in_addr addr;
+    if (strlen(ip) >= sizeof(server_ip) || inet_aton(ip, &addr) == 0 ||
+        http_port == 0 || udp_port == 0) {
+        return false;
+    }
+    taskENTER_CRITICAL(&server_lock);
+    strcpy(server_ip, ip);
+    cfg.http_port = http_port;
+    cfg.udp_port = udp_port;
+    udp_dest_addr.sin_port = htons(udp_port);
+    udp_dest_addr.sin_addr = addr;
+    snprintf(pending_url, sizeof(pending_url), "http://%s:%u/", ip, (unsigned)http_port);
+    url_pending = true;
+    taskEXIT_CRITICAL(&server_lock);
+    printf("Wi-Fi: server now %s (UDP %u)\n", pending_url, (unsigned)udp_port);
+    return true;
+}
+
+// --- HTTP client ---
+
+static esp_http_client_handle_t http_client_create(void)
+{
+    esp_http_client_config_t config = {};
+    config.url = server_url;
+    config.timeout_ms = cfg.http_timeout_ms;
+    // TCP keep-alive so a dead AP path is noticed on the idle connection
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = 5;
+    config.keep_alive_interval = 5;
+    config.keep_alive_count = 3;
+    return esp_http_client_init(&config);
+}
+
+static void http_failed(const char *what)
+{
+    http_fail_streak++;
+    printf("HTTP: POST failed: %s (%d in a row) | heap=%u\n", what, http_fail_streak,
+           (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    // Drop the stale socket; the next open reconnects on the same client.
+    // Only rebuild the client if reconnecting keeps failing.
+    if (http_fail_streak % cfg.http_reinit_after_fails == 0) {
+        // A cached address someone else now holds looks just like this
+        wifi_cache_drop("POSTs keep failing");
+        esp_http_client_cleanup(http_client);
+        http_client = http_client_create();
+    } else {
+        esp_http_client_close(http_client);
+    }
+}
+
+// --- transport_t ---
+
+static bool wifi_start(void)
+{
+    if (udp_sock < 0) {
+        udp_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (udp_sock < 0) {
+            printf("UDP: socket() failed\n");
+            return false;
+        }
+        taskENTER_CRITICAL(&server_lock);
+        udp_dest_addr.sin_family = AF_INET;
+        udp_dest_addr.sin_port = htons(cfg.udp_port);
+        inet_aton(cfg.server_ip, &udp_dest_addr.sin_addr);
+        taskEXIT_CRITICAL(&server_lock);
+    }
+    if (http_client == NULL) http_client = http_client_create();
+
+    wifi_wanted = true;
+    printf("Wi-Fi: Connecting to \"%s\", server %s (UDP %u)...\n", cfg.ssid, server_url,
+           (unsigned)cfg.udp_port);
+    esp_wifi_connect();
+    return http_client != NULL;
+}
+
+static void wifi_stop(void)
+{
+    wifi_wanted = false;
+    if (http_client != NULL) esp_http_client_close(http_client);
+    esp_wifi_disconnect();
+}
+
+static bool wifi_ready(void)
+{
+    return (xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+}
+
+static bool wifi_send_datagram(const uint8_t *buf, size_t len)
+{
+    if (udp_sock < 0) return false;
+    taskENTER_CRITICAL(&server_lock);
+    struct sockaddr_in dest = udp_dest_addr;
+    taskEXIT_CRITICAL(&server_lock);
+    int sent = sendto(udp_sock, buf, len, 0, (struct sockaddr *)&dest, sizeof(dest));
+    if (sent != (int)len) {
+        printf("UDP: sendto failed (sent=%d, len=%d)\n", sent, (int)len);
+        return false;
+    }
+    return true;
+}
+
+// Only datagrams from the server we send to: the AP is open, and a CONFIG
+// from anyone else could move the racquet to another server for good
+static int wifi_recv_control(uint8_t *buf, size_t cap)
+{
+    if (udp_sock < 0) return 0;
+    for (;;) {
+        struct sockaddr_in src = {};
+        socklen_t src_len = sizeof(src);
+        int len = recvfrom(udp_sock, buf, cap, MSG_DONTWAIT, (struct sockaddr *)&src, &src_len);
+        if (len <= 0) return 0;
+        taskENTER_CRITICAL(&server_lock);
+        bool from_server = src.sin_addr.s_addr == udp_dest_addr.sin_addr.s_addr &&
+                           src.sin_port == udp_dest_addr.sin_port;
+        taskEXIT_CRITICAL(&server_lock);
+        if (from_server) return len;
+        udp_foreign++;
+        if ((udp_foreign & (udp_foreign - 1)) == 0) {     // 1, 2, 4, ...: not a flood of logs
+            printf("UDP: dropped %u control datagrams not from the server (last %s:%u)\n",
+                   (unsigned)udp_foreign, inet_ntoa(src.sin_addr), (unsigned)ntohs(src.sin_port));
+        }
+    }
+}
+
+static bool wifi_event_open(int content_len)
+{
+    if (http_client == NULL) return false;
+    bool moved = false;
+    taskENTER_CRITICAL(&server_lock);
+    if (url_pending) {
+        memcpy(server_url, pending_url, sizeof(server_url));
+        url_pending = false;
+        moved = true;
+    }
+    taskEXIT_CRITICAL(&server_lock);
+    if (moved) esp_http_client_close(http_client);    // keep-alive socket is to the old server
+    esp_http_client_set_url(http_client, server_url);
+    esp_http_client_set_method(http_client, HTTP_METHOD_POST);
+    esp_http_client_set_header(http_client, "Content-Type", cfg.content_type);
+    http_chunked = content_len < 0;
+    esp_err_t err = esp_http_client_open(http_client, content_len);
+    if (err != ESP_OK) {
+        http_failed(esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+// Plain writes when Content-Length was sent, chunked transfer coding
+// framing otherwise
+static bool wifi_event_write(const uint8_t *data, size_t len)
+{
+    if (http_chunked) {
+        char size_line[12];
+        int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)len);
+        if (esp_http_client_write(http_client, size_line, n) != n) return false;
+    }
+    if (esp_http_client_write(http_client, (const char *)data, (int)len) != (int)len) {
+        return false;
+    }
+    if (http_chunked && esp_http_client_write(http_client, "\r\n", 2) != 2) return false;
+    return true;
+}
+
+static bool wifi_event_close(bool complete)
+{
+    bool sent = complete;
+    if (sent && http_chunked) {
+        sent = esp_http_client_write(http_client, "0\r\n\r\n", 5) == 5;
+    }
+    if (!sent || esp_http_client_fetch_headers(http_client) < 0) {
+        http_failed(complete ? "no response" : "body not sent");
+        return false;
+    }
+    // Read the rest of the response so the connection can be reused, and
+    // leave it open: the server speaks HTTP/1.1 keep-alive, so the next
+    // POST goes out without a new TCP handshake
+    esp_http_client_flush_response(http_client, NULL);
+    if (http_fail_streak > 0) {
+        printf("HTTP: reconnected after %d failed POSTs\n", http_fail_streak);
+        http_fail_streak = 0;
+    }
+    int status = esp_http_client_get_status_code(http_client);
+    if (status != 200) {
+        printf("HTTP: Non-200 status: %d\n", status);
+        return false;
+    }
+    return true;
+}
+
+static int wifi_rssi(void)
+{
+    wifi_ap_record_t ap = {};
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return TRANSPORT_RSSI_NONE;
+    return ap.rssi;
+}
+
+static void wifi_set_power_save(bool idle)
+{
+    esp_err_t err = esp_wifi_set_ps(idle ? IDLE_WIFI_PS : ACTIVE_WIFI_PS);
+    printf("Wi-Fi: %s\n", err != ESP_OK ? esp_err_to_name(err)
+                          : idle ? "max modem sleep" : "min modem sleep");
+}
+
+static const transport_t wifi_transport = {
+    "wifi",
+    wifi_start,
+    wifi_stop,
+    wifi_ready,
+    wifi_send_datagram,
+    wifi_recv_control,
+    wifi_event_open,
+    wifi_event_write,
+    wifi_event_close,
+    wifi_rssi,
+    wifi_set_power_save,
+};
+
+const transport_t *transport_wifi(void)
+{
+    return &wifi_transport;
+}
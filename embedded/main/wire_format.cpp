@@ -0,0 +1,329 @@
+/*
+ * Binary wire format encoder. See wire_format.h for the layout.
+ */
+
+#include "wire_format.h"
+
+#include <math.h>
+#include <string.h>
+
+// --- Quantization helpers ---
+
+static inline int16_t quantize_q(float v, int q)
+{
+    float scaled = ldexpf(v, q);    // q may be negative for large batches
+    if (scaled > 32767.0f) return 32767;
+    if (scaled < -32768.0f) return -32768;
+    return (int16_t)lrintf(scaled);
+}
+
+// Largest Q-point <= max_q at which every value in the batch fits int16
+static int batch_q(const sample_view_t *samples, int first_axis, int count, int max_q)
+{
+    float peak = 0.0f;
+    for (int a = first_axis; a < first_axis + 3; a++) {
+        for (int i = 0; i < count; i++) {
+            float v = fabsf(sample_view_axis(samples, a, i));
+            if (v > peak) peak = v;
+        }
+    }
+    int q = max_q;
+    while (q > -16 && ldexpf(peak, q) > 32767.0f) q--;
+    return q;
+}
+
+// Zig-zag LEB128; returns bytes written (max 5)
+static inline size_t put_varint(uint8_t *p, int32_t v)
+{
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    size_t n = 0;
+    while (z >= 0x80) {
+        p[n++] = (uint8_t)(z | 0x80);
+        z >>= 7;
+    }
+    p[n++] = (uint8_t)z;
+    return n;
+}
+
+static inline uint32_t clamp_dt(int64_t dt, uint32_t max)
+{
+    if (dt < 0) return 0;
+    if (dt > (int64_t)max) return max;
+    return (uint32_t)dt;
+}
+
+// --- Phase summary ---
+
+static wire_phase_t encode_phase(const swing_phase_t *p)
+{
+    wire_phase_t w = {};
+    w.valid = p->valid ? 1 : 0;
+    w.stroke = p->stroke;
+    w.stroke_confidence = (uint16_t)lroundf(p->stroke_confidence * 1000.0f);
+    w.num_samples = (uint16_t)p->num_samples;
+    w.accel_start_idx = (uint16_t)p->accel_start_idx;
+    w.peak_idx = (uint16_t)p->peak_idx;
+    w.decel_end_idx = (uint16_t)p->decel_end_idx;
+    w.t_first_us = p->t_first_us;
+    if (p->valid) {
+        w.accel_start_dt_us = (int32_t)(p->accel_start_us - p->t_first_us);
+        w.peak_dt_us = (int32_t)(p->peak_us - p->t_first_us);
+        w.decel_end_dt_us = (int32_t)(p->decel_end_us - p->t_first_us);
+    }
+    w.t_last_dt_us = (int32_t)(p->t_last_us - p->t_first_us);
+    w.peak_gyro = p->peak_gyro;
+    w.peak_accel = p->peak_accel;
+    w.gyro_at_peak = p->gyro_at_peak;
+    w.accel_at_peak = p->accel_at_peak;
+    return w;
+}
+
+// --- Header ---
+
+static uint16_t device_id = 0;
+
+void wire_set_device_id(uint16_t id)
+{
+    device_id = id;
+}
+
+uint16_t wire_device_id(void)
+{
+    return device_id;
+}
+
+static wire_header_t make_header(wire_pkt_type_t type, int64_t base_t_us)
+{
+    wire_header_t hdr = {};
+    hdr.magic = WIRE_MAGIC;
+    hdr.version = WIRE_VERSION;
+    hdr.type = type;
+    hdr.device_id = device_id;
+    hdr.base_t_us = base_t_us;
+    return hdr;
+}
+
+// --- Packet builder ---
+
+size_t wire_packet_size(wire_pkt_type_t type, wire_encoding_t enc, int count,
+                        bool with_phase)
+{
+    size_t rec = (enc == WIRE_ENC_Q16) ? sizeof(wire_sample_q16_t)
+                                       : sizeof(wire_sample_f32_t);
+    size_t size = sizeof(wire_header_t) + (size_t)count * rec;
+    if (type == WIRE_PKT_EVENT) {
+        size += sizeof(wire_event_ext_t);
+        if (with_phase) size += sizeof(wire_phase_t);
+    }
+    return size;
+}
+
+bool wire_write_packet(byte_sink_t *sink, wire_pkt_type_t type, wire_encoding_t enc,
+                       uint16_t rate_hz, const sample_view_t *samples, int count,
+                       int64_t trigger_t_us, int64_t wall_offset_us,
+                       const swing_phase_t *phase)
+{
+    if (count < 0 || count > 0xFFFF) return false;
+
+    int64_t base_t = (count > 0) ? sample_view_timestamp(samples, 0) : 0;
+
+    wire_header_t hdr = make_header(type, base_t);
+    hdr.encoding = enc;
+    if (type == WIRE_PKT_EVENT && phase != NULL) hdr.flags |= WIRE_FLAG_PHASE;
+    hdr.count = (uint16_t)count;
+    hdr.first_seq = (count > 0) ? sample_view_seq(samples, 0) : 0;
+    hdr.rate_hz = rate_hz;
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+
+    if (type == WIRE_PKT_EVENT) {
+        wire_event_ext_t ext = {};
+        ext.trigger_t_us = trigger_t_us;
+        ext.wall_offset_us = wall_offset_us;
+        if (!byte_sink_write(sink, &ext, sizeof(ext))) return false;
+        if (phase != NULL) {
+            wire_phase_t w = encode_phase(phase);
+            if (!byte_sink_write(sink, &w, sizeof(w))) return false;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        int64_t dt = sample_view_timestamp(samples, i) - base_t;
+        bool ok;
+        if (enc == WIRE_ENC_Q16) {
+            wire_sample_q16_t rec;
+            rec.dt_us = clamp_dt(dt, 0xFFFFFFFFu);
+            for (int a = 0; a < 3; a++) {
+                rec.gyro[a] = quantize_q(sample_view_axis(samples, SAMPLE_GYRO_X + a, i),
+                                         WIRE_GYRO_Q);
+                rec.accel[a] = quantize_q(sample_view_axis(samples, SAMPLE_ACCEL_X + a, i),
+                                          WIRE_ACCEL_Q);
+            }
+            ok = byte_sink_write(sink, &rec, sizeof(rec));
+        } else {
+            wire_sample_f32_t rec;
+            rec.dt_us = clamp_dt(dt, 0xFFFFFFFFu);
+            for (int a = 0; a < 3; a++) {
+                rec.gyro[a] = sample_view_axis(samples, SAMPLE_GYRO_X + a, i);
+                rec.accel[a] = sample_view_axis(samples, SAMPLE_ACCEL_X + a, i);
+            }
+            ok = byte_sink_write(sink, &rec, sizeof(rec));
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+int wire_build_packet(wire_pkt_type_t type, wire_encoding_t enc, uint16_t rate_hz,
+                      const sample_view_t *samples, int count, int64_t trigger_t_us,
+                      int64_t wall_offset_us, const swing_phase_t *phase,
+                      uint8_t *out_buf, size_t out_size)
+{
+    byte_sink_t sink;
+    byte_sink_init(&sink, out_buf, out_size, NULL, NULL);
+    if (!wire_write_packet(&sink, type, enc, rate_hz, samples, count, trigger_t_us,
+                           wall_offset_us, phase)) {
+        return -1;
+    }
+    return (int)sink.len;
+}
+
+int wire_build_live_delta(uint16_t rate_hz, const sample_view_t *samples, int count,
+                          uint8_t *out_buf, size_t out_size, int *encoded)
+{
+    *encoded = 0;
+    if (count > 0xFFFF) count = 0xFFFF;
+    size_t len = sizeof(wire_header_t) + sizeof(wire_delta_ext_t);
+    if (count <= 0 || out_size < len) return -1;
+
+    int64_t base_t = sample_view_timestamp(samples, 0);
+    wire_delta_ext_t ext = {};
+    ext.gyro_q = (int8_t)batch_q(samples, SAMPLE_GYRO_X, count, WIRE_GYRO_Q);
+    ext.accel_q = (int8_t)batch_q(samples, SAMPLE_ACCEL_X, count, WIRE_ACCEL_Q);
+    ext.dt_us = (rate_hz > 0) ? (uint16_t)((1000000 + rate_hz / 2) / rate_hz) : 0;
+
+    int16_t prev[SAMPLE_NUM_AXES] = {};
+    int64_t prev_t = base_t;
+    int n = 0;
+    for (; n < count; n++) {
+        // Worst case: one 32-bit step plus six 16-bit deltas
+        uint8_t rec[5 + SAMPLE_NUM_AXES * 3];
+        size_t r = 0;
+        int64_t t = sample_view_timestamp(samples, n);
+        int64_t step = (n == 0) ? 0 : t - prev_t - ext.dt_us;
+        if (step > INT32_MAX / 2 || step < INT32_MIN / 2) break;
+        r += put_varint(rec + r, (int32_t)step);
+        int16_t cur[SAMPLE_NUM_AXES];
+        for (int a = 0; a < SAMPLE_NUM_AXES; a++) {
+            int q = (a < SAMPLE_ACCEL_X) ? ext.gyro_q : ext.accel_q;
+            cur[a] = quantize_q(sample_view_axis(samples, a, n), q);
+            r += put_varint(rec + r, (int32_t)cur[a] - (int32_t)prev[a]);
+        }
+        if (len + r > out_size) break;
+        memcpy(out_buf + len, rec, r);
+        len += r;
+        memcpy(prev, cur, sizeof(prev));
+        prev_t = t;
+    }
+    if (n == 0) return -1;
+
+    wire_header_t hdr = make_header(WIRE_PKT_LIVE, base_t);
+    hdr.encoding = WIRE_ENC_DELTA;
+    hdr.count = (uint16_t)n;
+    hdr.first_seq = sample_view_seq(samples, 0);
+    hdr.rate_hz = rate_hz;
+    memcpy(out_buf, &hdr, sizeof(hdr));
+    memcpy(out_buf + sizeof(hdr), &ext, sizeof(ext));
+
+    *encoded = n;
+    return (int)len;
+}
+
+bool wire_write_stats(byte_sink_t *sink, int64_t t_us, const wire_stats_t *stats,
+                      const wire_task_stats_t *tasks, int num_tasks)
+{
+    wire_header_t hdr = make_header(WIRE_PKT_STATS, t_us);
+    hdr.count = (uint16_t)num_tasks;
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+    if (!byte_sink_write(sink, stats, sizeof(*stats))) return false;
+    return byte_sink_write(sink, tasks, sizeof(*tasks) * (size_t)num_tasks);
+}
+
+bool wire_write_profile(byte_sink_t *sink, int64_t t_us, const wire_profile_ext_t *ext,
+                        const wire_profile_stage_t *stages, int num_stages)
+{
+    wire_header_t hdr = make_header(WIRE_PKT_PROFILE, t_us);
+    hdr.count = (uint16_t)num_stages;
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+    if (!byte_sink_write(sink, ext, sizeof(*ext))) return false;
+    return byte_sink_write(sink, stages, sizeof(*stages) * (size_t)num_stages);
+}
+
+bool wire_write_sync(byte_sink_t *sink, const wire_clock_t *clock)
+{
+    wire_header_t hdr = make_header(WIRE_PKT_SYNC, clock->mono_us);
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+    return byte_sink_write(sink, clock, sizeof(*clock));
+}
+
+bool wire_write_config_ack(byte_sink_t *sink, int64_t t_us, const wire_config_t *cfg)
+{
+    wire_header_t hdr = make_header(WIRE_PKT_CONFIG_ACK, t_us);
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+    return byte_sink_write(sink, cfg, sizeof(*cfg));
+}
+
+bool wire_write_phase_mark(byte_sink_t *sink, const phase_mark_t *mark)
+{
+    wire_header_t hdr = make_header(WIRE_PKT_PHASE_MARK, mark->t_us);
+    wire_phase_mark_t body = {};
+    body.kind = mark->kind;
+    body.swing_id = mark->swing_id;
+    body.detect_delay_us = (uint32_t)(mark->detected_us - mark->t_us);
+    body.gyro = mark->gyro;
+    body.accel = mark->accel;
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+    return byte_sink_write(sink, &body, sizeof(body));
+}
+
+bool wire_write_backlog_header(byte_sink_t *sink, int64_t t_us, int64_t wall_offset_us,
+                               uint32_t boot_id, int count)
+{
+    wire_header_t hdr = make_header(WIRE_PKT_BACKLOG, t_us);
+    hdr.count = (uint16_t)count;
+    wire_backlog_ext_t ext = {};
+    ext.wall_offset_us = wall_offset_us;
+    ext.boot_id = boot_id;
+    if (!byte_sink_write(sink, &hdr, sizeof(hdr))) return false;
+    return byte_sink_write(sink, &ext, sizeof(ext));
+}
+
+bool wire_parse_config(const uint8_t *buf, size_t len, wire_config_t *out)
+{
+    wire_header_t hdr;
+    if (len < sizeof(hdr) + sizeof(*out)) return false;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != WIRE_MAGIC || hdr.version != WIRE_VERSION || hdr.type != WIRE_PKT_CONFIG) {
+        return false;
+    }
+    // Settings are persisted, so no "any racquet" (0) here as for NACKs
+    if (hdr.device_id != device_id) return false;
+    memcpy(out, buf + sizeof(hdr), sizeof(*out));
+    out->server_ip[sizeof(out->server_ip) - 1] = '\0';
+    return true;
+}
+
+int wire_parse_nack(const uint8_t *buf, size_t len, wire_nack_range_t *out, int max)
+{
+    wire_header_t hdr;
+    if (len < sizeof(hdr)) return -1;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != WIRE_MAGIC || hdr.version != WIRE_VERSION || hdr.type != WIRE_PKT_NACK) {
+        return -1;
+    }
+    // Addressed to another racquet (0 is anyone)
+    if (hdr.device_id != 0 && hdr.device_id != device_id) return -1;
+    if (len < sizeof(hdr) + (size_t)hdr.count * sizeof(wire_nack_range_t)) return -1;
+    int n = hdr.count < max ? hdr.count : max;
+    memcpy(out, buf + sizeof(hdr), sizeof(wire_nack_range_t) * (size_t)n);
+    return n;
+}
@@ -0,0 +1,366 @@
+/*
+ * Binary wire format for live (UDP) and event (HTTP) packets.
+ *
+ * Little-endian, which is the native byte order of the ESP32-S3, so the
+ * packed structs below are written with memcpy. Layout of one packet:
+ *
+ *   wire_header_t | wire_event_ext_t (events only)
+ *                 | wire_phase_t (events with WIRE_FLAG_PHASE) | count x sample record
+ *
+ * Timestamps are microseconds of the racquet's monotonic clock
+ * (esp_timer, from boot), and sample timestamps are sent as offsets from
+ * header.base_t_us. Records are either plain float32 (WIRE_ENC_F32) or
+ * int16 in the BNO085's own Q-points (WIRE_ENC_Q16: gyro Q9 rad/s, accel Q8
+ * m/s^2), which loses nothing over what the sensor reports. The decoder
+ * lives in wire_format.py.
+ *
+ * Wall-clock time is never stamped per sample. Events carry the
+ * monotonic-to-wall offset at upload time in their extension, and a sync
+ * packet (WIRE_PKT_SYNC) with a (monotonic, wall) pair goes out over the
+ * live channel once a second so the server can map live samples and
+ * follow drift and SNTP steps:
+ *
+ *   wire_header_t | wire_clock_t
+ *
+ * Live packets can instead use WIRE_ENC_DELTA, sized to one datagram:
+ *
+ *   wire_header_t | wire_delta_ext_t | count x delta record
+ *
+ * Each axis is quantized to int16 with a per-batch Q-point (the sensor's own
+ * Q-point unless the batch would clip), and every record holds zig-zag
+ * LEB128 varints: the timestamp step minus delta_ext.dt_us, then the change
+ * of each of the six axes from the previous record (from 0 for the first).
+ * At 200 Hz a record is typically 8-11 bytes.
+ *
+ * Events carry the on-device phase segmentation (swing_phase.h) and stroke
+ * label (stroke_classifier.h) ahead of the samples; with raw upload turned
+ * off an event is just that summary and count is 0.
+ *
+ * Stats packets (WIRE_PKT_STATS) carry device telemetry instead of samples:
+ *
+ *   wire_header_t | wire_stats_t | count x wire_task_stats_t
+ *
+ * and are followed by a profile packet (WIRE_PKT_PROFILE) with per-stage
+ * cycle counts since the previous one (profile.h):
+ *
+ *   wire_header_t | wire_profile_ext_t | count x wire_profile_stage_t
+ *
+ * Every header carries the sending racquet's device_id, so one server can
+ * take packets from many racquets at once and keep their sequence numbers,
+ * clocks and events apart.
+ *
+ * Live sample sequence numbers count live samples (the live ring index), so
+ * a gap in first_seq .. first_seq + count - 1 is a lost datagram. The
+ * server asks for those again with a NACK packet (WIRE_PKT_NACK), sent back
+ * to the racquet's live socket:
+ *
+ *   wire_header_t | count x wire_nack_range_t
+ *
+ * Settings are changed the same way (WIRE_PKT_CONFIG, server -> racquet):
+ * the set mask says which fields of the wire_config_t to apply, and 0
+ * just asks for the current ones. The racquet answers every request with
+ * a WIRE_PKT_CONFIG_ACK holding its settings after the change, the
+ * request_id echoed and status WIRE_CFG_OK, or WIRE_CFG_REJECTED if any
+ * field was out of range (then nothing was applied):
+ *
+ *   wire_header_t | wire_config_t
+ *
+ * Live phase marks (WIRE_PKT_PHASE_MARK, phase_tracker.h) go out over the
+ * live channel the moment a swing phase is recognised, ahead of the event,
+ * with base_t_us the time of the phase itself:
+ *
+ *   wire_header_t | wire_phase_mark_t
+ *
+ * What the racquet could not send while the link was down is spooled to
+ * flash (spool.h) and uploaded later over the event channel as backlog
+ * packets (WIRE_PKT_BACKLOG), many spooled packets to one body:
+ *
+ *   wire_header_t | wire_backlog_ext_t | count x (wire_spool_record_t | packet)
+ *
+ * Each packet is whole, as it would have gone out then: full-rate live
+ * batches (WIRE_ENC_DELTA), events and sync pairs. base_t_us and the
+ * extension's wall_offset_us are taken at upload, and map the monotonic
+ * times of every record written in the same boot (boot_id) to wall time.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "byte_sink.h"
+#include "sample_view.h"
+#include "swing_phase.h"
+#include "phase_tracker.h"
+
+#define WIRE_MAGIC              0x4353      // "SC"
+#define WIRE_VERSION            2           // 2: microsecond monotonic timestamps
+
+#define WIRE_GYRO_Q             9           // rad/s, 1/512 LSB
+#define WIRE_ACCEL_Q            8           // m/s^2, 1/256 LSB
+
+typedef enum : uint8_t {
+    WIRE_PKT_LIVE  = 1,
+    WIRE_PKT_EVENT = 2,
+    WIRE_PKT_STATS = 3,
+    WIRE_PKT_NACK  = 4,     // server -> racquet
+    WIRE_PKT_PROFILE = 5,
+    WIRE_PKT_SYNC  = 6,
+    WIRE_PKT_CONFIG = 7,    // server -> racquet
+    WIRE_PKT_CONFIG_ACK = 8,
+    WIRE_PKT_PHASE_MARK = 9,
+    WIRE_PKT_BACKLOG = 10,  // event channel only
+} wire_pkt_type_t;
+
+typedef enum : uint8_t {
+    WIRE_ENC_F32 = 0,
+    WIRE_ENC_Q16 = 1,
+    WIRE_ENC_DELTA = 2,     // live packets only
+} wire_encoding_t;
+
+#define WIRE_FLAG_PHASE         0x01        // wire_phase_t follows the event extension
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  type;          // wire_pkt_type_t
+    uint8_t  encoding;      // wire_encoding_t
+    uint8_t  flags;
+    uint16_t count;         // number of sample records
+    uint32_t first_seq;     // seq of the first sample
+    uint16_t rate_hz;       // sample rate of the records in this packet
+    uint16_t device_id;     // which racquet, see wire_set_device_id()
+    int64_t  base_t_us;     // monotonic time of the first sample (or of the packet)
+} wire_header_t;  // 24 bytes
+
+typedef struct __attribute__((packed)) {
+    int64_t trigger_t_us;
+    int64_t wall_offset_us;         // wall clock (Unix us) minus monotonic, at upload
+} wire_event_ext_t;  // 16 bytes
+
+typedef struct __attribute__((packed)) {
+    uint8_t  valid;                 // 0: no swing found, only peaks are meaningful
+    uint8_t  stroke;                // stroke_label_t (stroke_classifier.h)
+    uint16_t num_samples;           // samples analyzed
+    uint16_t accel_start_idx;
+    uint16_t peak_idx;
+    uint16_t decel_end_idx;
+    uint16_t stroke_confidence;     // per mille
+    int64_t  t_first_us;
+    int32_t  accel_start_dt_us;     // boundary times, offsets from t_first_us
+    int32_t  peak_dt_us;
+    int32_t  decel_end_dt_us;
+    int32_t  t_last_dt_us;
+    float    peak_gyro;             // rad/s, smoothed magnitudes
+    float    peak_accel;            // m/s^2
+    float    gyro_at_peak;
+    float    accel_at_peak;
+} wire_phase_t;  // 52 bytes
+
+typedef struct __attribute__((packed)) {
+    int8_t  gyro_q;         // values are int16 * 2^-gyro_q rad/s
+    int8_t  accel_q;        // values are int16 * 2^-accel_q m/s^2
+    uint16_t dt_us;         // nominal timestamp step
+} wire_delta_ext_t;  // 4 bytes
+
+typedef struct __attribute__((packed)) {
+    uint32_t dt_us;         // offset from base_t_us
+    float gyro[3];
+    float accel[3];
+} wire_sample_f32_t;  // 28 bytes
+
+typedef struct __attribute__((packed)) {
+    uint32_t dt_us;         // offset from base_t_us
+    int16_t gyro[3];
+    int16_t accel[3];
+} wire_sample_q16_t;  // 16 bytes
+
+#define WIRE_TASK_NAME_LEN      12
+
+typedef struct __attribute__((packed)) {
+    uint32_t uptime_ms;
+    uint32_t free_heap;             // bytes, 8-bit capable
+    uint32_t min_free_heap;         // lowest free_heap since boot
+    uint32_t largest_free_block;
+    uint32_t arena_used;
+    uint32_t arena_size;
+    uint32_t live_dropped;          // live samples lost to ring overrun
+    uint32_t events_dropped;        // events lost to the drop policy
+    uint16_t events_pending;
+    uint16_t live_rate_hz;          // current adaptive live rate
+    uint32_t live_nacked;           // live samples the server asked for again
+    uint32_t live_retransmitted;    // ... and that were resent from the ring
+    uint32_t live_unrecoverable;    // ... that had already been overwritten
+    uint32_t sensor_gaps;           // report spacings over 1.5 periods while active
+    uint32_t sensor_gap_max_us;     // longest of them since boot
+} wire_stats_t;  // 56 bytes
+
+typedef struct __attribute__((packed)) {
+    char name[WIRE_TASK_NAME_LEN];
+    uint32_t stack_size;            // bytes
+    uint32_t stack_min_free;        // uxTaskGetStackHighWaterMark, bytes
+} wire_task_stats_t;  // 20 bytes
+
+#define WIRE_PROFILE_NAME_LEN   12
+
+typedef struct __attribute__((packed)) {
+    uint16_t cpu_mhz;               // cycles per microsecond
+    uint16_t reserved;
+    uint32_t window_ms;             // time covered by the histograms
+} wire_profile_ext_t;  // 8 bytes
+
+typedef struct __attribute__((packed)) {
+    char name[WIRE_PROFILE_NAME_LEN];
+    uint32_t count;                 // times the stage ran in the window
+    uint32_t min_cycles;
+    uint32_t p50_cycles;
+    uint32_t p99_cycles;
+    uint32_t max_cycles;
+} wire_profile_stage_t;  // 32 bytes
+
+typedef struct __attribute__((packed)) {
+    int64_t mono_us;                // esp_timer_get_time()
+    int64_t wall_us;                // gettimeofday() read right after, Unix us
+} wire_clock_t;  // 16 bytes
+
+#define WIRE_NACK_MAX_RANGES    16
+
+typedef struct __attribute__((packed)) {
+    uint32_t first_seq;
+    uint16_t count;
+    uint16_t reserved;
+} wire_nack_range_t;  // 8 bytes
+
+// wire_config_t.set bits
+#define WIRE_CFG_SENSOR_RATE    0x0001
+#define WIRE_CFG_TRIGGER        0x0002      // gyro_on .. debounce_ms, all together
+#define WIRE_CFG_CAPTURE        0x0004      // pre_samples and post_samples
+#define WIRE_CFG_LIVE_LEVEL     0x0008
+#define WIRE_CFG_SERVER         0x0010      // server_ip, http_port, udp_port
+#define WIRE_CFG_TRANSPORT      0x0020
+#define WIRE_CFG_ALL            0x003F
+
+#define WIRE_CFG_OK             0
+#define WIRE_CFG_REJECTED       1
+
+#define WIRE_LIVE_LEVEL_AUTO    0xFF        // rate controller picks the level
+
+typedef struct __attribute__((packed)) {
+    uint16_t request_id;            // echoed in the ack
+    uint8_t  status;                // WIRE_CFG_OK / WIRE_CFG_REJECTED, acks only
+    uint8_t  transport;             // transport_kind_t (transport.h)
+    uint32_t set;                   // WIRE_CFG_* fields to apply; acks: fields applied
+    uint16_t sensor_rate_hz;
+    uint16_t pre_samples;           // capture window, including the trigger sample
+    uint16_t post_samples;
+    uint8_t  live_level;            // live_rate ladder index or WIRE_LIVE_LEVEL_AUTO
+    uint8_t  reserved;
+    float    gyro_on;               // event_trigger_config_t
+    float    energy_on;
+    float    energy_off;
+    float    accel_on;
+    float    jerk_on;
+    uint32_t debounce_ms;
+    uint16_t http_port;
+    uint16_t udp_port;
+    char     server_ip[16];         // dotted quad, NUL-terminated
+} wire_config_t;  // 60 bytes
+
+typedef struct __attribute__((packed)) {
+    uint8_t  kind;                  // phase_mark_kind_t
+    uint8_t  reserved;
+    uint16_t swing_id;              // the three marks of one swing share it
+    uint32_t detect_delay_us;       // from the phase to the sample that confirmed it
+    float    gyro;                  // smoothed |gyro| at the phase, rad/s
+    float    accel;                 // smoothed |accel|, m/s^2
+} wire_phase_mark_t;  // 16 bytes
+
+typedef struct __attribute__((packed)) {
+    int64_t  wall_offset_us;        // wall clock (Unix us) minus monotonic, at upload
+    uint32_t boot_id;               // boot the upload is made in
+    uint32_t reserved;
+} wire_backlog_ext_t;  // 16 bytes
+
+typedef struct __attribute__((packed)) {
+    uint16_t len;                   // packet bytes that follow
+    uint16_t reserved;
+    uint32_t boot_id;               // boot the packet was spooled in
+    uint32_t crc32;                 // of the packet (zlib's crc32)
+} wire_spool_record_t;  // 12 bytes
+
+static_assert(sizeof(wire_header_t) == 24, "wire_header_t layout");
+static_assert(sizeof(wire_event_ext_t) == 16, "wire_event_ext_t layout");
+static_assert(sizeof(wire_phase_t) == 52, "wire_phase_t layout");
+static_assert(sizeof(wire_delta_ext_t) == 4, "wire_delta_ext_t layout");
+static_assert(sizeof(wire_sample_f32_t) == 28, "wire_sample_f32_t layout");
+static_assert(sizeof(wire_sample_q16_t) == 16, "wire_sample_q16_t layout");
+static_assert(sizeof(wire_stats_t) == 56, "wire_stats_t layout");
+static_assert(sizeof(wire_task_stats_t) == 20, "wire_task_stats_t layout");
+static_assert(sizeof(wire_profile_ext_t) == 8, "wire_profile_ext_t layout");
+static_assert(sizeof(wire_profile_stage_t) == 32, "wire_profile_stage_t layout");
+static_assert(sizeof(wire_clock_t) == 16, "wire_clock_t layout");
+static_assert(sizeof(wire_nack_range_t) == 8, "wire_nack_range_t layout");
+static_assert(sizeof(wire_config_t) == 60, "wire_config_t layout");
+static_assert(sizeof(wire_phase_mark_t) == 16, "wire_phase_mark_t layout");
+static_assert(sizeof(wire_backlog_ext_t) == 16, "wire_backlog_ext_t layout");
+static_assert(sizeof(wire_spool_record_t) == 12, "wire_spool_record_t layout");
+
+// Racquet ID stamped into every packet header from now on. Set once at
+// boot, before any task sends.
+void wire_set_device_id(uint16_t id);
+uint16_t wire_device_id(void);
+
+// Size in bytes of a packet holding `count` samples (and a phase summary).
+size_t wire_packet_size(wire_pkt_type_t type, wire_encoding_t enc, int count,
+                        bool with_phase);
+
+// Stream a packet of `count` samples into `sink`. trigger_t_us,
+// wall_offset_us and phase (may be NULL) are only used for events. Returns
+// false if the sink failed. Does not flush the sink.
+bool wire_write_packet(byte_sink_t *sink, wire_pkt_type_t type, wire_encoding_t enc,
+                       uint16_t rate_hz, const sample_view_t *samples, int count,
+                       int64_t trigger_t_us, int64_t wall_offset_us,
+                       const swing_phase_t *phase);
+
+// Encode a whole packet into out_buf.
+// Returns the number of bytes written, or -1 if out_size is too small.
+int wire_build_packet(wire_pkt_type_t type, wire_encoding_t enc, uint16_t rate_hz,
+                      const sample_view_t *samples, int count, int64_t trigger_t_us,
+                      int64_t wall_offset_us, const swing_phase_t *phase,
+                      uint8_t *out_buf, size_t out_size);
+
+// Encode up to `count` samples as one WIRE_ENC_DELTA live packet of at most
+// out_size bytes. Returns the packet length and sets *encoded to the number
+// of samples that fit (the rest belong in the next packet), or -1 if out_size
+// cannot hold even one.
+int wire_build_live_delta(uint16_t rate_hz, const sample_view_t *samples, int count,
+                          uint8_t *out_buf, size_t out_size, int *encoded);
+
+// Stream a stats packet stamped t_us into `sink`.
+bool wire_write_stats(byte_sink_t *sink, int64_t t_us, const wire_stats_t *stats,
+                      const wire_task_stats_t *tasks, int num_tasks);
+
+// Stream a profile packet stamped t_us into `sink`.
+bool wire_write_profile(byte_sink_t *sink, int64_t t_us, const wire_profile_ext_t *ext,
+                        const wire_profile_stage_t *stages, int num_stages);
+
+// Stream a clock sync packet into `sink`.
+bool wire_write_sync(byte_sink_t *sink, const wire_clock_t *clock);
+
+// Stream a config ack (the racquet's settings) into `sink`.
+bool wire_write_config_ack(byte_sink_t *sink, int64_t t_us, const wire_config_t *cfg);
+
+// Stream a live phase mark into `sink`.
+bool wire_write_phase_mark(byte_sink_t *sink, const phase_mark_t *mark);
+
+// Stream the head of a backlog packet of `count` records stamped t_us into
+// `sink`; the records follow it (spool_batch_read()).
+bool wire_write_backlog_header(byte_sink_t *sink, int64_t t_us, int64_t wall_offset_us,
+                               uint32_t boot_id, int count);
+
+// Parse a config request into *out. Returns false if buf is not a
+// well-formed WIRE_PKT_CONFIG addressed to this racquet's own device_id.
+bool wire_parse_config(const uint8_t *buf, size_t len, wire_config_t *out);
+
+// Parse a NACK packet into at most `max` ranges. Returns the number of
+// ranges, or -1 if buf is not a well-formed NACK for this racquet.
+int wire_parse_nack(const uint8_t *buf, size_t len, wire_nack_range_t *out, int max);
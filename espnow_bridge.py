@@ -0,0 +1,236 @@
+"""
+Bridge between the ESP-NOW gateway on USB and the ingest server.
+
+Racquets on the ESP-NOW transport (embedded/main/transport_espnow.cpp)
+talk to a gateway ESP32 plugged into this laptop (embedded/gateway), which
+passes every radio frame through its serial port. This script turns those
+frames back into what the racquet would have sent over Wi-Fi, so
+ingest_server.py runs unchanged:
+
+  - datagrams are reassembled and sent to UDP 7104 from one socket per
+    racquet; whatever the server sends back to that socket (NACKs, config
+    requests) goes to the racquet as a CONTROL frame
+  - events are reassembled and POSTed to HTTP 7103; the status goes back
+    as an EVENT_ACK, and the racquet resends anything not acknowledged
+  - once a second, a broadcast HELLO tells racquets where the gateway is,
+    and a TIME frame hands them this laptop's clock in place of SNTP
+
+Frame layout and SLIP framing: embedded/main/espnow_link.h.
+
+Usage:
+    pip install pyserial
+    python espnow_bridge.py /dev/ttyUSB0            # COM5 on Windows
+    python espnow_bridge.py /dev/ttyUSB0 --server 127.0.0.1
+"""
+
+import argparse
+import http.client
+import select
+import socket
+import struct
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import serial
+
+HTTP_PORT = 7103
+LIVE_UDP_PORT = 7104
+BAUD = 921600               # ESPNOW_LINK_BAUD
+HELLO_INTERVAL_S = 1.0
+REASSEMBLY_TIMEOUT_S = 2.0
+HTTP_TIMEOUT_S = 2.0
+POST_WORKERS = 4
+
+LINK_MAGIC = 0x4E45
+LINK_MTU = 250
+FRAME_HDR = struct.Struct("<HBBHH")     # espnow_frame_hdr_t
+LINK_PAYLOAD = LINK_MTU - FRAME_HDR.size
+FLAG_LAST = 0x01
+
+DATAGRAM, EVENT, HELLO, TIME, CONTROL, EVENT_ACK = 1, 2, 3, 4, 5, 6
+
+BROADCAST = b"\xff" * 6
+SLIP_END, SLIP_ESC, SLIP_ESC_END, SLIP_ESC_ESC = 0xC0, 0xDB, 0xDC, 0xDD
+
+
+def slip_encode(data):
+    out = bytearray([SLIP_END])
+    for b in data:
+        if b == SLIP_END:
+            out += bytes([SLIP_ESC, SLIP_ESC_END])
+        elif b == SLIP_ESC:
+            out += bytes([SLIP_ESC, SLIP_ESC_ESC])
+        else:
+            out.append(b)
+    out.append(SLIP_END)
+    return bytes(out)
+
+
+class SlipDecoder:
+    """Feed serial bytes in, get whole packets out."""
+
+    def __init__(self):
+        self._buf = bytearray()
+        self._esc = False
+
+    def feed(self, data):
+        packets = []
+        for b in data:
+            if b == SLIP_END:
+                if self._buf:
+                    packets.append(bytes(self._buf))
+                self._buf.clear()
+                self._esc = False
+            elif self._esc:
+                self._buf.append({SLIP_ESC_END: SLIP_END,
+                                  SLIP_ESC_ESC: SLIP_ESC}.get(b, b))
+                self._esc = False
+            elif b == SLIP_ESC:
+                self._esc = True
+            else:
+                self._buf.append(b)
+        return packets
+
+
+def mac_str(mac):
+    return ":".join(f"{b:02x}" for b in mac)
+
+
+class Reassembler:
+    """Fragments keyed by (mac, kind, msg_id) until the last one is in."""
+
+    def __init__(self):
+        self._parts = {}
+
+    def add(self, mac, kind, flags, msg_id, frag, payload):
+        key = (mac, kind, msg_id)
+        entry = self._parts.setdefault(key, {"frags": {}, "last": None,
+                                             "t": time.monotonic()})
+        entry["frags"][frag] = payload
+        if flags & FLAG_LAST:
+            entry["last"] = frag
+        last = entry["last"]
+        if last is None or len(entry["frags"]) < last + 1:
+            return None
+        del self._parts[key]
+        return b"".join(entry["frags"][i] for i in range(last + 1))
+
+    def expire(self):
+        """Drop messages that lost a fragment; returns how many."""
+        cutoff = time.monotonic() - REASSEMBLY_TIMEOUT_S
+        stale = [k for k, e in self._parts.items() if e["t"] < cutoff]
+        for k in stale:
+            del self._parts[k]
+        return len(stale)
+
+
+class Bridge:
+    def __init__(self, port, server):
+        self.serial = serial.Serial(port, BAUD, timeout=0.02)
+        self.server = server
+        self.slip = SlipDecoder()
+        self.reassembler = Reassembler()
+        self.sockets = {}       # racquet MAC -> its UDP socket to the server
+        self.macs = {}          # socket -> racquet MAC
+        self.write_lock = threading.Lock()
+        self.posts = ThreadPoolExecutor(max_workers=POST_WORKERS)
+        self.counts = {"datagrams": 0, "events": 0, "nacks": 0, "lost": 0}
+
+    def send_frame(self, mac, kind, payload=b"", msg_id=0):
+        frame = FRAME_HDR.pack(LINK_MAGIC, kind, FLAG_LAST, msg_id, 0) + payload
+        with self.write_lock:
+            self.serial.write(slip_encode(mac + frame))
+
+    def udp_socket(self, mac):
+        sock = self.sockets.get(mac)
+        if sock is None:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            sock.setblocking(False)
+            self.sockets[mac] = sock
+            self.macs[sock] = mac
+            print(f"Racquet {mac_str(mac)} joined")
+        return sock
+
+    def post_event(self, mac, msg_id, body):
+        """Worker thread: one POST, then the racquet gets the status."""
+        status = 0
+        try:
+            conn = http.client.HTTPConnection(self.server, HTTP_PORT,
+                                              timeout=HTTP_TIMEOUT_S)
+            conn.request("POST", "/", body,
+                         {"Content-Type": "application/octet-stream"})
+            resp = conn.getresponse()
+            resp.read()
+            status = resp.status
+            conn.close()
+        except OSError as exc:
+            print(f"Event from {mac_str(mac)}: POST failed: {exc}")
+        if status:
+            self.send_frame(mac, EVENT_ACK, struct.pack("<H", status), msg_id)
+
+    def handle_packet(self, packet):
+        if len(packet) < 6 + FRAME_HDR.size:
+            return
+        mac, frame = packet[:6], packet[6:]
+        magic, kind, flags, msg_id, frag = FRAME_HDR.unpack_from(frame)
+        if magic != LINK_MAGIC or kind not in (DATAGRAM, EVENT):
+            return
+        message = self.reassembler.add(mac, kind, flags, msg_id, frag,
+                                       frame[FRAME_HDR.size:])
+        if message is None:
+            return
+        if kind == DATAGRAM:
+            self.udp_socket(mac).sendto(message, (self.server, LIVE_UDP_PORT))
+            self.counts["datagrams"] += 1
+        else:
+            self.counts["events"] += 1
+            self.posts.submit(self.post_event, mac, msg_id, message)
+
+    def relay_control(self):
+        """Server -> racquet: NACKs and config requests on the per-racquet sockets."""
+        if not self.sockets:
+            return
+        readable, _, _ = select.select(list(self.macs), [], [], 0)
+        for sock in readable:
+            try:
+                data = sock.recv(LINK_PAYLOAD)
+            except OSError:
+                continue
+            self.send_frame(self.macs[sock], CONTROL, data)
+            self.counts["nacks"] += 1
+
+    def beacon(self):
+        self.send_frame(BROADCAST, HELLO)
+        self.send_frame(BROADCAST, TIME, struct.pack("<q", time.time_ns() // 1000))
+
+    def run(self):
+        print(f"ESP-NOW bridge on {self.serial.port} -> {self.server} "
+              f"(HTTP {HTTP_PORT}, UDP {LIVE_UDP_PORT})")
+        next_beacon = 0.0
+        while True:
+            for packet in self.slip.feed(self.serial.read(4096)):
+                self.handle_packet(packet)
+            self.relay_control()
+            now = time.monotonic()
+            if now >= next_beacon:
+                self.beacon()
+                self.counts["lost"] += self.reassembler.expire()
+                next_beacon = now + HELLO_INTERVAL_S
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("port", help="gateway serial port")
+    parser.add_argument("--server", default="127.0.0.1",
+                        help="ingest server address (default: this machine)")
+    args = parser.parse_args(argv)
+    bridge = Bridge(args.port, args.server)
+    try:
+        bridge.run()
+    except KeyboardInterrupt:
+        print(f"\nBridge stopped: {bridge.counts}")
+
+
+if __name__ == "__main__":
+    main()
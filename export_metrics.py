@@ -1,6 +1,7 @@
 """
 Export tennis analyzer metrics for frontend viewer
 """
+import os
 import sys
 import json
 import numpy as np
@@ -8,6 +9,7 @@ from scipy.signal import savgol_filter
 
 # Add parent directory to path
 sys.path.insert(0, '/Users/ycy/Projects')
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
 
 from tennis_analyzer_v2 import TennisSwingAnalyzer, AnalyzerConfig
 
@@ -31,7 +33,27 @@ def get_video_duration(video_path: str) -> float:
     return float(result.stdout.strip())
 
 
-def export_for_frontend(video_path: str, output_path: str):
+def load_imu_swings(session_path: str) -> list:
+    """Per-swing IMU summaries of a recorded session (session_store.py).
+
+    `session_path` is a session's base path or the swing_data directory
+    (its latest session). Only the index is read, in place.
+    """
+    from session_store import Session, open_latest_session
+
+    if os.path.isdir(session_path):
+        session = open_latest_session(session_path)
+    else:
+        session = Session(session_path)
+    if session is None:
+        return []
+    try:
+        return session.summaries()
+    finally:
+        session.close()
+
+
+def export_for_frontend(video_path: str, output_path: str, imu_session: str = None):
     """Run analyzer and export metrics in frontend format"""
 
     print(f"Analyzing: {video_path}")
@@ -94,6 +116,11 @@ def export_for_frontend(video_path: str, output_path: str):
     data['elbow_angle'] = smooth_array(data['elbow_angle'], window)
     data['weight_distribution'] = smooth_array(data['weight_distribution'], window)
 
+    # IMU swings recorded alongside the video, if a session was given
+    if imu_session:
+        data['imu_swings'] = load_imu_swings(imu_session)
+        print(f"  IMU swings: {len(data['imu_swings'])}")
+
     # Save to JSON
     with open(output_path, 'w') as f:
         json.dump(data, f)
@@ -106,7 +133,7 @@ def export_for_frontend(video_path: str, output_path: str):
 
 if __name__ == '__main__':
     if len(sys.argv) < 3:
-        print("Usage: python export_metrics.py <video_path> <output_json>")
+        print("Usage: python export_metrics.py <video_path> <output_json> [imu_session]")
         sys.exit(1)
 
-    export_for_frontend(sys.argv[1], sys.argv[2])
+    export_for_frontend(sys.argv[1], sys.argv[2], sys.argv[3] if len(sys.argv) > 3 else None)
@@ -0,0 +1,544 @@
+"""
+Multi-racquet ingest service for the racquet firmware's HTTP and UDP streams.
+
+One asyncio event loop owns every socket, all of them non-blocking, so
+dozens of racquets cost one thread between them:
+
+  - UDP 7104: live, stats, profile and sync datagrams. Packets are keyed by
+    the device_id in their header; each racquet gets its own sequence
+    tracker (NACKs go back to that racquet's address), clock fit and
+    reorder buffer, so one racquet's losses or clock never touch another's.
+    Live phase marks (accel start / peak / decel end, sent while the swing
+    is still going) skip the reorder buffer and go straight to on_phase,
+    for coaching cues that cannot wait for the event.
+  - HTTP 7103: event POSTs (keep-alive, Content-Length or chunked) and
+    phone video uploads. The handler only reads the body and answers 200;
+    decoding, analysis, plotting and the JSON hand-off run in
+    swing_events.process_event on a process pool. When a worker returns,
+    the loop appends the event, straight from its binary body, to the
+    session file the backend reads (session_store.py) and prints the
+    report. The loop is that file's only writer.
+  - HTTP /config/<device_id>: a racquet's runtime settings. POST a JSON
+    object of wire_format.CONFIG_FIELDS to change them; it goes out as a
+    config packet to the racquet's live address, which saves it in NVS and
+    acks over UDP. GET returns the last ack and asks for a fresh one.
+  - Backlog POSTs: what a racquet spooled to flash while it was out of
+    range, uploaded in batches once it is back. Spooled events go the way
+    of fresh ones; spooled live packets (the full sensor rate) are put on
+    the wall clock, from the batch's offset for the running boot and from
+    the last spooled sync for earlier ones, and go to on_backlog oldest
+    first, bypassing the live sequence tracking.
+
+A slow plot therefore delays nothing but its own report.
+
+Usage:
+    python ingest_server.py [--workers N]
+    # or, from code:
+    server = IngestServer(on_live=consume)     # consume(racquet, packet)
+    server = IngestServer(on_phase=cue)        # cue(racquet, mark), mark["t"] wall ms
+    server = IngestServer(on_backlog=catch_up) # catch_up(racquet, packet), offline samples
+    asyncio.run(server.serve())
+
+    # retune racquet 0x1a2b for a session, no reflash
+    curl -d '{"sensor_rate_hz": 200, "pre_samples": 60, "live_level": "auto"}' \
+        http://localhost:7103/config/0x1a2b
+    curl http://localhost:7103/config/0x1a2b
+"""
+
+import argparse
+import asyncio
+import itertools
+import json
+import os
+import time
+from concurrent.futures import ProcessPoolExecutor
+from datetime import datetime
+
+from clock_sync import ClockSync
+from live_sequence import LiveSequenceTracker, LiveReorderBuffer
+from session_store import SessionWriter
+from swing_events import process_event
+from wire_format import (parse_payload, encode_nack, encode_config, packet_type,
+                         set_event_wall_offset, WireFormatError, CFG_OK, TRANSPORTS,
+                         LIVE_LEVEL_AUTO, PKT_BACKLOG)
+
+HTTP_PORT = 7103
+LIVE_UDP_PORT = 7104
+NACK_POLL_S = 0.05          # NACK and reorder-timeout cadence
+PRINT_LIVE_EVERY = 100      # per racquet, in live packets
+MAX_HEADER_BYTES = 16 * 1024
+MAX_EVENT_BODY = 4 * 1024 * 1024
+MAX_CONFIG_BODY = 4096
+VIDEO_DIR = "videos"
+SESSION_DIR = "swing_data"
+VIDEO_CHUNK = 256 * 1024
+
+
+class HttpError(Exception):
+    def __init__(self, status, reason):
+        super().__init__(reason)
+        self.status = status
+        self.reason = reason
+
+
+class Racquet:
+    """Per-device state, created on the first packet carrying its device_id."""
+
+    def __init__(self, device_id):
+        self.device_id = device_id
+        self.addr = None            # where its live datagrams come from
+        self.tracker = LiveSequenceTracker()
+        self.clock = ClockSync()
+        self.reorder = LiveReorderBuffer()
+        self.live_packets = 0
+        self.live_samples = 0
+        self.events = 0
+        self.config = None          # last config ack
+        self.boot_offsets = {}      # boot_id -> wall - mono us, for spooled records
+        self.backlog_records = 0
+        self.first_seen = time.monotonic()
+        self.last_seen = self.first_seen
+
+    @property
+    def label(self):
+        return f"0x{self.device_id:04x}"
+
+    def live_rate(self):
+        elapsed = self.last_seen - self.first_seen
+        return self.live_samples / elapsed if elapsed > 0 else 0.0
+
+
+def print_stats(racquet, stats):
+    """One-line summary of a firmware heap/stack telemetry packet."""
+    tasks = " ".join(f"{t['name']}={t['stack_min_free']}/{t['stack_size']}"
+                     for t in stats.get("tasks", []))
+    print(f"[STATS {racquet.label}] "
+          f"up {stats['uptime_ms'] / 1000:.0f}s | "
+          f"heap free {stats['free_heap']} (min {stats['min_free_heap']}, "
+          f"largest {stats['largest_free_block']}) | "
+          f"arena {stats['arena_used']}/{stats['arena_size']} | "
+          f"dropped live={stats['live_dropped']} events={stats['events_dropped']} | "
+          f"pending {stats['events_pending']} | stack free: {tasks}")
+    if "live_nacked" in stats:
+        rate = f"{stats['live_rate_hz']} Hz, " if stats.get("live_rate_hz") else ""
+        print(f"           racquet live: {rate}{stats['live_nacked']} NACKed, "
+              f"{stats['live_retransmitted']} resent, "
+              f"{stats['live_unrecoverable']} unrecoverable")
+    if "sensor_gaps" in stats:
+        print(f"           racquet sensor: {stats['sensor_gaps']} report gaps "
+              f"(longest {stats['sensor_gap_max_us'] / 1000:.1f} ms)")
+    print(f"           server live: {racquet.tracker.summary()}, "
+          f"{racquet.reorder.held} held, {racquet.reorder.skipped} skipped")
+    if racquet.clock.synced:
+        print(f"           racquet clock: drift {racquet.clock.drift_ppm:+.1f} ppm, "
+              f"{racquet.clock.steps} wall steps")
+
+
+def print_config(racquet, ack):
+    """One-line summary of a config ack."""
+    level = ack["live_level"]
+    level = "auto" if level == LIVE_LEVEL_AUTO else f"level {level}"
+    kind = ack["transport"]
+    kind = TRANSPORTS[kind] if kind < len(TRANSPORTS) else kind
+    print(f"[CONFIG {racquet.label}] request {ack['request_id']} "
+          f"{'ok' if ack['status'] == CFG_OK else 'REJECTED'} | "
+          f"{ack['sensor_rate_hz']} Hz, window {ack['pre_samples']}+{ack['post_samples']}, "
+          f"live {level} | trigger gyro {ack['gyro_on']:.1f} energy "
+          f"{ack['energy_on']:.1f}/{ack['energy_off']:.1f} accel {ack['accel_on']:.1f} "
+          f"jerk {ack['jerk_on']:.0f} debounce {ack['debounce_ms']} ms | "
+          f"{kind} -> {ack['server_ip']}:{ack['http_port']}/{ack['udp_port']}")
+
+
+def print_profile(racquet, profile):
+    """Per-stage timing of the firmware data path, in microseconds."""
+    mhz = profile.get("cpu_mhz") or 1
+    parts = []
+    for st in profile.get("stages", []):
+        if not st["count"]:
+            continue
+        parts.append(f"{st['name']} {st['p50_cycles'] / mhz:.1f}/"
+                     f"{st['p99_cycles'] / mhz:.1f}/{st['max_cycles'] / mhz:.0f}")
+    print(f"           profile us p50/p99/max over {profile.get('window_ms', 0) / 1000:.1f}s: "
+          + (" | ".join(parts) if parts else "no samples"))
+
+
+class _LiveProtocol(asyncio.DatagramProtocol):
+    def __init__(self, server):
+        self.server = server
+
+    def connection_made(self, transport):
+        self.server.udp = transport
+
+    def datagram_received(self, data, addr):
+        self.server.on_datagram(data, addr)
+
+
+class IngestServer:
+    """HTTP + UDP ingest for any number of racquets on one event loop."""
+
+    def __init__(self, host="0.0.0.0", http_port=HTTP_PORT, udp_port=LIVE_UDP_PORT,
+                 workers=None, on_live=None, on_phase=None, on_backlog=None,
+                 session_dir=SESSION_DIR):
+        self.host = host
+        self.http_port = http_port
+        self.udp_port = udp_port
+        self.workers = workers or os.cpu_count() or 2
+        self.on_live = on_live      # called with (racquet, packet) in seq order
+        self.on_phase = on_phase    # called with (racquet, mark) as each arrives
+        self.on_backlog = on_backlog    # called with (racquet, packet), spooled live
+        self.session_dir = session_dir
+        self.session = None
+        self.racquets = {}
+        self.udp = None
+        self.pool = None
+        self._event_numbers = itertools.count(1)
+        self._config_ids = itertools.count(1)
+        self.events_pending = 0
+
+    def racquet(self, device_id):
+        r = self.racquets.get(device_id)
+        if r is None:
+            r = self.racquets[device_id] = Racquet(device_id)
+            print(f"[{datetime.now().strftime('%H:%M:%S')}] racquet {r.label} connected "
+                  f"({len(self.racquets)} active)")
+        return r
+
+    async def serve(self):
+        loop = asyncio.get_running_loop()
+        self.pool = ProcessPoolExecutor(max_workers=self.workers)
+        self.session = SessionWriter.create(self.session_dir)
+        await loop.create_datagram_endpoint(lambda: _LiveProtocol(self),
+                                            local_addr=(self.host, self.udp_port))
+        http = await asyncio.start_server(self._http_connection, self.host, self.http_port,
+                                          limit=MAX_HEADER_BYTES)
+        print(f"Ingest server: HTTP {self.host}:{self.http_port}, "
+              f"UDP {self.host}:{self.udp_port}, {self.workers} workers")
+        timer = asyncio.create_task(self._nack_loop())
+        try:
+            async with http:
+                await http.serve_forever()
+        finally:
+            timer.cancel()
+            self.pool.shutdown(wait=False, cancel_futures=True)
+            self.session.close()
+
+    # --- UDP ---
+
+    def on_datagram(self, data, addr):
+        try:
+            raw = parse_payload(data)
+        except (WireFormatError, ValueError):
+            return
+        if not isinstance(raw, dict):
+            raw = {"type": "live", "samples": raw}    # pre-header JSON firmware
+
+        racquet = self.racquet(raw.get("device_id", 0))
+        racquet.last_seen = time.monotonic()
+        racquet.addr = addr         # NACKs and config requests go back here
+        pkt_type = raw.get("type")
+        if pkt_type == "stats":
+            print_stats(racquet, raw)
+        elif pkt_type == "profile":
+            print_profile(racquet, raw)
+        elif pkt_type == "sync":
+            racquet.clock.on_sync(raw["mono_us"], raw["wall_us"])
+        elif pkt_type == "config_ack":
+            racquet.config = raw
+            print_config(racquet, raw)
+        elif pkt_type == "phase_mark":
+            self._on_phase_mark(racquet, raw)
+        elif pkt_type == "live":
+            self._on_live(racquet, raw, len(data))
+
+    def _on_live(self, racquet, raw, size):
+        samples = raw.get("samples", [])
+        racquet.live_packets += 1
+        racquet.live_samples += len(samples)
+        if "first_seq" not in raw:
+            self._deliver(racquet, raw)
+            return
+
+        t_us = samples[0].get("t_us") if samples else None
+        racquet.tracker.on_packet(raw["first_seq"], len(samples), t_us)
+        for packet in racquet.reorder.push(raw["first_seq"], len(samples), raw, t_us):
+            self._deliver(racquet, packet)
+
+        if racquet.live_packets % PRINT_LIVE_EVERY == 0:
+            print(f"[{datetime.now().strftime('%H:%M:%S.%f')[:-3]}] "
+                  f"LIVE {racquet.label} #{racquet.live_packets} | "
+                  f"{len(samples)} smp in {size} B | "
+                  f"Rate: {racquet.live_rate():.0f} smp/s | "
+                  f"Events: {racquet.events} | "
+                  f"{'complete' if racquet.tracker.complete else 'LOSSY'}")
+
+    def _on_phase_mark(self, racquet, mark):
+        mark["t"] = racquet.clock.wall_ms(mark["t_us"])
+        print(f"[PHASE {racquet.label}] swing {mark['swing_id']} {mark['mark']} | "
+              f"gyro {mark['gyro']:.1f} rad/s accel {mark['accel']:.1f} m/s2 | "
+              f"+{mark['detect_delay_us'] / 1000:.0f} ms to detect")
+        if self.on_phase is not None:
+            self.on_phase(racquet, mark)
+
+    def _deliver(self, racquet, packet):
+        # Put live samples on the wall clock through the racquet's drift fit
+        for s in packet.get("samples", ()):
+            if "t_us" in s:
+                s["t"] = racquet.clock.wall_ms(s["t_us"])
+        if self.on_live is not None:
+            self.on_live(racquet, packet)
+
+    async def _nack_loop(self):
+        # NACK gaps while the racquets' live rings still hold them, and let
+        # reorder buffers give up on holes that will not fill
+        while True:
+            await asyncio.sleep(NACK_POLL_S)
+            for racquet in list(self.racquets.values()):
+                if racquet.addr is not None and self.udp is not None:
+                    ranges = racquet.tracker.due_nacks()
+                    if ranges:
+                        self.udp.sendto(encode_nack(ranges, racquet.device_id), racquet.addr)
+                for packet in racquet.reorder.poll():
+                    self._deliver(racquet, packet)
+
+    # --- HTTP ---
+
+    async def _http_connection(self, reader, writer):
+        # Keep-alive: each racquet reuses one connection for every event POST
+        try:
+            while True:
+                try:
+                    head = await reader.readuntil(b"\r\n\r\n")
+                except asyncio.IncompleteReadError:
+                    return
+                except asyncio.LimitOverrunError:
+                    raise HttpError(431, "Request Header Fields Too Large")
+                method, path, headers = _parse_head(head)
+                if path.startswith("/config/"):
+                    await self._config_request(method, path, reader, writer, headers)
+                elif method != "POST":
+                    raise HttpError(405, "Method Not Allowed")
+                elif path == "/upload-video":
+                    await self._video_upload(reader, writer, headers)
+                else:
+                    body = await _read_body(reader, headers, MAX_EVENT_BODY)
+                    _respond(writer, 200, "OK", b"OK")
+                    if packet_type(body) == PKT_BACKLOG:
+                        self._on_backlog(body)
+                    else:
+                        self._submit_event(body)
+                await writer.drain()
+        except HttpError as e:
+            _respond(writer, e.status, e.reason, b"", close=True)
+            print(f"[WARN] HTTP {e.status} {e.reason}")
+        except (ConnectionError, asyncio.IncompleteReadError):
+            pass
+        finally:
+            writer.close()
+
+    def _on_backlog(self, body):
+        try:
+            backlog = parse_payload(body)
+        except (WireFormatError, ValueError) as e:
+            print(f"[WARN] Bad backlog packet: {e}")
+            return
+        racquet = self.racquet(backlog["device_id"])
+        racquet.last_seen = time.monotonic()
+        boot = backlog["boot_id"]
+        racquet.boot_offsets[boot] = backlog["wall_offset_us"]
+
+        live = samples = events = 0
+        bad = backlog["corrupt"]
+        for record in backlog["records"]:
+            try:
+                packet = parse_payload(record["data"])
+            except (WireFormatError, ValueError):
+                bad += 1
+                continue
+            kind = packet.get("type")
+            if kind == "sync":
+                # The running boot has the upload's own offset; earlier
+                # ones only what they spooled
+                if record["boot_id"] != boot:
+                    racquet.boot_offsets[record["boot_id"]] = (packet["wall_us"]
+                                                               - packet["mono_us"])
+            elif kind == "event":
+                events += 1
+                data = record["data"]
+                if record["boot_id"] == boot:
+                    data = set_event_wall_offset(data, backlog["wall_offset_us"])
+                self._submit_event(data)
+            elif kind == "live":
+                offset_us = racquet.boot_offsets.get(record["boot_id"])
+                for s in packet["samples"]:
+                    s["t"] = (s["t_us"] + offset_us) / 1000.0 if offset_us is not None else None
+                packet["boot_id"] = record["boot_id"]
+                live += 1
+                samples += len(packet["samples"])
+                if self.on_backlog is not None:
+                    self.on_backlog(racquet, packet)
+        racquet.backlog_records += len(backlog["records"])
+        print(f"[BACKLOG {racquet.label}] {len(backlog['records'])} records: "
+              f"{live} live ({samples} smp), {events} events | boot {boot} | "
+              f"{racquet.backlog_records} so far" + (f" | {bad} corrupt" if bad else ""))
+
+    def _submit_event(self, body):
+        number = next(self._event_numbers)
+        self.events_pending += 1
+        future = asyncio.get_running_loop().run_in_executor(self.pool, process_event,
+                                                            body, number)
+        future.add_done_callback(lambda f: self._event_done(f, body))
+
+    def _event_done(self, future, body):
+        self.events_pending -= 1
+        try:
+            report = future.result()
+        except (WireFormatError, ValueError) as e:
+            print(f"[WARN] Bad sensor packet: {e}")
+            return
+        except Exception as e:
+            print(f"[ERROR] Event processing failed: {e!r}")
+            return
+        self.racquet(report["device_id"]).events += 1
+        try:
+            self.session.append_event(body, report["result"], report["event_number"])
+            saved = f"  IMU data saved: {self.session.base_path} event {report['event_number']}"
+        except Exception as e:
+            saved = f"  [ERROR] Session append failed: {e!r}"
+        print(report["text"])
+        print(saved)
+        print(f"{'='*70}\n")
+        if self.events_pending:
+            print(f"  ({self.events_pending} events still processing)")
+
+    async def _config_request(self, method, path, reader, writer, headers):
+        """POST: send a settings change. GET: the last ack, plus a query."""
+        try:
+            racquet = self.racquets[int(path[len("/config/"):], 0)]
+        except (KeyError, ValueError):
+            raise HttpError(404, "Not Found")
+        if racquet.addr is None or self.udp is None:
+            raise HttpError(503, "Service Unavailable")
+        if method == "POST":
+            try:
+                settings = json.loads(await _read_body(reader, headers, MAX_CONFIG_BODY))
+                if not isinstance(settings, dict):
+                    raise ValueError("expected a JSON object")
+                request_id = next(self._config_ids) & 0xFFFF
+                packet = encode_config(settings, request_id, racquet.device_id,
+                                       base=racquet.config)
+            except ValueError as e:
+                body = json.dumps({"status": "error", "message": str(e)}).encode()
+                _respond(writer, 400, "Bad Request", body, "application/json")
+                return
+            self.udp.sendto(packet, racquet.addr)
+            body = json.dumps({"status": "sent", "request_id": request_id}).encode()
+            _respond(writer, 202, "Accepted", body, "application/json")
+        elif method == "GET":
+            request_id = next(self._config_ids) & 0xFFFF
+            self.udp.sendto(encode_config({}, request_id, racquet.device_id), racquet.addr)
+            _respond(writer, 200, "OK", json.dumps(racquet.config).encode(),
+                     "application/json")
+        else:
+            raise HttpError(405, "Method Not Allowed")
+
+    async def _video_upload(self, reader, writer, headers):
+        """Stream a phone video upload to disk without buffering it whole."""
+        loop = asyncio.get_running_loop()
+        try:
+            length = int(headers["content-length"])
+        except (KeyError, ValueError):
+            raise HttpError(411, "Length Required")
+        filename = os.path.basename(headers.get("x-filename", "")) or \
+            f"video_{int(time.time() * 1000)}.mp4"
+        os.makedirs(VIDEO_DIR, exist_ok=True)
+        filepath = os.path.join(VIDEO_DIR, filename)
+        try:
+            with open(filepath, "wb") as f:
+                remaining = length
+                while remaining > 0:
+                    chunk = await reader.readexactly(min(VIDEO_CHUNK, remaining))
+                    await loop.run_in_executor(None, f.write, chunk)
+                    remaining -= len(chunk)
+        except OSError as e:
+            body = json.dumps({"status": "error", "message": str(e)}).encode()
+            _respond(writer, 500, "Internal Server Error", body, "application/json")
+            print(f"\n[ERROR] Video upload failed: {e}")
+            return
+        body = json.dumps({"status": "success", "filename": filename,
+                           "size": length, "path": filepath}).encode()
+        _respond(writer, 200, "OK", body, "application/json")
+        print(f"\n[{datetime.now().strftime('%H:%M:%S')}] VIDEO UPLOADED: {filename} "
+              f"({length / 1024 / 1024:.2f} MB)")
+
+
+def _parse_head(head):
+    lines = head.decode("latin-1").split("\r\n")
+    try:
+        method, path, _version = lines[0].split(" ", 2)
+    except ValueError:
+        raise HttpError(400, "Bad Request")
+    headers = {}
+    for line in lines[1:]:
+        if ":" in line:
+            k, v = line.split(":", 1)
+            headers[k.strip().lower()] = v.strip()
+    return method, path, headers
+
+
+async def _read_body(reader, headers, limit):
+    """Request body, honouring chunked transfer coding (JSON events are
+    streamed by the firmware without a Content-Length)."""
+    if "chunked" in headers.get("transfer-encoding", "").lower():
+        body = bytearray()
+        while True:
+            try:
+                size = int((await reader.readline()).split(b";", 1)[0].strip(), 16)
+            except ValueError:
+                raise HttpError(400, "Bad Request")
+            if size == 0:
+                # Skip optional trailers up to the terminating blank line
+                while await reader.readline() not in (b"\r\n", b"\n", b""):
+                    pass
+                return bytes(body)
+            if len(body) + size > limit:
+                raise HttpError(413, "Payload Too Large")
+            body += await reader.readexactly(size)
+            await reader.readline()  # CRLF after each chunk
+    try:
+        length = int(headers["content-length"])
+    except (KeyError, ValueError):
+        raise HttpError(411, "Length Required")
+    if length > limit:
+        raise HttpError(413, "Payload Too Large")
+    return await reader.readexactly(length)
+
+
+def _respond(writer, status, reason, body, content_type=None, close=False):
+    # Every response carries a Content-Length so the racquet can keep the
+    # connection open
+    head = [f"HTTP/1.1 {status} {reason}", f"Content-Length: {len(body)}"]
+    if content_type:
+        head.append(f"Content-Type: {content_type}")
+    if close:
+        head.append("Connection: close")
+    writer.write(("\r\n".join(head) + "\r\n\r\n").encode("latin-1") + body)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--workers", type=int, default=None,
+                        help="analysis/plot processes (default: one per CPU)")
+    args = parser.parse_args(argv)
+    print(f"  Sensor Data (POST /, UDP {LIVE_UDP_PORT}): any number of racquets, "
+          f"keyed by device ID")
+    print(f"  Video Upload (POST /upload-video): Accept MP4/MOV files from phone")
+    print(f"  Racquet settings (GET/POST /config/<device_id>): applied live, kept in NVS")
+    print(f"Waiting for data...\n")
+    try:
+        asyncio.run(IngestServer(workers=args.workers).serve())
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
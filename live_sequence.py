@@ -0,0 +1,222 @@
+"""
+Sequence tracking for the racquet's live UDP stream.
+
+Every live packet carries first_seq and a sample count, and live sample
+numbers are consecutive, so a jump in first_seq is a lost datagram. The
+tracker records the missing numbers, decides when to NACK them (the racquet
+resends from its live ring while the samples are still there), and keeps the
+loss / reorder counters that say whether a session arrived complete.
+
+Only the last LIVE_RETRANSMIT_WINDOW samples of a gap are asked for: older
+ones have left the racquet's live ring. A gap that long is a link outage,
+which the racquet spools to flash and uploads as a BACKLOG packet, so those
+samples are counted as `beyond_ring` rather than lost.
+
+A racquet that reboots starts over at seq 0 on a clock that starts over at
+0. Both objects pass over to the new run when a packet's first sample time
+jumps back (t_us, from the packet itself) or its seq is back near 0.
+
+Usage:
+    tracker = LiveSequenceTracker()
+    tracker.on_packet(first_seq, count, t_us)
+    for first, count in tracker.due_nacks():
+        sock.sendto(encode_nack(...), addr)
+"""
+
+import time
+
+NACK_RETRY_S = 0.1          # re-ask for a gap this often
+NACK_MAX_TRIES = 3          # then count it as lost
+LIVE_RETRANSMIT_WINDOW = 256    # racquet's LIVE_RING_SIZE (main.cpp)
+RESTART_T_BACK_US = 5_000_000   # first sample this much older than the newest: rebooted
+RESTART_SEQ = 16 * LIVE_RETRANSMIT_WINDOW   # "near 0" for a restarted seq
+RESET_GAP = 100_000         # a seq jump this far back means the racquet rebooted
+
+
+def is_restart(expected, newest_t_us, first_seq, t_us):
+    """True if a packet at (first_seq, t_us) comes from a new run of the
+    racquet rather than the one that got the stream to `expected`.
+
+    Retransmits and reordered packets come from the live ring, so they are
+    never more than a ring's worth of samples (about a second) old.
+    """
+    if expected is None:
+        return False
+    if t_us is not None and newest_t_us is not None and t_us < newest_t_us - RESTART_T_BACK_US:
+        return True
+    back = expected - first_seq
+    if first_seq < RESTART_SEQ and back > LIVE_RETRANSMIT_WINDOW:
+        return True
+    return back > RESET_GAP
+
+
+class LiveSequenceTracker:
+    """Gap, loss and reorder bookkeeping for one racquet's live stream."""
+
+    def __init__(self):
+        self.restarts = 0
+        self.reset()
+
+    def reset(self):
+        self.expected = None        # next seq we have not seen yet
+        self.newest_t_us = None     # latest first-sample time seen
+        # seq -> [times NACKed, last NACK time]. Gaps only ever open past
+        # every seq already here, so insertion order is seq order.
+        self.missing = {}
+        self.received = 0           # samples received (first copies)
+        self.gaps = 0               # holes opened in the sequence
+        self.recovered = 0          # missing samples filled by a retransmit
+        self.reordered = 0          # missing samples that arrived late on their own
+        self.duplicates = 0
+        self.lost = 0               # given up on after NACK_MAX_TRIES
+        self.beyond_ring = 0        # gap samples too old to NACK (left to the backlog)
+        self.restarts = 0           # racquet reboots seen (kept across reset())
+
+    def on_packet(self, first_seq, count, t_us=None, now=None):
+        """Account for a live packet holding samples [first_seq, first_seq + count),
+        the first taken at t_us on the racquet's clock."""
+        if count <= 0:
+            return
+        now = time.monotonic() if now is None else now
+
+        if is_restart(self.expected, self.newest_t_us, first_seq, t_us):
+            restarts = self.restarts + 1
+            self.reset()
+            self.restarts = restarts
+        if self.expected is None:
+            self.expected = first_seq
+
+        if first_seq > self.expected:
+            self.gaps += 1
+            nack_from = max(self.expected, first_seq - LIVE_RETRANSMIT_WINDOW)
+            self.beyond_ring += nack_from - self.expected
+            for seq in range(nack_from, first_seq):
+                # First NACK goes out on the next due_nacks() call
+                self.missing[seq] = [0, now - NACK_RETRY_S]
+
+        for seq in range(first_seq, first_seq + count):
+            if seq >= self.expected:
+                self.received += 1
+            elif seq in self.missing:
+                tries, _ = self.missing.pop(seq)
+                self.received += 1
+                if tries > 0:
+                    self.recovered += 1
+                else:
+                    self.reordered += 1
+            else:
+                self.duplicates += 1
+
+        if first_seq + count > self.expected:
+            self.expected = first_seq + count
+            if t_us is not None:
+                self.newest_t_us = t_us
+
+    def due_nacks(self, now=None, max_ranges=16):
+        """(first_seq, count) ranges to NACK now; gives up on stale gaps."""
+        now = time.monotonic() if now is None else now
+        ranges = []
+        for seq, entry in list(self.missing.items()):
+            if now - entry[1] < NACK_RETRY_S:
+                continue
+            if entry[0] >= NACK_MAX_TRIES:
+                del self.missing[seq]
+                self.lost += 1
+                continue
+            if ranges and ranges[-1][0] + ranges[-1][1] == seq and ranges[-1][1] < 0xFFFF:
+                ranges[-1][1] += 1
+            elif len(ranges) < max_ranges:
+                ranges.append([seq, 1])
+            else:
+                continue            # next round
+            entry[0] += 1
+            entry[1] = now
+        return [tuple(r) for r in ranges]
+
+    @property
+    def complete(self):
+        """True if every sample so far has arrived, directly or by retransmit."""
+        return self.lost == 0 and not self.missing
+
+    def summary(self):
+        state = "complete" if self.complete else "LOSSY"
+        return (f"{state}: {self.received} smp, {self.gaps} gaps, "
+                f"{self.recovered} recovered, {self.reordered} reordered, "
+                f"{self.duplicates} dup, {len(self.missing)} pending, {self.lost} lost, "
+                f"{self.beyond_ring} beyond ring, {self.restarts} restarts")
+
+
+REORDER_HOLD_S = NACK_RETRY_S * (NACK_MAX_TRIES + 1)    # time a NACK gets to fill a hole
+REORDER_MAX_PACKETS = 64
+
+
+class LiveReorderBuffer:
+    """Hands live packets on in first_seq order.
+
+    Packets after a hole are held until the hole is filled (usually by a
+    NACK retransmit) or has been open REORDER_HOLD_S, then released; a hole
+    given up on is counted in `skipped`.
+
+    Usage:
+        buf = LiveReorderBuffer()
+        for packet in buf.push(first_seq, count, packet, t_us):
+            consume(packet)
+        for packet in buf.poll():
+            consume(packet)
+    """
+
+    def __init__(self, hold_s=REORDER_HOLD_S, max_packets=REORDER_MAX_PACKETS):
+        self.hold_s = hold_s
+        self.max_packets = max_packets
+        self.reset()
+
+    def reset(self):
+        self.next_seq = None        # first seq not handed on yet
+        self.newest_t_us = None     # latest first-sample time seen
+        self.pending = {}           # first_seq -> (count, item, arrival time)
+        self.held = 0               # packets that had to wait for a hole
+        self.skipped = 0            # samples never filled in
+        self.late = 0               # packets that arrived after their hole was skipped
+
+    def push(self, first_seq, count, item, t_us=None, now=None):
+        """Add a packet (first sample at t_us); returns the items now ready,
+        in order. A racquet restart hands on what was held first."""
+        now = time.monotonic() if now is None else now
+        out = []
+        horizon = self.next_seq
+        if self.pending:
+            horizon = max(horizon, max(f + c for f, (c, _, _) in self.pending.items()))
+        if is_restart(horizon, self.newest_t_us, first_seq, t_us):
+            out = [item for _, (_, item, _) in sorted(self.pending.items())]
+            self.reset()
+        if self.next_seq is None:
+            self.next_seq = first_seq
+        if count <= 0 or first_seq + count <= self.next_seq:
+            self.late += 1
+            return out
+        if first_seq > self.next_seq:
+            self.held += 1
+        if t_us is not None and (self.newest_t_us is None or t_us > self.newest_t_us):
+            self.newest_t_us = t_us
+        self.pending[first_seq] = (count, item, now)
+        return out + self._drain(now)
+
+    def poll(self, now=None):
+        """Items released because the hole they waited on timed out."""
+        if not self.pending:
+            return []
+        return self._drain(time.monotonic() if now is None else now)
+
+    def _drain(self, now):
+        out = []
+        while self.pending:
+            first = min(self.pending)
+            count, item, arrived = self.pending[first]
+            if first > self.next_seq:
+                if now - arrived < self.hold_s and len(self.pending) <= self.max_packets:
+                    break
+                self.skipped += first - self.next_seq
+            del self.pending[first]
+            out.append(item)
+            self.next_seq = max(self.next_seq, first + count)
+        return out
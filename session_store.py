@@ -0,0 +1,283 @@
+"""
+Append-only columnar session files for swing events.
+
+A session is two files next to each other in swing_data/:
+
+    <name>.swd   data: a 16-byte file header, then one block per event
+    <name>.swi   index: a 16-byte file header, then one fixed-size record
+                 per event (INDEX_REC), in arrival order
+
+Event block (every part 8-byte aligned):
+
+    block header (BLOCK_HDR) | dt_us u32[count]
+                             | six channel columns, gyro xyz then accel xyz
+                             | analysis result (UTF-8 JSON)
+
+Channels keep the type the racquet sent them in: int16 Q-points for Q16
+events (scale in the block header), float32 otherwise. Columns are copied
+out of the firmware's binary packet with strided slices
+(wire_format.decode_event_columns), never through per-sample dicts.
+
+Both files are only ever appended to, data first, so an index record never
+points past the data a reader can see. Readers mmap the files and hand out
+memoryviews into them, so loading a session copies nothing and the latest
+swing is the last index record: O(1) however long the session runs.
+
+Usage:
+    writer = SessionWriter.create("swing_data")
+    writer.append_event(body, result, event_number)
+
+    session = open_latest_session("swing_data")
+    session.latest_result()                 # dict, or None for an empty session
+    ev = session.event(-1)
+    ev.channel("gyro_x")                    # memoryview, zero-copy
+"""
+
+import json
+import mmap
+import os
+import struct
+import time
+from array import array
+
+from wire_format import AXES, ENC_F32, decode_event_columns, is_binary, parse_payload
+
+DATA_MAGIC = b"SWSD"
+INDEX_MAGIC = b"SWSI"
+SESSION_VERSION = 1
+LATEST_POINTER = "latest_session"       # holds the current session's name
+
+_FILE_HDR = struct.Struct("<4sHHQ")     # magic, version, record size, created (Unix s)
+# magic, block_len, count, device_id, rate_hz, encoding, channel itemsize,
+# result_len, base_t_us, wall_offset_us, trigger_t_us, gyro scale, accel scale,
+# reserved
+BLOCK_HDR = struct.Struct("<4sIIHHBBHqqqffI")
+# data offset, block_len, event_number, count, device_id, rate_hz, valid,
+# encoding, trigger_t_us, wall_offset_us, peak gyro, peak accel,
+# swing duration ms, peak time ms (from the first sample)
+INDEX_REC = struct.Struct("<QIIHHHBBqqffff")
+
+RESULT_ARRAYS = ("t_ms", "gyro_mag", "accel_mag", "raw_gyro_mag")   # recomputable, not stored
+
+
+def _pad8(n):
+    return (n + 7) & ~7
+
+
+def _columns_from_json(raw):
+    """Columns of an event that arrived as JSON (WIRE_FORMAT_JSON firmware)."""
+    samples = raw.get("samples", [])
+    base = samples[0]["t_us"] if samples else 0
+    axes = [array("f", (s[k][a] for s in samples))
+            for k in ("gyro", "accel") for a in ("x", "y", "z")]
+    return {"device_id": raw.get("device_id", 0), "rate_hz": raw.get("rate_hz", 0),
+            "encoding": ENC_F32, "base_t_us": base,
+            "trigger_t_us": raw.get("trigger_t_us", 0),
+            "wall_offset_us": raw.get("wall_offset_us", 0),
+            "dt_us": array("I", (s["t_us"] - base for s in samples)),
+            "axes": axes, "scales": (1.0, 1.0)}
+
+
+def _summary(result):
+    return {k: v for k, v in result.items() if k not in RESULT_ARRAYS}
+
+
+class SessionWriter:
+    """Appends events to one session. Single writer: the ingest server's loop."""
+
+    def __init__(self, base_path):
+        self.base_path = base_path
+        new = not os.path.exists(base_path + ".swi")
+        self._data = open(base_path + ".swd", "ab")
+        self._index = open(base_path + ".swi", "ab")
+        if new:
+            now = int(time.time())
+            self._data.write(_FILE_HDR.pack(DATA_MAGIC, SESSION_VERSION, 0, now))
+            self._index.write(_FILE_HDR.pack(INDEX_MAGIC, SESSION_VERSION,
+                                             INDEX_REC.size, now))
+            self._data.flush()
+            self._index.flush()
+        self.offset = self._data.tell()
+
+    @classmethod
+    def create(cls, directory, name=None):
+        """Start a new session in `directory` and point LATEST_POINTER at it."""
+        os.makedirs(directory, exist_ok=True)
+        name = name or time.strftime("session_%Y%m%d_%H%M%S")
+        writer = cls(os.path.join(directory, name))
+        tmp = os.path.join(directory, LATEST_POINTER + ".tmp")
+        with open(tmp, "w") as f:
+            f.write(name)
+        os.replace(tmp, os.path.join(directory, LATEST_POINTER))
+        return writer
+
+    def append_event(self, body, result, event_number):
+        """Append one event from its raw POST body and its analysis result."""
+        if is_binary(body):
+            cols = decode_event_columns(body)
+        else:
+            cols = _columns_from_json(parse_payload(body))
+        count = len(cols["dt_us"])
+        itemsize = cols["axes"][0].itemsize
+        result_json = json.dumps(_summary(result)).encode()
+
+        col_len = _pad8(count * itemsize)
+        block_len = (BLOCK_HDR.size + _pad8(count * 4) + 6 * col_len
+                     + _pad8(len(result_json)))
+        block = bytearray(block_len)
+        BLOCK_HDR.pack_into(block, 0, b"EVT1", block_len, count, cols["device_id"],
+                            cols["rate_hz"], cols["encoding"], itemsize, len(result_json),
+                            cols["base_t_us"], cols["wall_offset_us"],
+                            cols["trigger_t_us"], *cols["scales"], 0)
+        pos = BLOCK_HDR.size
+        block[pos:pos + count * 4] = cols["dt_us"].tobytes()
+        pos += _pad8(count * 4)
+        for col in cols["axes"]:
+            block[pos:pos + count * itemsize] = col.tobytes()
+            pos += col_len
+        block[pos:pos + len(result_json)] = result_json
+
+        phases = result.get("phases") or {}
+        peak_ms = 0.0
+        if phases and count:
+            t_first = (cols["base_t_us"] + cols["wall_offset_us"]) / 1000.0
+            peak_ms = phases["peak"]["t_ms"] - t_first
+        rec = INDEX_REC.pack(self.offset, block_len, event_number, count,
+                             cols["device_id"], cols["rate_hz"], 1 if phases else 0,
+                             cols["encoding"], cols["trigger_t_us"], cols["wall_offset_us"],
+                             result.get("peak_gyro_rad_s", 0.0),
+                             result.get("peak_accel_m_s2", 0.0),
+                             result.get("swing_duration_ms", 0.0), peak_ms)
+
+        # Data before index, so readers never see a record past the data
+        self._data.write(block)
+        self._data.flush()
+        self._index.write(rec)
+        self._index.flush()
+        self.offset += block_len
+
+    def close(self):
+        self._data.close()
+        self._index.close()
+
+
+class EventView:
+    """One event of a mapped session; channels are views into the mapping."""
+
+    def __init__(self, session, rec):
+        (self.offset, self.block_len, self.event_number, self.count, self.device_id,
+         self.rate_hz, valid, self.encoding, self.trigger_t_us, self.wall_offset_us,
+         self.peak_gyro_rad_s, self.peak_accel_m_s2, self.swing_duration_ms,
+         self.peak_ms) = rec
+        self.valid = bool(valid)
+        buf = session._data_view(self.offset + self.block_len)
+        (_magic, _len, _count, _dev, _rate, _enc, self.itemsize, self._result_len,
+         self.base_t_us, _wall, _trig, self.gyro_scale, self.accel_scale,
+         _reserved) = BLOCK_HDR.unpack_from(buf, self.offset)
+        self._buf = buf
+
+    def _slice(self, pos, nbytes, code):
+        return self._buf[pos:pos + nbytes].cast(code)
+
+    @property
+    def dt_us(self):
+        """Sample offsets from base_t_us (monotonic), uint32."""
+        return self._slice(self.offset + BLOCK_HDR.size, self.count * 4, "I")
+
+    def channel(self, name):
+        """Raw column of one axis (AXES order); multiply by scale() for units."""
+        a = AXES.index(name)
+        pos = (self.offset + BLOCK_HDR.size + _pad8(self.count * 4)
+               + a * _pad8(self.count * self.itemsize))
+        return self._slice(pos, self.count * self.itemsize,
+                           "h" if self.itemsize == 2 else "f")
+
+    def scale(self, name):
+        return self.gyro_scale if name.startswith("gyro") else self.accel_scale
+
+    @property
+    def result(self):
+        """The analysis result as written (plot arrays left out)."""
+        pos = self.offset + self.block_len - _pad8(self._result_len)
+        return json.loads(bytes(self._buf[pos:pos + self._result_len]))
+
+
+class Session:
+    """Read side of a session, mmapped; picks up events appended meanwhile."""
+
+    def __init__(self, base_path):
+        self.base_path = base_path
+        self._data_f = open(base_path + ".swd", "rb")
+        self._index_f = open(base_path + ".swi", "rb")
+        self._data = self._index = None
+        self._data_len = self._index_len = 0
+        self.refresh()
+        magic, version, rec_size, self.created = _FILE_HDR.unpack_from(self._index, 0)
+        if magic != INDEX_MAGIC or version != SESSION_VERSION or rec_size != INDEX_REC.size:
+            raise ValueError(f"{base_path}: not a version {SESSION_VERSION} session")
+
+    @staticmethod
+    def _map(f):
+        size = os.fstat(f.fileno()).st_size
+        return (mmap.mmap(f.fileno(), size, access=mmap.ACCESS_READ) if size else b""), size
+
+    def refresh(self):
+        """Remap if the writer appended since the last look (one fstat)."""
+        if os.fstat(self._index_f.fileno()).st_size != self._index_len:
+            self._index, self._index_len = self._map(self._index_f)
+
+    def _data_view(self, needed):
+        if self._data_len < needed:
+            self._data, self._data_len = self._map(self._data_f)
+        return memoryview(self._data)
+
+    def __len__(self):
+        # Events as of the last refresh()
+        return max(0, (self._index_len - _FILE_HDR.size) // INDEX_REC.size)
+
+    def record(self, i):
+        """Index record i (negative counts from the end) as a tuple."""
+        n = len(self)
+        if i < 0:
+            i += n
+        if not 0 <= i < n:
+            raise IndexError(i)
+        return INDEX_REC.unpack_from(self._index, _FILE_HDR.size + i * INDEX_REC.size)
+
+    def event(self, i):
+        return EventView(self, self.record(i))
+
+    def summaries(self):
+        """Index fields of every event, read in place without touching the
+        event blocks: a whole session's scalars in one pass."""
+        self.refresh()
+        end = _FILE_HDR.size + len(self) * INDEX_REC.size
+        view = memoryview(self._index)[_FILE_HDR.size:end]
+        return [{"event_number": r[2], "device_id": r[4], "count": r[3],
+                 "rate_hz": r[5], "valid": bool(r[6]),
+                 "trigger_t_ms": (r[8] + r[9]) / 1000.0,
+                 "peak_gyro_rad_s": r[10], "peak_accel_m_s2": r[11],
+                 "swing_duration_ms": r[12], "peak_ms": r[13]}
+                for r in INDEX_REC.iter_unpack(view)]
+
+    def latest_result(self):
+        """Analysis result of the most recent swing, or None."""
+        self.refresh()
+        return self.event(-1).result if len(self) else None
+
+    def close(self):
+        for m in (self._data, self._index):
+            if isinstance(m, mmap.mmap):
+                m.close()
+        self._data_f.close()
+        self._index_f.close()
+
+
+def open_latest_session(directory):
+    """The session LATEST_POINTER names, or None if there is none yet."""
+    try:
+        with open(os.path.join(directory, LATEST_POINTER)) as f:
+            name = f.read().strip()
+        return Session(os.path.join(directory, name))
+    except (OSError, ValueError):
+        return None
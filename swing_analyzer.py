@@ -9,13 +9,18 @@ Usage:
 
     result = analyze_swing(samples)
     # samples = [{"t": ms, "gyro": {"x","y","z"}, "accel": {"x","y","z"}}, ...]
+
+For whole sessions, swing_batch.py stacks events into blocks for
+analyze_batch(), which analyze_swing() itself calls with one row.
 """
 
+from functools import lru_cache
+
 import numpy as np
 from scipy.signal import butter, sosfiltfilt, find_peaks
 
 # ── Filter parameters ──────────────────────────────────────────────────
-SAMPLE_RATE_HZ = 400
+SAMPLE_RATE_HZ = 400    # nominal; the actual rate comes from the timestamps
 CUTOFF_HZ = 30          # low-pass cutoff
 FILTER_ORDER = 2
 
@@ -24,15 +29,32 @@ ACCEL_DERIV_THRESH = 0.05   # fraction of peak derivative to mark acceleration s
 DECEL_DERIV_THRESH = 0.05   # fraction of peak negative derivative to mark decel end
 MIN_PEAK_GYRO_RAD = 1.0     # ignore swings below this gyro magnitude (rad/s)
 DECEL_ACCEL_THRESH = 30.0   # deceleration ends when accel mag drops below this (m/s²)
+MIN_SAMPLES = 10            # fewer is not an event worth segmenting
+UNFILTERED_BELOW = 15       # sosfiltfilt needs this many samples of padding
 
 
-def _build_filter():
-    """Pre-compute Butterworth second-order sections."""
-    nyq = SAMPLE_RATE_HZ / 2.0
-    sos = butter(FILTER_ORDER, CUTOFF_HZ / nyq, btype="low", output="sos")
+@lru_cache(maxsize=8)
+def _build_filter(rate_hz=SAMPLE_RATE_HZ):
+    """Butterworth second-order sections for one sample rate."""
+    nyq = rate_hz / 2.0
+    cutoff = min(CUTOFF_HZ, 0.9 * nyq)
+    sos = butter(FILTER_ORDER, cutoff / nyq, btype="low", output="sos")
     return sos
 
-_SOS = _build_filter()
+
+def _sample_rates(t_ms):
+    """Sample rate of every row (E x N timestamps) from its median spacing,
+    rounded to 1 Hz.
+
+    Timestamps are the racquet's own microsecond clock, so the spacing is
+    the real one, not SAMPLE_RATE_HZ's nominal 2.5 ms.
+    """
+    if t_ms.shape[1] < 2:
+        return np.full(t_ms.shape[0], SAMPLE_RATE_HZ)
+    dt = np.median(np.diff(t_ms, axis=1), axis=1)
+    with np.errstate(divide="ignore"):
+        rates = np.maximum(1, np.round(1000.0 / dt))
+    return np.where(dt > 0, rates, SAMPLE_RATE_HZ).astype(int)
 
 
 def _extract_arrays(samples):
@@ -50,65 +72,109 @@ def _extract_arrays(samples):
     return t, gyro, accel
 
 
-def _smooth(signal):
-    """Apply zero-phase Butterworth low-pass filter."""
-    if len(signal) < 15:          # sosfiltfilt needs padding
+def _smooth(signal, rate_hz=SAMPLE_RATE_HZ):
+    """Apply zero-phase Butterworth low-pass filter (along the last axis,
+    so a 2-D array smooths every row at once)."""
+    if signal.shape[-1] < UNFILTERED_BELOW:
         return signal.copy()
-    return sosfiltfilt(_SOS, signal)
+    return sosfiltfilt(_build_filter(rate_hz), signal, axis=-1)
 
 
-def _find_phase_boundaries(t_ms, gyro_mag_smooth, accel_mag_smooth):
-    """
-    Return phase boundary timestamps using gyro magnitude for the peak and
-    acceleration start, and accel magnitude for the deceleration end.
-
-    Returns dict with keys:
-        accel_start_ms, peak_ms, decel_end_ms
-    or None if no valid swing detected.
-    """
-    # Find the dominant peak in the smoothed gyro magnitude
+def _dominant_peak(gyro_mag_smooth, rate_hz=SAMPLE_RATE_HZ):
+    """Index of the tallest qualifying peak of the smoothed gyro magnitude,
+    or None if no valid swing detected."""
     peaks, props = find_peaks(
         gyro_mag_smooth,
         height=MIN_PEAK_GYRO_RAD,
         prominence=MIN_PEAK_GYRO_RAD * 0.3,
-        distance=int(SAMPLE_RATE_HZ * 0.05),           # at least 50 ms apart
+        distance=max(1, int(rate_hz * 0.05)),          # at least 50 ms apart
     )
 
     if len(peaks) == 0:
         return None
+    return peaks[np.argmax(props["peak_heights"])]
 
-    # Pick the tallest peak
-    best = peaks[np.argmax(props["peak_heights"])]
-    peak_ms = t_ms[best]
-
-    # ── Acceleration start: walk left from peak until gyro mag drops
-    #    below a fraction of the peak value ──
-    peak_val = gyro_mag_smooth[best]
-    accel_thresh = peak_val * 0.10   # 10% of peak
-    accel_start_idx = 0
-    for i in range(best - 1, -1, -1):
-        if gyro_mag_smooth[i] < accel_thresh:
-            accel_start_idx = i
-            break
-
-    # ── Deceleration end: walk right from peak until accel magnitude
-    #    drops below DECEL_ACCEL_THRESH (m/s²) ──
-    decel_end_idx = len(accel_mag_smooth) - 1
-    for i in range(best + 1, len(accel_mag_smooth)):
-        if accel_mag_smooth[i] < DECEL_ACCEL_THRESH:
-            decel_end_idx = i
-            break
 
+def _boundary_dict(t_ms, accel_start_idx, peak_idx, decel_end_idx):
     return {
         "accel_start_idx": int(accel_start_idx),
-        "peak_idx": int(best),
+        "peak_idx": int(peak_idx),
         "decel_end_idx": int(decel_end_idx),
         "accel_start_ms": float(t_ms[accel_start_idx]),
-        "peak_ms": float(peak_ms),
+        "peak_ms": float(t_ms[peak_idx]),
         "decel_end_ms": float(t_ms[decel_end_idx]),
     }
 
 
+def _walk_boundaries(gyro_mag_smooth, accel_mag_smooth, best):
+    """
+    Acceleration start and deceleration end indices of every row (E x N),
+    walking out from each row's gyro peak index in best.
+
+    The acceleration start is the last index left of the peak where gyro
+    magnitude is below 10% of the peak (else 0); the deceleration end is
+    the first right of it where accel magnitude is below
+    DECEL_ACCEL_THRESH m/s² (else the last).
+    """
+    n = gyro_mag_smooth.shape[1]
+    idx = np.arange(n)
+    peak = best[:, None]
+    peak_val = np.take_along_axis(gyro_mag_smooth, peak, axis=1)
+
+    below = (gyro_mag_smooth < peak_val * 0.10) & (idx < peak)
+    starts = np.where(below.any(axis=1), n - 1 - np.argmax(below[:, ::-1], axis=1), 0)
+
+    settled = (accel_mag_smooth < DECEL_ACCEL_THRESH) & (idx > peak)
+    ends = np.where(settled.any(axis=1), np.argmax(settled, axis=1), n - 1)
+    return starts, ends
+
+
+def analyze_batch(t, gyro, accel):
+    """
+    analyze_swing() for E events of N samples each.
+
+    t is E x N (ms), gyro and accel E x N x 3. Returns the E results.
+    analyze_swing() is this with E = 1, so a row comes out the same either
+    way; magnitudes, smoothing and the boundary walks run over all rows at
+    once, the peak pick (scipy's find_peaks has no batched form) per row.
+    """
+    t = np.asarray(t, dtype=np.float64)
+    n_events, n = t.shape
+    if n < MIN_SAMPLES:
+        return [_too_short() for _ in range(n_events)]
+
+    rates = _sample_rates(t)
+    gyro_raw = np.linalg.norm(gyro, axis=-1)
+    accel_raw = np.linalg.norm(accel, axis=-1)
+
+    gyro_mag = np.empty_like(gyro_raw)
+    accel_mag = np.empty_like(accel_raw)
+    for rate in np.unique(rates):
+        rows = rates == rate
+        gyro_mag[rows] = _smooth(gyro_raw[rows], int(rate))
+        accel_mag[rows] = _smooth(accel_raw[rows], int(rate))
+
+    best = np.full(n_events, -1)
+    for e in range(n_events):
+        peak = _dominant_peak(gyro_mag[e], int(rates[e]))
+        if peak is not None:
+            best[e] = peak
+    found = best >= 0
+    starts = np.zeros(n_events, dtype=int)
+    ends = np.zeros(n_events, dtype=int)
+    if found.any():
+        starts[found], ends[found] = _walk_boundaries(gyro_mag[found], accel_mag[found],
+                                                      best[found])
+
+    results = []
+    for e in range(n_events):
+        boundaries = (_boundary_dict(t[e], starts[e], best[e], ends[e])
+                      if found[e] else None)
+        results.append(_build_result(t[e], gyro_raw[e], gyro_mag[e], accel_mag[e],
+                                     boundaries))
+    return results
+
+
 def analyze_swing(samples):
     """
     Analyze a single swing event.
@@ -131,22 +197,19 @@ def analyze_swing(samples):
         - t_ms          : list of timestamps corresponding to magnitude arrays
         - raw_gyro_mag  : list of unfiltered gyro magnitudes
     """
-    if not samples or len(samples) < 10:
-        return {"error": "not enough samples", "phases": None}
+    if not samples or len(samples) < MIN_SAMPLES:
+        return _too_short()
 
     t, gyro, accel = _extract_arrays(samples)
+    return analyze_batch(t[None], gyro[None], accel[None])[0]
 
-    # Magnitudes
-    gyro_mag_raw = np.linalg.norm(gyro, axis=1)
-    accel_mag_raw = np.linalg.norm(accel, axis=1)
 
-    # Smooth
-    gyro_mag = _smooth(gyro_mag_raw)
-    accel_mag = _smooth(accel_mag_raw)
+def _too_short():
+    return {"error": "not enough samples", "phases": None}
 
-    # Phase detection
-    boundaries = _find_phase_boundaries(t, gyro_mag, accel_mag)
 
+def _build_result(t, gyro_mag_raw, gyro_mag, accel_mag, boundaries):
+    """analyze_swing()'s result from one event's arrays and boundaries."""
     if boundaries is None:
         return {
             "error": "no swing detected (gyro peak below threshold)",
@@ -207,6 +270,63 @@ def analyze_swing(samples):
     }
 
 
+def result_from_phase(phase):
+    """
+    Build an ``analyze_swing()``-shaped result from the racquet's own phase
+    summary (the "phase" dict of a decoded event packet).
+
+    Used when the firmware uploads the summary without raw samples, so the
+    result has no per-sample arrays and cannot be plotted.
+    """
+    peak_gyro = float(phase["peak_gyro_rad_s"])
+    if not phase["valid"]:
+        return {
+            "error": "no swing detected (gyro peak below threshold)",
+            "phases": None,
+            "peak_gyro_rad_s": peak_gyro,
+            "peak_gyro_deg_s": peak_gyro * 57.2958,
+            "source": "device",
+        }
+
+    accel_start = float(phase["accel_start_ms"])
+    peak = float(phase["peak_ms"])
+    decel_end = float(phase["decel_end_ms"])
+    gyro_at_peak = float(phase["gyro_at_peak_rad_s"])
+
+    return {
+        "phases": {
+            "preparation": {"start_ms": float(phase["t_first_ms"]), "end_ms": accel_start},
+            "acceleration": {"start_ms": accel_start, "end_ms": peak},
+            "peak": {
+                "t_ms": peak,
+                "gyro_mag_rad_s": gyro_at_peak,
+                "gyro_mag_deg_s": gyro_at_peak * 57.2958,
+                "accel_mag_m_s2": float(phase["accel_at_peak_m_s2"]),
+            },
+            "deceleration": {"start_ms": peak, "end_ms": decel_end},
+            "follow_through": {"start_ms": decel_end, "end_ms": float(phase["t_last_ms"])},
+        },
+        "peak_gyro_rad_s": peak_gyro,
+        "peak_gyro_deg_s": peak_gyro * 57.2958,
+        "peak_accel_m_s2": float(phase["peak_accel_m_s2"]),
+        "swing_duration_ms": decel_end - accel_start,
+        "boundary_indices": {
+            "accel_start": phase["accel_start_idx"],
+            "peak": phase["peak_idx"],
+            "decel_end": phase["decel_end_idx"],
+        },
+        "source": "device",
+    }
+
+
+def stroke_from_phase(phase):
+    """The racquet's stroke label as {"label", "confidence"}, or None if the
+    phase summary predates the classifier."""
+    if "stroke" not in phase:
+        return None
+    return {"label": phase["stroke"], "confidence": float(phase.get("stroke_confidence", 0.0))}
+
+
 # ── CLI quick test ─────────────────────────────────────────────────────
 if __name__ == "__main__":
     # Generate a synthetic swing for testing
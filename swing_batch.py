@@ -0,0 +1,242 @@
+"""
+Batch swing analysis over a whole session.
+
+analyze_swing() takes one event as a list of per-sample dicts, so a
+session of hundreds of swings used to be re-analyzed one dict loop at a
+time. This module reads the session's columns (session_store.py) straight
+into arrays, stacks events of the same length into 2-D blocks and hands
+each block to swing_analyzer.analyze_batch(), which runs each step of the
+analysis over a block at once:
+
+  - magnitudes and the zero-phase low-pass along the sample axis, one
+    sosfiltfilt call per block and sample rate
+  - sample rates and both phase boundary walks as row-wise array ops
+
+Only the peak pick stays per row: scipy's find_peaks has no batched form,
+and its distance/prominence rules are what the phases hang on.
+analyze_swing() is analyze_batch() on a one-row block, so the per-swing
+loop and this module run the same code and every row is computed on its
+own; results match the loop for events the racquet sent as binary packets.
+(JSON events are stored as float32 columns, so for those both paths see
+the stored values, not the original doubles.) --check and --selftest
+compare the two.
+
+With --workers N the blocks are split into chunks and analyzed in N
+processes; the arrays go through pickling either way, so this only pays
+off on long sessions.
+
+Usage:
+    from swing_batch import analyze_session
+    results = analyze_session(session)              # list, in session order
+
+    python swing_batch.py swing_data                # latest session
+    python swing_batch.py swing_data/<name> --workers 4
+    python swing_batch.py swing_data --check        # time against analyze_swing()
+    python swing_batch.py --selftest                # synthetic events, both paths
+"""
+
+import argparse
+import os
+import sys
+import time
+from concurrent.futures import ProcessPoolExecutor
+
+import numpy as np
+
+from session_store import Session, open_latest_session
+from swing_analyzer import analyze_batch, analyze_swing
+from wire_format import ACCEL_SCALE, AXES, GYRO_SCALE
+
+CHUNK_EVENTS = 64           # rows per worker job with --workers
+
+
+# ── Loading ────────────────────────────────────────────────────────────
+
+def _event_arrays(ev):
+    """One event's t (ms, wall clock), gyro and accel (N x 3) arrays, as
+    wire_format.decode_packet() would have produced them."""
+    t_us = np.frombuffer(ev.dt_us, dtype=np.uint32).astype(np.int64)
+    t_ms = (t_us + (ev.base_t_us + ev.wall_offset_us)) / 1000.0
+    raw = np.int16 if ev.itemsize == 2 else np.float32
+    axes = np.stack([np.frombuffer(ev.channel(a), dtype=raw).astype(np.float64)
+                     * ev.scale(a) for a in AXES], axis=1)
+    return t_ms, axes[:, :3], axes[:, 3:]
+
+
+def load_session(session):
+    """Events of a session stacked by sample count:
+    {count: (event indices, t (E x N), gyro (E x N x 3), accel (E x N x 3))}."""
+    session.refresh()
+    rows = {}
+    for i in range(len(session)):
+        ev = session.event(i)
+        rows.setdefault(ev.count, []).append((i, _event_arrays(ev)))
+    blocks = {}
+    for count, events in rows.items():
+        idx = np.array([i for i, _ in events])
+        t, gyro, accel = (np.stack(parts) for parts in zip(*(a for _, a in events)))
+        blocks[count] = (idx, t, gyro, accel)
+    return blocks
+
+
+# ── Analysis ───────────────────────────────────────────────────────────
+
+def _analyze_chunk(args):
+    return analyze_batch(*args)
+
+
+def analyze_session(session, workers=None):
+    """analyze_swing() of every event of a session, in session order.
+    workers > 1 spreads chunks of CHUNK_EVENTS over that many processes."""
+    blocks = load_session(session)
+    jobs = []
+    for idx, t, gyro, accel in blocks.values():
+        step = CHUNK_EVENTS if workers and workers > 1 else len(idx)
+        for lo in range(0, len(idx), step):
+            sl = slice(lo, lo + step)
+            jobs.append((idx[sl], (t[sl], gyro[sl], accel[sl])))
+
+    if workers and workers > 1:
+        with ProcessPoolExecutor(max_workers=workers) as pool:
+            outputs = pool.map(_analyze_chunk, [arrays for _, arrays in jobs])
+            chunks = list(outputs)
+    else:
+        chunks = [analyze_batch(*arrays) for _, arrays in jobs]
+
+    results = [None] * len(session)
+    for (idx, _), chunk in zip(jobs, chunks):
+        for i, result in zip(idx, chunk):
+            results[i] = result
+    return results
+
+
+# ── Benchmark ──────────────────────────────────────────────────────────
+
+def _samples(t, gyro, accel):
+    """Per-sample dicts as analyze_swing() takes them."""
+    return [{"t": float(t[i]),
+             "gyro": {"x": float(gyro[i, 0]), "y": float(gyro[i, 1]), "z": float(gyro[i, 2])},
+             "accel": {"x": float(accel[i, 0]), "y": float(accel[i, 1]),
+                       "z": float(accel[i, 2])}}
+            for i in range(len(t))]
+
+
+def check_session(session, workers=None):
+    """Time the batch path against the per-swing loop and compare results.
+    Returns (events, mismatches, loop seconds, batch seconds)."""
+    events = [_event_arrays(session.event(i)) for i in range(len(session))]
+    samples = [_samples(*arrays) for arrays in events]
+
+    t0 = time.perf_counter()
+    loop = [analyze_swing(s) for s in samples]
+    t1 = time.perf_counter()
+    batch = analyze_session(session, workers)
+    t2 = time.perf_counter()
+
+    mismatches = [i for i, (a, b) in enumerate(zip(loop, batch)) if a != b]
+    return len(loop), mismatches, t1 - t0, t2 - t1
+
+
+def _synthetic_events(rng):
+    """Q16 events (t_us, gyro, accel) of mixed lengths and sample rates, as
+    a session holds them: swings, quiet stretches, double peaks, and lengths
+    on both sides of MIN_SAMPLES and the filter's minimum."""
+    events = []
+    shapes = ([(n, 400) for n in (9, 10, 12, 14, 15, 16, 60)]
+              + [(200, 400)] * 12 + [(200, 200)] * 4 + [(200, 1000)] * 4
+              + [(500, 1000)] * 6 + [(437, 400)])
+    for n, rate in shapes:
+        step = 1_000_000 // rate
+        t_us = 5_000_000 + np.cumsum(rng.integers(step - 3, step + 4, n))
+        t_ms = np.arange(n) * (step / 1000.0)
+        gyro_peak = rng.choice([2.0, 20.0, 35.0, 60.0])
+        center = rng.uniform(0.3, 0.7) * t_ms[-1]
+        width = rng.uniform(20.0, 80.0)
+        g = gyro_peak * np.exp(-0.5 * ((t_ms - center) / width) ** 2)
+        if rng.random() < 0.3:                  # a second, smaller swing
+            g += 0.6 * gyro_peak * np.exp(-0.5 * ((t_ms - 0.2 * t_ms[-1]) / width) ** 2)
+        g += rng.normal(0.0, 0.5, n)
+        gyro = np.stack([g * 0.6, g * 0.7, g * 0.4], axis=1)
+        accel = np.stack([g * 1.5, g * 0.8, 9.8 + rng.normal(0.0, 0.5, n)], axis=1)
+        # Through the wire's int16 Q-points, as decode_packet() hands them on
+        gyro = np.clip(np.round(gyro / GYRO_SCALE), -32768, 32767) * GYRO_SCALE
+        accel = np.clip(np.round(accel / ACCEL_SCALE), -32768, 32767) * ACCEL_SCALE
+        events.append((t_us / 1000.0, gyro, accel))
+    return events
+
+
+def selftest(seed=1):
+    """analyze_batch() against analyze_swing() on synthetic events, grouped
+    by length as load_session() does. Returns (events, mismatches, loop
+    seconds, batch seconds)."""
+    events = _synthetic_events(np.random.default_rng(seed))
+    samples = [_samples(*arrays) for arrays in events]
+
+    t0 = time.perf_counter()
+    loop = [analyze_swing(s) for s in samples]
+    t1 = time.perf_counter()
+    groups = {}
+    for i, (t, gyro, accel) in enumerate(events):
+        groups.setdefault(len(t), []).append(i)
+    batch = [None] * len(events)
+    for idx in groups.values():
+        block = (np.stack([events[i][k] for i in idx]) for k in range(3))
+        for i, result in zip(idx, analyze_batch(*block)):
+            batch[i] = result
+    t2 = time.perf_counter()
+
+    mismatches = [i for i, (a, b) in enumerate(zip(loop, batch)) if a != b]
+    return len(loop), mismatches, t1 - t0, t2 - t1
+
+
+def _report(n, mismatches, loop_s, batch_s):
+    print(f"{n} events: per-swing {loop_s * 1000:.1f} ms, "
+          f"batch {batch_s * 1000:.1f} ms ({loop_s / max(batch_s, 1e-9):.1f}x)")
+    if mismatches:
+        print(f"  {len(mismatches)} results differ, first at event {mismatches[0]}")
+        return 1
+    print("  results identical")
+    return 0
+
+
+def _open(path):
+    if os.path.isdir(path):
+        return open_latest_session(path)
+    return Session(path[:-4] if path.endswith((".swd", ".swi")) else path)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("session", nargs="?",
+                        help="session base path, or a directory for its latest")
+    parser.add_argument("--workers", type=int, default=None,
+                        help="analysis processes (default: this one)")
+    parser.add_argument("--check", action="store_true",
+                        help="also run analyze_swing() per event; compare and time both")
+    parser.add_argument("--selftest", action="store_true",
+                        help="compare and time both paths on synthetic events")
+    args = parser.parse_args(argv)
+
+    if args.selftest:
+        return _report(*selftest())
+    if args.session is None:
+        parser.error("a session is needed (or --selftest)")
+
+    session = _open(args.session)
+    if session is None:
+        print(f"{args.session}: no session")
+        return 1
+
+    if args.check:
+        return _report(*check_session(session, args.workers))
+
+    t0 = time.perf_counter()
+    results = analyze_session(session, args.workers)
+    elapsed = time.perf_counter() - t0
+    swings = sum(1 for r in results if r.get("phases"))
+    print(f"{len(results)} events, {swings} swings, analyzed in {elapsed * 1000:.1f} ms")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
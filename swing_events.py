@@ -0,0 +1,106 @@
+"""
+Swing event processing, run on the ingest server's worker pool.
+
+One call takes the raw body of an event POST and does everything that used
+to happen inside the HTTP handler: decode (binary or JSON), phase analysis
+and the plot. It returns the result and the report as text instead of
+printing it, so reports from parallel workers do not interleave; the
+ingest server then appends the event to the session file (session_store.py)
+from its single writer.
+
+Usage:
+    report = process_event(body, event_number=7)
+    print(report["text"])
+"""
+
+from datetime import datetime, timezone
+
+from swing_analyzer import analyze_swing, result_from_phase, stroke_from_phase
+from swing_visualizer import plot_swing
+from wire_format import parse_payload
+
+PRINT_EVENT_DETAILS = False  # per-sample event dump (very slow)
+
+
+def _wall_str(t_ms):
+    return datetime.fromtimestamp(t_ms / 1000.0, tz=timezone.utc).strftime(
+        "%H:%M:%S.%f")[:-3]
+
+
+def process_event(body: bytes, event_number: int) -> dict:
+    """Decode, analyze and plot one event.
+
+    Returns {"device_id", "event_number", "result", "text", "plot_path"}.
+    Raises WireFormatError / ValueError for a malformed body.
+    """
+    raw = parse_payload(body)
+    samples = raw.get("samples", [])
+    device_id = raw.get("device_id", 0)
+    trigger_t = raw.get("trigger_t", 0)
+    lines = []
+    out = lines.append
+
+    out(f"\n{'='*70}")
+    out(f"  SWING EVENT #{event_number} | racquet 0x{device_id:04x} | "
+        f"{len(samples)} samples @ {raw.get('rate_hz', 400)}Hz | "
+        f"trigger at {_wall_str(trigger_t) if trigger_t else '?'}")
+
+    if samples:
+        gyro_mags = [
+            (s["gyro"]["x"]**2 + s["gyro"]["y"]**2 + s["gyro"]["z"]**2)**0.5
+            for s in samples
+        ]
+        peak_gyro = max(gyro_mags)
+        peak_idx = gyro_mags.index(peak_gyro)
+        out(f"  Duration: {samples[-1]['t'] - samples[0]['t']:.1f}ms | "
+            f"Peak gyro: {peak_gyro:.1f} rad/s ({peak_gyro * 57.3:.0f} deg/s) "
+            f"at sample {peak_idx}/{len(samples)}")
+        if PRINT_EVENT_DETAILS:
+            out(f"{'='*70}")
+            for s, gm in zip(samples, gyro_mags):
+                am = (s["accel"]["x"]**2 + s["accel"]["y"]**2 + s["accel"]["z"]**2)**0.5
+                out(f"  [{_wall_str(s['t'])}] "
+                    f"|gyro|={gm:6.1f}  "
+                    f"|accel|={am:6.1f}  "
+                    f"gyro=({s['gyro']['x']:7.2f},{s['gyro']['y']:7.2f},{s['gyro']['z']:7.2f})")
+
+    # Swing phases: the racquet segments every event itself; re-run the
+    # analysis here only when the raw samples came along
+    device_phase = raw.get("phase")
+    if samples:
+        result = analyze_swing(samples)
+        if device_phase is not None:
+            result["device_phase"] = device_phase
+            if device_phase["valid"]:
+                out(f"  On-device: peak {device_phase['peak_ms']:.0f} ms | "
+                    f"{device_phase['gyro_at_peak_rad_s'] * 57.2958:.0f} deg/s | "
+                    f"swing {device_phase['decel_end_ms'] - device_phase['accel_start_ms']:.1f} ms")
+    elif device_phase is not None:
+        result = result_from_phase(device_phase)
+    else:
+        result = analyze_swing(samples)
+    result["device_id"] = device_id
+    stroke = stroke_from_phase(device_phase) if device_phase is not None else None
+    if stroke is not None:
+        result["stroke"] = stroke
+        out(f"  Stroke: {stroke['label']} ({stroke['confidence'] * 100:.0f}%)")
+
+    if result.get("phases"):
+        phases = result["phases"]
+        out(f"  Phases:")
+        out(f"    Preparation:    {phases['preparation']['start_ms']:.0f} – {phases['preparation']['end_ms']:.0f} ms")
+        out(f"    Acceleration:   {phases['acceleration']['start_ms']:.0f} – {phases['acceleration']['end_ms']:.0f} ms")
+        out(f"    Peak:           {phases['peak']['t_ms']:.0f} ms | {phases['peak']['gyro_mag_deg_s']:.0f} deg/s")
+        out(f"    Deceleration:   {phases['deceleration']['start_ms']:.0f} – {phases['deceleration']['end_ms']:.0f} ms")
+        out(f"    Follow-through: {phases['follow_through']['start_ms']:.0f} – {phases['follow_through']['end_ms']:.0f} ms")
+        out(f"  Swing duration: {result['swing_duration_ms']:.0f} ms")
+    else:
+        out(f"  No swing detected: {result.get('error')}")
+
+    # Always generate a plot for every swing event
+    plot_path = plot_swing(result, event_number=event_number, device_id=device_id)
+    if plot_path:
+        out(f"  Plot saved: {plot_path}")
+
+    return {"device_id": device_id, "event_number": event_number, "result": result,
+            "text": "\n".join(lines), "plot_path": plot_path}
@@ -38,7 +38,7 @@ PHASE_LABELS = {
 }
 
 
-def plot_swing(result, event_number=0, out_dir=PLOT_DIR):
+def plot_swing(result, event_number=0, out_dir=PLOT_DIR, device_id=None):
     """
     Save a two-panel PNG for one swing event.
 
@@ -50,6 +50,8 @@ def plot_swing(result, event_number=0, out_dir=PLOT_DIR):
         Sequential event counter (used in filename and title).
     out_dir : str
         Directory to save PNGs into.
+    device_id : int, optional
+        Racquet that recorded the swing, shown in the title.
 
     Returns
     -------
@@ -77,6 +79,8 @@ def plot_swing(result, event_number=0, out_dir=PLOT_DIR):
         gridspec_kw={"hspace": 0.12},
     )
     title = f"Swing Event #{event_number}"
+    if device_id is not None:
+        title += f"  (racquet 0x{device_id:04x})"
     if phases is None:
         title += "  (no phases detected)"
     fig.suptitle(title, fontsize=14, fontweight="bold", y=0.97)
@@ -0,0 +1,237 @@
+"""
+Train the racquet's stroke classifier and write embedded/main/stroke_model.h.
+
+Reads a recorded session (session_store.py) and a CSV of labels, one
+"event_number,label" per line with label forehand / backhand / serve.
+Features are computed as stroke_classifier.cpp does, from the stored
+columns and the racquet's own phase boundaries, then quantized to int8 the
+way the firmware does: the scale as stroke_model.h stores it, a float32
+product and roundf()'s halves away from zero. The sums behind the features
+run in float64 here and in float32 on the racquet, so a feature within a
+rounding error of a step boundary can land one int8 step apart; otherwise
+the model is trained on what the firmware feeds it.
+
+The model is multinomial logistic regression on the quantized features
+(plain gradient descent, no dependencies), with its weights then scaled
+to int8 and the bias to int32.
+
+Usage:
+    python train_stroke_model.py swing_data/session_20260101_120000 labels.csv
+    python train_stroke_model.py swing_data labels.csv -o /tmp/stroke_model.h
+"""
+
+import argparse
+import csv
+import math
+import os
+import struct
+
+from session_store import Session, open_latest_session
+from wire_format import AXES, STROKE_LABELS
+
+MODEL_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            "embedded", "main", "stroke_model.h")
+CLASSES = STROKE_LABELS[1:]     # model outputs, "unknown" excluded
+NUM_FEATURES = 18               # STROKE_NUM_FEATURES
+FEATURE_UNITS = ["rad/s"] * 9 + ["rad"] * 3 + ["m/s^2"] * 4 + ["ms"] * 2
+EPOCHS = 2000
+LEARNING_RATE = 0.5
+L2 = 1e-3
+
+
+# ── Features (stroke_classifier.cpp) ──────────────────────────────────
+
+def _signed_extreme(x, first, last):
+    best = 0.0
+    for v in x[first:last + 1]:
+        if abs(v) > abs(best):
+            best = v
+    return best
+
+
+def event_features(ev):
+    """stroke_features() of one stored event, or None without a valid
+    device phase."""
+    phase = ev.result.get("device_phase")
+    if not phase or not phase.get("valid"):
+        return None
+    start, peak, end = phase["accel_start_idx"], phase["peak_idx"], phase["decel_end_idx"]
+    t = ev.dt_us
+    ch = {name: [v * ev.scale(name) for v in ev.channel(name)] for name in AXES}
+
+    f = [0.0] * NUM_FEATURES
+    for a, name in enumerate(AXES[:3]):
+        g = ch[name]
+        f[a] = _signed_extreme(g, 0, start)
+        f[3 + a] = _signed_extreme(g, start, peak)
+        f[6 + a] = _signed_extreme(g, peak, end)
+        f[9 + a] = sum(g[i] * (t[i] - t[i - 1]) for i in range(start + 1, end + 1)) * 1e-6
+    for a, name in enumerate(AXES[3:]):
+        f[12 + a] = sum(ch[name][:start + 1]) / (start + 1)
+    f[15] = phase["peak_accel_m_s2"]
+    f[16] = (phase["peak_us"] - phase["accel_start_us"]) * 1e-3
+    f[17] = (phase["decel_end_us"] - phase["peak_us"]) * 1e-3
+    return f
+
+
+def _f32(v):
+    return struct.unpack("<f", struct.pack("<f", v))[0]
+
+
+def _roundf(v):
+    """C roundf(): halves away from zero (Python's round() goes to even)."""
+    return int(math.copysign(math.floor(abs(v) + 0.5), v))
+
+
+def stored_scale(s):
+    """A feature scale as the firmware sees it: printed to 6 places in
+    stroke_model.h, then a float literal."""
+    return _f32(float(f"{s:.6f}"))
+
+
+def quantize(f, scales):
+    """stroke_classifier.cpp's quantize() of each feature."""
+    return [max(-127, min(127, _roundf(_f32(_f32(v) * stored_scale(s)))))
+            for v, s in zip(f, scales)]
+
+
+# ── Training ──────────────────────────────────────────────────────────
+
+def _softmax(z):
+    m = max(z)
+    e = [math.exp(v - m) for v in z]
+    s = sum(e)
+    return [v / s for v in e]
+
+
+def train(xs, ys):
+    """Logistic regression on inputs in [-1, 1]. Returns (weights, bias)."""
+    k, n = len(CLASSES), len(xs[0])
+    w = [[0.0] * n for _ in range(k)]
+    b = [0.0] * k
+    for _ in range(EPOCHS):
+        gw = [[L2 * w[c][j] for j in range(n)] for c in range(k)]
+        gb = [0.0] * k
+        for x, y in zip(xs, ys):
+            p = _softmax([b[c] + sum(wc * xj for wc, xj in zip(w[c], x)) for c in range(k)])
+            for c in range(k):
+                err = (p[c] - (1.0 if c == y else 0.0)) / len(xs)
+                gb[c] += err
+                for j in range(n):
+                    gw[c][j] += err * x[j]
+        for c in range(k):
+            b[c] -= LEARNING_RATE * gb[c]
+            for j in range(n):
+                w[c][j] -= LEARNING_RATE * gw[c][j]
+    return w, b
+
+
+# ── Export ────────────────────────────────────────────────────────────
+
+def write_header(path, scales, w, b, num_events):
+    """Fold the 1/127 input scaling into the weights and quantize them."""
+    v = [[wc / 127.0 for wc in row] for row in w]
+    k = 127.0 / max(1e-9, max(abs(x) for row in v for x in row))
+    qw = [[round(x * k) for x in row] for row in v]
+    qb = [round(x * k) for x in b]
+
+    lines = [
+        "/*",
+        " * int8 weights of the stroke classifier (stroke_classifier.h).",
+        " *",
+        f" * Generated by train_stroke_model.py from {num_events} labelled events;",
+        " * rerun it rather than editing by hand.",
+        " *",
+        " * Feature q[j] = clamp(roundf(feature[j] * stroke_feature_scale[j]), -127, 127)",
+        " * Logit of class c = (stroke_bias[c] + sum_j stroke_weights[c][j] * q[j])",
+        " *                    * STROKE_LOGIT_SCALE",
+        " */",
+        "",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        '#include "stroke_classifier.h"',
+        "",
+        "#define STROKE_MODEL_VERSION        1       // 0: hand-set prior",
+        f"#define STROKE_LOGIT_SCALE          (1.0f / {k:.4f}f)",
+        "",
+        "// Per feature: int8 steps per unit (rad/s, rad, m/s^2, ms)",
+        "static const float stroke_feature_scale[STROKE_NUM_FEATURES] = {",
+    ]
+    lines += [f"    {s:.6f}f,   // {u}" for s, u in zip(scales, FEATURE_UNITS)]
+    lines += ["};", "", f"// Rows: {', '.join(CLASSES)}",
+              "static const int8_t stroke_weights[STROKE_NUM_CLASSES][STROKE_NUM_FEATURES] = {"]
+    lines += ["    { " + ", ".join(f"{x:4d}" for x in row) + " }," for row in qw]
+    lines += ["};", "",
+              "static const int32_t stroke_bias[STROKE_NUM_CLASSES] = { "
+              + ", ".join(str(x) for x in qb) + " };", ""]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def load_labels(path):
+    labels = {}
+    with open(path, newline="") as f:
+        for row in csv.reader(f):
+            if not row or row[0].strip().startswith("#") or not row[0].strip().isdigit():
+                continue
+            label = row[1].strip().lower()
+            if label not in CLASSES:
+                raise ValueError(f"{path}: unknown label {label!r} for event {row[0]}")
+            labels[int(row[0])] = CLASSES.index(label)
+    return labels
+
+
+def labelled_features(session, labels):
+    """(features, class index) of every labelled event with a valid swing."""
+    feats, ys = [], []
+    for i in range(len(session)):
+        ev = session.event(i)
+        if ev.event_number not in labels:
+            continue
+        f = event_features(ev)
+        if f is None:
+            print(f"  event {ev.event_number}: no valid swing, skipped")
+            continue
+        feats.append(f)
+        ys.append(labels[ev.event_number])
+    return feats, ys
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    ap.add_argument("session", help="session base path, or swing_data/ for the latest")
+    ap.add_argument("labels", help="CSV of event_number,label")
+    ap.add_argument("-o", "--output", default=MODEL_HEADER)
+    args = ap.parse_args(argv)
+
+    session = (open_latest_session(args.session) if os.path.isdir(args.session)
+               else Session(args.session))
+    if session is None:
+        raise SystemExit(f"no session in {args.session}")
+    labels = load_labels(args.labels)
+
+    feats, ys = labelled_features(session, labels)
+    session.close()
+    if len(set(ys)) < 2:
+        raise SystemExit(f"need events of at least two strokes, have {len(ys)} "
+                         f"({', '.join(sorted({CLASSES[y] for y in ys}))})")
+
+    # Scale each feature so the largest value seen uses the int8 range
+    scales = [127.0 / max(1e-6, max(abs(f[j]) for f in feats)) for j in range(NUM_FEATURES)]
+    xs = [[q / 127.0 for q in quantize(f, scales)] for f in feats]
+    w, b = train(xs, ys)
+
+    correct = 0
+    for x, y in zip(xs, ys):
+        z = [b[c] + sum(wc * xj for wc, xj in zip(w[c], x)) for c in range(len(CLASSES))]
+        correct += z.index(max(z)) == y
+    counts = ", ".join(f"{c} {ys.count(i)}" for i, c in enumerate(CLASSES))
+    print(f"{len(ys)} events ({counts}), training accuracy {correct / len(ys):.0%}")
+
+    write_header(args.output, scales, w, b, len(ys))
+    print(f"Wrote {args.output}")
+
+
+if __name__ == "__main__":
+    main()
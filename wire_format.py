@@ -0,0 +1,566 @@
+"""
+Decoder for the racquet firmware's binary wire format.
+
+Mirrors embedded/main/wire_format.h. Packets are little-endian:
+
+    header (24 B) | event extension (16 B, events only)
+                  | phase summary (52 B, events flagged FLAG_PHASE) | count x sample record
+
+Decoded packets have the same shape as the firmware's JSON packets, so the
+rest of server.py does not care which format the racquet was built with:
+
+    {"type": "event", "samples": [{"t_us", "t", "gyro": {x,y,z}, "accel": {x,y,z}}],
+     "trigger_t_us": ..., "wall_offset_us": ..., "trigger_t": ...,
+     "first_seq": ..., "rate_hz": ..., "phase": {...}}
+
+"t_us" is the racquet's monotonic clock (microseconds since boot), which
+never steps. "t" is milliseconds for the analysis code: for events it is
+wall-clock time, from the offset the racquet sent with the upload; for live
+packets it is monotonic until a ClockSync (clock_sync.py) fitted from the
+sync packets maps it. Phase boundaries come as both *_us and *_ms the same
+way.
+
+"phase" is the firmware's own segmentation of the event (swing_phase.h),
+with its stroke label ("stroke": one of STROKE_LABELS, and
+"stroke_confidence", stroke_classifier.h), and is present whenever the
+racquet sent one; "samples" is empty if it was built to upload the summary
+only.
+
+Live packets may instead be delta coded (ENC_DELTA, see wire_format.h):
+a 4-byte extension with the batch's Q-points and nominal timestamp step,
+then zig-zag varint deltas per sample. They decode to the same shape.
+
+Stats packets decode to {"type": "stats", "t_us", "free_heap", ..., "tasks": [...]}
+with the same keys as the firmware's JSON stats. Profile packets, sent right
+after each stats packet, decode to {"type": "profile", "t_us", "cpu_mhz",
+"window_ms", "stages": [{"name", "count", "min_cycles", "p50_cycles",
+"p99_cycles", "max_cycles"}]}. Sync packets decode to {"type": "sync",
+"mono_us", "wall_us"}.
+
+Every packet carries the sending racquet's "device_id" (0 from firmware
+that predates it), so one server can demultiplex several racquets.
+
+Live first_seq numbers live samples consecutively; encode_nack() builds the
+retransmit request the server sends back for a gap.
+
+encode_config() builds a settings change (sample rate, trigger thresholds,
+capture window, live level, server endpoint, transport) sent the same way,
+addressed to one racquet by its device_id (the firmware ignores a config
+for device 0, "any racquet", since it persists what it applies). The
+racquet only takes control packets from its own server; it answers with a config ack, which decodes to {"type":
+"config_ack", "request_id", "status", "set", <every CONFIG_FIELDS key>}
+like the firmware's JSON one.
+
+Phase marks are the racquet's live, causal swing phases (phase_tracker.h),
+sent the moment each is recognised: {"type": "phase_mark", "t_us", "mark"
+(one of PHASE_MARKS), "swing_id", "detect_delay_us", "gyro", "accel"}, with
+"t_us" the time of the phase itself. The event that follows carries the
+accurate segmentation.
+
+Backlog packets carry what the racquet spooled to flash while it was
+offline (spool.h): {"type": "backlog", "t_us", "wall_offset_us",
+"boot_id", "records": [{"boot_id", "data"}], "corrupt"}, where each
+record's "data" is one whole packet as it would have been sent (live,
+event or sync; decode it with parse_payload) and "corrupt" counts records
+whose CRC did not match, left out. The offset maps "t_us" of records from
+the batch's own boot_id; older boots need a sync record of their own.
+"""
+
+import json
+import struct
+import zlib
+from array import array
+
+WIRE_MAGIC = 0x4353
+WIRE_VERSION = 2
+MAGIC_BYTES = struct.pack("<H", WIRE_MAGIC)
+
+PKT_LIVE = 1
+PKT_EVENT = 2
+PKT_STATS = 3
+PKT_NACK = 4
+PKT_PROFILE = 5
+PKT_SYNC = 6
+PKT_CONFIG = 7
+PKT_CONFIG_ACK = 8
+PKT_PHASE_MARK = 9
+PKT_BACKLOG = 10
+PKT_NAMES = {PKT_LIVE: "live", PKT_EVENT: "event", PKT_STATS: "stats",
+             PKT_PROFILE: "profile", PKT_SYNC: "sync", PKT_CONFIG_ACK: "config_ack",
+             PKT_PHASE_MARK: "phase_mark", PKT_BACKLOG: "backlog"}
+
+NACK_MAX_RANGES = 16
+
+# wire_config_t set bits, and the fields each one covers; a group is
+# always sent whole
+CFG_SENSOR_RATE = 0x01
+CFG_TRIGGER = 0x02
+CFG_CAPTURE = 0x04
+CFG_LIVE_LEVEL = 0x08
+CFG_SERVER = 0x10
+CFG_TRANSPORT = 0x20
+CONFIG_GROUPS = {
+    CFG_SENSOR_RATE: ("sensor_rate_hz",),
+    CFG_TRIGGER: ("gyro_on", "energy_on", "energy_off", "accel_on", "jerk_on",
+                  "debounce_ms"),
+    CFG_CAPTURE: ("pre_samples", "post_samples"),
+    CFG_LIVE_LEVEL: ("live_level",),
+    CFG_SERVER: ("server_ip", "http_port", "udp_port"),
+    CFG_TRANSPORT: ("transport",),
+}
+CONFIG_FIELDS = tuple(f for group in CONFIG_GROUPS.values() for f in group)
+CFG_OK = 0
+CFG_REJECTED = 1
+LIVE_LEVEL_AUTO = 0xFF
+TRANSPORTS = ("wifi", "espnow")     # transport_kind_t
+
+ENC_F32 = 0
+ENC_Q16 = 1
+ENC_DELTA = 2
+
+FLAG_PHASE = 0x01
+
+STROKE_LABELS = ("unknown", "forehand", "backhand", "serve")   # stroke_label_t
+PHASE_MARKS = ("unknown", "accel_start", "peak", "decel_end")   # phase_mark_kind_t
+
+GYRO_SCALE = 1.0 / (1 << 9)    # Q9 rad/s
+ACCEL_SCALE = 1.0 / (1 << 8)   # Q8 m/s^2
+
+_HEADER = struct.Struct("<HBBBBHIHHq")
+_EVENT_EXT = struct.Struct("<qq")
+_PHASE = struct.Struct("<BBHHHHHqiiii4f")
+_DELTA_EXT = struct.Struct("<bbH")
+_SAMPLE_F32 = struct.Struct("<I6f")
+_SAMPLE_Q16 = struct.Struct("<I6h")
+_STATS = struct.Struct("<8IHH5I")
+_TASK_STATS = struct.Struct("<12sII")
+_STATS_FIELDS = ("uptime_ms", "free_heap", "min_free_heap", "largest_free_block",
+                 "arena_used", "arena_size", "live_dropped", "events_dropped",
+                 "events_pending", "live_rate_hz", "live_nacked", "live_retransmitted",
+                 "live_unrecoverable", "sensor_gaps", "sensor_gap_max_us")
+_PROFILE_EXT = struct.Struct("<HHI")
+_PROFILE_STAGE = struct.Struct("<12s5I")
+_NACK_RANGE = struct.Struct("<IHH")
+_CLOCK = struct.Struct("<qq")
+_CONFIG = struct.Struct("<HBBIHHHBB5fIHH16s")
+_PHASE_MARK = struct.Struct("<BBHIff")
+_BACKLOG_EXT = struct.Struct("<qII")
+_SPOOL_RECORD = struct.Struct("<HHII")
+
+
+class WireFormatError(ValueError):
+    """Raised when a binary packet is malformed or of an unknown version."""
+
+
+def is_binary(data: bytes) -> bool:
+    """True if `data` starts with the binary wire magic."""
+    return len(data) >= 2 and data[:2] == MAGIC_BYTES
+
+
+def packet_type(data: bytes):
+    """PKT_* of a binary packet without decoding it; None for JSON."""
+    if not is_binary(data) or len(data) < _HEADER.size:
+        return None
+    return data[3]
+
+
+def decode_packet(data: bytes) -> dict:
+    """Decode one binary packet into the JSON packet shape."""
+    if len(data) < _HEADER.size:
+        raise WireFormatError(f"short packet ({len(data)} bytes)")
+
+    (magic, version, pkt_type, encoding, flags, count,
+     first_seq, rate_hz, device_id, base_t) = _HEADER.unpack_from(data, 0)
+    if magic != WIRE_MAGIC:
+        raise WireFormatError(f"bad magic 0x{magic:04x}")
+    if version != WIRE_VERSION:
+        raise WireFormatError(f"unsupported wire version {version}")
+    if pkt_type not in PKT_NAMES:
+        raise WireFormatError(f"unknown packet type {pkt_type}")
+
+    offset = _HEADER.size
+    if pkt_type == PKT_STATS:
+        packet = _decode_stats(data, offset, count, base_t)
+    elif pkt_type == PKT_PROFILE:
+        packet = _decode_profile(data, offset, count, base_t)
+    elif pkt_type == PKT_SYNC:
+        if len(data) < offset + _CLOCK.size:
+            raise WireFormatError("truncated sync packet")
+        mono_us, wall_us = _CLOCK.unpack_from(data, offset)
+        packet = {"type": "sync", "mono_us": mono_us, "wall_us": wall_us}
+    elif pkt_type == PKT_CONFIG_ACK:
+        packet = _decode_config(data, offset, base_t)
+    elif pkt_type == PKT_PHASE_MARK:
+        packet = _decode_phase_mark(data, offset, base_t)
+    elif pkt_type == PKT_BACKLOG:
+        packet = _decode_backlog(data, offset, count, base_t)
+    else:
+        packet = _decode_samples(data, offset, pkt_type, encoding, flags, count,
+                                 first_seq, rate_hz, base_t)
+    packet["device_id"] = device_id
+    return packet
+
+
+def _decode_samples(data, offset, pkt_type, encoding, flags, count, first_seq,
+                    rate_hz, base_t):
+    """Body of a live or event packet, after the header."""
+
+    trigger_t = 0
+    wall_offset = 0
+    phase = None
+    if pkt_type == PKT_EVENT:
+        if len(data) < offset + _EVENT_EXT.size:
+            raise WireFormatError("truncated event extension")
+        trigger_t, wall_offset = _EVENT_EXT.unpack_from(data, offset)
+        offset += _EVENT_EXT.size
+        if flags & FLAG_PHASE:
+            if len(data) < offset + _PHASE.size:
+                raise WireFormatError("truncated phase summary")
+            phase = _decode_phase(data, offset)
+            offset += _PHASE.size
+
+    if encoding == ENC_DELTA:
+        samples = _decode_delta(data, offset, count, base_t)
+        rec = None
+    elif encoding == ENC_Q16:
+        rec, gs, as_ = _SAMPLE_Q16, GYRO_SCALE, ACCEL_SCALE
+    elif encoding == ENC_F32:
+        rec, gs, as_ = _SAMPLE_F32, 1.0, 1.0
+    else:
+        raise WireFormatError(f"unknown sample encoding {encoding}")
+
+    if rec is not None:
+        if len(data) < offset + count * rec.size:
+            raise WireFormatError(
+                f"truncated packet: {count} samples need {offset + count * rec.size} "
+                f"bytes, got {len(data)}")
+
+        samples = []
+        for dt, gx, gy, gz, ax, ay, az in rec.iter_unpack(
+                data[offset:offset + count * rec.size]):
+            samples.append({
+                "t_us": base_t + dt,
+                "gyro": {"x": gx * gs, "y": gy * gs, "z": gz * gs},
+                "accel": {"x": ax * as_, "y": ay * as_, "z": az * as_},
+            })
+
+    packet = {
+        "type": PKT_NAMES[pkt_type],
+        "samples": samples,
+        "first_seq": first_seq,
+        "rate_hz": rate_hz,
+    }
+    if pkt_type == PKT_EVENT:
+        packet["trigger_t_us"] = trigger_t
+        packet["wall_offset_us"] = wall_offset
+        if phase is not None:
+            packet["phase"] = phase
+    return _add_ms_times(packet)
+
+
+_PHASE_TIMES = ("t_first", "accel_start", "peak", "decel_end", "t_last")
+
+
+def _add_ms_times(packet: dict) -> dict:
+    """Fill the millisecond "t" / "trigger_t" / phase *_ms views of the
+    packet's monotonic microsecond times (events on the wall clock)."""
+    if not isinstance(packet, dict):
+        return packet
+    offset = packet.get("wall_offset_us", 0) if packet.get("type") == "event" else 0
+    for s in packet.get("samples", ()):
+        if "t_us" in s:
+            s["t"] = (s["t_us"] + offset) / 1000.0
+    if "trigger_t_us" in packet:
+        packet["trigger_t"] = (packet["trigger_t_us"] + offset) / 1000.0
+    phase = packet.get("phase")
+    if phase is not None:
+        for name in _PHASE_TIMES:
+            if name + "_us" in phase:
+                phase[name + "_ms"] = (phase[name + "_us"] + offset) / 1000.0
+    return packet
+
+
+def _read_varint(data: bytes, pos: int):
+    """Decode one zig-zag LEB128 varint; returns (value, next_pos)."""
+    z = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise WireFormatError("truncated varint")
+        b = data[pos]
+        pos += 1
+        z |= (b & 0x7F) << shift
+        if not b & 0x80:
+            break
+        shift += 7
+        if shift > 35:
+            raise WireFormatError("varint too long")
+    return (z >> 1) ^ -(z & 1), pos
+
+
+def _decode_delta(data: bytes, offset: int, count: int, base_t: int) -> list:
+    if len(data) < offset + _DELTA_EXT.size:
+        raise WireFormatError("truncated delta extension")
+    gyro_q, accel_q, step_us = _DELTA_EXT.unpack_from(data, offset)
+    gs = 2.0 ** -gyro_q
+    as_ = 2.0 ** -accel_q
+    pos = offset + _DELTA_EXT.size
+
+    samples = []
+    t = base_t
+    vals = [0] * 6
+    for i in range(count):
+        dt, pos = _read_varint(data, pos)
+        if i > 0:
+            t += step_us + dt
+        for a in range(6):
+            d, pos = _read_varint(data, pos)
+            vals[a] += d
+        gx, gy, gz, ax, ay, az = vals
+        samples.append({
+            "t_us": t,
+            "gyro": {"x": gx * gs, "y": gy * gs, "z": gz * gs},
+            "accel": {"x": ax * as_, "y": ay * as_, "z": az * as_},
+        })
+    return samples
+
+
+def _decode_phase(data: bytes, offset: int) -> dict:
+    (valid, stroke, num_samples, accel_start_idx, peak_idx, decel_end_idx, stroke_pm,
+     t_first, accel_start_dt, peak_dt, decel_end_dt, t_last_dt,
+     peak_gyro, peak_accel, gyro_at_peak, accel_at_peak) = _PHASE.unpack_from(data, offset)
+    return {
+        "valid": bool(valid),
+        "num_samples": num_samples,
+        "accel_start_idx": accel_start_idx,
+        "peak_idx": peak_idx,
+        "decel_end_idx": decel_end_idx,
+        "t_first_us": t_first,
+        "accel_start_us": t_first + accel_start_dt,
+        "peak_us": t_first + peak_dt,
+        "decel_end_us": t_first + decel_end_dt,
+        "t_last_us": t_first + t_last_dt,
+        "peak_gyro_rad_s": peak_gyro,
+        "peak_accel_m_s2": peak_accel,
+        "gyro_at_peak_rad_s": gyro_at_peak,
+        "accel_at_peak_m_s2": accel_at_peak,
+        "stroke": STROKE_LABELS[stroke] if stroke < len(STROKE_LABELS) else "unknown",
+        "stroke_confidence": stroke_pm / 1000.0,
+    }
+
+
+def _decode_phase_mark(data: bytes, offset: int, t: int) -> dict:
+    if len(data) < offset + _PHASE_MARK.size:
+        raise WireFormatError("truncated phase mark packet")
+    kind, _, swing_id, delay_us, gyro, accel = _PHASE_MARK.unpack_from(data, offset)
+    return {"type": "phase_mark", "t_us": t,
+            "mark": PHASE_MARKS[kind] if kind < len(PHASE_MARKS) else "unknown",
+            "swing_id": swing_id, "detect_delay_us": delay_us, "gyro": gyro,
+            "accel": accel}
+
+
+def _decode_backlog(data: bytes, offset: int, count: int, t: int) -> dict:
+    if len(data) < offset + _BACKLOG_EXT.size:
+        raise WireFormatError("truncated backlog extension")
+    wall_offset, boot_id, _ = _BACKLOG_EXT.unpack_from(data, offset)
+    offset += _BACKLOG_EXT.size
+    records = []
+    corrupt = 0
+    for _ in range(count):
+        if len(data) < offset + _SPOOL_RECORD.size:
+            raise WireFormatError("truncated backlog record header")
+        length, _, rec_boot, crc = _SPOOL_RECORD.unpack_from(data, offset)
+        offset += _SPOOL_RECORD.size
+        if len(data) < offset + length:
+            raise WireFormatError(f"truncated backlog record ({length} bytes)")
+        body = bytes(data[offset:offset + length])
+        offset += length
+        if zlib.crc32(body) != crc:
+            corrupt += 1
+            continue
+        records.append({"boot_id": rec_boot, "data": body})
+    return {"type": "backlog", "t_us": t, "wall_offset_us": wall_offset,
+            "boot_id": boot_id, "records": records, "corrupt": corrupt}
+
+
+def _decode_stats(data: bytes, offset: int, num_tasks: int, t: int) -> dict:
+    if len(data) < offset + _STATS.size + num_tasks * _TASK_STATS.size:
+        raise WireFormatError("truncated stats packet")
+    values = _STATS.unpack_from(data, offset)
+    stats = {"type": "stats", "t_us": t}
+    stats.update((k, v) for k, v in zip(_STATS_FIELDS, values) if k is not None)
+    offset += _STATS.size
+    stats["tasks"] = [
+        {"name": name.rstrip(b"\0").decode("ascii", "replace"),
+         "stack_size": size, "stack_min_free": min_free}
+        for name, size, min_free in _TASK_STATS.iter_unpack(
+            data[offset:offset + num_tasks * _TASK_STATS.size])
+    ]
+    return stats
+
+
+def _decode_profile(data: bytes, offset: int, num_stages: int, t: int) -> dict:
+    if len(data) < offset + _PROFILE_EXT.size + num_stages * _PROFILE_STAGE.size:
+        raise WireFormatError("truncated profile packet")
+    cpu_mhz, _reserved, window_ms = _PROFILE_EXT.unpack_from(data, offset)
+    offset += _PROFILE_EXT.size
+    stages = [
+        {"name": name.rstrip(b"\0").decode("ascii", "replace"), "count": count,
+         "min_cycles": lo, "p50_cycles": p50, "p99_cycles": p99, "max_cycles": hi}
+        for name, count, lo, p50, p99, hi in _PROFILE_STAGE.iter_unpack(
+            data[offset:offset + num_stages * _PROFILE_STAGE.size])
+    ]
+    return {"type": "profile", "t_us": t, "cpu_mhz": cpu_mhz, "window_ms": window_ms,
+            "stages": stages}
+
+
+AXES = ("gyro_x", "gyro_y", "gyro_z", "accel_x", "accel_y", "accel_z")
+
+
+def _decode_config(data: bytes, offset: int, t: int) -> dict:
+    if len(data) < offset + _CONFIG.size:
+        raise WireFormatError("truncated config packet")
+    (request_id, status, transport, set_mask, rate, pre, post, live_level, _,
+     gyro_on, energy_on, energy_off, accel_on, jerk_on, debounce_ms,
+     http_port, udp_port, server_ip) = _CONFIG.unpack_from(data, offset)
+    return {"type": "config_ack", "t_us": t, "request_id": request_id,
+            "status": status, "set": set_mask, "transport": transport,
+            "sensor_rate_hz": rate, "pre_samples": pre, "post_samples": post,
+            "live_level": live_level, "gyro_on": gyro_on, "energy_on": energy_on,
+            "energy_off": energy_off, "accel_on": accel_on, "jerk_on": jerk_on,
+            "debounce_ms": debounce_ms,
+            "server_ip": server_ip.split(b"\0", 1)[0].decode("ascii", "replace"),
+            "http_port": http_port, "udp_port": udp_port}
+
+
+def decode_event_columns(data: bytes) -> dict:
+    """Per-channel columns of a binary event packet, for session_store.
+
+    Unlike decode_packet this builds no per-sample dicts: each column is
+    sliced straight out of the packet's records and keeps the record's own
+    type (int16 Q-points for ENC_Q16, float32 for ENC_F32), with "scales"
+    giving the gyro and accel factors to physical units. Returns
+    {"device_id", "rate_hz", "encoding", "base_t_us", "trigger_t_us",
+    "wall_offset_us", "phase", "dt_us": array('I'), "axes": [6 x array],
+    "scales": (gyro, accel)}.
+    """
+    (magic, version, pkt_type, encoding, flags, count,
+     _first_seq, rate_hz, device_id, base_t) = _HEADER.unpack_from(data, 0)
+    if magic != WIRE_MAGIC or version != WIRE_VERSION or pkt_type != PKT_EVENT:
+        raise WireFormatError("not a binary event packet")
+    if encoding == ENC_Q16:
+        rec, code, scales = _SAMPLE_Q16, "h", (GYRO_SCALE, ACCEL_SCALE)
+    elif encoding == ENC_F32:
+        rec, code, scales = _SAMPLE_F32, "f", (1.0, 1.0)
+    else:
+        raise WireFormatError(f"unknown sample encoding {encoding}")
+
+    offset = _HEADER.size
+    if len(data) < offset + _EVENT_EXT.size:
+        raise WireFormatError("truncated event extension")
+    trigger_t, wall_offset = _EVENT_EXT.unpack_from(data, offset)
+    offset += _EVENT_EXT.size
+    phase = None
+    if flags & FLAG_PHASE:
+        if len(data) < offset + _PHASE.size:
+            raise WireFormatError("truncated phase summary")
+        phase = _decode_phase(data, offset)
+        offset += _PHASE.size
+    end = offset + count * rec.size
+    if len(data) < end:
+        raise WireFormatError("truncated packet")
+
+    # Records are dt (u32) then six values; stride through them per channel
+    records = memoryview(data)[offset:end]
+    words = records.cast(code)
+    per_rec = rec.size // words.itemsize
+    first = 4 // words.itemsize
+    dt_us = array("I", records.cast("I")[0::rec.size // 4]) if count else array("I")
+    axes = [array(code, words[first + a::per_rec]) for a in range(6)]
+
+    return {"device_id": device_id, "rate_hz": rate_hz, "encoding": encoding,
+            "base_t_us": base_t, "trigger_t_us": trigger_t,
+            "wall_offset_us": wall_offset, "phase": phase, "dt_us": dt_us,
+            "axes": axes, "scales": scales}
+
+
+def encode_nack(ranges, device_id=0) -> bytes:
+    """Build a NACK packet asking for live samples again.
+
+    `ranges` is a list of (first_seq, count); at most NACK_MAX_RANGES are sent
+    and counts are capped at 65535. A racquet ignores NACKs addressed to
+    another device_id (0 addresses any).
+    """
+    ranges = list(ranges)[:NACK_MAX_RANGES]
+    out = bytearray(_HEADER.pack(WIRE_MAGIC, WIRE_VERSION, PKT_NACK, 0, 0,
+                                 len(ranges), 0, 0, device_id, 0))
+    for first, count in ranges:
+        out += _NACK_RANGE.pack(first & 0xFFFFFFFF, min(count, 0xFFFF), 0)
+    return bytes(out)
+
+
+def encode_config(settings: dict, request_id: int, device_id: int, base=None) -> bytes:
+    """Build a config request changing the CONFIG_FIELDS keys in `settings`.
+
+    Only the groups (CONFIG_GROUPS) that `settings` touches are applied; the
+    rest of a touched group comes from `base`, the racquet's last config ack,
+    and a group that is still incomplete raises ValueError. An empty
+    `settings` just asks for the current config. "live_level" may be "auto",
+    "transport" a TRANSPORTS name.
+    """
+    if not device_id:
+        raise ValueError("a config request needs the racquet's device_id")
+    unknown = set(settings) - set(CONFIG_FIELDS)
+    if unknown:
+        raise ValueError(f"unknown config fields: {', '.join(sorted(unknown))}")
+    values = dict.fromkeys(CONFIG_FIELDS, 0)
+    values["server_ip"] = ""
+    set_mask = 0
+    for bit, fields in CONFIG_GROUPS.items():
+        if not any(f in settings for f in fields):
+            continue
+        for f in fields:
+            if f in settings:
+                values[f] = settings[f]
+            elif base is not None and f in base:
+                values[f] = base[f]
+            else:
+                raise ValueError(f"{f} is needed with {', '.join(fields)}")
+        set_mask |= bit
+    if values["live_level"] == "auto":
+        values["live_level"] = LIVE_LEVEL_AUTO
+    if values["transport"] in TRANSPORTS:
+        values["transport"] = TRANSPORTS.index(values["transport"])
+    try:
+        body = _CONFIG.pack(
+            request_id & 0xFFFF, 0, int(values["transport"]), set_mask,
+            int(values["sensor_rate_hz"]), int(values["pre_samples"]),
+            int(values["post_samples"]), int(values["live_level"]), 0,
+            float(values["gyro_on"]), float(values["energy_on"]),
+            float(values["energy_off"]), float(values["accel_on"]),
+            float(values["jerk_on"]), int(values["debounce_ms"]),
+            int(values["http_port"]), int(values["udp_port"]),
+            str(values["server_ip"]).encode("ascii")[:15])
+    except (struct.error, TypeError, UnicodeEncodeError) as e:
+        raise ValueError(f"bad config value: {e}")
+    header = _HEADER.pack(WIRE_MAGIC, WIRE_VERSION, PKT_CONFIG, 0, 0, 0, 0, 0,
+                          device_id, 0)
+    return header + body
+
+
+def set_event_wall_offset(data: bytes, wall_offset_us: int) -> bytes:
+    """An event packet (binary or JSON) with its wall clock offset replaced,
+    for spooled events whose boot's offset is only known at upload."""
+    if is_binary(data):
+        at = _HEADER.size + 8
+        return data[:at] + struct.pack("<q", wall_offset_us) + data[at + 8:]
+    packet = json.loads(data)
+    packet["wall_offset_us"] = wall_offset_us
+    return json.dumps(packet).encode()
+
+
+def parse_payload(data: bytes):
+    """Decode a packet body that is either binary wire format or JSON."""
+    if is_binary(data):
+        return decode_packet(data)
+    return _add_ms_times(json.loads(data))